@@ -1,4 +1,5 @@
 #include "animation.h"
+#include "bench.h"
 #include "globalconf.h"
 #include "luaa.h"
 #include <stdlib.h>
@@ -243,6 +244,9 @@ animation_tick_all(void)
 
 		/* Call tick(eased_progress) */
 		lua_rawgeti(L, LUA_REGISTRYINDEX, anim->tick_ref);
+#ifdef SOMEWM_BENCH
+		int alloc_depth = bench_alloc_enter_function(L, BENCH_ALLOC_ANIMATION);
+#endif
 		lua_pushnumber(L, eased);
 		if (lua_pcall(L, 1, 0, 0) != 0) {
 			fprintf(stderr, "animation tick error: %s\n", lua_tostring(L, -1));
@@ -264,6 +268,9 @@ animation_tick_all(void)
 			animation_nil_handle(L, anim);
 			animation_destroy(anim);
 		}
+#ifdef SOMEWM_BENCH
+		bench_alloc_leave(alloc_depth);
+#endif
 	}
 
 	if (wl_list_empty(&animations))
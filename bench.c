@@ -2,7 +2,10 @@
 
 #ifdef SOMEWM_BENCH
 
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <lua.h>
 #include <wlr/types/wlr_scene.h>
 
 /* --- Shared stats computation --- */
@@ -100,6 +103,7 @@ const char *bench_stage_names[BENCH_STAGE_COUNT] = {
     "banning",
     "stack",
     "destroy",
+    "gc",
 };
 
 static uint64_t bench_stage_times_ns[BENCH_STAGE_COUNT][BENCH_FRAME_HISTORY];
@@ -201,6 +205,7 @@ bench_record_frame_time(uint64_t elapsed_ns)
 
     bench_crossings_frame_end();
     bench_stage_frame_end();
+    bench_x11_frame_end();
 }
 
 /* --- Input-to-display latency --- */
@@ -229,7 +234,7 @@ bench_input_event_record(void)
 }
 
 void
-bench_input_commit_flush(void)
+bench_input_commit_flush(uint64_t display_ns)
 {
     if (bench_input_head == bench_input_tail)
         return;  /* No pending inputs */
@@ -237,6 +242,8 @@ bench_input_commit_flush(void)
     struct timespec ts;
     clock_gettime(CLOCK_MONOTONIC, &ts);
     uint64_t now = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    if (display_ns > now)
+        now = display_ns;
 
     uint64_t max_latency = 0;
     while (bench_input_tail != bench_input_head) {
@@ -376,6 +383,537 @@ bench_render_reset(void)
     bench_render_count = 0;
 }
 
+/* --- Per-output frame timing --- */
+
+#define BENCH_OUTPUT_HISTORY 256
+
+typedef struct {
+    char name[32];
+    uint64_t frames;
+    uint64_t presented;
+    uint64_t late;
+    uint64_t resize_waits;
+    uint64_t fence_timeouts;
+    uint64_t deferred;
+    uint64_t missed;
+    uint64_t deferred_min_ns, deferred_max_ns;
+    uint64_t period_ns;
+    uint64_t last_frame_ns;
+    uint64_t render_ns[BENCH_OUTPUT_HISTORY];
+    uint64_t interval_ns[BENCH_OUTPUT_HISTORY];
+    int render_index, render_count;
+    int interval_index, interval_count;
+} bench_output_t;
+
+static bench_output_t bench_outputs[BENCH_OUTPUTS_MAX];
+static int bench_output_count;
+
+static bench_output_t *
+bench_output_find(const char *name)
+{
+    for (int i = 0; i < bench_output_count; i++)
+        if (strcmp(bench_outputs[i].name, name) == 0)
+            return &bench_outputs[i];
+    if (bench_output_count == BENCH_OUTPUTS_MAX)
+        return NULL;
+
+    bench_output_t *o = &bench_outputs[bench_output_count++];
+    memset(o, 0, sizeof(*o));
+    snprintf(o->name, sizeof(o->name), "%s", name);
+    return o;
+}
+
+void
+bench_output_frame(const char *name, int refresh_mhz,
+                   uint64_t render_ns, bool presented)
+{
+    bench_output_t *o = bench_output_find(name);
+    struct timespec ts;
+    uint64_t now;
+
+    if (!o)
+        return;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    now = (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+    o->period_ns = refresh_mhz > 0 ? 1000000000000ULL / (uint64_t)refresh_mhz : 0;
+
+    /* Frame events stop while nothing is damaged; only back-to-back
+     * frames (within a few periods) say anything about pacing */
+    if (o->last_frame_ns && o->period_ns
+            && now - o->last_frame_ns < o->period_ns * 4) {
+        uint64_t interval = now - o->last_frame_ns;
+        o->interval_ns[o->interval_index] = interval;
+        o->interval_index = (o->interval_index + 1) % BENCH_OUTPUT_HISTORY;
+        o->interval_count++;
+        if (interval * 2 > o->period_ns * 3)
+            o->late++;
+    }
+    o->last_frame_ns = now;
+
+    o->frames++;
+    if (presented) {
+        o->presented++;
+        o->render_ns[o->render_index] = render_ns;
+        o->render_index = (o->render_index + 1) % BENCH_OUTPUT_HISTORY;
+        o->render_count++;
+    }
+}
+
+void
+bench_output_resize_wait(const char *name, bool timed_out)
+{
+    bench_output_t *o = bench_output_find(name);
+
+    if (!o)
+        return;
+    if (timed_out)
+        o->fence_timeouts++;
+    else
+        o->resize_waits++;
+}
+
+void
+bench_output_deferred(const char *name, bool missed, uint64_t render_ns)
+{
+    bench_output_t *o = bench_output_find(name);
+
+    if (!o)
+        return;
+    if (!o->deferred || render_ns < o->deferred_min_ns)
+        o->deferred_min_ns = render_ns;
+    if (render_ns > o->deferred_max_ns)
+        o->deferred_max_ns = render_ns;
+    o->deferred++;
+    if (missed)
+        o->missed++;
+}
+
+int
+bench_output_stats_count(void)
+{
+    return bench_output_count;
+}
+
+void
+bench_output_stats_get(int i, bench_output_stats_t *stats)
+{
+    bench_output_t *o = &bench_outputs[i];
+    uint64_t unused;
+    int n;
+
+    stats->name = o->name;
+    stats->frames = o->frames;
+    stats->presented = o->presented;
+    stats->late = o->late;
+    stats->resize_waits = o->resize_waits;
+    stats->fence_timeouts = o->fence_timeouts;
+    stats->deferred = o->deferred;
+    stats->missed = o->missed;
+    stats->deferred_min_ns = o->deferred_min_ns;
+    stats->deferred_max_ns = o->deferred_max_ns;
+    stats->period_ns = o->period_ns;
+
+    n = o->render_count < BENCH_OUTPUT_HISTORY ? o->render_count : BENCH_OUTPUT_HISTORY;
+    bench_compute_stats(o->render_ns, n, &stats->render_min_ns, &stats->render_max_ns,
+                        &stats->render_avg_ns, &stats->render_p99_ns);
+    n = o->interval_count < BENCH_OUTPUT_HISTORY ? o->interval_count : BENCH_OUTPUT_HISTORY;
+    bench_compute_stats(o->interval_ns, n, &unused, &stats->interval_max_ns,
+                        &stats->interval_avg_ns, &stats->interval_p99_ns);
+}
+
+void
+bench_output_reset(void)
+{
+    /* Keep the slots (and names) so outputs keep their order */
+    for (int i = 0; i < bench_output_count; i++) {
+        bench_output_t *o = &bench_outputs[i];
+        o->frames = o->presented = o->late = 0;
+        o->resize_waits = o->fence_timeouts = 0;
+        o->deferred = o->missed = 0;
+        o->deferred_min_ns = o->deferred_max_ns = 0;
+        o->last_frame_ns = 0;
+        o->render_index = o->render_count = 0;
+        o->interval_index = o->interval_count = 0;
+    }
+}
+
+/* --- Client title/app_id updates --- */
+
+static uint64_t bench_prop_counts[BENCH_PROP_COUNT];
+
+void
+bench_prop_update(bench_prop_t what)
+{
+    bench_prop_counts[what]++;
+}
+
+uint64_t
+bench_prop_count(bench_prop_t what)
+{
+    return bench_prop_counts[what];
+}
+
+void
+bench_prop_reset(void)
+{
+    memset(bench_prop_counts, 0, sizeof(bench_prop_counts));
+}
+
+/* --- XWayland property writes --- */
+
+static uint64_t bench_x11_counts[BENCH_X11_COUNT];
+static uint64_t bench_x11_sent_this_frame = 0;
+static uint64_t bench_x11_per_frame[BENCH_FRAME_HISTORY];
+static int bench_x11_index = 0;
+static int bench_x11_frames = 0;
+
+void
+bench_x11_update(bench_x11_t what)
+{
+    bench_x11_counts[what]++;
+    if (what == BENCH_X11_SENT)
+        bench_x11_sent_this_frame++;
+}
+
+uint64_t
+bench_x11_count(bench_x11_t what)
+{
+    return bench_x11_counts[what];
+}
+
+static void
+bench_x11_frame_end(void)
+{
+    bench_x11_per_frame[bench_x11_index] = bench_x11_sent_this_frame;
+    bench_x11_index = (bench_x11_index + 1) % BENCH_FRAME_HISTORY;
+    bench_x11_frames++;
+    bench_x11_sent_this_frame = 0;
+}
+
+void
+bench_x11_stats_get(double *avg, uint64_t *max)
+{
+    if (bench_x11_frames == 0) {
+        *avg = 0;
+        *max = 0;
+        return;
+    }
+
+    int n = bench_x11_frames < BENCH_FRAME_HISTORY
+          ? bench_x11_frames : BENCH_FRAME_HISTORY;
+    uint64_t sum = 0;
+    uint64_t mx = 0;
+    for (int i = 0; i < n; i++) {
+        sum += bench_x11_per_frame[i];
+        if (bench_x11_per_frame[i] > mx)
+            mx = bench_x11_per_frame[i];
+    }
+    *avg = (double)sum / n;
+    *max = mx;
+}
+
+void
+bench_x11_reset(void)
+{
+    memset(bench_x11_counts, 0, sizeof(bench_x11_counts));
+    bench_x11_sent_this_frame = 0;
+    bench_x11_index = 0;
+    bench_x11_frames = 0;
+}
+
+/* --- Spawn-to-exec latency --- */
+
+static uint64_t bench_spawn_times_ns[BENCH_FRAME_HISTORY];
+static int bench_spawn_index = 0;
+static int bench_spawn_count = 0;
+
+void
+bench_spawn_record(uint64_t elapsed_ns)
+{
+    bench_spawn_times_ns[bench_spawn_index] = elapsed_ns;
+    bench_spawn_index = (bench_spawn_index + 1) % BENCH_FRAME_HISTORY;
+    bench_spawn_count++;
+}
+
+void
+bench_spawn_stats_get(uint64_t *count, uint64_t *min_ns, uint64_t *max_ns,
+                      uint64_t *avg_ns, uint64_t *p99_ns)
+{
+    *count = bench_spawn_count;
+    int n = bench_spawn_count < BENCH_FRAME_HISTORY
+          ? bench_spawn_count : BENCH_FRAME_HISTORY;
+    bench_compute_stats(bench_spawn_times_ns, n, min_ns, max_ns, avg_ns, p99_ns);
+}
+
+void
+bench_spawn_reset(void)
+{
+    bench_spawn_index = 0;
+    bench_spawn_count = 0;
+}
+
+/* --- Lua allocation accounting --- */
+
+#define BENCH_ALLOC_SITES 256
+#define BENCH_ALLOC_PROBES 16
+#define BENCH_ALLOC_DEPTH 32
+
+typedef struct {
+    bool used;
+    bench_alloc_kind_t kind;
+    char name[BENCH_ALLOC_NAME_MAX];
+    uint64_t calls;
+    uint64_t allocs;
+    uint64_t alloc_bytes;
+    uint64_t free_bytes;
+} bench_alloc_site_t;
+
+/* The allocator of the state we wrap; lives as long as the state */
+typedef struct {
+    lua_Alloc f;
+    void *ud;
+} bench_alloc_chain_t;
+
+const char *bench_alloc_kind_names[BENCH_ALLOC_KIND_COUNT] = {
+    "other",
+    "signal",
+    "queue",
+    "animation",
+    "ipc",
+    "timer",
+};
+
+static bench_alloc_site_t bench_alloc_sites[BENCH_ALLOC_SITES];
+/* Per kind, for entries that found no free site */
+static bench_alloc_site_t bench_alloc_unnamed[BENCH_ALLOC_KIND_COUNT];
+static bench_alloc_site_t *bench_alloc_stack[BENCH_ALLOC_DEPTH];
+static int bench_alloc_depth = 0;
+static uint64_t bench_alloc_reset_ns = 0;
+
+static uint64_t
+bench_alloc_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void *
+bench_alloc_f(void *ud, void *ptr, size_t osize, size_t nsize)
+{
+    bench_alloc_chain_t *chain = ud;
+    bench_alloc_site_t *site;
+    void *ret = chain->f(chain->ud, ptr, osize, nsize);
+    /* With ptr NULL, osize is the object type (5.2+), not a size */
+    size_t old = ptr ? osize : 0;
+
+    if (nsize > 0 && !ret)
+        return ret;
+
+    if (bench_alloc_depth == 0)
+        site = &bench_alloc_unnamed[BENCH_ALLOC_OTHER];
+    else if (bench_alloc_depth <= BENCH_ALLOC_DEPTH)
+        site = bench_alloc_stack[bench_alloc_depth - 1];
+    else
+        site = bench_alloc_stack[BENCH_ALLOC_DEPTH - 1];
+
+    if (!ptr && nsize > 0)
+        site->allocs++;
+    if (nsize > old)
+        site->alloc_bytes += nsize - old;
+    else
+        site->free_bytes += old - nsize;
+
+    return ret;
+}
+
+void
+bench_alloc_install(lua_State *L)
+{
+    bench_alloc_chain_t *chain = malloc(sizeof(*chain));
+
+    if (!chain)
+        return;
+    chain->f = lua_getallocf(L, &chain->ud);
+    lua_setallocf(L, bench_alloc_f, chain);
+
+    if (!bench_alloc_reset_ns)
+        bench_alloc_reset_ns = bench_alloc_now_ns();
+}
+
+void
+bench_alloc_uninstall(lua_State *L)
+{
+    void *ud;
+    bench_alloc_chain_t *chain;
+
+    if (lua_getallocf(L, &ud) != bench_alloc_f)
+        return;
+    chain = ud;
+    lua_setallocf(L, chain->f, chain->ud);
+    free(chain);
+}
+
+static bench_alloc_site_t *
+bench_alloc_site(bench_alloc_kind_t kind, const char *name)
+{
+    char key[BENCH_ALLOC_NAME_MAX];
+    uint32_t hash = 2166136261u ^ (uint32_t)kind;
+
+    if (!name)
+        return &bench_alloc_unnamed[kind];
+
+    snprintf(key, sizeof(key), "%s", name);
+    for (const char *c = key; *c; c++)
+        hash = (hash ^ (uint8_t)*c) * 16777619u;
+
+    for (int i = 0; i < BENCH_ALLOC_PROBES; i++) {
+        bench_alloc_site_t *site = &bench_alloc_sites[(hash + i) % BENCH_ALLOC_SITES];
+
+        if (!site->used) {
+            site->used = true;
+            site->kind = kind;
+            memcpy(site->name, key, sizeof(key));
+            return site;
+        }
+        if (site->kind == kind && strcmp(site->name, key) == 0)
+            return site;
+    }
+
+    return &bench_alloc_unnamed[kind];
+}
+
+int
+bench_alloc_enter(bench_alloc_kind_t kind, const char *name)
+{
+    bench_alloc_site_t *site = bench_alloc_site(kind, name);
+    int depth = bench_alloc_depth;
+
+    site->calls++;
+    /* Past the maximum depth, the deepest tracked entry keeps the bytes */
+    if (bench_alloc_depth < BENCH_ALLOC_DEPTH)
+        bench_alloc_stack[bench_alloc_depth] = site;
+    bench_alloc_depth++;
+
+    return depth;
+}
+
+void
+bench_alloc_leave(int depth)
+{
+    if (depth >= 0 && depth < bench_alloc_depth)
+        bench_alloc_depth = depth;
+}
+
+int
+bench_alloc_enter_function(lua_State *L, bench_alloc_kind_t kind)
+{
+    lua_Debug ar;
+    char name[BENCH_ALLOC_NAME_MAX];
+
+    if (!lua_isfunction(L, -1))
+        return bench_alloc_enter(kind, NULL);
+
+    lua_pushvalue(L, -1);
+    lua_getinfo(L, ">S", &ar);
+    if (ar.linedefined > 0)
+        snprintf(name, sizeof(name), "%s:%d", ar.short_src, ar.linedefined);
+    else
+        snprintf(name, sizeof(name), "%s", ar.short_src);
+
+    return bench_alloc_enter(kind, name);
+}
+
+bench_alloc_kind_t
+bench_alloc_kind_from_name(const char *name)
+{
+    for (int i = 0; i < BENCH_ALLOC_KIND_COUNT; i++)
+        if (strcmp(bench_alloc_kind_names[i], name) == 0)
+            return i;
+    return BENCH_ALLOC_OTHER;
+}
+
+static void
+bench_alloc_stats_from(const bench_alloc_site_t *site, bench_alloc_stats_t *stats)
+{
+    stats->kind = site->kind;
+    stats->name = site->used ? site->name : NULL;
+    stats->calls = site->calls;
+    stats->allocs = site->allocs;
+    stats->alloc_bytes = site->alloc_bytes;
+    stats->free_bytes = site->free_bytes;
+}
+
+void
+bench_alloc_kind_get(bench_alloc_kind_t kind, bench_alloc_stats_t *stats)
+{
+    bench_alloc_stats_from(&bench_alloc_unnamed[kind], stats);
+    stats->kind = kind;
+
+    for (int i = 0; i < BENCH_ALLOC_SITES; i++) {
+        const bench_alloc_site_t *site = &bench_alloc_sites[i];
+        if (!site->used || site->kind != kind)
+            continue;
+        stats->calls += site->calls;
+        stats->allocs += site->allocs;
+        stats->alloc_bytes += site->alloc_bytes;
+        stats->free_bytes += site->free_bytes;
+    }
+}
+
+static int
+bench_alloc_cmp(const void *a, const void *b)
+{
+    const bench_alloc_stats_t *sa = a, *sb = b;
+
+    if (sa->alloc_bytes != sb->alloc_bytes)
+        return sa->alloc_bytes < sb->alloc_bytes ? 1 : -1;
+    return 0;
+}
+
+int
+bench_alloc_top(bench_alloc_stats_t *sites, int max)
+{
+    bench_alloc_stats_t all[BENCH_ALLOC_SITES];
+    int n = 0;
+
+    for (int i = 0; i < BENCH_ALLOC_SITES; i++)
+        if (bench_alloc_sites[i].used && bench_alloc_sites[i].alloc_bytes > 0)
+            bench_alloc_stats_from(&bench_alloc_sites[i], &all[n++]);
+
+    qsort(all, n, sizeof(all[0]), bench_alloc_cmp);
+
+    if (n > max)
+        n = max;
+    memcpy(sites, all, n * sizeof(all[0]));
+    return n;
+}
+
+double
+bench_alloc_elapsed_s(void)
+{
+    return (double)(bench_alloc_now_ns() - bench_alloc_reset_ns) / 1e9;
+}
+
+void
+bench_alloc_reset(void)
+{
+    /* Keep the sites: entries on the stack point into them */
+    for (int i = 0; i < BENCH_ALLOC_SITES; i++) {
+        bench_alloc_site_t *site = &bench_alloc_sites[i];
+        site->calls = site->allocs = 0;
+        site->alloc_bytes = site->free_bytes = 0;
+    }
+    for (int i = 0; i < BENCH_ALLOC_KIND_COUNT; i++) {
+        bench_alloc_site_t *site = &bench_alloc_unnamed[i];
+        site->kind = i;
+        site->calls = site->allocs = 0;
+        site->alloc_bytes = site->free_bytes = 0;
+    }
+    bench_alloc_reset_ns = bench_alloc_now_ns();
+}
+
 void
 bench_count_scene_nodes(struct wlr_scene_node *root,
                         int *trees, int *rects, int *buffers)
@@ -408,6 +946,11 @@ bench_reset_all(void)
     bench_input_latency_reset();
     bench_manage_latency_reset();
     bench_render_reset();
+    bench_output_reset();
+    bench_prop_reset();
+    bench_x11_reset();
+    bench_spawn_reset();
+    bench_alloc_reset();
 }
 
 #endif /* SOMEWM_BENCH */
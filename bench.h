@@ -36,6 +36,7 @@ typedef enum {
     BENCH_STAGE_BANNING,
     BENCH_STAGE_STACK,
     BENCH_STAGE_DESTROY,
+    BENCH_STAGE_GC,         /* Idle Lua GC steps after the refresh (luagc.c) */
     BENCH_STAGE_COUNT
 } bench_stage_t;
 
@@ -58,7 +59,10 @@ void bench_crossings_reset(void);
 #define BENCH_INPUT_RING 64
 
 void bench_input_event_record(void);
-void bench_input_commit_flush(void);
+/* Inputs recorded so far reach the screen with this commit. display_ns is
+ * the vblank it is expected to be scanned out at (CLOCK_MONOTONIC), or 0
+ * to measure to the commit itself. */
+void bench_input_commit_flush(uint64_t display_ns);
 void bench_input_latency_stats_get(uint64_t *count, uint64_t *avg_ns,
                                    uint64_t *p99_ns, uint64_t *max_ns);
 void bench_input_latency_reset(void);
@@ -78,6 +82,126 @@ void bench_render_stats_get(uint64_t *count, uint64_t *min_ns, uint64_t *max_ns,
                             uint64_t *avg_ns, uint64_t *p99_ns);
 void bench_render_reset(void);
 
+/* --- Per-output frame timing --- */
+
+#define BENCH_OUTPUTS_MAX 16
+
+typedef struct {
+    const char *name;
+    uint64_t frames;         /* Frame events handled */
+    uint64_t presented;      /* Commits that presented new content */
+    uint64_t late;           /* Frame events more than 1.5 periods apart */
+    uint64_t resize_waits;   /* Frames skipped for a pending client resize */
+    uint64_t fence_timeouts; /* Resize waits cut short by the resize fence */
+    uint64_t deferred;       /* Renders delayed towards the vblank */
+    uint64_t missed;         /* Deferred renders done after their vblank */
+    uint64_t deferred_min_ns, deferred_max_ns; /* Refresh + commit of deferred renders */
+    uint64_t period_ns;      /* From the output's refresh rate, 0 if unknown */
+    uint64_t render_min_ns, render_max_ns, render_avg_ns, render_p99_ns;
+    uint64_t interval_max_ns, interval_avg_ns, interval_p99_ns;
+} bench_output_stats_t;
+
+/* One frame event of an output. interval and lateness are measured from
+ * the output's previous frame event, so a main loop stalled by work for
+ * another output (or Lua) shows up on every output it delayed. */
+void bench_output_frame(const char *name, int refresh_mhz,
+                        uint64_t render_ns, bool presented);
+/* A render of the output was deferred by the frame scheduler; missed if
+ * it completed after the vblank it aimed for. render_ns is the time the
+ * frame scheduler budgets for it: the refresh before it plus the commit. */
+void bench_output_deferred(const char *name, bool missed, uint64_t render_ns);
+/* A frame of the output was held back by a pending client resize, or
+ * (timed_out) rendered anyway because the resize fence expired */
+void bench_output_resize_wait(const char *name, bool timed_out);
+int bench_output_stats_count(void);
+void bench_output_stats_get(int i, bench_output_stats_t *stats);
+void bench_output_reset(void);
+
+/* --- Client title/app_id updates (property.c) --- */
+
+typedef enum {
+    BENCH_PROP_RECEIVED,      /* set_title / set_app_id from clients */
+    BENCH_PROP_COALESCED,     /* Overwritten before reaching Lua */
+    BENCH_PROP_RATE_LIMITED,  /* Deliveries held back by the rate cap */
+    BENCH_PROP_DELIVERED,     /* Deliveries to Lua */
+    BENCH_PROP_COUNT
+} bench_prop_t;
+
+void bench_prop_update(bench_prop_t what);
+uint64_t bench_prop_count(bench_prop_t what);
+void bench_prop_reset(void);
+
+/* --- XWayland property writes (ewmh.c) --- */
+
+typedef enum {
+    BENCH_X11_STAGED,   /* Property values staged by EWMH updates */
+    BENCH_X11_SKIPPED,  /* Flushed values equal to what the server has */
+    BENCH_X11_SENT,     /* ChangeProperty/DeleteProperty requests sent */
+    BENCH_X11_COUNT
+} bench_x11_t;
+
+void bench_x11_update(bench_x11_t what);
+uint64_t bench_x11_count(bench_x11_t what);
+/* Requests sent per frame */
+void bench_x11_stats_get(double *avg, uint64_t *max);
+void bench_x11_reset(void);
+
+/* --- Spawn-to-exec latency (posix_spawn return, i.e. after exec) --- */
+
+void bench_spawn_record(uint64_t elapsed_ns);
+void bench_spawn_stats_get(uint64_t *count, uint64_t *min_ns, uint64_t *max_ns,
+                           uint64_t *avg_ns, uint64_t *p99_ns);
+void bench_spawn_reset(void);
+
+/* --- Lua allocation accounting ---
+ *
+ * bench_alloc_install() chains an allocator in front of the state's own
+ * that charges allocated and freed bytes to the innermost active entry
+ * point. C code that calls into Lua brackets the call with
+ * bench_alloc_enter()/bench_alloc_leave(); anything else is "other".
+ * Nested entries are not charged to the outer one. */
+
+typedef enum {
+    BENCH_ALLOC_OTHER,      /* No entry point active (startup, reload) */
+    BENCH_ALLOC_SIGNAL,     /* Signal handlers, by signal name */
+    BENCH_ALLOC_QUEUE,      /* Event queue drain, outside the handlers */
+    BENCH_ALLOC_ANIMATION,  /* Animation tick/done callbacks, by source */
+    BENCH_ALLOC_IPC,        /* IPC commands, by command word */
+    BENCH_ALLOC_TIMER,      /* Timer callbacks, by source */
+    BENCH_ALLOC_KIND_COUNT
+} bench_alloc_kind_t;
+
+#define BENCH_ALLOC_NAME_MAX 64
+
+typedef struct {
+    bench_alloc_kind_t kind;
+    const char *name;
+    uint64_t calls;          /* Times the entry point was entered */
+    uint64_t allocs;         /* New blocks */
+    uint64_t alloc_bytes;    /* Bytes allocated (growing reallocs count) */
+    uint64_t free_bytes;     /* Bytes freed (shrinking reallocs count) */
+} bench_alloc_stats_t;
+
+extern const char *bench_alloc_kind_names[BENCH_ALLOC_KIND_COUNT];
+
+struct lua_State;
+void bench_alloc_install(struct lua_State *L);
+/* Hand the state its own allocator back, before it is closed or leaked */
+void bench_alloc_uninstall(struct lua_State *L);
+/* Returns the depth to pass to bench_alloc_leave(); restoring it also
+ * drops entries left behind by a Lua error unwinding past their leave */
+int bench_alloc_enter(bench_alloc_kind_t kind, const char *name);
+void bench_alloc_leave(int depth);
+/* Enter with the source of the function on top of the stack as the name */
+int bench_alloc_enter_function(struct lua_State *L, bench_alloc_kind_t kind);
+bench_alloc_kind_t bench_alloc_kind_from_name(const char *name);
+void bench_alloc_kind_get(bench_alloc_kind_t kind, bench_alloc_stats_t *stats);
+/* The sites with the most allocated bytes, sorted; returns how many */
+int bench_alloc_top(bench_alloc_stats_t *sites, int max);
+/* Seconds since the last reset, for rates */
+double bench_alloc_elapsed_s(void);
+void bench_alloc_reset(void);
+
 /* Scene node counting (called at query time, not per-frame) */
 struct wlr_scene_node;
 void bench_count_scene_nodes(struct wlr_scene_node *root,
@@ -33,7 +33,10 @@
 /* luaA_getuservalue and luaA_setuservalue are now in luaa.h */
 
 #define LUA_OBJECT_HEADER \
-        signal_array_t signals;
+        signal_array_t signals; \
+        /** LUA_REGISTRYINDEX slot while referenced by luaA_object_ref(), \
+         * 0 otherwise */ \
+        int registry_ref;
 
 /** Generic type for all objects.
  * All Lua objects can be casted to this type.
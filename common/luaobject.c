@@ -32,14 +32,14 @@
 #include "globalconf.h"
 #include "bench.h"
 
+int luaA_object_registry = LUA_NOREF;
+
 /** Setup the object system at startup.
  * \param L The Lua VM state.
  */
 void
 luaA_object_setup(lua_State *L)
 {
-    /* Push identification string */
-    lua_pushliteral(L, LUAA_OBJECT_REGISTRY_KEY);
     /* Create an empty table */
     lua_newtable(L);
     /* Create an empty metatable */
@@ -47,8 +47,67 @@ luaA_object_setup(lua_State *L)
     /* Set this empty table as the registry metatable.
      * It's used to store the number of reference on stored objects. */
     lua_setmetatable(L, -2);
-    /* Register table inside registry */
-    lua_rawset(L, LUA_REGISTRYINDEX);
+    /* Register table inside registry, at an integer slot so fetching it
+     * is a lua_rawgeti() instead of a string key lookup */
+    luaA_object_registry = luaL_ref(L, LUA_REGISTRYINDEX);
+}
+
+/** Reference an object and return a pointer to it.
+ * That only works with userdata, table, thread or function. Objects of a
+ * Lua class additionally get their own registry slot, which is what
+ * luaA_object_push() uses.
+ * \param L The Lua VM state.
+ * \param oud The object index on the stack.
+ * \return The object reference, or NULL if not referenceable.
+ */
+void *
+luaA_object_ref(lua_State *L, int oud)
+{
+    void *p;
+
+    oud = luaA_absindex(L, oud);
+    if(luaA_class_get(L, oud))
+    {
+        lua_object_t *obj = lua_touserdata(L, oud);
+        if(!obj->registry_ref)
+        {
+            lua_pushvalue(L, oud);
+            obj->registry_ref = luaL_ref(L, LUA_REGISTRYINDEX);
+        }
+    }
+
+    luaA_object_registry_push(L);
+    p = luaA_object_incref(L, -1, oud);
+    lua_pop(L, 1);
+    return p;
+}
+
+/** Unreference an object.
+ * That only works with userdata, table, thread or function.
+ * \param L The Lua VM state.
+ * \param pointer The object reference.
+ */
+void
+luaA_object_unref(lua_State *L, const void *pointer)
+{
+    lua_object_t *obj = NULL;
+
+    luaA_object_registry_push(L);
+
+    /* Find out whether this is a class object before the last reference
+     * removes it from the registry */
+    lua_pushlightuserdata(L, (void *) pointer);
+    lua_rawget(L, -2);
+    if(luaA_class_get(L, -1))
+        obj = lua_touserdata(L, -1);
+    lua_pop(L, 1);
+
+    if(luaA_object_decref(L, -1, pointer) == 0 && obj && obj->registry_ref > 0)
+    {
+        luaL_unref(L, LUA_REGISTRYINDEX, obj->registry_ref);
+        obj->registry_ref = 0;
+    }
+    lua_pop(L, 1);
 }
 
 /** Increment a object reference in its store table.
@@ -108,15 +167,15 @@ luaA_object_incref(lua_State *L, int tud, int oud)
  * \param L The Lua VM state.
  * \param tud The table index on the stack.
  * \param oud The object index on the stack.
- * \return A pointer to the object.
+ * \return The remaining reference count, -1 if the object was not found.
  */
-void
+int
 luaA_object_decref(lua_State *L, int tud, const void *pointer)
 {
     int count;
 
     if(!pointer)
-        return;
+        return -1;
 
     /* First, refcount-- */
     /* Get the metatable */
@@ -135,7 +194,7 @@ luaA_object_decref(lua_State *L, int tud, const void *pointer)
 
         /* Pop reference count and metatable */
         lua_pop(L, 2);
-        return;
+        return -1;
     }
     lua_pop(L, 1);
     /* Push the pointer (key) */
@@ -161,6 +220,8 @@ luaA_object_decref(lua_State *L, int tud, const void *pointer)
         /* table[pointer] = nil */
         lua_rawset(L, tud < 0 ? tud - 2 : tud);
     }
+
+    return count;
 }
 
 int
@@ -249,10 +310,13 @@ signal_object_emit(lua_State *L, signal_array_t *arr, const char *name, int narg
     {
         int nbfunc = sigfound->sigfuncs.len;
         luaL_checkstack(L, nbfunc + nargs + 1, "too much signal");
+#ifdef SOMEWM_BENCH
+        int alloc_depth = bench_alloc_enter(BENCH_ALLOC_SIGNAL, name);
+#endif
         /* Push all functions and then execute, because this list can change
          * while executing funcs. */
         foreach(func, sigfound->sigfuncs)
-            luaA_object_push(L, *func);
+            luaA_object_push_pointer(L, *func);
 
         for(int i = 0; i < nbfunc; i++)
         {
@@ -268,6 +332,9 @@ signal_object_emit(lua_State *L, signal_array_t *arr, const char *name, int narg
 #endif
             luaA_dofunction(L, nargs, 0);
         }
+#ifdef SOMEWM_BENCH
+        bench_alloc_leave(alloc_depth);
+#endif
     }
 
     /* remove args */
@@ -311,6 +378,9 @@ luaA_object_emit_signal(lua_State *L, int oud,
     {
         int nbfunc = sigfound->sigfuncs.len;
         luaL_checkstack(L, nbfunc + nargs + 2, "too much signal");
+#ifdef SOMEWM_BENCH
+        int alloc_depth = bench_alloc_enter(BENCH_ALLOC_SIGNAL, name);
+#endif
         /* Push all functions and then execute, because this list can change
          * while executing funcs. */
         foreach(func, sigfound->sigfuncs)
@@ -332,6 +402,9 @@ luaA_object_emit_signal(lua_State *L, int oud,
 #endif
             luaA_dofunction(L, nargs + 1, 0);
         }
+#ifdef SOMEWM_BENCH
+        bench_alloc_leave(alloc_depth);
+#endif
     }
 
     /* Then emit signal on the class */
@@ -25,12 +25,15 @@
 #include "common/luaclass.h"
 #include "common/signal.h"
 
-#define LUAA_OBJECT_REGISTRY_KEY "awesome.object.registry"
+/** LUA_REGISTRYINDEX slot of the object registry table */
+extern int luaA_object_registry;
 
 int luaA_settype(lua_State *, lua_class_t *);
 void luaA_object_setup(lua_State *);
 void * luaA_object_incref(lua_State *, int, int);
-void luaA_object_decref(lua_State *, int, const void *);
+int luaA_object_decref(lua_State *, int, const void *);
+void * luaA_object_ref(lua_State *, int);
+void luaA_object_unref(lua_State *, const void *);
 
 /** Store an item in the environment table of an object.
  * \param L The Lua VM state.
@@ -89,24 +92,7 @@ luaA_object_push_item(lua_State *L, int ud, const void *pointer)
 static inline void
 luaA_object_registry_push(lua_State *L)
 {
-    lua_pushliteral(L, LUAA_OBJECT_REGISTRY_KEY);
-    lua_rawget(L, LUA_REGISTRYINDEX);
-}
-
-/** Reference an object and return a pointer to it.
- * That only works with userdata, table, thread or function.
- * \param L The Lua VM state.
- * \param oud The object index on the stack.
- * \return The object reference, or NULL if not referenceable.
- */
-static inline void *
-luaA_object_ref(lua_State *L, int oud)
-{
-    void *p;
-    luaA_object_registry_push(L);
-    p = luaA_object_incref(L, -1, oud < 0 ? oud - 1 : oud);
-    lua_pop(L, 1);
-    return p;
+    lua_rawgeti(L, LUA_REGISTRYINDEX, luaA_object_registry);
 }
 
 /** Reference an object and return a pointer to it checking its type.
@@ -123,32 +109,42 @@ luaA_object_ref_class(lua_State *L, int oud, lua_class_t *class)
     return luaA_object_ref(L, oud);
 }
 
-/** Unreference an object and return a pointer to it.
- * That only works with userdata, table, thread or function.
+/** Push any value referenced with luaA_object_ref() (function, table...)
+ * onto the stack.
  * \param L The Lua VM state.
- * \param oud The object index on the stack.
+ * \param pointer The value pointer.
+ * \return The number of element pushed on stack.
  */
-static inline void
-luaA_object_unref(lua_State *L, const void *pointer)
+static inline int
+luaA_object_push_pointer(lua_State *L, const void *pointer)
 {
     luaA_object_registry_push(L);
-    luaA_object_decref(L, -1, pointer);
-    lua_pop(L, 1);
+    lua_pushlightuserdata(L, (void *) pointer);
+    lua_rawget(L, -2);
+    lua_remove(L, -2);
+    return 1;
 }
 
 /** Push a referenced object onto the stack.
  * \param L The Lua VM state.
- * \param pointer The object to push.
+ * \param pointer The object to push, of a type with LUA_OBJECT_HEADER.
  * \return The number of element pushed on stack.
  */
 static inline int
 luaA_object_push(lua_State *L, const void *pointer)
 {
-    luaA_object_registry_push(L);
-    lua_pushlightuserdata(L, (void *) pointer);
-    lua_rawget(L, -2);
-    lua_remove(L, -2);
-    return 1;
+    const lua_object_t *obj = pointer;
+
+    if(obj && obj->registry_ref > 0)
+    {
+        lua_rawgeti(L, LUA_REGISTRYINDEX, obj->registry_ref);
+        /* A slot number kept from the Lua state before a hot reload
+         * means something else in this one */
+        if(lua_touserdata(L, -1) == pointer)
+            return 1;
+        lua_pop(L, 1);
+    }
+    return luaA_object_push_pointer(L, pointer);
 }
 
 void signal_object_emit(lua_State *, signal_array_t *, const char *, int);
@@ -41,6 +41,7 @@
 #ifdef WITH_DBUS
 
 #include <dbus/dbus.h>
+#include <stdint.h>
 #include <unistd.h>
 #include <fcntl.h>
 
@@ -78,200 +79,353 @@ a_dbus_cleanup_bus(DBusConnection *dbus_connection, GSource **source)
     dbus_connection_unref(dbus_connection);
 }
 
-/** Iterate through the D-Bus messages counting each or traverse each sub message.
- * \param L The Lua VM state.
- * \param iter The D-Bus message iterator pointer
- * \return The number of arguments in the iterator
+/* Signature-directed message decoding.
+ *
+ * Every D-Bus message carries its signature string. Instead of asking the
+ * iterator for the type of every single value, a signature is compiled
+ * once into a tree of decode nodes and cached, so decoding a message is a
+ * walk of that tree. Tables are filled as elements are decoded rather than
+ * staging a whole container on the Lua stack first. */
+
+/** A compiled signature node */
+typedef struct a_dbus_plan_t a_dbus_plan_t;
+struct a_dbus_plan_t
+{
+    /** D-Bus type code, DBUS_TYPE_INVALID for the top-level argument list */
+    int type;
+    /** Struct fields, array element ([0]) or dict entry key and value */
+    int nchildren;
+    a_dbus_plan_t *children;
+};
+
+/** Upper bound on cached signatures. Variant contents make the set of
+ * signatures open-ended, so the cache is simply flushed when full
+ * (between messages, see a_dbus_message_push_args()). */
+#define A_DBUS_PLAN_CACHE_MAX 256
+
+static GHashTable *dbus_plan_cache = NULL;
+
+static void
+a_dbus_plan_wipe(a_dbus_plan_t *plan)
+{
+    for(int i = 0; i < plan->nchildren; i++)
+        a_dbus_plan_wipe(&plan->children[i]);
+    p_delete(&plan->children);
+}
+
+static void
+a_dbus_plan_free(gpointer data)
+{
+    a_dbus_plan_t *plan = data;
+    a_dbus_plan_wipe(plan);
+    p_delete(&plan);
+}
+
+/** Compile the complete types at a signature iterator into plan children.
+ * \param plan The node receiving the children.
+ * \param sigiter The signature iterator, positioned at the first type.
  */
-static int
-a_dbus_message_iter(lua_State *L, DBusMessageIter *iter)
+static void
+a_dbus_plan_compile(a_dbus_plan_t *plan, DBusSignatureIter *sigiter)
 {
-    int nargs = 0;
+    DBusSignatureIter count_iter = *sigiter;
+    int n = 0;
+
+    if(dbus_signature_iter_get_current_type(&count_iter) != DBUS_TYPE_INVALID)
+        do
+            n++;
+        while(dbus_signature_iter_next(&count_iter));
 
-    do
+    plan->nchildren = n;
+    plan->children = n ? p_new(a_dbus_plan_t, n) : NULL;
+
+    for(int i = 0; i < n; i++)
     {
-        switch(dbus_message_iter_get_arg_type(iter))
+        a_dbus_plan_t *child = &plan->children[i];
+        child->type = dbus_signature_iter_get_current_type(sigiter);
+
+        if(child->type == DBUS_TYPE_ARRAY
+           || child->type == DBUS_TYPE_STRUCT
+           || child->type == DBUS_TYPE_DICT_ENTRY)
         {
-          default:
-            lua_pushnil(L);
-            nargs++;
-            break;
-          case DBUS_TYPE_INVALID:
-            break;
-          case DBUS_TYPE_VARIANT:
-            {
-                DBusMessageIter subiter;
-                dbus_message_iter_recurse(iter, &subiter);
-                a_dbus_message_iter(L, &subiter);
-            }
-            nargs++;
-            break;
-          case DBUS_TYPE_DICT_ENTRY:
-            {
-                DBusMessageIter subiter;
+            DBusSignatureIter subiter;
+            dbus_signature_iter_recurse(sigiter, &subiter);
+            a_dbus_plan_compile(child, &subiter);
+        }
 
-                /* initialize a sub iterator */
-                dbus_message_iter_recurse(iter, &subiter);
-                /* create a new table to store the dict */
-                a_dbus_message_iter(L, &subiter);
-            }
-            nargs++;
-            break;
-          case DBUS_TYPE_STRUCT:
-            {
-                DBusMessageIter subiter;
-                /* initialize a sub iterator */
-                dbus_message_iter_recurse(iter, &subiter);
+        dbus_signature_iter_next(sigiter);
+    }
+}
 
-                int n = a_dbus_message_iter(L, &subiter);
+/** Get the compiled plan for a signature, compiling it on first use.
+ * \param signature A valid D-Bus signature.
+ * \return The plan, its children being the complete types of the signature.
+ */
+static const a_dbus_plan_t *
+a_dbus_plan_get(const char *signature)
+{
+    a_dbus_plan_t *plan;
+    DBusSignatureIter sigiter;
 
-                /* create a new table to store all the value */
-                lua_createtable(L, n, 0);
-                /* move the table before array elements */
-                lua_insert(L, - n - 1);
+    if(!dbus_plan_cache)
+        dbus_plan_cache = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                                g_free, a_dbus_plan_free);
 
-                for(int i = n; i > 0; i--)
-                    lua_rawseti(L, - i - 1, i);
-            }
-            nargs++;
-            break;
-          case DBUS_TYPE_ARRAY:
-            {
-                int array_type = dbus_message_iter_get_element_type(iter);
+    if((plan = g_hash_table_lookup(dbus_plan_cache, signature)))
+        return plan;
 
-                if(dbus_type_is_fixed(array_type))
-                {
-                    DBusMessageIter sub;
-                    dbus_message_iter_recurse(iter, &sub);
+    plan = p_new(a_dbus_plan_t, 1);
+    plan->type = DBUS_TYPE_INVALID;
+    dbus_signature_iter_init(&sigiter, signature);
+    a_dbus_plan_compile(plan, &sigiter);
+    g_hash_table_insert(dbus_plan_cache, g_strdup(signature), plan);
+
+    return plan;
+}
+
+static void a_dbus_decode_value(lua_State *L, DBusMessageIter *iter,
+                                const a_dbus_plan_t *plan);
+
+/** Push a fixed-size array in one go.
+ * Byte arrays (`ay`, e.g. icon pixmaps) become a single Lua string.
+ */
+static void
+a_dbus_decode_fixed_array(lua_State *L, DBusMessageIter *iter, int array_type)
+{
+    DBusMessageIter sub;
+    int datalen;
+
+    dbus_message_iter_recurse(iter, &sub);
 
-                    switch(array_type)
-                    {
-                      int datalen;
+    switch(array_type)
+    {
 #define DBUS_MSG_HANDLE_ARRAY_TYPE_NUMBER_OR_INT(type, dbustype, pusher) \
-                      case dbustype: \
-                        { \
-                            const type *data; \
-                            dbus_message_iter_get_fixed_array(&sub, &data, &datalen); \
-                            lua_createtable(L, datalen, 0); \
-                            for(int i = 0; i < datalen; i++) \
-                            { \
-                                pusher(L, data[i]); \
-                                lua_rawseti(L, -2, i + 1); \
-                            } \
-                        } \
-                        break;
-                      DBUS_MSG_HANDLE_ARRAY_TYPE_NUMBER_OR_INT(int16_t, DBUS_TYPE_INT16, lua_pushinteger)
-                      DBUS_MSG_HANDLE_ARRAY_TYPE_NUMBER_OR_INT(uint16_t, DBUS_TYPE_UINT16, lua_pushinteger)
-                      DBUS_MSG_HANDLE_ARRAY_TYPE_NUMBER_OR_INT(int32_t, DBUS_TYPE_INT32, lua_pushinteger)
-                      DBUS_MSG_HANDLE_ARRAY_TYPE_NUMBER_OR_INT(uint32_t, DBUS_TYPE_UINT32, lua_pushinteger)
-                      DBUS_MSG_HANDLE_ARRAY_TYPE_NUMBER_OR_INT(int64_t, DBUS_TYPE_INT64, lua_pushinteger)
-                      DBUS_MSG_HANDLE_ARRAY_TYPE_NUMBER_OR_INT(uint64_t, DBUS_TYPE_UINT64, lua_pushinteger)
-                      DBUS_MSG_HANDLE_ARRAY_TYPE_NUMBER_OR_INT(double, DBUS_TYPE_DOUBLE, lua_pushnumber)
+      case dbustype: \
+        { \
+            const type *data; \
+            dbus_message_iter_get_fixed_array(&sub, &data, &datalen); \
+            lua_createtable(L, datalen, 0); \
+            for(int i = 0; i < datalen; i++) \
+            { \
+                pusher(L, data[i]); \
+                lua_rawseti(L, -2, i + 1); \
+            } \
+        } \
+        break;
+      DBUS_MSG_HANDLE_ARRAY_TYPE_NUMBER_OR_INT(int16_t, DBUS_TYPE_INT16, lua_pushinteger)
+      DBUS_MSG_HANDLE_ARRAY_TYPE_NUMBER_OR_INT(uint16_t, DBUS_TYPE_UINT16, lua_pushinteger)
+      DBUS_MSG_HANDLE_ARRAY_TYPE_NUMBER_OR_INT(int32_t, DBUS_TYPE_INT32, lua_pushinteger)
+      DBUS_MSG_HANDLE_ARRAY_TYPE_NUMBER_OR_INT(uint32_t, DBUS_TYPE_UINT32, lua_pushinteger)
+      DBUS_MSG_HANDLE_ARRAY_TYPE_NUMBER_OR_INT(int64_t, DBUS_TYPE_INT64, lua_pushinteger)
+      DBUS_MSG_HANDLE_ARRAY_TYPE_NUMBER_OR_INT(uint64_t, DBUS_TYPE_UINT64, lua_pushinteger)
+      DBUS_MSG_HANDLE_ARRAY_TYPE_NUMBER_OR_INT(double, DBUS_TYPE_DOUBLE, lua_pushnumber)
 #undef DBUS_MSG_HANDLE_ARRAY_TYPE_NUMBER_OR_INT
-                      case DBUS_TYPE_BYTE:
-                        {
-                            const char *c;
-                            dbus_message_iter_get_fixed_array(&sub, &c, &datalen);
-                            lua_pushlstring(L, c, datalen);
-                        }
-                        break;
-                      case DBUS_TYPE_BOOLEAN:
-                        {
-                            const dbus_bool_t *b;
-                            dbus_message_iter_get_fixed_array(&sub, &b, &datalen);
-                            lua_createtable(L, datalen, 0);
-                            for(int i = 0; i < datalen; i++)
-                            {
-                                lua_pushboolean(L, b[i]);
-                                lua_rawseti(L, -2, i + 1);
-                            }
-                        }
-                        break;
-                    }
-                }
-                else if(array_type == DBUS_TYPE_DICT_ENTRY)
-                {
-                    DBusMessageIter subiter;
-                    /* initialize a sub iterator */
-                    dbus_message_iter_recurse(iter, &subiter);
+      case DBUS_TYPE_BYTE:
+        {
+            const char *c;
+            dbus_message_iter_get_fixed_array(&sub, &c, &datalen);
+            lua_pushlstring(L, c, datalen);
+        }
+        break;
+      case DBUS_TYPE_BOOLEAN:
+        {
+            const dbus_bool_t *b;
+            dbus_message_iter_get_fixed_array(&sub, &b, &datalen);
+            lua_createtable(L, datalen, 0);
+            for(int i = 0; i < datalen; i++)
+            {
+                lua_pushboolean(L, b[i]);
+                lua_rawseti(L, -2, i + 1);
+            }
+        }
+        break;
+      default:
+        /* Unix fds are not passed to Lua */
+        lua_newtable(L);
+        break;
+    }
+}
 
-                    /* get the keys and the values
-                     * n is the number of entry in dict */
-                    int n = a_dbus_message_iter(L, &subiter);
+/** Push the value held by a variant.
+ * Basic contents are decoded directly; container contents go through the
+ * plan cache, keyed by the variant's own signature.
+ */
+static void
+a_dbus_decode_variant(lua_State *L, DBusMessageIter *iter)
+{
+    DBusMessageIter sub;
+    int type;
 
-                    /* create a new table to store all the value */
-                    lua_createtable(L, n, 0);
-                    /* move the table before array elements */
-                    lua_insert(L, - (n * 2) - 1);
+    dbus_message_iter_recurse(iter, &sub);
+    type = dbus_message_iter_get_arg_type(&sub);
 
-                    for(int i = 0; i < n; i ++)
-                        lua_rawset(L, - (n * 2) - 1 + i * 2);
-                }
-                else
-                {
-                    DBusMessageIter subiter;
-                    /* prepare to dig into the array*/
-                    dbus_message_iter_recurse(iter, &subiter);
+    if(dbus_type_is_basic(type))
+    {
+        a_dbus_plan_t basic = { .type = type };
+        a_dbus_decode_value(L, &sub, &basic);
+    }
+    else
+    {
+        char *signature = dbus_message_iter_get_signature(&sub);
+        const a_dbus_plan_t *plan = a_dbus_plan_get(signature);
+        dbus_free(signature);
+        a_dbus_decode_value(L, &sub, &plan->children[0]);
+    }
+}
 
-                    /* now iterate over every element of the array */
-                    int n = a_dbus_message_iter(L, &subiter);
+/** Push one D-Bus value as one Lua value.
+ * \param L The Lua VM state.
+ * \param iter The message iterator, positioned on the value.
+ * \param plan The compiled node describing the value.
+ */
+static void
+a_dbus_decode_value(lua_State *L, DBusMessageIter *iter, const a_dbus_plan_t *plan)
+{
+    /* Nesting is bounded by D-Bus itself (64 levels) */
+    if(!lua_checkstack(L, 4))
+    {
+        warn("D-Bus message nested too deeply");
+        lua_pushnil(L);
+        return;
+    }
 
-                    /* create a new table to store all the value */
-                    lua_createtable(L, n, 0);
-                    /* move the table before array elements */
-                    lua_insert(L, - n - 1);
+    switch(plan->type)
+    {
+      default:
+        lua_pushnil(L);
+        break;
+      case DBUS_TYPE_VARIANT:
+        a_dbus_decode_variant(L, iter);
+        break;
+      case DBUS_TYPE_STRUCT:
+        {
+            DBusMessageIter sub;
+            dbus_message_iter_recurse(iter, &sub);
+            lua_createtable(L, plan->nchildren, 0);
+            for(int i = 0; i < plan->nchildren; i++)
+            {
+                a_dbus_decode_value(L, &sub, &plan->children[i]);
+                lua_rawseti(L, -2, i + 1);
+                dbus_message_iter_next(&sub);
+            }
+        }
+        break;
+      case DBUS_TYPE_ARRAY:
+        {
+            const a_dbus_plan_t *element = &plan->children[0];
+            DBusMessageIter sub;
 
-                    for(int i = n; i > 0; i--)
-                        lua_rawseti(L, - i - 1, i);
-                }
+            if(dbus_type_is_fixed(element->type))
+            {
+                a_dbus_decode_fixed_array(L, iter, element->type);
+                break;
             }
-            nargs++;
-            break;
-          case DBUS_TYPE_BOOLEAN:
+
+            dbus_message_iter_recurse(iter, &sub);
+
+            if(element->type == DBUS_TYPE_DICT_ENTRY)
             {
-                dbus_bool_t b;
-                dbus_message_iter_get_basic(iter, &b);
-                lua_pushboolean(L, b);
+                /* a{..}: a table mapping keys to values */
+                lua_newtable(L);
+                while(dbus_message_iter_get_arg_type(&sub) != DBUS_TYPE_INVALID)
+                {
+                    DBusMessageIter entry;
+                    dbus_message_iter_recurse(&sub, &entry);
+                    a_dbus_decode_value(L, &entry, &element->children[0]);
+                    dbus_message_iter_next(&entry);
+                    a_dbus_decode_value(L, &entry, &element->children[1]);
+                    lua_rawset(L, -3);
+                    dbus_message_iter_next(&sub);
+                }
             }
-            nargs++;
-            break;
-          case DBUS_TYPE_BYTE:
+            else
             {
-                char c;
-                dbus_message_iter_get_basic(iter, &c);
-                lua_pushlstring(L, &c, 1);
+                int i = 0;
+                lua_newtable(L);
+                while(dbus_message_iter_get_arg_type(&sub) != DBUS_TYPE_INVALID)
+                {
+                    a_dbus_decode_value(L, &sub, element);
+                    lua_rawseti(L, -2, ++i);
+                    dbus_message_iter_next(&sub);
+                }
             }
-            nargs++;
-            break;
+        }
+        break;
+      case DBUS_TYPE_BOOLEAN:
+        {
+            dbus_bool_t b;
+            dbus_message_iter_get_basic(iter, &b);
+            lua_pushboolean(L, b);
+        }
+        break;
+      case DBUS_TYPE_BYTE:
+        {
+            char c;
+            dbus_message_iter_get_basic(iter, &c);
+            lua_pushlstring(L, &c, 1);
+        }
+        break;
 #define DBUS_MSG_HANDLE_TYPE_NUMBER_OR_INT(type, dbustype, pusher) \
-          case dbustype: \
-            { \
-                type ui; \
-                dbus_message_iter_get_basic(iter, &ui); \
-                pusher(L, ui); \
-            } \
-            nargs++; \
-            break;
-          DBUS_MSG_HANDLE_TYPE_NUMBER_OR_INT(int16_t, DBUS_TYPE_INT16, lua_pushinteger)
-          DBUS_MSG_HANDLE_TYPE_NUMBER_OR_INT(uint16_t, DBUS_TYPE_UINT16, lua_pushinteger)
-          DBUS_MSG_HANDLE_TYPE_NUMBER_OR_INT(int32_t, DBUS_TYPE_INT32, lua_pushinteger)
-          DBUS_MSG_HANDLE_TYPE_NUMBER_OR_INT(uint32_t, DBUS_TYPE_UINT32, lua_pushinteger)
-          DBUS_MSG_HANDLE_TYPE_NUMBER_OR_INT(int64_t, DBUS_TYPE_INT64, lua_pushinteger)
-          DBUS_MSG_HANDLE_TYPE_NUMBER_OR_INT(uint64_t, DBUS_TYPE_UINT64, lua_pushinteger)
-          DBUS_MSG_HANDLE_TYPE_NUMBER_OR_INT(double, DBUS_TYPE_DOUBLE, lua_pushnumber)
+      case dbustype: \
+        { \
+            type ui; \
+            dbus_message_iter_get_basic(iter, &ui); \
+            pusher(L, ui); \
+        } \
+        break;
+      DBUS_MSG_HANDLE_TYPE_NUMBER_OR_INT(int16_t, DBUS_TYPE_INT16, lua_pushinteger)
+      DBUS_MSG_HANDLE_TYPE_NUMBER_OR_INT(uint16_t, DBUS_TYPE_UINT16, lua_pushinteger)
+      DBUS_MSG_HANDLE_TYPE_NUMBER_OR_INT(int32_t, DBUS_TYPE_INT32, lua_pushinteger)
+      DBUS_MSG_HANDLE_TYPE_NUMBER_OR_INT(uint32_t, DBUS_TYPE_UINT32, lua_pushinteger)
+      DBUS_MSG_HANDLE_TYPE_NUMBER_OR_INT(int64_t, DBUS_TYPE_INT64, lua_pushinteger)
+      DBUS_MSG_HANDLE_TYPE_NUMBER_OR_INT(uint64_t, DBUS_TYPE_UINT64, lua_pushinteger)
+      DBUS_MSG_HANDLE_TYPE_NUMBER_OR_INT(double, DBUS_TYPE_DOUBLE, lua_pushnumber)
 #undef DBUS_MSG_HANDLE_TYPE_NUMBER_OR_INT
-          case DBUS_TYPE_STRING:
-            {
-                char *s;
-                dbus_message_iter_get_basic(iter, &s);
-                lua_pushstring(L, s);
-            }
-            nargs++;
-            break;
+      case DBUS_TYPE_STRING:
+      case DBUS_TYPE_OBJECT_PATH:
+      case DBUS_TYPE_SIGNATURE:
+        {
+            char *s;
+            dbus_message_iter_get_basic(iter, &s);
+            lua_pushstring(L, s);
         }
-    } while(dbus_message_iter_next(iter));
+        break;
+    }
+}
+
+/** Push all arguments of a D-Bus message, one Lua value per argument.
+ * \param L The Lua VM state.
+ * \param msg The D-Bus message.
+ * \return The number of values pushed.
+ */
+static int
+a_dbus_message_push_args(lua_State *L, DBusMessage *msg)
+{
+    const a_dbus_plan_t *plan;
+    DBusMessageIter iter;
 
-    return nargs;
+    if(!dbus_message_iter_init(msg, &iter))
+        return 0;
+
+    /* Only flush between messages: plans are in use while decoding */
+    if(dbus_plan_cache && g_hash_table_size(dbus_plan_cache) >= A_DBUS_PLAN_CACHE_MAX)
+        g_hash_table_remove_all(dbus_plan_cache);
+
+    plan = a_dbus_plan_get(dbus_message_get_signature(msg));
+
+    if(!lua_checkstack(L, plan->nchildren))
+    {
+        warn("too many arguments in D-Bus message");
+        return 0;
+    }
+
+    for(int i = 0; i < plan->nchildren; i++)
+    {
+        a_dbus_decode_value(L, &iter, &plan->children[i]);
+        dbus_message_iter_next(&iter);
+    }
+
+    return plan->nchildren;
 }
 
 static bool
@@ -357,6 +511,287 @@ a_dbus_convert_value(lua_State *L, int idx, DBusMessageIter *iter)
     return true;
 }
 
+/* Subscription index.
+ *
+ * A busy session bus delivers plenty of traffic nobody listens to: other
+ * clients' broadcasts matched by broad rules, signals on interfaces without
+ * a connected handler. Those are dropped here, before the message table is
+ * built or any argument is decoded. Broadcast signals are additionally
+ * checked against the (interface, member, path) parts of the match rules
+ * added through add_match(); rules are indexed by interface. */
+
+/** A parsed match rule. NULL fields match anything. */
+typedef struct
+{
+    /** The rule string as given to add_match(), for remove_match() */
+    char *rule;
+    /** DBUS_MESSAGE_TYPE_INVALID for any type */
+    int type;
+    char *interface;
+    char *member;
+    char *path;
+    char *path_namespace;
+} a_dbus_rule_t;
+
+/** Match rules added on one bus */
+typedef struct
+{
+    /** interface -> GPtrArray of a_dbus_rule_t */
+    GHashTable *by_interface;
+    /** Rules without an interface key */
+    GPtrArray *any_interface;
+    int nrules;
+} a_dbus_match_index_t;
+
+/** Per-interface message counters */
+typedef struct
+{
+    uint64_t received;
+    uint64_t dropped;
+    uint64_t dispatched;
+} a_dbus_iface_stats_t;
+
+/** Bound on distinct interfaces with their own counters; anything beyond
+ * is accounted under A_DBUS_STATS_OTHER. */
+#define A_DBUS_STATS_MAX 512
+#define A_DBUS_STATS_OTHER "(other)"
+
+static a_dbus_match_index_t dbus_match_session;
+static a_dbus_match_index_t dbus_match_system;
+static GHashTable *dbus_iface_stats = NULL;
+
+static void
+a_dbus_rule_free(gpointer data)
+{
+    a_dbus_rule_t *rule = data;
+    p_delete(&rule->rule);
+    p_delete(&rule->interface);
+    p_delete(&rule->member);
+    p_delete(&rule->path);
+    p_delete(&rule->path_namespace);
+    p_delete(&rule);
+}
+
+/** Parse the keys the index cares about out of a match rule.
+ * Other keys (sender, arg0, ...) are left to the bus: the rule then simply
+ * matches more here than on the bus, never less.
+ * \param str The match rule string.
+ * \return A new rule.
+ */
+static a_dbus_rule_t *
+a_dbus_rule_parse(const char *str)
+{
+    a_dbus_rule_t *rule = p_new(a_dbus_rule_t, 1);
+    const char *p = str;
+
+    rule->rule = a_strdup(str);
+    rule->type = DBUS_MESSAGE_TYPE_INVALID;
+
+    while(*p)
+    {
+        while(*p == ',' || *p == ' ')
+            p++;
+
+        const char *eq = strchr(p, '=');
+        if(!eq || eq[1] != '\'')
+            break;
+
+        const char *value = eq + 2;
+        const char *end = strchr(value, '\'');
+        if(!end)
+            break;
+
+        char *v = g_strndup(value, end - value);
+        size_t klen = eq - p;
+        char **field = NULL;
+
+        if(klen == 4 && !strncmp(p, "type", 4))
+            rule->type = dbus_message_type_from_string(v);
+        else if(klen == 9 && !strncmp(p, "interface", 9))
+            field = &rule->interface;
+        else if(klen == 6 && !strncmp(p, "member", 6))
+            field = &rule->member;
+        else if(klen == 4 && !strncmp(p, "path", 4))
+            field = &rule->path;
+        else if(klen == 14 && !strncmp(p, "path_namespace", 14))
+            field = &rule->path_namespace;
+
+        if(field)
+        {
+            p_delete(field);
+            *field = a_strdup(v);
+        }
+        g_free(v);
+
+        p = end + 1;
+    }
+
+    return rule;
+}
+
+static a_dbus_match_index_t *
+a_dbus_match_index_get(DBusConnection *dbus_connection)
+{
+    a_dbus_match_index_t *index = dbus_connection == dbus_connection_system
+        ? &dbus_match_system : &dbus_match_session;
+
+    if(!index->by_interface)
+    {
+        index->by_interface = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+                                                    (GDestroyNotify) g_ptr_array_unref);
+        index->any_interface = g_ptr_array_new_with_free_func(a_dbus_rule_free);
+    }
+
+    return index;
+}
+
+static void
+a_dbus_match_index_wipe(a_dbus_match_index_t *index)
+{
+    if(index->by_interface)
+        g_hash_table_destroy(index->by_interface);
+    if(index->any_interface)
+        g_ptr_array_unref(index->any_interface);
+    p_clear(index, 1);
+}
+
+static void
+a_dbus_match_index_add(DBusConnection *dbus_connection, const char *str)
+{
+    a_dbus_match_index_t *index = a_dbus_match_index_get(dbus_connection);
+    a_dbus_rule_t *rule = a_dbus_rule_parse(str);
+    GPtrArray *rules = index->any_interface;
+
+    if(rule->interface)
+    {
+        rules = g_hash_table_lookup(index->by_interface, rule->interface);
+        if(!rules)
+        {
+            rules = g_ptr_array_new_with_free_func(a_dbus_rule_free);
+            g_hash_table_insert(index->by_interface, g_strdup(rule->interface), rules);
+        }
+    }
+
+    g_ptr_array_add(rules, rule);
+    index->nrules++;
+}
+
+/** Remove the most recently added rule identical to str, like the bus does. */
+static void
+a_dbus_match_index_remove(DBusConnection *dbus_connection, const char *str)
+{
+    a_dbus_match_index_t *index = a_dbus_match_index_get(dbus_connection);
+    a_dbus_rule_t *parsed = a_dbus_rule_parse(str);
+    GPtrArray *rules = index->any_interface;
+
+    if(parsed->interface)
+        rules = g_hash_table_lookup(index->by_interface, parsed->interface);
+
+    for(int i = rules ? (int) rules->len - 1 : -1; i >= 0; i--)
+    {
+        a_dbus_rule_t *rule = g_ptr_array_index(rules, i);
+        if(A_STREQ(rule->rule, str))
+        {
+            g_ptr_array_remove_index(rules, i);
+            index->nrules--;
+            break;
+        }
+    }
+
+    if(parsed->interface && rules && rules->len == 0)
+        g_hash_table_remove(index->by_interface, parsed->interface);
+
+    a_dbus_rule_free(parsed);
+}
+
+static bool
+a_dbus_rule_matches(const a_dbus_rule_t *rule, DBusMessage *msg)
+{
+    if(rule->type != DBUS_MESSAGE_TYPE_INVALID
+       && rule->type != dbus_message_get_type(msg))
+        return false;
+    if(rule->member && A_STRNEQ(rule->member, dbus_message_get_member(msg)))
+        return false;
+    if(rule->path && A_STRNEQ(rule->path, dbus_message_get_path(msg)))
+        return false;
+    if(rule->path_namespace && !A_STREQ(rule->path_namespace, "/"))
+    {
+        const char *path = NONULL(dbus_message_get_path(msg));
+        size_t len = strlen(rule->path_namespace);
+        if(strncmp(path, rule->path_namespace, len) != 0
+           || (path[len] != '\0' && path[len] != '/'))
+            return false;
+    }
+    return true;
+}
+
+static bool
+a_dbus_rules_match(GPtrArray *rules, DBusMessage *msg)
+{
+    if(rules)
+        for(guint i = 0; i < rules->len; i++)
+            if(a_dbus_rule_matches(g_ptr_array_index(rules, i), msg))
+                return true;
+    return false;
+}
+
+/** Decide whether a message is worth handing to Lua.
+ * \param dbus_connection The connection the message arrived on.
+ * \param msg The message.
+ * \param interface The message interface.
+ * \return True if a handler exists and, for broadcast signals, one of our
+ * match rules covers it.
+ */
+static bool
+a_dbus_message_wanted(DBusConnection *dbus_connection, DBusMessage *msg,
+                      const char *interface)
+{
+    if(!signal_array_getbyname(&dbus_signals, NONULL(interface)))
+        return false;
+
+    /* Method calls, replies and signals addressed to us are not subject to
+     * match rules */
+    if(dbus_message_get_type(msg) != DBUS_MESSAGE_TYPE_SIGNAL
+       || dbus_message_get_destination(msg))
+        return true;
+
+    a_dbus_match_index_t *index = a_dbus_match_index_get(dbus_connection);
+
+    /* No rules at all: keep the historical behaviour of forwarding everything */
+    if(!index->nrules)
+        return true;
+
+    if(interface
+       && a_dbus_rules_match(g_hash_table_lookup(index->by_interface, interface), msg))
+        return true;
+
+    return a_dbus_rules_match(index->any_interface, msg);
+}
+
+static a_dbus_iface_stats_t *
+a_dbus_iface_stats_get(const char *interface)
+{
+    if(!dbus_iface_stats)
+        dbus_iface_stats = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+
+    interface = NONULL(interface);
+
+    a_dbus_iface_stats_t *stats = g_hash_table_lookup(dbus_iface_stats, interface);
+    if(stats)
+        return stats;
+
+    if(g_hash_table_size(dbus_iface_stats) >= A_DBUS_STATS_MAX)
+    {
+        interface = A_DBUS_STATS_OTHER;
+        if((stats = g_hash_table_lookup(dbus_iface_stats, interface)))
+            return stats;
+    }
+
+    stats = g_new0(a_dbus_iface_stats_t, 1);
+    g_hash_table_insert(dbus_iface_stats, g_strdup(interface), stats);
+    return stats;
+}
+
 /** Process a single request from D-Bus
  * \param dbus_connection  The connection to the D-Bus server.
  * \param msg The D-Bus message request being sent to the D-Bus connection.
@@ -383,6 +818,17 @@ a_dbus_process_request(DBusConnection *dbus_connection, DBusMessage *msg)
         /* Continue processing as normal D-Bus signal too */
     }
 
+    a_dbus_iface_stats_t *stats = a_dbus_iface_stats_get(interface);
+    stats->received++;
+
+    if(!a_dbus_message_wanted(dbus_connection, msg, interface))
+    {
+        stats->dropped++;
+        return;
+    }
+
+    stats->dispatched++;
+
     lua_createtable(L, 0, 5);
 
     switch(dbus_message_get_type(msg))
@@ -431,10 +877,7 @@ a_dbus_process_request(DBusConnection *dbus_connection, DBusMessage *msg)
 
     /* + 1 for the table above */
     DBusMessageIter iter;
-    int nargs = 1;
-
-    if(dbus_message_iter_init(msg, &iter))
-        nargs += a_dbus_message_iter(L, &iter);
+    int nargs = 1 + a_dbus_message_push_args(L, msg);
 
     if(dbus_message_get_no_reply(msg))
     {
@@ -454,7 +897,7 @@ a_dbus_process_request(DBusConnection *dbus_connection, DBusMessage *msg)
 
             int n = lua_gettop(L) - nargs;
 
-            luaA_object_push(L, (void *) func);
+            luaA_object_push_pointer(L, func);
             luaA_dofunction(L, nargs, LUA_MULTRET);
 
             n -= lua_gettop(L);
@@ -696,6 +1139,21 @@ a_dbus_cleanup(void)
 {
     a_dbus_cleanup_bus(dbus_connection_session, &session_source);
     a_dbus_cleanup_bus(dbus_connection_system, &system_source);
+
+    if(dbus_plan_cache)
+    {
+        g_hash_table_destroy(dbus_plan_cache);
+        dbus_plan_cache = NULL;
+    }
+
+    a_dbus_match_index_wipe(&dbus_match_session);
+    a_dbus_match_index_wipe(&dbus_match_system);
+
+    if(dbus_iface_stats)
+    {
+        g_hash_table_destroy(dbus_iface_stats);
+        dbus_iface_stats = NULL;
+    }
 }
 
 /** Retrieve the D-Bus bus by its name.
@@ -762,6 +1220,7 @@ luaA_dbus_add_match(lua_State *L)
 
     if(dbus_connection)
     {
+        a_dbus_match_index_add(dbus_connection, name);
         dbus_bus_add_match(dbus_connection, name, NULL);
         dbus_connection_flush(dbus_connection);
     }
@@ -785,6 +1244,7 @@ luaA_dbus_remove_match(lua_State *L)
 
     if(dbus_connection)
     {
+        a_dbus_match_index_remove(dbus_connection, name);
         dbus_bus_remove_match(dbus_connection, name, NULL);
         dbus_connection_flush(dbus_connection);
     }
@@ -905,6 +1365,46 @@ luaA_dbus_emit_signal(lua_State *L)
     return 1;
 }
 
+/** Get per-interface message counters.
+ *
+ * Every message received on either bus is counted under its interface
+ * (method returns and errors, which have none, under the empty string).
+ * Messages without a connected handler, or broadcast signals not covered by
+ * any rule added with add_match(), are dropped before reaching Lua.
+ *
+ * @return A table mapping interface names to tables with `received`,
+ * `dropped` and `dispatched` counts.
+ * @function get_stats
+ */
+static int
+luaA_dbus_get_stats(lua_State *L)
+{
+    GHashTableIter it;
+    gpointer key, value;
+
+    lua_createtable(L, 0, dbus_iface_stats ? g_hash_table_size(dbus_iface_stats) : 0);
+
+    if(!dbus_iface_stats)
+        return 1;
+
+    g_hash_table_iter_init(&it, dbus_iface_stats);
+    while(g_hash_table_iter_next(&it, &key, &value))
+    {
+        a_dbus_iface_stats_t *stats = value;
+
+        lua_createtable(L, 0, 3);
+        lua_pushnumber(L, stats->received);
+        lua_setfield(L, -2, "received");
+        lua_pushnumber(L, stats->dropped);
+        lua_setfield(L, -2, "dropped");
+        lua_pushnumber(L, stats->dispatched);
+        lua_setfield(L, -2, "dispatched");
+        lua_setfield(L, -2, key);
+    }
+
+    return 1;
+}
+
 const struct luaL_Reg awesome_dbus_lib[] =
 {
     { "request_name", luaA_dbus_request_name },
@@ -914,6 +1414,7 @@ const struct luaL_Reg awesome_dbus_lib[] =
     { "connect_signal", luaA_dbus_connect_signal },
     { "disconnect_signal", luaA_dbus_disconnect_signal },
     { "emit_signal", luaA_dbus_emit_signal },
+    { "get_stats", luaA_dbus_get_stats },
     { "__index", luaA_default_index },
     { "__newindex", luaA_default_newindex },
     { NULL, NULL }
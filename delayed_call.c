@@ -0,0 +1,356 @@
+/*
+ * delayed_call.c - Deferred Lua calls run at the refresh boundary
+ *
+ * Each priority class keeps a C array of calls and one Lua table, anchored
+ * in the registry, holding the callback, its arguments and its key in
+ * consecutive integer slots. Queueing a call only writes into that table,
+ * whose array part is reused across refresh cycles, so it does not
+ * allocate a table per call like the former Lua implementation. Slots are
+ * cleared as calls run so the queue keeps nothing alive.
+ *
+ * Calls queued while draining run in the same drain, after any pending
+ * call of a higher class.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <lua.h>
+#include <lauxlib.h>
+
+#include "delayed_call.h"
+#include "globalconf.h"
+#include "common/lualib.h"
+#ifdef SOMEWM_BENCH
+#include <time.h>
+#include <glib.h>
+#endif
+
+#define DELAYED_CALL_INITIAL_CAP 32
+
+typedef struct {
+	int first;   /* Slot of the callback; arguments follow */
+	int nargs;
+	bool keyed;  /* Key stored after the arguments */
+} delayed_call_t;
+
+typedef struct {
+	delayed_call_t *calls;
+	int len;
+	int cap;
+	int next;          /* First call not run yet */
+	int slots;         /* Used slots of the values table */
+	int values_ref;    /* Registry ref: callbacks, arguments, keys */
+	int keys_ref;      /* Registry ref: key -> true while queued or running */
+} delayed_queue_t;
+
+static const char *const class_names[] = { "layout", "drawing", "user", NULL };
+
+static delayed_queue_t queues[DELAYED_CALL_CLASSES];
+/* State the registry refs above belong to */
+static lua_State *queue_L;
+static int run_depth;
+/* Bumped by delayed_call_reset() so a drain notices it mid-call */
+static unsigned int generation;
+
+#ifdef SOMEWM_BENCH
+#define DELAYED_CALL_SITES_MAX 256
+
+typedef struct {
+	uint64_t count;
+	uint64_t total_ns;
+	uint64_t max_ns;
+} delayed_call_timing_t;
+
+static delayed_call_timing_t class_timing[DELAYED_CALL_CLASSES];
+static uint64_t class_deduplicated[DELAYED_CALL_CLASSES];
+/* "source:line" of the callback -> delayed_call_timing_t */
+static GHashTable *site_timing;
+
+static void
+delayed_call_timing_add(delayed_call_timing_t *t, uint64_t ns)
+{
+	t->count++;
+	t->total_ns += ns;
+	if (ns > t->max_ns)
+		t->max_ns = ns;
+}
+
+/** Timing slot for the function at index idx */
+static delayed_call_timing_t *
+delayed_call_site(lua_State *L, int idx)
+{
+	lua_Debug ar;
+	char name[128];
+	delayed_call_timing_t *t;
+
+	if (!site_timing)
+		site_timing = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+
+	lua_pushvalue(L, idx);
+	if (!lua_getinfo(L, ">S", &ar))
+		snprintf(name, sizeof(name), "?");
+	else
+		snprintf(name, sizeof(name), "%s:%d", ar.short_src, ar.linedefined);
+
+	if ((t = g_hash_table_lookup(site_timing, name)))
+		return t;
+	if (g_hash_table_size(site_timing) >= DELAYED_CALL_SITES_MAX) {
+		snprintf(name, sizeof(name), "(other)");
+		if ((t = g_hash_table_lookup(site_timing, name)))
+			return t;
+	}
+	t = g_new0(delayed_call_timing_t, 1);
+	g_hash_table_insert(site_timing, g_strdup(name), t);
+	return t;
+}
+
+static uint64_t
+delayed_call_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+#endif
+
+/** Create the Lua side of the queues in the current state on first use */
+static void
+delayed_call_setup(lua_State *L)
+{
+	lua_State *main_L = globalconf_get_lua_State();
+
+	if (queue_L == main_L)
+		return;
+
+	for (int i = 0; i < DELAYED_CALL_CLASSES; i++) {
+		delayed_queue_t *q = &queues[i];
+		lua_newtable(L);
+		q->values_ref = luaL_ref(L, LUA_REGISTRYINDEX);
+		lua_newtable(L);
+		q->keys_ref = luaL_ref(L, LUA_REGISTRYINDEX);
+		q->len = q->next = q->slots = 0;
+	}
+	queue_L = main_L;
+}
+
+void
+delayed_call_reset(void)
+{
+	/* Like some_event_queue_reset(): the refs go with the old state */
+	for (int i = 0; i < DELAYED_CALL_CLASSES; i++)
+		queues[i].len = queues[i].next = queues[i].slots = 0;
+	queue_L = NULL;
+	generation++;
+}
+
+bool
+delayed_call_pending(void)
+{
+	if (queue_L != globalconf_get_lua_State())
+		return false;
+	for (int i = 0; i < DELAYED_CALL_CLASSES; i++)
+		if (queues[i].next < queues[i].len)
+			return true;
+	return false;
+}
+
+int
+luaA_delayed_call(lua_State *L)
+{
+	int cls = luaL_checkoption(L, 1, "user", class_names);
+	bool keyed = !lua_isnoneornil(L, 2);
+	int nargs, values;
+	delayed_queue_t *q;
+	delayed_call_t *call;
+
+	luaL_checktype(L, 3, LUA_TFUNCTION);
+	nargs = lua_gettop(L) - 3;
+
+	delayed_call_setup(L);
+	q = &queues[cls];
+
+	if (keyed) {
+		lua_rawgeti(L, LUA_REGISTRYINDEX, q->keys_ref);
+		lua_pushvalue(L, 2);
+		lua_rawget(L, -2);
+		if (lua_toboolean(L, -1)) {
+#ifdef SOMEWM_BENCH
+			class_deduplicated[cls]++;
+#endif
+			lua_pushboolean(L, false);
+			return 1;
+		}
+		lua_pop(L, 1);
+		lua_pushvalue(L, 2);
+		lua_pushboolean(L, true);
+		lua_rawset(L, -3);
+		lua_pop(L, 1);
+	}
+
+	if (q->len == q->cap) {
+		int cap = q->cap ? q->cap * 2 : DELAYED_CALL_INITIAL_CAP;
+		delayed_call_t *calls = realloc(q->calls, cap * sizeof(*calls));
+		if (!calls)
+			return luaL_error(L, "out of memory queueing delayed call");
+		q->calls = calls;
+		q->cap = cap;
+	}
+
+	call = &q->calls[q->len++];
+	call->first = q->slots + 1;
+	call->nargs = nargs;
+	call->keyed = keyed;
+
+	lua_rawgeti(L, LUA_REGISTRYINDEX, q->values_ref);
+	values = lua_gettop(L);
+	for (int i = 0; i <= nargs; i++) {
+		lua_pushvalue(L, 3 + i);
+		lua_rawseti(L, values, call->first + i);
+	}
+	if (keyed) {
+		lua_pushvalue(L, 2);
+		lua_rawseti(L, values, call->first + nargs + 1);
+	}
+	q->slots = call->first + nargs + (keyed ? 1 : 0);
+
+	lua_pushboolean(L, true);
+	return 1;
+}
+
+/** Index of the highest class with a call left, -1 if none */
+static int
+delayed_call_next_class(void)
+{
+	for (int i = 0; i < DELAYED_CALL_CLASSES; i++)
+		if (queues[i].next < queues[i].len)
+			return i;
+	return -1;
+}
+
+int
+luaA_run_delayed_calls(lua_State *L)
+{
+	unsigned int gen = generation;
+	int cls;
+
+	if (queue_L != globalconf_get_lua_State())
+		return 0;
+
+	run_depth++;
+	while ((cls = delayed_call_next_class()) >= 0) {
+		delayed_queue_t *q = &queues[cls];
+		delayed_call_t call = q->calls[q->next++];
+		int top = lua_gettop(L);
+		int values, key = 0;
+
+		luaL_checkstack(L, call.nargs + 4, "too many delayed call arguments");
+		lua_rawgeti(L, LUA_REGISTRYINDEX, q->values_ref);
+		values = lua_gettop(L);
+
+		if (call.keyed) {
+			lua_rawgeti(L, values, call.first + call.nargs + 1);
+			lua_pushnil(L);
+			lua_rawseti(L, values, call.first + call.nargs + 1);
+			key = lua_gettop(L);
+		}
+		for (int i = 0; i <= call.nargs; i++) {
+			lua_rawgeti(L, values, call.first + i);
+			lua_pushnil(L);
+			lua_rawseti(L, values, call.first + i);
+		}
+
+#ifdef SOMEWM_BENCH
+		delayed_call_timing_t *site = delayed_call_site(L, -(call.nargs + 1));
+		uint64_t start = delayed_call_now();
+#endif
+		luaA_dofunction(L, call.nargs, 0);
+#ifdef SOMEWM_BENCH
+		uint64_t elapsed = delayed_call_now() - start;
+		delayed_call_timing_add(site, elapsed);
+		delayed_call_timing_add(&class_timing[cls], elapsed);
+#endif
+
+		if (gen != generation) {
+			/* The queues were dropped under us */
+			lua_settop(L, top);
+			break;
+		}
+
+		/* Release the key only now: requests made while the call ran
+		 * are covered by it */
+		if (key) {
+			lua_rawgeti(L, LUA_REGISTRYINDEX, q->keys_ref);
+			lua_pushvalue(L, key);
+			lua_pushnil(L);
+			lua_rawset(L, -3);
+		}
+		lua_settop(L, top);
+	}
+	run_depth--;
+
+	/* Everything ran: start filling the tables from slot 1 again */
+	if (run_depth == 0 && gen == generation)
+		for (int i = 0; i < DELAYED_CALL_CLASSES; i++)
+			queues[i].len = queues[i].next = queues[i].slots = 0;
+
+	return 0;
+}
+
+int
+luaA_delayed_calls_pending(lua_State *L)
+{
+	lua_pushboolean(L, delayed_call_pending());
+	return 1;
+}
+
+#ifdef SOMEWM_BENCH
+static void
+delayed_call_timing_push(lua_State *L, const delayed_call_timing_t *t)
+{
+	lua_newtable(L);
+	lua_pushinteger(L, (lua_Integer)t->count);
+	lua_setfield(L, -2, "count");
+	lua_pushnumber(L, t->count ? (double)t->total_ns / t->count / 1000.0 : 0.0);
+	lua_setfield(L, -2, "avg_us");
+	lua_pushnumber(L, (double)t->total_ns / 1000.0);
+	lua_setfield(L, -2, "total_us");
+	lua_pushnumber(L, (double)t->max_ns / 1000.0);
+	lua_setfield(L, -2, "max_us");
+}
+
+void
+delayed_call_bench_push(lua_State *L)
+{
+	GHashTableIter iter;
+	gpointer name, timing;
+
+	lua_newtable(L);
+	for (int i = 0; i < DELAYED_CALL_CLASSES; i++) {
+		delayed_call_timing_push(L, &class_timing[i]);
+		lua_pushinteger(L, (lua_Integer)class_deduplicated[i]);
+		lua_setfield(L, -2, "deduplicated");
+		lua_setfield(L, -2, class_names[i]);
+	}
+
+	lua_newtable(L);
+	if (site_timing) {
+		g_hash_table_iter_init(&iter, site_timing);
+		while (g_hash_table_iter_next(&iter, &name, &timing)) {
+			delayed_call_timing_push(L, timing);
+			lua_setfield(L, -2, name);
+		}
+	}
+	lua_setfield(L, -2, "callbacks");
+}
+
+void
+delayed_call_bench_reset(void)
+{
+	for (int i = 0; i < DELAYED_CALL_CLASSES; i++) {
+		class_timing[i] = (delayed_call_timing_t){0};
+		class_deduplicated[i] = 0;
+	}
+	if (site_timing)
+		g_hash_table_remove_all(site_timing);
+}
+#endif
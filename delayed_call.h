@@ -0,0 +1,42 @@
+/*
+ * delayed_call.h - Deferred Lua calls run at the refresh boundary
+ *
+ * Native backend of gears.timer.delayed_call(). Calls are queued in one
+ * of three priority classes (layout, drawing, user) and drained from the
+ * "refresh" signal, higher classes first and FIFO within a class. A
+ * call can carry a deduplication key: while a call with the same key is
+ * queued or running, further calls with that key are dropped (one
+ * arrange per screen).
+ */
+#ifndef DELAYED_CALL_H
+#define DELAYED_CALL_H
+
+#include <stdbool.h>
+#include <lua.h>
+
+typedef enum {
+	DELAYED_CALL_LAYOUT,
+	DELAYED_CALL_DRAWING,
+	DELAYED_CALL_USER,
+	DELAYED_CALL_CLASSES
+} delayed_call_class_t;
+
+/** Drop queued calls without touching the Lua state (hot reload) */
+void delayed_call_reset(void);
+
+bool delayed_call_pending(void);
+
+/** awesome._delayed_call(class, key, fn, ...) -> queued */
+int luaA_delayed_call(lua_State *L);
+/** awesome._run_delayed_calls() */
+int luaA_run_delayed_calls(lua_State *L);
+/** awesome._delayed_calls_pending() -> boolean */
+int luaA_delayed_calls_pending(lua_State *L);
+
+#ifdef SOMEWM_BENCH
+/** Push the delayed_calls table of awesome.bench_stats() */
+void delayed_call_bench_push(lua_State *L);
+void delayed_call_bench_reset(void);
+#endif
+
+#endif /* DELAYED_CALL_H */
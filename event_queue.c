@@ -11,6 +11,7 @@
 #include <lauxlib.h>
 
 #include "event_queue.h"
+#include "bench.h"
 #include "globalconf.h"
 #include "common/luaobject.h"
 #include "common/luaclass.h"
@@ -83,6 +84,7 @@ some_event_queue_signal0(lua_State *L, int obj_ud, uint16_t signal_id)
 	e->nargs = 0;
 	e->args_ref = LUA_NOREF;
 	e->class_ptr = NULL;
+	e->apply = NULL;
 
 	/* Capture object reference */
 	lua_pushvalue(L, obj_ud);
@@ -98,6 +100,7 @@ some_event_queue_signal(lua_State *L, int obj_ud, uint16_t signal_id,
 	e->signal_id = signal_id;
 	e->nargs = nargs;
 	e->class_ptr = NULL;
+	e->apply = NULL;
 
 	/* Capture object reference.
 	 * The caller passes obj_ud relative to the current stack which
@@ -132,6 +135,7 @@ some_event_queue_global(uint16_t signal_id)
 	e->nargs = 0;
 	e->args_ref = LUA_NOREF;
 	e->class_ptr = NULL;
+	e->apply = NULL;
 }
 
 void
@@ -144,6 +148,22 @@ some_event_queue_class(struct lua_class_t *class_ptr, uint16_t signal_id)
 	e->class_ptr = class_ptr;
 	e->nargs = 0;
 	e->args_ref = LUA_NOREF;
+	e->apply = NULL;
+}
+
+void
+some_event_queue_apply(lua_State *L, int obj_ud, some_event_apply_t apply)
+{
+	some_event_t *e = queue_push();
+	e->event_type = EVENT_APPLY;
+	e->signal_id = SIG_COUNT;  /* No signal of its own */
+	e->nargs = 0;
+	e->args_ref = LUA_NOREF;
+	e->class_ptr = NULL;
+	e->apply = apply;
+
+	lua_pushvalue(L, obj_ud);
+	e->object_ref = luaL_ref(L, LUA_REGISTRYINDEX);
 }
 
 void
@@ -202,6 +222,7 @@ some_event_queue_move(lua_State *L, int obj_ud, int local_x, int local_y)
 	e->signal_id = SIG_MOUSE_MOVE;
 	e->nargs = 2;
 	e->class_ptr = NULL;
+	e->apply = NULL;
 	e->object_ref = luaL_ref(L, LUA_REGISTRYINDEX);  /* consumes the pushed object */
 
 	lua_createtable(L, 2, 0);
@@ -219,6 +240,9 @@ some_event_queue_drain(lua_State *L)
 	 * (by signal handlers) will be processed on the next drain cycle,
 	 * not in this one. This prevents infinite loops. */
 	int count = queue_len;
+#ifdef SOMEWM_BENCH
+	int alloc_depth = bench_alloc_enter(BENCH_ALLOC_QUEUE, "drain");
+#endif
 
 	for (int i = 0; i < count; i++) {
 		/* Copy the event by value. Dispatched Lua handlers can call
@@ -228,6 +252,13 @@ some_event_queue_drain(lua_State *L)
 		 * local copy is independent of the buffer. */
 		some_event_t e = queue_buf[i];
 
+		if (e.event_type == EVENT_APPLY) {
+			lua_rawgeti(L, LUA_REGISTRYINDEX, e.object_ref);
+			e.apply(L, lua_gettop(L));
+			lua_pop(L, 1);
+			goto cleanup;
+		}
+
 		if (e.signal_id >= SIG_COUNT)
 			goto cleanup;
 
@@ -280,6 +311,9 @@ some_event_queue_drain(lua_State *L)
 		if (e.args_ref != LUA_NOREF)
 			luaL_unref(L, LUA_REGISTRYINDEX, e.args_ref);
 	}
+#ifdef SOMEWM_BENCH
+	bench_alloc_leave(alloc_depth);
+#endif
 
 	/* Remove processed events. If new events were added during drain,
 	 * shift them to the front. */
@@ -64,8 +64,12 @@ enum {
 	EVENT_OBJECT,  /* Signal on a specific Lua object */
 	EVENT_CLASS,   /* Signal on a Lua class */
 	EVENT_GLOBAL,  /* Signal on the awesome global */
+	EVENT_APPLY,   /* Callback applying C-side state to an object */
 };
 
+/* Called at drain time with the object at obj_idx */
+typedef void (*some_event_apply_t)(lua_State *L, int obj_idx);
+
 /* A single queued event */
 typedef struct {
 	uint8_t event_type;         /* EVENT_OBJECT, EVENT_CLASS, EVENT_GLOBAL */
@@ -74,6 +78,7 @@ typedef struct {
 	int nargs;                  /* Number of arguments captured */
 	int args_ref;               /* luaL_ref to args table (LUA_NOREF if 0 args) */
 	struct lua_class_t *class_ptr;/* Class for EVENT_CLASS (NULL otherwise) */
+	some_event_apply_t apply;   /* Callback for EVENT_APPLY (NULL otherwise) */
 } some_event_t;
 
 /* Queue a 0-arg signal on an object (fast path). Used for property
@@ -117,6 +122,16 @@ void some_event_queue_class(struct lua_class_t *class_ptr, uint16_t signal_id);
 void some_event_queue_move(lua_State *L, int obj_ud,
                            int local_x, int local_y);
 
+/* Queue a deferred update of an object. For state the caller stores in C
+ * and coalesces itself (client title and app_id, see property.c): queue
+ * once, keep updating the stored value, and let apply emit the signals for
+ * the latest one when the queue drains.
+ *
+ * Stack: reads the object at `obj_ud`; leaves the caller's stack
+ * unchanged. */
+void some_event_queue_apply(lua_State *L, int obj_ud,
+                            some_event_apply_t apply);
+
 /* Drain: dispatch all queued events to Lua, then clear */
 void some_event_queue_drain(lua_State *L);
 
@@ -27,10 +27,12 @@
 #include "x11_compat.h"
 #include "common/util.h"
 #include "event_queue.h"
+#include "bench.h"
 
 #ifdef XWAYLAND
 #include <xcb/xcb.h>
 #include <xcb/xcb_atom.h>
+#include <glib.h>
 #include <string.h>
 #include <stdlib.h>
 
@@ -40,6 +42,210 @@
 
 #define ALL_DESKTOPS 0xffffffff
 
+/* ========== PROPERTY BATCHING ========== */
+
+/* EWMH updates stage property values instead of writing them. ewmh_flush()
+ * runs once per refresh cycle and writes each staged value that differs
+ * from the last one written, so a property changed several times in a
+ * cycle, or set back to what it was, costs at most one request. The root
+ * window properties derived from the client and tag lists are only marked
+ * dirty and built at the flush. */
+
+typedef struct
+{
+    xcb_atom_t type;
+    uint8_t format;
+    bool deleted;
+    uint32_t len;       /* In items of format bits */
+    size_t size;        /* Bytes allocated for data */
+    uint8_t *data;
+} ewmh_prop_value_t;
+
+typedef struct
+{
+    gint64 key;
+    xcb_window_t window;
+    xcb_atom_t atom;
+    bool dirty;         /* In ewmh_dirty_props */
+    bool written;       /* sent holds what the server has */
+    ewmh_prop_value_t staged;
+    ewmh_prop_value_t sent;
+} ewmh_prop_t;
+
+enum
+{
+    EWMH_DIRTY_CLIENT_LIST          = 1 << 0,
+    EWMH_DIRTY_CLIENT_LIST_STACKING = 1 << 1,
+    EWMH_DIRTY_ACTIVE_WINDOW        = 1 << 2,
+    EWMH_DIRTY_CURRENT_DESKTOP      = 1 << 3,
+    EWMH_DIRTY_NUMBER_OF_DESKTOPS   = 1 << 4,
+    EWMH_DIRTY_DESKTOP_NAMES        = 1 << 5,
+    EWMH_DIRTY_ALL                  = (1 << 6) - 1
+};
+
+static GHashTable *ewmh_props;      /* (window, atom) -> ewmh_prop_t */
+static GPtrArray *ewmh_dirty_props;
+static unsigned int ewmh_dirty;     /* EWMH_DIRTY_* */
+static unsigned long ewmh_writes;   /* Properties sent, for tests */
+static xcb_window_t *ewmh_wins;     /* Scratch for the client lists */
+static int ewmh_wins_size;
+
+static gint64
+ewmh_prop_key(xcb_window_t window, xcb_atom_t atom)
+{
+    return ((gint64)window << 32) | atom;
+}
+
+static void
+ewmh_prop_free(gpointer data)
+{
+    ewmh_prop_t *prop = data;
+
+    p_delete(&prop->staged.data);
+    p_delete(&prop->sent.data);
+    p_delete(&prop);
+}
+
+static ewmh_prop_t *
+ewmh_prop_get(xcb_window_t window, xcb_atom_t atom)
+{
+    gint64 key = ewmh_prop_key(window, atom);
+    ewmh_prop_t *prop;
+
+    if(!ewmh_props)
+    {
+        ewmh_props = g_hash_table_new_full(g_int64_hash, g_int64_equal,
+                                           NULL, ewmh_prop_free);
+        ewmh_dirty_props = g_ptr_array_new();
+    }
+
+    if((prop = g_hash_table_lookup(ewmh_props, &key)))
+        return prop;
+
+    prop = p_new(ewmh_prop_t, 1);
+    prop->key = key;
+    prop->window = window;
+    prop->atom = atom;
+    g_hash_table_insert(ewmh_props, &prop->key, prop);
+    return prop;
+}
+
+static void
+ewmh_prop_mark(ewmh_prop_t *prop)
+{
+#ifdef SOMEWM_BENCH
+    bench_x11_update(BENCH_X11_STAGED);
+#endif
+    if(!prop->dirty)
+    {
+        prop->dirty = true;
+        g_ptr_array_add(ewmh_dirty_props, prop);
+    }
+}
+
+static bool
+ewmh_prop_value_equal(const ewmh_prop_value_t *a, const ewmh_prop_value_t *b)
+{
+    if(a->deleted || b->deleted)
+        return a->deleted == b->deleted;
+
+    return a->type == b->type
+        && a->format == b->format
+        && a->len == b->len
+        && (a->len == 0 || !memcmp(a->data, b->data, a->len * (a->format / 8)));
+}
+
+/** Stage a property write, replacing anything staged before for it.
+ * \param len The number of items of format bits in data.
+ */
+static void
+ewmh_set_property(xcb_window_t window, xcb_atom_t atom, xcb_atom_t type,
+                  uint8_t format, uint32_t len, const void *data)
+{
+    ewmh_prop_t *prop;
+    ewmh_prop_value_t *v;
+    size_t size = (size_t)len * (format / 8);
+
+    if(!window)
+        return;
+
+    prop = ewmh_prop_get(window, atom);
+    v = &prop->staged;
+    if(size > v->size)
+    {
+        p_realloc(&v->data, size);
+        v->size = size;
+    }
+    v->type = type;
+    v->format = format;
+    v->len = len;
+    v->deleted = false;
+    if(size)
+        memcpy(v->data, data, size);
+
+    ewmh_prop_mark(prop);
+}
+
+static void
+ewmh_delete_property(xcb_window_t window, xcb_atom_t atom)
+{
+    ewmh_prop_t *prop;
+
+    if(!window)
+        return;
+
+    prop = ewmh_prop_get(window, atom);
+    prop->staged.deleted = true;
+    ewmh_prop_mark(prop);
+}
+
+/** Write the staged value of a property, if the server has another. */
+static void
+ewmh_prop_write(ewmh_prop_t *prop)
+{
+    ewmh_prop_value_t tmp;
+
+    prop->dirty = false;
+
+    if(prop->written && ewmh_prop_value_equal(&prop->staged, &prop->sent))
+    {
+#ifdef SOMEWM_BENCH
+        bench_x11_update(BENCH_X11_SKIPPED);
+#endif
+        return;
+    }
+
+    if(prop->staged.deleted)
+        xcb_delete_property(globalconf.connection, prop->window, prop->atom);
+    else
+        xcb_change_property(globalconf.connection, XCB_PROP_MODE_REPLACE,
+                            prop->window, prop->atom, prop->staged.type,
+                            prop->staged.format, prop->staged.len,
+                            prop->staged.data);
+    ewmh_writes++;
+#ifdef SOMEWM_BENCH
+    bench_x11_update(BENCH_X11_SENT);
+#endif
+
+    /* Keep both buffers; the next staged value overwrites the old one */
+    tmp = prop->sent;
+    prop->sent = prop->staged;
+    prop->staged = tmp;
+    prop->written = true;
+}
+
+/** Room for n windows in ewmh_wins. */
+static xcb_window_t *
+ewmh_wins_reserve(int n)
+{
+    if(n > ewmh_wins_size)
+    {
+        ewmh_wins_size = MAX(n, ewmh_wins_size * 2);
+        p_realloc(&ewmh_wins, ewmh_wins_size);
+    }
+    return ewmh_wins;
+}
+
 /* ========== INITIALIZATION (Lines 645-680 from AwesomeWM) ========== */
 
 /** Initialize EWMH support on XWayland startup.
@@ -142,26 +348,24 @@ ewmh_init(xcb_connection_t *conn, int screen_nbr)
                         globalconf.ewmh.supported_atoms_count,
                         globalconf.ewmh.supported_atoms);
 
+    /* A new X server (XWayland restarted) has none of the properties
+     * cached for the last one */
+    if(ewmh_props)
+    {
+        g_ptr_array_set_size(ewmh_dirty_props, 0);
+        g_hash_table_remove_all(ewmh_props);
+    }
+
+    /* Tags and clients may predate XWayland; publish the lists now */
+    ewmh_dirty = EWMH_DIRTY_ALL;
+
     log_info("EWMH initialized (%zu atoms)", globalconf.ewmh.supported_atoms_count);
 }
 
 static int
 ewmh_update_net_active_window(lua_State *L)
 {
-    xcb_window_t win;
-
-    if (!globalconf.connection || !globalconf.screen)
-        return 0;
-
-    if(globalconf.focus.client && globalconf.focus.client->client_type == X11)
-        win = globalconf.focus.client->window;
-    else
-        win = XCB_NONE;
-
-    xcb_change_property(globalconf.connection, XCB_PROP_MODE_REPLACE,
-			globalconf.screen->root,
-			_NET_ACTIVE_WINDOW, XCB_ATOM_WINDOW, 32, 1, &win);
-
+    ewmh_dirty |= EWMH_DIRTY_ACTIVE_WINDOW;
     return 0;
 }
 
@@ -286,6 +490,9 @@ ewmh_client_check_hints(client_t *c)
         c->pid = pid;
     }
     free(reply);
+
+    /* State and type were set directly, bypassing the setters */
+    stack_client_changed(c);
 }
 
 /** Update client EWMH hints.
@@ -322,8 +529,7 @@ ewmh_client_update_hints(lua_State *L)
     if(c->urgent)
         state[i++] = _NET_WM_STATE_DEMANDS_ATTENTION;
 
-    xcb_change_property(globalconf.connection, XCB_PROP_MODE_REPLACE,
-                        c->window, _NET_WM_STATE, XCB_ATOM_ATOM, 32, i, state);
+    ewmh_set_property(c->window, _NET_WM_STATE, XCB_ATOM_ATOM, 32, i, state);
 
     return 0;
 }
@@ -546,21 +752,7 @@ ewmh_process_client_message(xcb_client_message_event_t *ev)
 static int
 ewmh_update_net_client_list(lua_State *L)
 {
-    int n = 0;
-
-    if (!globalconf.connection || !globalconf.screen)
-        return 0;
-
-    xcb_window_t wins[globalconf.clients.len];
-
-    foreach(client, globalconf.clients)
-        if((*client)->client_type == X11)
-            wins[n++] = (*client)->window;
-
-    xcb_change_property(globalconf.connection, XCB_PROP_MODE_REPLACE,
-                        globalconf.screen->root,
-                        _NET_CLIENT_LIST, XCB_ATOM_WINDOW, 32, n, wins);
-
+    ewmh_dirty |= EWMH_DIRTY_CLIENT_LIST;
     return 0;
 }
 
@@ -569,91 +761,161 @@ ewmh_update_net_client_list(lua_State *L)
 void
 ewmh_update_net_client_list_stacking(void)
 {
-    int n = 0;
-
-    if (!globalconf.connection || !globalconf.screen)
-        return;
-
-    xcb_window_t wins[globalconf.stack.len];
-
-    foreach(client, globalconf.stack)
-        if((*client)->client_type == X11)
-            wins[n++] = (*client)->window;
-
-    xcb_change_property(globalconf.connection, XCB_PROP_MODE_REPLACE,
-			globalconf.screen->root,
-			_NET_CLIENT_LIST_STACKING, XCB_ATOM_WINDOW, 32, n, wins);
+    ewmh_dirty |= EWMH_DIRTY_CLIENT_LIST_STACKING;
 }
 
 void
 ewmh_update_net_numbers_of_desktop(void)
 {
-    uint32_t count;
-
-    if (!globalconf.connection || !globalconf.screen)
-        return;
-
-    count = globalconf.tags.len;
-
-    xcb_change_property(globalconf.connection, XCB_PROP_MODE_REPLACE,
-			globalconf.screen->root,
-			_NET_NUMBER_OF_DESKTOPS, XCB_ATOM_CARDINAL, 32, 1, &count);
+    ewmh_dirty |= EWMH_DIRTY_NUMBER_OF_DESKTOPS;
 }
 
 int
 ewmh_update_net_current_desktop(lua_State *L)
 {
-    uint32_t idx = 0;
-    int i;
+    ewmh_dirty |= EWMH_DIRTY_CURRENT_DESKTOP;
+    return 0;
+}
 
-    if (!globalconf.connection || !globalconf.screen)
-        return 0;
+void
+ewmh_update_net_desktop_names(void)
+{
+    ewmh_dirty |= EWMH_DIRTY_DESKTOP_NAMES;
+}
 
-    /* Find first selected tag index */
-    for (i = 0; i < globalconf.tags.len; i++) {
-        if (globalconf.tags.tab[i]->selected) {
-            idx = i;
-            break;
-        }
+/** Stage the root window properties marked dirty since the last flush. */
+static void
+ewmh_stage_root(void)
+{
+    xcb_window_t root = globalconf.screen->root;
+    xcb_window_t *wins;
+    uint32_t value;
+    int n;
+
+    if(ewmh_dirty & EWMH_DIRTY_CLIENT_LIST)
+    {
+        wins = ewmh_wins_reserve(globalconf.clients.len);
+        n = 0;
+        foreach(client, globalconf.clients)
+            if((*client)->client_type == X11)
+                wins[n++] = (*client)->window;
+        ewmh_set_property(root, _NET_CLIENT_LIST, XCB_ATOM_WINDOW, 32, n, wins);
     }
 
-    xcb_change_property(globalconf.connection, XCB_PROP_MODE_REPLACE,
-                        globalconf.screen->root,
-                        _NET_CURRENT_DESKTOP, XCB_ATOM_CARDINAL, 32, 1, &idx);
-    return 0;
+    if(ewmh_dirty & EWMH_DIRTY_CLIENT_LIST_STACKING)
+    {
+        wins = ewmh_wins_reserve(globalconf.stack.len);
+        n = 0;
+        stack_foreach(client)
+            if(client->client_type == X11)
+                wins[n++] = client->window;
+        ewmh_set_property(root, _NET_CLIENT_LIST_STACKING, XCB_ATOM_WINDOW, 32, n, wins);
+    }
+
+    if(ewmh_dirty & EWMH_DIRTY_ACTIVE_WINDOW)
+    {
+        if(globalconf.focus.client && globalconf.focus.client->client_type == X11)
+            value = globalconf.focus.client->window;
+        else
+            value = XCB_NONE;
+        ewmh_set_property(root, _NET_ACTIVE_WINDOW, XCB_ATOM_WINDOW, 32, 1, &value);
+    }
+
+    if(ewmh_dirty & EWMH_DIRTY_CURRENT_DESKTOP)
+    {
+        /* First selected tag */
+        value = 0;
+        for(int i = 0; i < globalconf.tags.len; i++)
+            if(globalconf.tags.tab[i]->selected)
+            {
+                value = i;
+                break;
+            }
+        ewmh_set_property(root, _NET_CURRENT_DESKTOP, XCB_ATOM_CARDINAL, 32, 1, &value);
+    }
+
+    if(ewmh_dirty & EWMH_DIRTY_NUMBER_OF_DESKTOPS)
+    {
+        value = globalconf.tags.len;
+        ewmh_set_property(root, _NET_NUMBER_OF_DESKTOPS, XCB_ATOM_CARDINAL, 32, 1, &value);
+    }
+
+    if(ewmh_dirty & EWMH_DIRTY_DESKTOP_NAMES)
+    {
+        /* NULL-separated UTF8 string list (EWMH spec) */
+        GString *names = g_string_new(NULL);
+
+        foreach(tag, globalconf.tags)
+            g_string_append_len(names, (*tag)->name, strlen((*tag)->name) + 1);
+        if(names->len)
+            ewmh_set_property(root, _NET_DESKTOP_NAMES, UTF8_STRING, 8,
+                              names->len, names->str);
+        g_string_free(names, TRUE);
+    }
+
+    ewmh_dirty = 0;
 }
 
+/** Write the properties staged during this refresh cycle and flush the
+ * connection. Called once at the end of some_refresh().
+ */
 void
-ewmh_update_net_desktop_names(void)
+ewmh_flush(void)
 {
-    size_t total_len, len;
-    char *names, *p;
-
     if (!globalconf.connection || !globalconf.screen)
         return;
 
-    /* Build NULL-separated UTF8 string list (EWMH spec) */
-    total_len = 0;
-    foreach(tag, globalconf.tags)
-        total_len += strlen((*tag)->name) + 1;
+    if(ewmh_dirty)
+        ewmh_stage_root();
+
+    if(ewmh_dirty_props)
+    {
+        for(guint i = 0; i < ewmh_dirty_props->len; i++)
+            ewmh_prop_write(g_ptr_array_index(ewmh_dirty_props, i));
+        g_ptr_array_set_size(ewmh_dirty_props, 0);
+    }
+
+    xcb_flush(globalconf.connection);
+}
 
-    if (total_len == 0)
+/** Drop what is cached for the window of an unmanaged client, so that a
+ * later window with the same ID starts clean. Writes still pending are
+ * sent first, unless the window is gone.
+ * \param c The client.
+ * \param destroyed Whether the window was destroyed.
+ */
+void
+ewmh_client_forget(client_t *c, bool destroyed)
+{
+    xcb_atom_t atoms[] = { _NET_WM_STATE, _NET_WM_DESKTOP,
+                           _NET_WM_STRUT_PARTIAL, _NET_WM_WINDOW_TYPE };
+
+    if(!ewmh_props || c->client_type != X11 || !c->window)
         return;
 
-    names = malloc(total_len);
-    p = names;
-    foreach(tag, globalconf.tags)
+    for(int i = 0; i < countof(atoms); i++)
     {
-        len = strlen((*tag)->name);
-        memcpy(p, (*tag)->name, len);
-        p += len;
-        *p++ = '\0';
+        gint64 key = ewmh_prop_key(c->window, atoms[i]);
+        ewmh_prop_t *prop = g_hash_table_lookup(ewmh_props, &key);
+
+        if(!prop)
+            continue;
+        if(prop->dirty)
+        {
+            g_ptr_array_remove_fast(ewmh_dirty_props, prop);
+            if(!destroyed && globalconf.connection)
+                ewmh_prop_write(prop);
+        }
+        g_hash_table_remove(ewmh_props, &key);
     }
+}
 
-    xcb_change_property(globalconf.connection, XCB_PROP_MODE_REPLACE,
-			globalconf.screen->root,
-			_NET_DESKTOP_NAMES, UTF8_STRING, 8, total_len, names);
-    free(names);
+/** Number of property writes sent to the X server so far. Test hook for
+ * observing that staged values which did not change are skipped. */
+unsigned long
+ewmh_write_count(void)
+{
+    return ewmh_writes;
 }
 
 /** Update _NET_DESKTOP_GEOMETRY with screen size.
@@ -677,9 +939,8 @@ ewmh_update_net_desktop_geometry(xcb_connection_t *conn, int phys_screen)
     geom[0] = 1920;
     geom[1] = 1080;
 
-    xcb_change_property(conn, XCB_PROP_MODE_REPLACE,
-                        globalconf.screen->root,
-                        _NET_DESKTOP_GEOMETRY, XCB_ATOM_CARDINAL, 32, 2, geom);
+    ewmh_set_property(globalconf.screen->root,
+                      _NET_DESKTOP_GEOMETRY, XCB_ATOM_CARDINAL, 32, 2, geom);
 }
 
 /** Update the client active desktop.
@@ -697,20 +958,18 @@ ewmh_client_update_desktop(client_t *c)
 
     if(c->sticky)
     {
-        xcb_change_property(globalconf.connection, XCB_PROP_MODE_REPLACE,
-                            c->window, _NET_WM_DESKTOP, XCB_ATOM_CARDINAL, 32, 1,
-                            (uint32_t[]) { ALL_DESKTOPS });
+        ewmh_set_property(c->window, _NET_WM_DESKTOP, XCB_ATOM_CARDINAL, 32, 1,
+                          (uint32_t[]) { ALL_DESKTOPS });
         return;
     }
     for(i = 0; i < globalconf.tags.len; i++)
         if(is_client_tagged(c, globalconf.tags.tab[i]))
         {
-            xcb_change_property(globalconf.connection, XCB_PROP_MODE_REPLACE,
-                                c->window, _NET_WM_DESKTOP, XCB_ATOM_CARDINAL, 32, 1, &i);
+            ewmh_set_property(c->window, _NET_WM_DESKTOP, XCB_ATOM_CARDINAL, 32, 1, &i);
             return;
         }
     /* It doesn't have any tags, remove the property */
-    xcb_delete_property(globalconf.connection, c->window, _NET_WM_DESKTOP);
+    ewmh_delete_property(c->window, _NET_WM_DESKTOP);
 }
 
 /** Update the client struts.
@@ -741,8 +1000,7 @@ ewmh_update_strut(xcb_window_t window, strut_t *strut)
             strut->bottom_end_x
         };
 
-        xcb_change_property(globalconf.connection, XCB_PROP_MODE_REPLACE,
-                            window, _NET_WM_STRUT_PARTIAL, XCB_ATOM_CARDINAL, 32, 12, state);
+        ewmh_set_property(window, _NET_WM_STRUT_PARTIAL, XCB_ATOM_CARDINAL, 32, 12, state);
     }
 }
 
@@ -756,8 +1014,7 @@ ewmh_update_window_type(xcb_window_t window, uint32_t type)
     if (!globalconf.connection)
         return;
 
-    xcb_change_property(globalconf.connection, XCB_PROP_MODE_REPLACE,
-                        window, _NET_WM_WINDOW_TYPE, XCB_ATOM_ATOM, 32, 1, &type);
+    ewmh_set_property(window, _NET_WM_WINDOW_TYPE, XCB_ATOM_ATOM, 32, 1, &type);
 }
 
 /** Process the WM strut of a client.
@@ -871,6 +1128,21 @@ void ewmh_update_net_client_list_stacking(void)
     /* No-op */
 }
 
+void ewmh_flush(void)
+{
+    /* No-op */
+}
+
+void ewmh_client_forget(client_t *c, bool destroyed)
+{
+    (void)c; (void)destroyed;
+}
+
+unsigned long ewmh_write_count(void)
+{
+    return 0;
+}
+
 void ewmh_update_net_numbers_of_desktop(void)
 {
     /* No-op */
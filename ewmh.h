@@ -33,6 +33,9 @@ void ewmh_init_lua(void);
 void ewmh_update_net_numbers_of_desktop(void);
 void ewmh_update_net_desktop_names(void);
 void ewmh_update_net_client_list_stacking(void);
+void ewmh_flush(void);
+void ewmh_client_forget(client_t *, bool);
+unsigned long ewmh_write_count(void);
 void ewmh_client_check_hints(client_t *);
 void ewmh_client_update_desktop(client_t *);
 void ewmh_update_strut(xcb_window_t, strut_t *);
@@ -52,6 +55,9 @@ void ewmh_init_lua(void);
 void ewmh_update_net_numbers_of_desktop(void);
 void ewmh_update_net_desktop_names(void);
 void ewmh_update_net_client_list_stacking(void);
+void ewmh_flush(void);
+void ewmh_client_forget(client_t *c, bool destroyed);
+unsigned long ewmh_write_count(void);
 void ewmh_client_check_hints(client_t *c);
 void ewmh_client_update_desktop(client_t *c);
 void ewmh_update_strut(void *window, strut_t *strut);
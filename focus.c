@@ -71,15 +71,8 @@ focusclient(Client *c, int lift)
 
 	/* Put the new client atop the focus stack and select its monitor */
 	if (c && !client_is_unmanaged(c)) {
-		/* Remove from current position in focus stack */
-		foreach(elem, globalconf.stack) {
-			if (*elem == c) {
-				client_array_remove(&globalconf.stack, elem);
-				break;
-			}
-		}
-		/* Add to front of stack (most recent = index 0) */
-		client_array_push(&globalconf.stack, c);
+		/* Move to the front of the stack (most recent = head) */
+		stack_client_push(c);
 
 		selmon = c->mon;
 		/* Clear urgent flag via proper API to emit property::urgent signal */
@@ -132,7 +125,7 @@ focusclient(Client *c, int lift)
 		/* With no client, all we have left is to clear focus (deferred pattern) */
 		globalconf.focus.client = NULL;
 		globalconf.focus.need_update = true;
-		stack_windows();
+		stack_focus_changed();
 		return;
 	}
 
@@ -146,7 +139,7 @@ focusclient(Client *c, int lift)
 	/* Trigger stack refresh: client_layer_translator() depends on which
 	 * client has focus (e.g., fullscreen clients only get LyrFS when
 	 * focused or when the focused client is on a different screen). */
-	stack_windows();
+	stack_focus_changed();
 
 	/* Activate the new client */
 	client_activate_surface(client_surface(c), 1);
@@ -221,9 +214,9 @@ focusclient(Client *c, int lift)
 Client *
 focustop(Monitor *m)
 {
-	foreach(c, globalconf.stack) {
-		if (client_on_selected_tags(*c) && (*c)->mon == m)
-			return *c;
+	stack_foreach(c) {
+		if (client_on_selected_tags(c) && c->mon == m)
+			return c;
 	}
 	return NULL;
 }
@@ -73,6 +73,14 @@ ARRAY_TYPE(client_t *, client)
 ARRAY_TYPE(tag_t *, tag)
 #endif
 ARRAY_TYPE(screen_t *, screen)
+
+/** Intrusive list of clients, linked through client_t.stack_prev/stack_next */
+typedef struct
+{
+    client_t *head;
+    client_t *tail;
+    int len;
+} client_list_t;
 ARRAY_TYPE(drawin_t *, drawin)
 
 /* Layer surface array for layer shell surfaces */
@@ -149,8 +157,8 @@ typedef struct
     /** All managed clients */
     client_array_t clients;
 
-    /** Client stacking order (bottom to top) */
-    client_array_t stack;
+    /** Client stacking order (head is the bottom, tail the top) */
+    client_list_t stack;
 
     /** Input focus information */
     struct
@@ -311,6 +319,10 @@ typedef struct
      *  preserved across hot-reload (globalconf is zeroed by globalconf_wipe). */
     unsigned long frame_commit_count;
 
+    /** Cap on title/app_id deliveries per client per second, 0 for none
+     *  (awesome.client_property_rate, see property.c) */
+    int client_property_rate;
+
 
     /* ========== WALLPAPER SUPPORT ========== */
 
@@ -72,6 +72,9 @@ static unsigned int cursor_mode;
 static bool gesture_swipe_consumed = false;
 static bool gesture_pinch_consumed = false;
 static bool gesture_hold_consumed = false;
+/* Client a drag started from (set in requeststartdrag, cleared in
+ * destroydrag); resolves to NULL once it is unmanaged */
+static client_handle_t drag_source;
 
 /* Forward declarations */
 void axisnotify(struct wl_listener *listener, void *data);
@@ -848,15 +851,8 @@ motionnotify(uint32_t time, struct wlr_input_device *device, double dx, double d
 	/* Update drag icon's position */
 	wlr_scene_node_set_position(&drag_icon->node, (int)round(cursor->x), (int)round(cursor->y));
 
-
-	/* If drag source became invalid, clear it. */
-	if (seat->drag && drag_source_client) {
-		bool valid = false;
-		foreach(elem, globalconf.clients)
-			if (*elem == drag_source_client) { valid = true; break; }
-		if (!valid)
-			drag_source_client = NULL;
-	}
+	/* NULL once the drag source was unmanaged */
+	Client *drag_source_client = seat->drag ? client_handle_get(drag_source) : NULL;
 
 	/* During active drag over compositor surfaces (wibars), don't clear
 	 * drag focus - that would cancel the drag on drop. Instead, keep
@@ -929,24 +925,14 @@ motionnotify(uint32_t time, struct wlr_input_device *device, double dx, double d
 		Client *current_client = NULL;
 		drawin_t *current_drawin = NULL;
 		drawable_t *titlebar_drawable = NULL;
-		bool client_valid = false;
 
 		/* Find what's under cursor */
 		xytonode(cursor->x, cursor->y, NULL, &current_client, NULL, &current_drawin, &titlebar_drawable, NULL, NULL);
 
 		/* Validate client pointer - xytonode can return stale pointers from scene graph
 		 * if a node's data field wasn't cleared when the client was destroyed */
-		if (current_client) {
-			foreach(elem, globalconf.clients) {
-				if (*elem == current_client) {
-					client_valid = true;
-					break;
-				}
-			}
-			if (!client_valid) {
-				current_client = NULL;  /* Ignore stale/invalid client pointer */
-			}
-		}
+		if (current_client && !client_is_registered(current_client))
+			current_client = NULL;  /* Ignore stale/invalid client pointer */
 
 		if (current_client) {
 			/* Mouse is over a client */
@@ -1904,18 +1890,8 @@ xytonode(double x, double y, struct wlr_surface **psurface,
 found:
 	/* Validate client pointer - ensure it's still in globalconf.clients
 	 * to avoid returning stale pointers from scene graph data fields */
-	if (c && pc) {
-		bool valid = false;
-		foreach(elem, globalconf.clients) {
-			if (*elem == c) {
-				valid = true;
-				break;
-			}
-		}
-		if (!valid) {
-			c = NULL;  /* Stale pointer - don't return it */
-		}
-	}
+	if (c && pc && !client_is_registered(c))
+		c = NULL;  /* Stale pointer - don't return it */
 
 	if (psurface) *psurface = surface;
 	if (pc) *pc = c;
@@ -1994,10 +1970,10 @@ requeststartdrag(struct wl_listener *listener, void *data)
 		LayerSurface *l = NULL;
 		toplevel_from_wlr_surface(event->origin, &c, &l);
 
-		drag_source_client = c;
+		drag_source = c ? c->handle : (client_handle_t){ 0, 0 };
 	}
 	else {
-		drag_source_client = NULL;
+		drag_source = (client_handle_t){ 0, 0 };
 		wlr_data_source_destroy(event->drag->source);
 	}
 }
@@ -2021,7 +1997,7 @@ destroydrag(struct wl_listener *listener, void *data)
 	wl_list_remove(&listener->link);
 	free(listener);
 
-	drag_source_client = NULL;
+	drag_source = (client_handle_t){ 0, 0 };
 }
 
 void
@@ -2600,6 +2600,52 @@ local function register_builtin_commands()
     return "Rebuilding..."
   end)
 
+  --- startup profile - Phase timings of the last startup or hot-reload
+  ipc.register("startup.profile", function()
+    local report = capi.awesome.startup_profile()
+    if not report then
+      error("Startup profiling is off (start somewm with --startup-profile)")
+    end
+    return report
+  end)
+
+  local function profile_summary(stats)
+    return string.format("%d samples, %d outside Lua, %d stacks (%d dropped), %d Hz, %.1fs",
+      stats.samples, stats.outside_lua, stats.stacks, stats.dropped,
+      stats.hz, stats.duration_s)
+  end
+
+  --- profile start [hz] - Start the sampling Lua profiler
+  ipc.register("profile.start", function(hz)
+    local ok, err = capi.awesome.lua_profile_start(tonumber(hz))
+    if not ok then
+      error(err)
+    end
+    return "Lua profiler started"
+  end)
+
+  --- profile stop [file] - Stop it, write or return the folded stacks
+  ipc.register("profile.stop", function(path)
+    local folded, stats = capi.awesome.lua_profile_stop()
+    if not path then
+      return folded
+    end
+
+    local f, err = io.open(path, "w")
+    if not f then
+      error(err)
+    end
+    f:write(folded)
+    f:close()
+    return profile_summary(stats) .. "\nWrote " .. path
+  end)
+
+  --- profile status - Profiler state and sample counts
+  ipc.register("profile.status", function()
+    local stats = capi.awesome.lua_profile_stats()
+    return (stats.running and "running: " or "stopped: ") .. profile_summary(stats)
+  end)
+
   -- =================================================================
   -- RULES COMMANDS
   -- =================================================================
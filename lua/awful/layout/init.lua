@@ -105,8 +105,6 @@ end
 -- This is a special lock used by the arrange function.
 -- This avoids recurring call by emitted signals.
 local arrange_lock = false
--- Delay one arrange call per screen.
-local delayed_arrange = {}
 
 --- Get the current layout.
 -- @tparam screen screen The screen.
@@ -228,48 +226,56 @@ function layout.parameters(t, screen)
     return p
 end
 
+local function emit_arrange(screen)
+    if screen.valid then
+        screen:emit_signal("arrange")
+    end
+end
+
+local function arrange_screen(screen)
+    if not screen.valid then
+        -- Screen was removed
+        return
+    end
+    if arrange_lock then return end
+    arrange_lock = true
+
+    -- protected call to ensure that arrange_lock will be reset
+    protected_call(function()
+        local p = layout.parameters(nil, screen)
+
+        local useless_gap = p.useless_gap
+
+        p.geometries = setmetatable({}, {__mode = "k"})
+        layout.get(screen).arrange(p)
+
+        for c, g in pairs(p.geometries) do
+            g.width = math.max(1, g.width - c.border_width * 2 - useless_gap * 2)
+            g.height = math.max(1, g.height - c.border_width * 2 - useless_gap * 2)
+            g.x = g.x + useless_gap
+            g.y = g.y + useless_gap
+            c:geometry(g)
+        end
+    end)
+    arrange_lock = false
+
+    -- The key of this call is held until it returns. Emit from a call of
+    -- its own so that "arrange" handlers can request another arrange.
+    timer.queue_call("layout", nil, emit_arrange, screen)
+end
+
 --- Arrange a screen using its current layout.
 -- @tparam screen screen The screen to arrange.
 -- @noreturn
 -- @staticfct awful.layout.arrange
 function layout.arrange(screen)
     screen = get_screen(screen)
-    if not screen or delayed_arrange[screen] then
+    if not screen then
         return
     end
-    delayed_arrange[screen] = true
-
-    timer.delayed_call(function()
-        if not screen.valid then
-            -- Screen was removed
-            delayed_arrange[screen] = nil
-            return
-        end
-        if arrange_lock then return end
-        arrange_lock = true
-
-        -- protected call to ensure that arrange_lock will be reset
-        protected_call(function()
-            local p = layout.parameters(nil, screen)
 
-            local useless_gap = p.useless_gap
-
-            p.geometries = setmetatable({}, {__mode = "k"})
-            layout.get(screen).arrange(p)
-
-            for c, g in pairs(p.geometries) do
-                g.width = math.max(1, g.width - c.border_width * 2 - useless_gap * 2)
-                g.height = math.max(1, g.height - c.border_width * 2 - useless_gap * 2)
-                g.x = g.x + useless_gap
-                g.y = g.y + useless_gap
-                c:geometry(g)
-            end
-        end)
-        arrange_lock = false
-        delayed_arrange[screen] = nil
-
-        screen:emit_signal("arrange")
-    end)
+    -- Keyed by screen: one arrange per screen and refresh.
+    timer.queue_call("layout", screen, arrange_screen, screen)
 end
 
 --- Append a layout to the list of default tag layouts.
@@ -225,7 +225,6 @@ local capi =
 }
 local lgi = require("lgi")
 local Gio = lgi.Gio
-local GioUnix = lgi.GioUnix
 local GLib = lgi.GLib
 local gtable = require("gears.table")
 local gtimer = require("gears.timer")
@@ -418,20 +417,19 @@ function spawn.with_line_callback(cmd, callbacks)
             done_callback()
         end
     end
+    -- Lines are split and buffered in C and delivered once per refresh
+    -- cycle, see spawn_readers_dispatch() in spawn.c.
     if have_stdout then
-        spawn.read_lines(GioUnix.InputStream.new(stdout, true),
-                stdout_callback, step_done, true)
+        capi.awesome._spawn_read_lines(stdout, stdout_callback, step_done)
     end
     if have_stderr then
-        spawn.read_lines(GioUnix.InputStream.new(stderr, true),
-                stderr_callback, step_done, true)
+        capi.awesome._spawn_read_lines(stderr, stderr_callback, step_done)
     end
     assert(stdin == nil)
     return pid
 end
 
 --- Asynchronously spawn a program and capture its output.
--- (wraps `spawn.with_line_callback`).
 -- @tparam string|table cmd The command.
 -- @tparam table callback Function with the following arguments
 --   @tparam string callback.stdout Output on stdout.
@@ -444,41 +442,38 @@ end
 -- @see spawn.with_line_callback
 -- @staticfct awful.spawn.easy_async
 function spawn.easy_async(cmd, callback)
-    local stdout = ''
-    local stderr = ''
+    local stdout, stderr
     local exitcode, exitreason
-    local function parse_stdout(str)
-        stdout = stdout .. str .. "\n"
-    end
-    local function parse_stderr(str)
-        stderr = stderr .. str .. "\n"
-    end
-    local function done_callback()
-        return callback(stdout, stderr, exitreason, exitcode)
+    -- Wait for both output streams and the exit callback
+    local pending = 3
+    local function step_done()
+        pending = pending - 1
+        if pending == 0 then
+            return callback(stdout, stderr, exitreason, exitcode)
+        end
     end
-    local exit_callback_fired = false
-    local output_done_callback_fired = false
     local function exit_callback(reason, code)
         exitcode = code
         exitreason = reason
-        exit_callback_fired = true
-        if output_done_callback_fired then
-            return done_callback()
-        end
+        return step_done()
     end
-    local function output_done_callback()
-        output_done_callback_fired = true
-        if exit_callback_fired then
-            return done_callback()
-        end
+    local pid, _, _, stdout_fd, stderr_fd = capi.awesome.spawn(cmd,
+            false, false, true, true, exit_callback)
+    if type(pid) == "string" then
+        -- Error
+        return pid
     end
-    return spawn.with_line_callback(
-        cmd, {
-        stdout=parse_stdout,
-        stderr=parse_stderr,
-        exit=exit_callback,
-        output_done=output_done_callback
-    })
+    -- The whole output is accumulated in C and handed over as one string,
+    -- instead of being concatenated line by line in Lua.
+    capi.awesome._spawn_read_output(stdout_fd, function(output)
+        stdout = output
+        return step_done()
+    end)
+    capi.awesome._spawn_read_output(stderr_fd, function(output)
+        stderr = output
+        return step_done()
+    end)
+    return pid
 end
 
 --- Call `spawn.easy_async` with a shell.
@@ -201,6 +201,241 @@ function common.list_update(w, buttons, label, data, objects, args)
    end
 end
 
+-- Objects shown by the last keyed update of each layout.
+local shown_objects = setmetatable({}, { __mode = "k" })
+
+-- Record `value` as the last `key` of an entry; false if it is unchanged.
+local function changed(last, key, value)
+    if last.applied and last[key] == value then return false end
+    last[key] = value
+    return true
+end
+
+-- Apply the label outputs to a cached entry, only calling the setters of
+-- the values that differ from the previous update.
+local function apply_label(cache, text, bg, bg_image, icon, item_args)
+    local last = cache._last or {}
+    cache._last = last
+    item_args = item_args or {}
+
+    if changed(last, "text", text) then
+        if cache.tbm and (text == nil or text == "") then
+            cache.tbm:set_margins(0)
+        elseif cache.tb then
+            if not cache.tb:set_markup_silently(text) then
+                cache.tb:set_markup("<i>&lt;Invalid text&gt;</i>")
+            end
+        end
+    end
+
+    if cache.bgb then
+        if changed(last, "bg", bg) then
+            cache.bgb:set_bg(bg)
+        end
+
+        if type(bg_image) ~= "function" and changed(last, "bg_image", bg_image) then
+            cache.bgb:set_bgimage(bg_image)
+        end
+
+        if changed(last, "shape", item_args.shape) then
+            cache.bgb.shape = item_args.shape
+        end
+
+        if changed(last, "border_width", item_args.shape_border_width) then
+            cache.bgb.border_width = item_args.shape_border_width
+        end
+
+        if changed(last, "border_color", item_args.shape_border_color) then
+            cache.bgb.border_color = item_args.shape_border_color
+        end
+    end
+
+    -- Not compared: getters like `c.icon` return a new surface every time,
+    -- and a freed surface's address can come back for another icon.
+    if cache.ib and icon then
+        cache.ib:set_image(icon)
+    elseif cache.ibm then
+        cache.ibm:set_margins(0)
+    end
+
+    if cache.ib and changed(last, "icon_size", item_args.icon_size) then
+        cache.ib.forced_height = item_args.icon_size
+        cache.ib.forced_width  = item_args.icon_size
+    end
+
+    last.applied = true
+end
+
+-- Indices of a longest increasing subsequence of `seq`, as a set.
+local function lis_indices(seq)
+    local tails, prev, keep = {}, {}, {}
+
+    for i, v in ipairs(seq) do
+        local lo, hi = 1, #tails + 1
+        while lo < hi do
+            local mid = math.floor((lo + hi) / 2)
+            if seq[tails[mid]] < v then lo = mid + 1 else hi = mid end
+        end
+        prev[i] = tails[lo - 1]
+        tails[lo] = i
+    end
+
+    local i = tails[#tails]
+    while i do
+        keep[i] = true
+        i = prev[i]
+    end
+
+    return keep
+end
+
+-- Make the children of `w` match `widgets` with as few removals and
+-- insertions as possible. Returns the number of layout changes made.
+local function reconcile_children(w, widgets)
+    local current = w.get_children and w:get_children() or nil
+
+    if current and #current == #widgets then
+        local same = true
+        for i, child in ipairs(current) do
+            if child ~= widgets[i] then
+                same = false
+                break
+            end
+        end
+        if same then return 0 end
+    end
+
+    -- Layouts without indexed insertion are rebuilt.
+    if not (current and w.insert and w.remove) then
+        w:reset()
+        for _, widget in ipairs(widgets) do
+            w:add(widget)
+        end
+        return #widgets + 1
+    end
+
+    local target_pos = {}
+    for i, widget in ipairs(widgets) do
+        target_pos[widget] = i
+    end
+
+    -- Target positions of the children that stay, in their current order.
+    -- The longest increasing run of them does not need to move.
+    local positions, owners = {}, {}
+    for _, child in ipairs(current) do
+        if target_pos[child] then
+            positions[#positions + 1] = target_pos[child]
+            owners[#owners + 1] = child
+        end
+    end
+
+    local kept = {}
+    for k in pairs(lis_indices(positions)) do
+        kept[owners[k]] = true
+    end
+
+    local changes = 0
+
+    -- Back to front so the indices left to visit stay valid.
+    for i = #current, 1, -1 do
+        if not kept[current[i]] then
+            w:remove(i)
+            changes = changes + 1
+        end
+    end
+
+    for i, widget in ipairs(widgets) do
+        if w:get_children()[i] ~= widget then
+            w:insert(i, widget)
+            changes = changes + 1
+        end
+    end
+
+    return changes
+end
+
+common._lis_indices = lis_indices
+common._reconcile_children = reconcile_children
+
+--- Keyed update method.
+--
+-- Same contract as `common.list_update`, but the entries are reconciled
+-- with the previous update instead of being rebuilt: each object keeps its
+-- widget, only the label values that changed are applied (the icon is
+-- always set again), and the layout children are moved with as few
+-- removals and insertions as possible.
+--
+-- `args.dirty`, if set, is a set of the objects whose label may have
+-- changed. The other objects skip `label` and the template
+-- `update_callback` unless their position changed. Without it every label
+-- is recomputed.
+--
+-- @param w The widget.
+-- @tparam table buttons
+-- @func label Function to generate label parameters from an object.
+--   The function gets passed an object from `objects`, and
+--   has to return `text`, `bg`, `bg_image`, `icon`.
+-- @tparam table data Current data/cache, indexed by objects.
+-- @tparam table objects Objects to be displayed / updated.
+-- @tparam[opt={}] table args
+-- @treturn number The number of layout changes made.
+function common.list_update_keyed(w, buttons, label, data, objects, args)
+    local dirty = args and args.dirty
+    local widgets = {}
+    local shown = setmetatable({}, { __mode = "k" })
+
+    for i, o in ipairs(objects) do
+        local cache = data[o]
+        local fresh = false
+
+        -- Allow the buttons to be replaced.
+        if cache and cache._buttons ~= buttons then
+            cache = nil
+        end
+
+        if not cache then
+            cache = (args and args.widget_template) and
+                custom_template(args) or default_template()
+
+            cache.primary.buttons = {common.create_buttons(buttons, o)}
+
+            if cache.create_callback then
+                cache.create_callback(cache.primary, o, i, objects)
+            end
+
+            if args and args.create_callback then
+                args.create_callback(cache.primary, o, i, objects)
+            end
+
+            cache._buttons = buttons
+            data[o] = cache
+            fresh = true
+        end
+
+        if fresh or not dirty or dirty[o] or cache._index ~= i then
+            if not fresh and cache.update_callback then
+                cache.update_callback(cache.primary, o, i, objects)
+            end
+
+            apply_label(cache, label(o, cache.tb))
+        end
+
+        cache._index = i
+        widgets[i] = cache.primary
+        shown[o] = true
+    end
+
+    -- Hidden objects may change unnoticed: relabel them when they return.
+    for o in pairs(shown_objects[w] or {}) do
+        if not shown[o] and data[o] then
+            data[o]._index = nil
+        end
+    end
+    shown_objects[w] = shown
+
+    return reconcile_children(w, widgets)
+end
+
 return common
 
 -- vim: filetype=lua:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:textwidth=80
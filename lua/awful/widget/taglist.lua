@@ -556,7 +556,8 @@ end
 -- @tparam function[opt=nil] args.filter Filter function to define what clients will be listed.
 -- @tparam table args.buttons A table with buttons binding to set.
 -- @tparam[opt] function args.update_function Function to create a tag widget on each
---   update. See `awful.widget.common`.
+--   update. Defaults to `awful.widget.common.list_update_keyed`. See
+--   `awful.widget.common`.
 -- @tparam[opt] widget args.layout Optional layout widget for tag widgets. Default
 --   is wibox.layout.fixed.horizontal().
 -- @tparam[opt=awful.widget.taglist.source.for_screen] function args.source The
@@ -639,7 +640,7 @@ function taglist.new(args, filter, buttons, style, update_function, base_widget)
 
     screen = screen or get_screen(args.screen)
 
-    local uf = args.update_function or common.list_update
+    local uf = args.update_function or common.list_update_keyed
 
     local w = base.make_widget(nil, nil, {
         enable_properties = true,
@@ -673,7 +674,7 @@ function taglist.new(args, filter, buttons, style, update_function, base_widget)
     function w._do_taglist_update()
         -- Add a delayed callback for the first update.
         if not queued_update[w._private.screen] then
-            timer.delayed_call(w._do_taglist_update_now)
+            timer.queue_call("drawing", nil, w._do_taglist_update_now)
             queued_update[w._private.screen] = true
         end
     end
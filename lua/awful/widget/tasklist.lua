@@ -608,6 +608,7 @@ local function tasklist_update(s, self, buttons, filter, data, style, update_fun
         update_function(self._private.base_layout, buttons, label, data, clients, {
             widget_template = self._private.widget_template or default_template(self),
             create_callback = create_callback,
+            dirty           = self._private.dirty,
         })
     end)
 end
@@ -824,7 +825,8 @@ end
 -- @tparam function args.filter Filter function to define what clients will be listed.
 -- @tparam table args.buttons A table with buttons binding to set.
 -- @tparam[opt] function args.update_function Function to create a tag widget on each
---   update. See `awful.widget.common.list_update`.
+--   update. Defaults to `awful.widget.common.list_update_keyed`, which only
+--   updates the entries whose client changed.
 -- @tparam[opt] table args.layout Container widget for tag widgets. Default
 --   is `wibox.layout.flex.horizontal`.
 -- @tparam[opt=awful.widget.tasklist.source.all_clients] function args.source The
@@ -907,7 +909,7 @@ function tasklist.new(args, filter, buttons, style, update_function, base_widget
     end
 
     screen = screen or get_screen(args.screen)
-    local uf = args.update_function or common.list_update
+    local uf = args.update_function or common.list_update_keyed
 
     local w = base.make_widget(nil, nil, {
         enable_properties = true,
@@ -940,12 +942,20 @@ function tasklist.new(args, filter, buttons, style, update_function, base_widget
                 w._private.screen, w, w._private.buttons, w._private.filter, w._private.data, args.style, uf, args
             )
         end
+        w._private.dirty = setmetatable({}, { __mode = 'k' })
     end
 
-    function w._do_tasklist_update()
+    -- Without a client, every label may have changed.
+    function w._do_tasklist_update(c)
+        if not c then
+            w._private.dirty = nil
+        elseif w._private.dirty then
+            w._private.dirty[c] = true
+        end
+
         -- Add a delayed callback for the first update.
         if not queued_update then
-            timer.delayed_call(w._do_tasklist_update_now)
+            timer.queue_call("drawing", nil, w._do_tasklist_update_now)
             queued_update = true
         end
     end
@@ -969,32 +979,42 @@ function tasklist.new(args, filter, buttons, style, update_function, base_widget
                 end
             end
         end
+        -- Only the label of `c` changed; membership is still filtered again.
+        local function uc(c)
+            for s, i in pairs(instances) do
+                if s.valid then
+                    for _, tlist in pairs(i) do
+                        tlist._do_tasklist_update(c)
+                    end
+                end
+            end
+        end
 
         tag.attached_connect_signal(nil, "property::selected", u)
         tag.attached_connect_signal(nil, "property::activated", u)
-        capi.client.connect_signal("property::urgent", u)
-        capi.client.connect_signal("property::sticky", u)
-        capi.client.connect_signal("property::ontop", u)
-        capi.client.connect_signal("property::above", u)
-        capi.client.connect_signal("property::below", u)
-        capi.client.connect_signal("property::floating", u)
-        capi.client.connect_signal("property::maximized_horizontal", u)
-        capi.client.connect_signal("property::maximized_vertical", u)
-        capi.client.connect_signal("property::maximized", u)
-        capi.client.connect_signal("property::minimized", u)
-        capi.client.connect_signal("property::name", u)
-        capi.client.connect_signal("property::icon_name", u)
-        capi.client.connect_signal("property::icon", u)
-        capi.client.connect_signal("property::skip_taskbar", u)
+        capi.client.connect_signal("property::urgent", uc)
+        capi.client.connect_signal("property::sticky", uc)
+        capi.client.connect_signal("property::ontop", uc)
+        capi.client.connect_signal("property::above", uc)
+        capi.client.connect_signal("property::below", uc)
+        capi.client.connect_signal("property::floating", uc)
+        capi.client.connect_signal("property::maximized_horizontal", uc)
+        capi.client.connect_signal("property::maximized_vertical", uc)
+        capi.client.connect_signal("property::maximized", uc)
+        capi.client.connect_signal("property::minimized", uc)
+        capi.client.connect_signal("property::name", uc)
+        capi.client.connect_signal("property::icon_name", uc)
+        capi.client.connect_signal("property::icon", uc)
+        capi.client.connect_signal("property::skip_taskbar", uc)
         capi.client.connect_signal("property::screen", function(c, old_screen)
             us(c.screen)
             us(old_screen)
         end)
-        capi.client.connect_signal("property::hidden", u)
-        capi.client.connect_signal("tagged", u)
-        capi.client.connect_signal("untagged", u)
+        capi.client.connect_signal("property::hidden", uc)
+        capi.client.connect_signal("tagged", uc)
+        capi.client.connect_signal("untagged", uc)
         capi.client.connect_signal("request::unmanage", function(c)
-            u(c)
+            uc(c)
             for _, i in pairs(instances) do
                 for _, tlist in pairs(i) do
                     tlist._unmanage(c)
@@ -1002,7 +1022,7 @@ function tasklist.new(args, filter, buttons, style, update_function, base_widget
             end
         end)
         capi.client.connect_signal("list", u)
-        capi.client.connect_signal("property::active", u)
+        capi.client.connect_signal("property::active", uc)
         capi.screen.connect_signal("removed", function(s)
             instances[get_screen(s)] = nil
         end)
@@ -215,8 +215,294 @@ function matcher:matches_rule(o, entry)
     return true
 end
 
+-- Rule lists shorter than this are matched linearly.
+local INDEX_MIN_RULES = 16
+
+-- Fields a `rule` is indexed by, in order of preference.
+local index_fields = { "class", "instance", "role", "type", "name" }
+
+-- Lua pattern magic characters.
+local pattern_magic = "[%^%$%(%)%%%.%[%]%*%+%-%?]"
+
+-- The longest run of characters every match of the pattern `p` contains.
+-- nil if the pattern has no such run or uses %b/%f.
+local function required_literal(p)
+    local best, run = "", {}
+    local i, n = 1, #p
+
+    local function flush()
+        local s = table.concat(run)
+        if #s > #best then best = s end
+        run = {}
+    end
+
+    if p:sub(1, 1) == "^" then i = 2 end
+
+    while i <= n do
+        local c = p:sub(i, i)
+        local char, single = nil, true
+
+        if c == "%" then
+            local e = p:sub(i + 1, i + 1)
+            if e == "" or e == "b" or e == "f" then return nil end
+            -- Letters are classes or back references, others are escapes.
+            if not e:match("%w") then char = e end
+            i = i + 2
+        elseif c == "[" then
+            local j = i + 1
+            if p:sub(j, j) == "^" then j = j + 1 end
+            if p:sub(j, j) == "]" then j = j + 1 end
+            while j <= n and p:sub(j, j) ~= "]" do
+                if p:sub(j, j) == "%" then j = j + 1 end
+                j = j + 1
+            end
+            if j > n then return nil end
+            i = j + 1
+        elseif c == "(" or c == ")" or (c == "$" and i == n) then
+            single = false
+            i = i + 1
+        elseif c == "." then
+            i = i + 1
+        else
+            char = c
+            i = i + 1
+        end
+
+        local q = single and p:sub(i, i) or ""
+
+        if q == "*" or q == "-" or q == "?" then
+            flush()
+            i = i + 1
+        elseif q == "+" then
+            if char then table.insert(run, char) end
+            flush()
+            i = i + 1
+        elseif char then
+            table.insert(run, char)
+        else
+            flush()
+        end
+    end
+
+    flush()
+
+    return best ~= "" and best or nil
+end
+
+-- The keys under which a rule value is indexed, as { kind, value } pairs.
+-- "exact" keys match equal values, "substring" keys every string
+-- containing them; one of them holds for every value `default_matcher`
+-- accepts. nil if there is no such key (the rule goes to the fallback
+-- list).
+local function value_keys(value)
+    if type(value) ~= "string" then return nil end
+
+    -- An empty match is rejected, so "" only matches itself.
+    if value == "" then return {{ "exact", value }} end
+
+    if not value:find(pattern_magic) then return {{ "substring", value }} end
+
+    local inner = value:match("^%^(.*)%$$")
+    if inner and inner ~= "" and not inner:find(pattern_magic) then
+        return {{ "exact", value }, { "exact", inner }}
+    end
+
+    -- The pattern itself also matches by equality.
+    local literal = required_literal(value)
+    return literal and {{ "exact", value }, { "substring", literal }} or nil
+end
+
+-- The values one of which `o` must have for `entry` to match, as a list of
+-- { field, kind, value }. nil if the entry cannot be indexed.
+local function entry_keys(self, entry)
+    local pms = self._private.prop_matchers
+
+    if not (entry.rule or entry.rule_any) then return nil end
+
+    local keys = {}
+
+    if entry.rule then
+        -- A property matcher accepts the whole rule on its own.
+        for field in pairs(entry.rule) do
+            if pms[field] then return nil end
+        end
+
+        for _, field in ipairs(index_fields) do
+            local vkeys = value_keys(entry.rule[field])
+            if vkeys then
+                for _, k in ipairs(vkeys) do
+                    table.insert(keys, { field, k[1], k[2] })
+                end
+                break
+            end
+        end
+
+        if #keys == 0 then return nil end
+    end
+
+    if entry.rule_any then
+        for field, values in pairs(entry.rule_any) do
+            if pms[field] or type(values) ~= "table" then return nil end
+
+            for _, value in ipairs(values) do
+                local vkeys = value_keys(value)
+                if not vkeys then return nil end
+                for _, k in ipairs(vkeys) do
+                    table.insert(keys, { field, k[1], k[2] })
+                end
+            end
+        end
+    end
+
+    return keys
+end
+
+local function build_index(self, rules)
+    local index = {
+        count    = #rules,
+        entries  = {},
+        rule     = {},
+        rule_any = {},
+        fallback = {},
+        exact    = {},
+        substring = {},
+    }
+
+    for i, entry in ipairs(rules) do
+        index.entries[i]  = entry
+        index.rule[i]     = entry.rule or false
+        index.rule_any[i] = entry.rule_any or false
+
+        local keys = entry_keys(self, entry)
+
+        if not keys then
+            table.insert(index.fallback, i)
+        end
+
+        for _, key in ipairs(keys or {}) do
+            local field, kind, value = key[1], key[2], key[3]
+
+            if kind == "exact" then
+                index.exact[field] = index.exact[field] or {}
+                local bucket = index.exact[field]
+                bucket[value] = bucket[value] or {}
+                table.insert(bucket[value], i)
+            else
+                local sub = index.substring[field] or {
+                    buckets = {}, literals = {}, lengths = {}, nlengths = 0
+                }
+                index.substring[field] = sub
+
+                if not sub.buckets[value] then
+                    sub.buckets[value] = {}
+                    table.insert(sub.literals, value)
+                    if not sub.lengths[#value] then
+                        sub.lengths[#value] = true
+                        sub.nlengths = sub.nlengths + 1
+                    end
+                end
+                table.insert(sub.buckets[value], i)
+            end
+        end
+    end
+
+    return index
+end
+
+-- The index of `rules`, rebuilt if the list was modified directly. Rules
+-- whose `rule` or `rule_any` table is edited in place are not noticed;
+-- remove and append them again.
+local function rule_index(self, rules)
+    local indexes = self._private.rule_indexes
+    local index = indexes[rules]
+
+    if index and index.count == #rules then
+        for i = 1, index.count do
+            local entry = rules[i]
+            if entry ~= index.entries[i]
+              or (entry.rule or false) ~= index.rule[i]
+              or (entry.rule_any or false) ~= index.rule_any[i] then
+                index = nil
+                break
+            end
+        end
+    else
+        index = nil
+    end
+
+    if not index then
+        index = build_index(self, rules)
+        indexes[rules] = index
+    end
+
+    return index
+end
+
+-- Positions, in ascending order, of the rules `o` may match. The others
+-- are known not to match. nil when every rule has to be checked.
+local function candidate_positions(self, o, rules)
+    if #rules < INDEX_MIN_RULES
+      or self.matches_rule ~= matcher.matches_rule
+      or self._match ~= matcher._match
+      or self._match_any ~= matcher._match_any then
+        return nil
+    end
+
+    local index = rule_index(self, rules)
+    local seen, positions = {}, {}
+
+    local function add(bucket)
+        for _, i in ipairs(bucket) do
+            if not seen[i] then
+                seen[i] = true
+                table.insert(positions, i)
+            end
+        end
+    end
+
+    for field, buckets in pairs(index.exact) do
+        local value = o[field]
+        if value ~= nil and buckets[value] then
+            add(buckets[value])
+        end
+    end
+
+    for field, sub in pairs(index.substring) do
+        local value = o[field]
+
+        if type(value) == "string" then
+            -- Look up each substring of a matching length, or search for
+            -- each literal, whichever takes fewer steps.
+            if #value * sub.nlengths < #sub.literals then
+                for len in pairs(sub.lengths) do
+                    for i = 1, #value - len + 1 do
+                        local bucket = sub.buckets[value:sub(i, i + len - 1)]
+                        if bucket then add(bucket) end
+                    end
+                end
+            else
+                for _, literal in ipairs(sub.literals) do
+                    if value:find(literal, 1, true) then
+                        add(sub.buckets[literal])
+                    end
+                end
+            end
+        end
+    end
+
+    add(index.fallback)
+    table.sort(positions)
+
+    return positions
+end
+
 --- Get list of matching rules for an object.
 --
+-- Long rule lists are indexed by the literal `class`, `instance`, `role`,
+-- `type` and `name` values of their rules, so only the rules the object can
+-- match are checked. The result and its order are the same as checking
+-- every rule.
+--
 -- If the `rules` argument is not provided, the rules added with
 -- `add_matching_rules` will be used.
 --
@@ -246,6 +532,17 @@ function matcher:matching_rules(o, rules)
         return result
     end
 
+    local positions = candidate_positions(self, o, rules)
+
+    if positions then
+        for _, i in ipairs(positions) do
+            if self:matches_rule(o, rules[i]) then
+                table.insert(result, rules[i])
+            end
+        end
+        return result
+    end
+
     for _, entry in ipairs(rules) do
         if self:matches_rule(o, entry) then
             table.insert(result, entry)
@@ -261,6 +558,17 @@ end
 -- @treturn boolean True if at least one rule is matched, false otherwise.
 -- @method matches_rules
 function matcher:matches_rules(o, rules)
+    local positions = candidate_positions(self, o, rules)
+
+    if positions then
+        for _, i in ipairs(positions) do
+            if self:matches_rule(o, rules[i]) then
+                return true
+            end
+        end
+        return false
+    end
+
     for _, entry in ipairs(rules) do
         if self:matches_rule(o, entry) then
             return true
@@ -305,6 +613,8 @@ function matcher:add_property_matcher(name, f)
     assert(not self._private.prop_matchers[name], name .. " already has a matcher")
 
     self._private.prop_matchers[name] = f
+    -- Rules using `name` can no longer be indexed.
+    self._private.rule_indexes = setmetatable({}, { __mode = "k" })
 
     self:emit_signal("property_matcher::added", name, f)
 end
@@ -524,6 +834,7 @@ function matcher:append_rule(source, rule)
         self:add_matching_rules(source, {}, {}, {})
     end
     table.insert(self._matching_rules[source], rule)
+    self._private.rule_indexes[self._matching_rules[source]] = nil
     self:emit_signal("rule::appended", rule, source, self._matching_rules[source])
 end
 
@@ -549,6 +860,7 @@ function matcher:remove_rule(source, rule)
     for k, v in ipairs(self._matching_rules[source]) do
         if v == rule or v.id == rule then
             table.remove(self._matching_rules[source], k)
+            self._private.rule_indexes[self._matching_rules[source]] = nil
             self:emit_signal("rule::removed", rule, source, self._matching_rules[source])
             return true
         end
@@ -567,7 +879,8 @@ local function new()
     local ret = gobject()
 
     rawset(ret, "_private", {
-        rules = {}, prop_matchers = {}, prop_setters = {}
+        rules = {}, prop_matchers = {}, prop_setters = {},
+        rule_indexes = setmetatable({}, { __mode = "k" }),
     })
 
     -- Contains the sources.
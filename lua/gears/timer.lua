@@ -63,6 +63,10 @@ local protected_call = require("gears.protected_call")
 local gdebug = require("gears.debug")
 local gmath = require("gears.math")
 
+-- Bench builds charge Lua allocations to the timer that made them.
+local alloc_enter = capi.awesome._bench_alloc_enter
+local alloc_leave = capi.awesome._bench_alloc_leave
+
 --- Timer objects. This type of object is useful when triggering events repeatedly.
 --
 -- The timer will emit the "timeout" signal every N seconds, N being the timeout
@@ -100,7 +104,13 @@ function timer:start()
     end
     local timeout_ms = gmath.round(self.data.timeout * 1000)
     self.data.source_id = glib.timeout_add(glib.PRIORITY_DEFAULT, timeout_ms, function()
-        protected_call(self.emit_signal, self, "timeout")
+        if alloc_enter then
+            local depth = alloc_enter("timer", self.data.alloc_site)
+            protected_call(self.emit_signal, self, "timeout")
+            alloc_leave(depth)
+        else
+            protected_call(self.emit_signal, self, "timeout")
+        end
         return glib.SOURCE_CONTINUE
     end)
     self:emit_signal("start")
@@ -172,6 +182,17 @@ local timer_instance_mt = {
     end
 }
 
+-- Where the timer was created, outside of this file.
+local function creation_site()
+    for level = 3, 20 do
+        local info = debug.getinfo(level, "Sl")
+        if not info then break end
+        if not info.short_src:find("gears/timer.lua", 1, true) then
+            return info.short_src .. ":" .. (info.currentline or 0)
+        end
+    end
+end
+
 --- Create a new timer object.
 --
 -- `call_now` only takes effect when a `callback` is provided. `single_shot`,
@@ -194,6 +215,11 @@ function timer.new(args)
     local ret = object()
 
     ret.data = { timeout = 0 } --TODO v5 rename to ._private
+
+    if alloc_enter then
+        ret.data.alloc_site = creation_site()
+    end
+
     setmetatable(ret, timer_instance_mt)
 
     for k, v in pairs(args) do
@@ -267,13 +293,40 @@ function timer.weak_start_new(timeout, callback)
     end)
 end
 
-local delayed_calls = {}
+--- Priority classes of the delayed call queue, drained in this order.
+local delayed_call_classes = { "layout", "drawing", "user" }
+
+-- Lua fallback for when the native queue is unavailable (unit tests).
+local function new_delayed_queues()
+    return { layout = { next = 1 }, drawing = { next = 1 }, user = { next = 1 } }
+end
+local delayed_calls = new_delayed_queues()
+local delayed_keys = { layout = {}, drawing = {}, user = {} }
 
 --- Check if there are pending delayed calls.
 -- @treturn boolean True if there are pending delayed calls
 -- @staticfct gears.timer.has_pending_delayed_calls
 function timer.has_pending_delayed_calls()
-    return #delayed_calls > 0
+    if capi.awesome._delayed_calls_pending then
+        return capi.awesome._delayed_calls_pending()
+    end
+    for _, class in ipairs(delayed_call_classes) do
+        if delayed_calls[class].next <= #delayed_calls[class] then
+            return true
+        end
+    end
+    return false
+end
+
+local function next_delayed_call()
+    for _, class in ipairs(delayed_call_classes) do
+        local queue = delayed_calls[class]
+        if queue.next <= #queue then
+            local call = queue[queue.next]
+            queue.next = queue.next + 1
+            return class, call
+        end
+    end
 end
 
 --- Run all pending delayed calls now. This function should best not be used at
@@ -282,20 +335,63 @@ end
 -- @staticfct gears.timer.run_delayed_calls_now
 -- @noreturn
 function timer.run_delayed_calls_now()
-    for _, callback in ipairs(delayed_calls) do
-        protected_call(unpack(callback))
+    if capi.awesome._run_delayed_calls then
+        return capi.awesome._run_delayed_calls()
+    end
+    while true do
+        local class, call = next_delayed_call()
+        if not class then break end
+        protected_call(call.callback, unpack(call, 1, call.n))
+        if call.key ~= nil then
+            delayed_keys[class][call.key] = nil
+        end
+    end
+    delayed_calls = new_delayed_queues()
+end
+
+--- Call the given function at the end of the current main loop iteration.
+--
+-- Calls are run in priority classes: all `"layout"` calls first, then
+-- `"drawing"` calls, then `"user"` calls; within a class they run in the
+-- order they were queued. Calls queued while the queue is running are run
+-- in the same pass.
+--
+-- If `key` is not `nil`, the call is dropped while another call of the same
+-- class with the same key is queued or running. This is how a screen is
+-- arranged only once per refresh, however many times it was requested.
+--
+-- @tparam string priority One of `"layout"`, `"drawing"` or `"user"`.
+-- @param key Deduplication key, or `nil`.
+-- @tparam function callback The function that should be called
+-- @param ... Arguments to the callback function
+-- @treturn boolean Whether the call was queued (`false` if deduplicated).
+-- @staticfct gears.timer.queue_call
+function timer.queue_call(priority, key, callback, ...)
+    assert(type(callback) == "function", "callback must be a function, got: " .. type(callback))
+    if capi.awesome._delayed_call then
+        return capi.awesome._delayed_call(priority, key, callback, ...)
     end
-    delayed_calls = {}
+    assert(delayed_calls[priority], "invalid delayed call priority: " .. tostring(priority))
+    if key ~= nil then
+        if delayed_keys[priority][key] then
+            return false
+        end
+        delayed_keys[priority][key] = true
+    end
+    table.insert(delayed_calls[priority],
+        { callback = callback, key = key, n = select("#", ...), ... })
+    return true
 end
 
---- Call the given function at the end of the current GLib event loop iteration.
+--- Call the given function at the end of the current main loop iteration.
+--
+-- This queues the call in the `"user"` class, see `gears.timer.queue_call`.
 -- @tparam function callback The function that should be called
 -- @param ... Arguments to the callback function
 -- @noreturn
 -- @staticfct gears.timer.delayed_call
 function timer.delayed_call(callback, ...)
-    assert(type(callback) == "function", "callback must be a function, got: " .. type(callback))
-    table.insert(delayed_calls, { callback, ... })
+    timer.queue_call("user", nil, callback, ...)
 end
 
 capi.awesome.connect_signal("refresh", timer.run_delayed_calls_now)
@@ -0,0 +1,336 @@
+---------------------------------------------------------------------------
+--- Persistent index of the directories read by `menubar`.
+--
+-- Directory listings (names and modification times of the files and
+-- subdirectories) and the keys of parsed `.desktop` files are kept in
+-- `$XDG_CACHE_HOME/somewm/menubar-index.lua`, so a new session or a hot
+-- reload does not walk `XDG_DATA_DIRS` and parse every desktop entry again.
+--
+-- A cached listing is used if the directory modification time did not
+-- change; it is checked once per session, after that the listing is
+-- trusted until a watched directory reports a change. Editing a file in
+-- place does not change the directory, so listings of desktop entries also
+-- get the modification times of their files checked then. Desktop entries
+-- are reparsed only when the modification time of their file changed.
+-- Directories passed to `watch` are monitored (inotify on Linux); any change
+-- drops the session checks and emits `changed`.
+--
+-- @author somewm contributors
+-- @copyright 2026 somewm contributors
+-- @module menubar.index
+---------------------------------------------------------------------------
+
+local gfs = require("gears.filesystem")
+local gobject = require("gears.object")
+local gdebug = require("gears.debug")
+local lgi = require("lgi")
+local gio = lgi.Gio
+local glib = lgi.GLib
+
+local pairs = pairs
+local string = string
+local table = table
+
+local index = gobject {}
+
+-- Bumped when the format of the cached data changes.
+local FORMAT_VERSION = 1
+
+local QUERY = "standard::name,standard::type,time::modified,time::modified-usec"
+local MTIME_QUERY = "time::modified,time::modified-usec"
+
+--- The attributes to query when enumerating directories for listings.
+-- @tfield string menubar.index.query
+index.query = QUERY
+
+-- Cached data: { version, locale, dirs = { path -> listing },
+-- entries = { path -> { mtime, keys } } }. `keys` is false for files that
+-- are not desktop entries.
+local data = nil
+-- Directories checked in this session: path -> true (listing is current)
+-- or false (not a directory).
+local checked = {}
+local dirty = false
+local monitors = {}
+
+local function cache_file()
+    return gfs.get_cache_dir() .. "menubar-index.lua"
+end
+
+-- Localized keys are stored, so the cache is only valid for one locale.
+local function locale()
+    return table.concat(glib.get_language_names(), ":")
+end
+
+local function load_cached(path)
+    local chunk
+
+    -- Data only: the chunk gets an empty environment.
+    if setfenv then -- luacheck: globals setfenv (Lua 5.1)
+        chunk = loadfile(path)
+        if chunk then setfenv(chunk, {}) end
+    else
+        chunk = loadfile(path, "t", {})
+    end
+
+    if not chunk then return nil end
+
+    local ok, ret = pcall(chunk)
+    return ok and type(ret) == "table" and ret or nil
+end
+
+local function get_data()
+    if data then return data end
+
+    data = load_cached(cache_file())
+
+    if not data or data.version ~= FORMAT_VERSION or data.locale ~= locale()
+      or type(data.dirs) ~= "table" or type(data.entries) ~= "table" then
+        data = { version = FORMAT_VERSION, locale = locale(), dirs = {}, entries = {} }
+    end
+
+    return data
+end
+
+local function serialize(value, out)
+    local t = type(value)
+
+    if t == "table" then
+        table.insert(out, "{")
+        for k, v in pairs(value) do
+            table.insert(out, "[")
+            serialize(k, out)
+            table.insert(out, "]=")
+            serialize(v, out)
+            table.insert(out, ",")
+        end
+        table.insert(out, "}")
+    elseif t == "string" then
+        table.insert(out, string.format("%q", value))
+    elseif t == "number" then
+        table.insert(out, string.format("%.17g", value))
+    elseif t == "boolean" then
+        table.insert(out, tostring(value))
+    else
+        table.insert(out, "nil")
+    end
+end
+
+-- Modification time in microseconds (seconds alone miss quick changes).
+local function mtime_of(info)
+    return info:get_attribute_uint64("time::modified") * 1000000
+        + info:get_attribute_uint32("time::modified-usec")
+end
+
+local function parent_and_name(path)
+    return path:match("^(.*)/([^/]+)$")
+end
+
+-- Update the file modification times of a cached listing. Files that are
+-- gone are dropped; the directory's own time covers files added.
+local function stat_files(path, listing)
+    for name, mtime in pairs(listing.files) do
+        local info = gio.File.new_for_path(path .. "/" .. name):query_info(
+            MTIME_QUERY, gio.FileQueryInfoFlags.NONE)
+        local current = info and mtime_of(info) or nil
+
+        if current ~= mtime then
+            listing.files[name] = current
+            dirty = true
+        end
+    end
+end
+
+--- Get the listing of a directory if it is known to be current.
+--
+-- @tparam string path The directory.
+-- @tparam[opt] number mtime The modification time of the directory. If it
+--  matches the cached listing, that listing becomes current for the session.
+-- @tparam[opt=false] boolean check_files Also check the modification times
+--  of the cached files when the listing becomes current.
+-- @treturn table|nil The listing: `mtime`, `files` (name -> modification
+--  time) and `dirs` (name -> true).
+-- @staticfct menubar.index.get_listing
+function index.get_listing(path, mtime, check_files)
+    local cached = get_data().dirs[path]
+
+    if checked[path] then return cached end
+
+    if mtime and cached and cached.mtime == mtime then
+        if check_files then
+            stat_files(path, cached)
+        end
+        checked[path] = true
+        return cached
+    end
+end
+
+--- Store the listing of a directory read in this session.
+-- @tparam string path The directory.
+-- @tparam table listing See `get_listing`.
+-- @noreturn
+-- @staticfct menubar.index.set_listing
+function index.set_listing(path, listing)
+    get_data().dirs[path] = listing
+    checked[path] = true
+    dirty = true
+end
+
+--- Read a directory, through the cache.
+--
+-- The directory is only enumerated if it changed since it was cached.
+--
+-- @tparam string path The directory.
+-- @treturn table|nil The listing (see `get_listing`), nil if `path` is not
+--  a readable directory.
+-- @staticfct menubar.index.list_dir
+function index.list_dir(path)
+    if checked[path] == false then return nil end
+
+    local listing = checked[path] and get_data().dirs[path]
+    if listing then return listing end
+
+    local dir = gio.File.new_for_path(path)
+    local info = dir:query_info(QUERY, gio.FileQueryInfoFlags.NONE)
+
+    if not info or info:get_file_type() ~= "DIRECTORY" then
+        checked[path] = false
+        return nil
+    end
+
+    local mtime = mtime_of(info)
+    listing = index.get_listing(path, mtime)
+    if listing then return listing end
+
+    local enum = dir:enumerate_children(QUERY, gio.FileQueryInfoFlags.NONE)
+    if not enum then
+        checked[path] = false
+        return nil
+    end
+
+    listing = { mtime = mtime, files = {}, dirs = {} }
+
+    while true do
+        local child = enum:next_file()
+        if not child then break end
+        index.add_to_listing(listing, child)
+    end
+    enum:close()
+
+    index.set_listing(path, listing)
+
+    return listing
+end
+
+--- Add an enumerated `Gio.FileInfo` to a listing.
+-- @tparam table listing See `get_listing`.
+-- @tparam Gio.FileInfo info Queried with `index.query`.
+-- @noreturn
+-- @staticfct menubar.index.add_to_listing
+function index.add_to_listing(listing, info)
+    local file_type = info:get_file_type()
+
+    if file_type == "REGULAR" then
+        listing.files[info:get_name()] = mtime_of(info)
+    elseif file_type == "DIRECTORY" then
+        listing.dirs[info:get_name()] = true
+    end
+end
+
+--- Get the modification time of a `Gio.FileInfo` as stored in listings.
+-- @tparam Gio.FileInfo info Queried with `index.query`.
+-- @treturn number
+-- @staticfct menubar.index.mtime
+index.mtime = mtime_of
+
+--- Get the cached keys of a desktop entry.
+-- @tparam string path The file.
+-- @tparam number mtime Its modification time.
+-- @treturn table|boolean|nil The keys, false if the file is known not to be
+--  a desktop entry, nil if it was not cached with this modification time.
+-- @staticfct menubar.index.get_desktop_entry
+function index.get_desktop_entry(path, mtime)
+    local entry = get_data().entries[path]
+
+    if entry and entry.mtime == mtime then
+        return entry.keys
+    end
+end
+
+--- Cache the keys of a desktop entry.
+-- @tparam string path The file.
+-- @tparam number mtime Its modification time.
+-- @tparam table|boolean keys The keys, or false if it is not a desktop entry.
+-- @noreturn
+-- @staticfct menubar.index.set_desktop_entry
+function index.set_desktop_entry(path, mtime, keys)
+    get_data().entries[path] = { mtime = mtime, keys = keys }
+    dirty = true
+end
+
+--- Monitor a directory for changes.
+--
+-- A change drops the session checks of every directory (icons are usually
+-- installed along with desktop entries) and emits `changed` with the path.
+--
+-- @tparam string path The directory.
+-- @noreturn
+-- @staticfct menubar.index.watch
+function index.watch(path)
+    if monitors[path] then return end
+
+    local monitor = gio.File.new_for_path(path):monitor_directory(
+        gio.FileMonitorFlags.NONE)
+
+    if not monitor then return end
+
+    function monitor.on_changed()
+        checked = {}
+        index:emit_signal("changed", path)
+    end
+
+    monitors[path] = monitor
+end
+
+--- Write the cache to disk if anything changed.
+--
+-- Entries of files that are no longer in their cached directory are
+-- dropped.
+--
+-- @noreturn
+-- @staticfct menubar.index.save
+function index.save()
+    if not dirty then return end
+
+    local d = get_data()
+
+    for path in pairs(d.entries) do
+        local parent, name = parent_and_name(path)
+        local listing = parent and d.dirs[parent]
+        if listing and not listing.files[name] then
+            d.entries[path] = nil
+        end
+    end
+
+    local out = { "return " }
+    serialize(d, out)
+
+    local path = cache_file()
+    local tmp = path .. ".tmp"
+    local f, err = io.open(tmp, "w")
+
+    if not f then
+        gdebug.print_warning("menubar.index: cannot write " .. tmp .. ": " .. tostring(err))
+        return
+    end
+
+    f:write(table.concat(out))
+    f:close()
+    os.rename(tmp, path)
+
+    dirty = false
+end
+
+return index
+
+-- vim: filetype=lua:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:textwidth=80
@@ -40,6 +40,8 @@ local wibox = require("wibox")
 local gcolor = require("gears.color")
 local gstring = require("gears.string")
 local gdebug = require("gears.debug")
+local gtimer = require("gears.timer")
+local index = require("menubar.index")
 
 local function get_screen(s)
     return s and capi.screen[s]
@@ -83,8 +85,8 @@ menubar.utils = require("menubar.utils")
 -- Options section
 
 --- When true the .desktop files will be reparsed only when the
--- extension is initialized. Use this if menubar takes much time to
--- open.
+-- extension is initialized, or when an application directory changes.
+-- Use this if menubar takes much time to open.
 -- @tfield[opt=true] boolean cache_entries
 menubar.cache_entries = true
 
@@ -408,6 +410,21 @@ function menubar.refresh(scr)
     end)
 end
 
+-- Installing a package touches many files at once: refresh once it settled.
+local refresh_timer = gtimer {
+    timeout     = 1,
+    single_shot = true,
+    callback    = function()
+        if instance and menubar.cache_entries then
+            menubar.refresh()
+        end
+    end,
+}
+
+index:connect_signal("changed", function()
+    refresh_timer:again()
+end)
+
 --- Awful.prompt keypressed callback to be used when the user presses a key.
 -- @param mod Table of key combination modifiers (Control, Shift).
 -- @param key The key that was pressed.
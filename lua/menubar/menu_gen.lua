@@ -10,6 +10,7 @@
 local gtable = require("gears.table")
 local gfilesystem = require("gears.filesystem")
 local utils = require("menubar.utils")
+local index = require("menubar.index")
 local pairs = pairs
 local ipairs = ipairs
 local table = table
@@ -125,6 +126,7 @@ function menu_gen.generate(callback)
             end
             dirs_parsed = dirs_parsed + 1
             if dirs_parsed == #menu_gen.all_menu_dirs then
+                index.save()
                 callback(result)
             end
         end)
@@ -19,6 +19,7 @@ local glib = lgi.GLib
 local w_textbox = require("wibox.widget.textbox")
 local gdebug = require("gears.debug")
 local protected_call = require("gears.protected_call")
+local index = require("menubar.index")
 local unpack = unpack or table.unpack -- luacheck: globals unpack (compatibility with Lua 5.1)
 
 local utils = {}
@@ -246,27 +247,86 @@ function utils.lookup_icon_uncached(icon_file)
     end
 end
 
+-- Icon name -> file, for every file of the lookup path. Holds what
+-- lookup_icon_uncached() would find for names without a directory part:
+-- directories in lookup path order, and in a directory the exact name
+-- before the name with an extension appended.
+local icon_map = nil
+
+local function get_icon_map()
+    if icon_map then return icon_map end
+
+    local exts = {}
+    for ext in pairs(supported_icon_file_exts) do table.insert(exts, ext) end
+    table.sort(exts, function(a, b)
+        return supported_icon_file_exts[a] < supported_icon_file_exts[b]
+    end)
+
+    icon_map = {}
+
+    for _, directory in ipairs(get_icon_lookup_path()) do
+        local listing = index.list_dir(directory)
+
+        if listing then
+            local found = {}
+
+            for name in pairs(listing.files) do
+                if supported_icon_file_exts[name:match(".+%.(.*)$")] then
+                    found[name] = directory .. "/" .. name
+                end
+            end
+
+            for _, ext in ipairs(exts) do
+                for name in pairs(listing.files) do
+                    local stem = name:match("^(.+)%." .. ext .. "$")
+                    if stem and not found[stem] then
+                        found[stem] = directory .. "/" .. name
+                    end
+                end
+            end
+
+            for name, path in pairs(found) do
+                if icon_map[name] == nil then
+                    icon_map[name] = path
+                end
+            end
+        end
+    end
+
+    index.save()
+
+    return icon_map
+end
+
 local lookup_icon_cache = {}
+
+index:connect_signal("changed", function()
+    icon_map = nil
+    lookup_icon_cache = {}
+end)
+
 --- Lookup an icon in different folders of the filesystem (cached).
+--
+-- Names are resolved through an index of the lookup path directories,
+-- cached across sessions by `menubar.index`.
+--
 -- @param icon Short or full name of the icon.
 -- @return full name of the icon.
 -- @staticfct menubar.utils.lookup_icon
 function utils.lookup_icon(icon)
     if not lookup_icon_cache[icon] and lookup_icon_cache[icon] ~= false then
-        lookup_icon_cache[icon] = utils.lookup_icon_uncached(icon)
+        if not icon or icon == "" or icon:find("/", 1, true) then
+            -- Absolute paths and names with a directory part are probed
+            lookup_icon_cache[icon] = utils.lookup_icon_uncached(icon)
+        else
+            lookup_icon_cache[icon] = get_icon_map()[icon] or false
+        end
     end
     return lookup_icon_cache[icon] or default_icon
 end
 
---- Parse a .desktop file.
--- @param file The .desktop file.
--- @return A table with file entries.
--- @staticfct menubar.utils.parse_desktop_file
-function utils.parse_desktop_file(file)
-    local program = { show = true, file = file }
-
-    -- Parse the .desktop file.
-    -- We are interested in [Desktop Entry] group only.
+-- Read the [Desktop Entry] group of a .desktop file, nil if it has none.
+local function read_desktop_entry(file)
     local keyfile = glib.KeyFile()
     if not keyfile:load_from_file(file, glib.KeyFileFlags.NONE) then
         return nil
@@ -277,11 +337,36 @@ function utils.parse_desktop_file(file)
         return nil
     end
 
+    local keys = {}
+
     for _, key in pairs(keyfile:get_keys("Desktop Entry")) do
         local getter = keys_getters[key] or function(kf, k)
             return kf:get_string("Desktop Entry", k)
         end
-        program[key] = getter(keyfile, key)
+        keys[key] = getter(keyfile, key)
+    end
+
+    return keys
+end
+
+--- Parse a .desktop file.
+-- @param file The .desktop file.
+-- @tparam[opt] table keys The keys of its [Desktop Entry] group, as cached
+--  by `menubar.index`. Read from `file` if not given.
+-- @return A table with file entries.
+-- @staticfct menubar.utils.parse_desktop_file
+function utils.parse_desktop_file(file, keys)
+    local program = { show = true, file = file }
+
+    -- Parse the .desktop file.
+    -- We are interested in [Desktop Entry] group only.
+    keys = keys or read_desktop_entry(file)
+    if not keys then
+        return nil
+    end
+
+    for key, value in pairs(keys) do
+        program[key] = value
     end
 
     -- In case the (required) 'Name' entry was not found
@@ -354,6 +439,11 @@ function utils.parse_desktop_file(file)
 end
 
 --- Parse a directory with .desktop files recursively.
+--
+-- Listings and parsed entries come from `menubar.index` when the
+-- directories and files did not change, and the directories are watched
+-- for changes.
+--
 -- @tparam string dir_path The directory path.
 -- @tparam function callback Will be fired when all the files were parsed
 -- with the resulting list of menu entries as argument.
@@ -366,43 +456,91 @@ function utils.parse_dir(dir_path, callback)
         return file:get_path() or file:get_uri()
     end
 
-    local function parser(file, programs)
+    -- Read the listing of `file`, unless it did not change since it was
+    -- cached.
+    local function read_listing(file, path)
+        local listing = index.get_listing(path)
+        if listing then return listing end
+
         -- Except for "NONE" there is also NOFOLLOW_SYMLINKS
-        local query = gio.FILE_ATTRIBUTE_STANDARD_NAME .. "," .. gio.FILE_ATTRIBUTE_STANDARD_TYPE
-        local enum, err = file:async_enumerate_children(query, gio.FileQueryInfoFlags.NONE)
-        if not enum then
+        local info, err = file:async_query_info(index.query, gio.FileQueryInfoFlags.NONE)
+        if not info then
             gdebug.print_warning(get_readable_path(file) .. ": " .. tostring(err))
             return
         end
+
+        -- Desktop entries are edited in place too, check their times
+        listing = index.get_listing(path, index.mtime(info), true)
+        if listing then return listing end
+
+        local enum, enum_err = file:async_enumerate_children(index.query, gio.FileQueryInfoFlags.NONE)
+        if not enum then
+            gdebug.print_warning(get_readable_path(file) .. ": " .. tostring(enum_err))
+            return
+        end
+
+        listing = { mtime = index.mtime(info), files = {}, dirs = {} }
+
         local files_per_call = 100 -- Actual value is not that important
         while true do
-            local list, enum_err = enum:async_next_files(files_per_call)
+            local list
+            list, enum_err = enum:async_next_files(files_per_call)
             if enum_err then
                 gdebug.print_error(get_readable_path(file) .. ": " .. tostring(enum_err))
                 return
             end
-            for _, info in ipairs(list) do
-                local file_type = info:get_file_type()
-                local file_child = enum:get_child(info)
-                if file_type == 'REGULAR' then
-                    local path = file_child:get_path()
-                    if path then
-                        local success, program = pcall(utils.parse_desktop_file, path)
-                        if not success then
-                            gdebug.print_error("Error while reading '" .. path .. "': " .. program)
-                        elseif program then
-                            table.insert(programs, program)
-                        end
-                    end
-                elseif file_type == 'DIRECTORY' then
-                    parser(file_child, programs)
-                end
+            for _, child in ipairs(list) do
+                index.add_to_listing(listing, child)
             end
             if #list == 0 then
                 break
             end
         end
         enum:async_close()
+
+        index.set_listing(path, listing)
+
+        return listing
+    end
+
+    local function sorted_keys(t)
+        local ret = {}
+        for k in pairs(t) do table.insert(ret, k) end
+        table.sort(ret)
+        return ret
+    end
+
+    local function parser(file, programs)
+        local path = file:get_path()
+        if not path then return end
+
+        local listing = read_listing(file, path)
+        if not listing then return end
+
+        index.watch(path)
+
+        for _, name in ipairs(sorted_keys(listing.files)) do
+            local child = file:get_child(name):get_path()
+            local mtime = listing.files[name]
+            -- Only files that changed since they were cached are parsed
+            local keys = index.get_desktop_entry(child, mtime)
+            local success, program = pcall(function()
+                if keys == nil then
+                    keys = read_desktop_entry(child) or false
+                    index.set_desktop_entry(child, mtime, keys)
+                end
+                return keys and utils.parse_desktop_file(child, keys) or nil
+            end)
+            if not success then
+                gdebug.print_error("Error while reading '" .. child .. "': " .. program)
+            elseif program then
+                table.insert(programs, program)
+            end
+        end
+
+        for _, name in ipairs(sorted_keys(listing.dirs)) do
+            parser(file:get_child(name), programs)
+        end
     end
 
     gio.Async.start(do_protected_call)(function()
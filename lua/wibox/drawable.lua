@@ -415,7 +415,7 @@ function drawable.new(d, widget_context_skeleton, drawable_name)
     -- Connect our signal when we need a redraw
     ret.draw = function()
         if not ret._redraw_pending then
-            timer.delayed_call(ret._do_redraw)
+            timer.queue_call("drawing", nil, ret._do_redraw)
             ret._redraw_pending = true
         end
     end
@@ -83,14 +83,44 @@ local function hierarchy_new(redraw_callback, layout_callback, callback_arg)
     return result
 end
 
+-- Union the device space rectangle covered by a hierarchy of the given size
+-- into the region.
+local function damage_rectangle(region, matrix_to_device, width, height)
+    local x, y, w, h = matrix.transform_rectangle(matrix_to_device, 0, 0, width, height)
+    local new_x, new_y = math.floor(x), math.floor(y)
+    region:union_rectangle(cairo.RectangleInt{
+        x = new_x, y = new_y,
+        width = math.ceil(x + w) - new_x, height = math.ceil(y + h) - new_y
+    })
+end
+
+-- Move a hierarchy whose own layout is still valid to a new place in device
+-- space. Layout results are relative to the widget itself, so the subtree only
+-- needs its device matrices updated; nothing is laid out again. This is what
+-- happens to the siblings after a widget that changed its size.
+local hierarchy_move
+function hierarchy_move(self, region, matrix_to_parent, matrix_to_device)
+    damage_rectangle(region, self._matrix_to_device, self._size.width, self._size.height)
+    self._matrix = matrix_to_parent
+    self._matrix_to_device = matrix_to_device
+    damage_rectangle(region, matrix_to_device, self._size.width, self._size.height)
+
+    for _, child in ipairs(self._children) do
+        hierarchy_move(child, region, child._matrix, child._matrix * matrix_to_device)
+    end
+end
+
 local hierarchy_update
 function hierarchy_update(self, context, widget, width, height, region, matrix_to_parent, matrix_to_device)
     if (not self._need_update) and self._widget == widget and
             self._context == context and
-            self._size.width == width and self._size.height == height and
-            matrix.equals(self._matrix, matrix_to_parent) and
-            matrix.equals(self._matrix_to_device, matrix_to_device) then
-        -- Nothing changed
+            self._size.width == width and self._size.height == height then
+        if not matrix.equals(self._matrix_to_device, matrix_to_device) then
+            hierarchy_move(self, region, matrix_to_parent, matrix_to_device)
+        else
+            -- Nothing changed
+            self._matrix = matrix_to_parent
+        end
         return
     end
 
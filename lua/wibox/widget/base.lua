@@ -471,8 +471,13 @@ end
 
 -- {{{ Caches
 
--- Indexes are widgets, allow them to be garbage-collected.
-local widget_dependencies = setmetatable({}, { __mode = "kv" })
+-- Indexes are widgets, allow them to be garbage-collected. The sets of
+-- parents are held strongly: the last fit/layout results (see cached_call)
+-- survive a collection, and a parent that reuses them does not ask its
+-- children again, so nothing would record the dependencies anew. The
+-- parents in a set are weak, so a child does not keep them alive.
+local widget_dependencies = setmetatable({}, { __mode = "k" })
+local dependency_set_mt = { __mode = "k" }
 
 -- Get the cache of the given kind for this widget. This returns a gears.cache
 -- that calls the callback of kind `kind` on the widget.
@@ -485,6 +490,34 @@ local function get_cache(widget, kind)
     return widget._private.widget_caches[kind]
 end
 
+-- gears.cache holds its entries weakly, so every garbage collection cycle
+-- empties it. On top of it, keep the last result per context strongly: a
+-- relayout asks almost every widget for the same size as last time, so
+-- only the widgets that changed (and their parents, see clear_caches) have
+-- to be laid out again. Keyed weakly by context so a widget doesn't keep
+-- its old drawables alive.
+local last_result_key = { fit = "last_fit", layout = "last_layout" }
+local last_result_mt = { __mode = "k" }
+
+local function cached_call(widget, kind, context, width, height)
+    local caches = widget._private.widget_caches
+    local key = last_result_key[kind]
+    local last = caches[key]
+    if not last then
+        last = setmetatable({}, last_result_mt)
+        caches[key] = last
+    end
+
+    local entry = last[context]
+    if entry and entry.width == width and entry.height == height then
+        return entry[1], entry[2]
+    end
+
+    local r1, r2 = get_cache(widget, kind):get(context, width, height)
+    last[context] = { width = width, height = height, r1, r2 }
+    return r1, r2
+end
+
 -- Special value to skip the dependency recording that is normally done by
 -- base.fit_widget() and base.layout_widget(). The caller must ensure that no
 -- caches depend on the result of the call and/or must handle the children's
@@ -501,7 +534,7 @@ local function record_dependency(parent, child)
     base.check_widget(parent)
     base.check_widget(child)
 
-    local deps = widget_dependencies[child] or {}
+    local deps = widget_dependencies[child] or setmetatable({}, dependency_set_mt)
     deps[parent] = true
     widget_dependencies[child] = deps
 end
@@ -510,7 +543,7 @@ end
 local clear_caches
 function clear_caches(widget)
     local deps = widget_dependencies[widget] or {}
-    widget_dependencies[widget] = {}
+    widget_dependencies[widget] = nil
     widget._private.widget_caches = {}
     for w in pairs(deps) do
         clear_caches(w)
@@ -563,7 +596,7 @@ function base.fit_widget(parent, context, widget, width, height)
 
     local w, h = 0, 0
     if widget.fit then
-        w, h = get_cache(widget, "fit"):get(context, width, height)
+        w, h = cached_call(widget, "fit", context, width, height)
     else
         -- If it has no fit method, calculate based on the size of children
         local children = base.layout_widget(parent, context, widget, width, height)
@@ -610,7 +643,7 @@ function base.layout_widget(parent, context, widget, width, height)
     height = math.max(0, height)
 
     if widget.layout then
-        return get_cache(widget, "layout"):get(context, width, height)
+        return (cached_call(widget, "layout", context, width, height))
     end
 end
 
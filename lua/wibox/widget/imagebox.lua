@@ -57,6 +57,11 @@ do
     end
 end
 
+local capi = { drawable = drawable }
+
+-- C draw fast path for plain surfaces; absent outside of somewm (unit tests)
+local native = capi.drawable and capi.drawable.draw_image and capi.drawable
+
 local imagebox = { mt = {} }
 
 local rsvg_handle_cache = setmetatable({}, { __mode = 'k' })
@@ -105,6 +110,7 @@ local function set_surface(ib, surf)
     ib._private.default = { width = surf.width, height = surf.height }
     ib._private.handle = nil
     ib._private.image = surf
+    ib._private.image_native = native and surf._native
     return true
 end
 
@@ -118,6 +124,7 @@ local function set_handle(ib, handle, cache)
     ib._private.handle = handle
     ib._private.cache = cache
     ib._private.image = nil
+    ib._private.image_native = nil
 
     return true
 end
@@ -238,6 +245,10 @@ function imagebox:draw(ctx, cr, width, height)
         h = self._private.vertical_fit_policy or "auto"
     }
 
+    -- Plain surfaces without a clip shape are painted by one native call
+    local fast = native and self._private.image_native and not self._private.clip_shape
+    local scale_w, scale_h = 1, 1
+
     if self._private.resize then
         -- That's for the "fit" policy.
         local aspects = {
@@ -269,8 +280,6 @@ function imagebox:draw(ctx, cr, width, height)
             translate.y = math.floor(height - (h*aspects.h))
         end
 
-        cr:translate(translate.x, translate.y)
-
         -- Before using the scale, make sure it is below the threshold.
         local threshold, max_factor = self._private.max_scaling_factor, math.max(aspects.w, aspects.h)
 
@@ -279,12 +288,17 @@ function imagebox:draw(ctx, cr, width, height)
             aspects.h = (aspects.h*threshold)/max_factor
         end
 
-        -- Set the clip
-        if self._private.clip_shape then
-            cr:clip(self._private.clip_shape(cr, w*aspects.w, h*aspects.h, unpack(self._private.clip_args)))
-        end
+        if not fast then
+            cr:translate(translate.x, translate.y)
+
+            -- Set the clip
+            if self._private.clip_shape then
+                cr:clip(self._private.clip_shape(cr, w*aspects.w, h*aspects.h, unpack(self._private.clip_args)))
+            end
 
-        cr:scale(aspects.w, aspects.h)
+            cr:scale(aspects.w, aspects.h)
+        end
+        scale_w, scale_h = aspects.w, aspects.h
     else
         if self._private.halign == "center" then
             translate.x = math.floor((width - w)/2)
@@ -298,32 +312,36 @@ function imagebox:draw(ctx, cr, width, height)
             translate.y = math.floor(height - h)
         end
 
-        cr:translate(translate.x, translate.y)
+        if not fast then
+            cr:translate(translate.x, translate.y)
 
-        -- Set the clip
-        if self._private.clip_shape then
-            cr:clip(self._private.clip_shape(cr, w, h, unpack(self._private.clip_args)))
+            -- Set the clip
+            if self._private.clip_shape then
+                cr:clip(self._private.clip_shape(cr, w, h, unpack(self._private.clip_args)))
+            end
         end
     end
 
-    if self._private.handle then
+    -- Yes, it is possible that the vertical or horizontal policies both
+    -- have extends, but Cairo doesn't support this. So be it.
+    local extend = policies_to_extents[policy.w] and policy.w
+    extend = extend or (policies_to_extents[policy.h] and policy.h)
+    local filter = self._private.scaling_quality
+
+    if fast then
+        native.draw_image(cr._native, self._private.image_native,
+            translate.x, translate.y, scale_w, scale_h, extend, filter and filter:lower())
+    elseif self._private.handle then
         self._private.handle:render_cairo(cr)
     else
-        -- Yes, it is possible that the vertical or horizontal policies both
-        -- have extends, but Cairo doesn't support this. So be it.
-        local pol = policies_to_extents[policy.w]
-        pol = pol or policies_to_extents[policy.h]
-
-        if pol then
+        if extend then
             local pat = cairo.Pattern.create_for_surface(self._private.image)
-            pat:set_extend(pol)
+            pat:set_extend(policies_to_extents[extend])
             cr:set_source(pat)
         else
             cr:set_source_surface(self._private.image, 0, 0)
         end
 
-        local filter = self._private.scaling_quality
-
         if filter then
             cr:get_source():set_filter(cairo.Filter[filter:upper()])
         end
@@ -432,6 +450,7 @@ function imagebox:set_image(image)
         setup_succeed = true
         self._private.handle = nil
         self._private.image = nil
+        self._private.image_native = nil
         self._private.default = nil
     end
 
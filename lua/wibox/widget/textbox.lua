@@ -19,6 +19,12 @@ local Pango = lgi.Pango
 local PangoCairo = lgi.PangoCairo
 local setmetatable = setmetatable
 
+local capi = { drawable = drawable }
+
+-- C draw fast path on the native Pango layout; absent outside of somewm
+-- (unit tests), where the LGI calls below are used.
+local native = capi.drawable and capi.drawable.draw_text_layout and capi.drawable
+
 local textbox = { mt = {} }
 
 --- Set the DPI of a Pango layout
@@ -40,6 +46,12 @@ end
 
 -- Draw the given textbox on the given cairo context in the given geometry
 function textbox:draw(context, cr, width, height)
+    if native then
+        setup_dpi(self, context.dpi)
+        native.draw_text_layout(cr._native, self._private.layout_native,
+            width, height, self._private.valign)
+        return
+    end
     setup_layout(self, width, height, context.dpi)
     cr:update_layout(self._private.layout)
     local _, logical = self._private.layout:get_pixel_extents()
@@ -63,6 +75,10 @@ end
 
 -- Fit the given textbox
 function textbox:fit(context, width, height)
+    if native then
+        setup_dpi(self, context.dpi)
+        return native.fit_text_layout(self._private.layout_native, width, height)
+    end
     setup_layout(self, width, height, context.dpi)
     return do_fit_return(self)
 end
@@ -489,6 +505,7 @@ local function new(text, ignore_markup)
     ret._private.dpi = -1
     ret._private.ctx = PangoCairo.font_map_get_default():create_context()
     ret._private.layout = Pango.Layout.new(ret._private.ctx)
+    ret._private.layout_native = native and ret._private.layout._native
     ret._private.layout:set_font_description(beautiful.get_font(beautiful.font))
 
     ret:set_ellipsize("end")
@@ -43,7 +43,14 @@
 #include "dbus.h"
 #include "shadow.h"
 #include "event_queue.h"
+#include "luacache.h"
+#include "startup_profile.h"
+#include "luaprof.h"
+#include "luagc.h"
+#include "delayed_call.h"
+#include "property.h"
 #include "pam_auth.h"
+#include "ewmh.h"
 
 /* Forward declaration for Lua state recreation (used by config timeout handler) */
 static lua_State *luaA_create_fresh_state(void);
@@ -1866,6 +1873,11 @@ bool some_is_lock_drawin(drawin_t *d) {
 #ifdef SOMEWM_BENCH
 #include "bench.h"
 
+/* Last config load: rc.lua execution time excluding nested chunk loading,
+ * and the chunk loading counters at the end of it (see luaA_loadrc()). */
+static uint64_t bench_rc_exec_ns;
+static luacache_stats_t bench_rc_load;
+
 static void
 bench_push_stage_table(lua_State *L, bench_stage_t stage)
 {
@@ -1883,6 +1895,26 @@ bench_push_stage_table(lua_State *L, bench_stage_t stage)
     lua_setfield(L, -2, "p99_us");
 }
 
+#define BENCH_ALLOC_TOP 20
+
+static void
+bench_push_alloc_table(lua_State *L, const bench_alloc_stats_t *a, double elapsed)
+{
+    lua_newtable(L);
+    lua_pushinteger(L, (lua_Integer)a->calls);
+    lua_setfield(L, -2, "calls");
+    lua_pushinteger(L, (lua_Integer)a->allocs);
+    lua_setfield(L, -2, "allocs");
+    lua_pushnumber(L, (double)a->alloc_bytes / 1024.0);
+    lua_setfield(L, -2, "alloc_kb");
+    lua_pushnumber(L, (double)a->free_bytes / 1024.0);
+    lua_setfield(L, -2, "freed_kb");
+    lua_pushnumber(L, elapsed > 0 ? (double)a->alloc_bytes / 1024.0 / elapsed : 0);
+    lua_setfield(L, -2, "alloc_kb_per_s");
+    lua_pushnumber(L, a->calls ? (double)a->alloc_bytes / a->calls : 0);
+    lua_setfield(L, -2, "bytes_per_call");
+}
+
 static int
 luaA_awesome_bench_stats(lua_State *L)
 {
@@ -1983,6 +2015,174 @@ luaA_awesome_bench_stats(lua_State *L)
         lua_setfield(L, -2, "render");
     }
 
+    /* Per-output frame timing */
+    lua_newtable(L);
+    for(int i = 0; i < bench_output_stats_count(); i++) {
+        bench_output_stats_t o;
+        bench_output_stats_get(i, &o);
+        lua_newtable(L);
+        lua_pushinteger(L, (lua_Integer)o.frames);
+        lua_setfield(L, -2, "frames");
+        lua_pushinteger(L, (lua_Integer)o.presented);
+        lua_setfield(L, -2, "presented");
+        lua_pushinteger(L, (lua_Integer)o.late);
+        lua_setfield(L, -2, "late_frames");
+        lua_pushinteger(L, (lua_Integer)o.resize_waits);
+        lua_setfield(L, -2, "resize_waits");
+        lua_pushinteger(L, (lua_Integer)o.fence_timeouts);
+        lua_setfield(L, -2, "fence_timeouts");
+        lua_pushinteger(L, (lua_Integer)o.deferred);
+        lua_setfield(L, -2, "deferred_frames");
+        lua_pushinteger(L, (lua_Integer)o.missed);
+        lua_setfield(L, -2, "missed_vblanks");
+        lua_pushnumber(L, (double)o.deferred_min_ns / 1000.0);
+        lua_setfield(L, -2, "deferred_render_min_us");
+        lua_pushnumber(L, (double)o.deferred_max_ns / 1000.0);
+        lua_setfield(L, -2, "deferred_render_max_us");
+        lua_pushnumber(L, (double)o.period_ns / 1000.0);
+        lua_setfield(L, -2, "period_us");
+        lua_pushnumber(L, (double)o.render_avg_ns / 1000.0);
+        lua_setfield(L, -2, "render_avg_us");
+        lua_pushnumber(L, (double)o.render_p99_ns / 1000.0);
+        lua_setfield(L, -2, "render_p99_us");
+        lua_pushnumber(L, (double)o.render_max_ns / 1000.0);
+        lua_setfield(L, -2, "render_max_us");
+        lua_pushnumber(L, (double)o.interval_avg_ns / 1000.0);
+        lua_setfield(L, -2, "interval_avg_us");
+        lua_pushnumber(L, (double)o.interval_p99_ns / 1000.0);
+        lua_setfield(L, -2, "interval_p99_us");
+        lua_pushnumber(L, (double)o.interval_max_ns / 1000.0);
+        lua_setfield(L, -2, "interval_max_us");
+        lua_setfield(L, -2, o.name);
+    }
+    lua_setfield(L, -2, "outputs");
+
+    /* Coalesced client title/app_id updates */
+    lua_newtable(L);
+    lua_pushinteger(L, (lua_Integer)bench_prop_count(BENCH_PROP_RECEIVED));
+    lua_setfield(L, -2, "received");
+    lua_pushinteger(L, (lua_Integer)bench_prop_count(BENCH_PROP_COALESCED));
+    lua_setfield(L, -2, "coalesced");
+    lua_pushinteger(L, (lua_Integer)bench_prop_count(BENCH_PROP_RATE_LIMITED));
+    lua_setfield(L, -2, "rate_limited");
+    lua_pushinteger(L, (lua_Integer)bench_prop_count(BENCH_PROP_DELIVERED));
+    lua_setfield(L, -2, "delivered");
+    lua_setfield(L, -2, "property_updates");
+
+    /* XWayland property writes (EWMH) */
+    {
+        double x11_avg;
+        uint64_t x11_max;
+        bench_x11_stats_get(&x11_avg, &x11_max);
+        lua_newtable(L);
+        lua_pushinteger(L, (lua_Integer)bench_x11_count(BENCH_X11_STAGED));
+        lua_setfield(L, -2, "staged");
+        lua_pushinteger(L, (lua_Integer)bench_x11_count(BENCH_X11_SKIPPED));
+        lua_setfield(L, -2, "skipped");
+        lua_pushinteger(L, (lua_Integer)bench_x11_count(BENCH_X11_SENT));
+        lua_setfield(L, -2, "sent");
+        lua_pushnumber(L, x11_avg);
+        lua_setfield(L, -2, "avg_per_frame");
+        lua_pushinteger(L, (lua_Integer)x11_max);
+        lua_setfield(L, -2, "max_per_frame");
+        lua_setfield(L, -2, "x11_requests");
+    }
+
+    /* Spawn-to-exec latency */
+    {
+        uint64_t s_count, s_min, s_max, s_avg, s_p99;
+        bench_spawn_stats_get(&s_count, &s_min, &s_max, &s_avg, &s_p99);
+        lua_newtable(L);
+        lua_pushinteger(L, (lua_Integer)s_count);
+        lua_setfield(L, -2, "count");
+        lua_pushnumber(L, (double)s_min / 1000.0);
+        lua_setfield(L, -2, "min_us");
+        lua_pushnumber(L, (double)s_max / 1000.0);
+        lua_setfield(L, -2, "max_us");
+        lua_pushnumber(L, (double)s_avg / 1000.0);
+        lua_setfield(L, -2, "avg_us");
+        lua_pushnumber(L, (double)s_p99 / 1000.0);
+        lua_setfield(L, -2, "p99_us");
+        lua_setfield(L, -2, "spawn");
+    }
+
+    /* Last config load: chunk loading (parse or bytecode cache) vs. execution */
+    {
+        lua_newtable(L);
+        lua_pushnumber(L, (double)bench_rc_load.load_ns / 1000.0);
+        lua_setfield(L, -2, "load_us");
+        lua_pushnumber(L, (double)bench_rc_exec_ns / 1000.0);
+        lua_setfield(L, -2, "exec_us");
+        lua_pushinteger(L, (lua_Integer)bench_rc_load.hits);
+        lua_setfield(L, -2, "cache_hits");
+        lua_pushinteger(L, (lua_Integer)bench_rc_load.misses);
+        lua_setfield(L, -2, "cache_misses");
+        lua_setfield(L, -2, "startup");
+    }
+
+    /* Frame-paced Lua GC (time per frame is stages.gc) */
+    {
+        luagc_stats_t gc;
+        luagc_stats_get(&gc);
+        lua_newtable(L);
+        lua_pushinteger(L, (lua_Integer)gc.steps);
+        lua_setfield(L, -2, "steps");
+        lua_pushinteger(L, (lua_Integer)gc.cycles);
+        lua_setfield(L, -2, "cycles");
+        lua_pushinteger(L, (lua_Integer)gc.forced_steps);
+        lua_setfield(L, -2, "forced_steps");
+        lua_pushinteger(L, (lua_Integer)gc.step_kb);
+        lua_setfield(L, -2, "step_kb");
+        lua_setfield(L, -2, "lua_gc");
+    }
+
+    delayed_call_bench_push(L);
+    lua_setfield(L, -2, "delayed_calls");
+
+    /* Lua allocations by entry point */
+    {
+        double elapsed = bench_alloc_elapsed_s();
+        bench_alloc_stats_t sites[BENCH_ALLOC_TOP];
+        bench_alloc_stats_t total = { 0 };
+        int n;
+
+        lua_newtable(L);
+
+        lua_newtable(L);
+        for (int i = 0; i < BENCH_ALLOC_KIND_COUNT; i++) {
+            bench_alloc_stats_t k;
+            bench_alloc_kind_get(i, &k);
+            bench_push_alloc_table(L, &k, elapsed);
+            lua_setfield(L, -2, bench_alloc_kind_names[i]);
+            total.allocs += k.allocs;
+            total.alloc_bytes += k.alloc_bytes;
+            total.free_bytes += k.free_bytes;
+        }
+        lua_setfield(L, -2, "kinds");
+
+        n = bench_alloc_top(sites, BENCH_ALLOC_TOP);
+        lua_newtable(L);
+        for (int i = 0; i < n; i++) {
+            bench_push_alloc_table(L, &sites[i], elapsed);
+            lua_pushstring(L, bench_alloc_kind_names[sites[i].kind]);
+            lua_setfield(L, -2, "kind");
+            lua_pushstring(L, sites[i].name);
+            lua_setfield(L, -2, "name");
+            lua_rawseti(L, -2, i + 1);
+        }
+        lua_setfield(L, -2, "top");
+
+        lua_pushnumber(L, elapsed);
+        lua_setfield(L, -2, "elapsed_s");
+        lua_pushnumber(L, (double)total.alloc_bytes / 1024.0);
+        lua_setfield(L, -2, "alloc_kb");
+        lua_pushnumber(L, (double)total.free_bytes / 1024.0);
+        lua_setfield(L, -2, "freed_kb");
+        lua_pushnumber(L, elapsed > 0 ? (double)total.alloc_bytes / 1024.0 / elapsed : 0);
+        lua_setfield(L, -2, "alloc_kb_per_s");
+        lua_setfield(L, -2, "lua_alloc");
+    }
+
     /* Memory counters */
     extern struct wlr_scene *scene;
     lua_newtable(L);
@@ -2007,11 +2207,71 @@ luaA_awesome_bench_stats(lua_State *L)
     return 1;
 }
 
+/** awesome.bench_object_push(iterations) - push/pop the first screen
+ * object through its registry slot and through the pointer-keyed object
+ * registry; returns a table with ns per push for both. */
+static int
+luaA_awesome_bench_object_push(lua_State *L)
+{
+    int iterations = luaL_optinteger(L, 1, 1000000);
+    struct timespec start, end;
+    const void *obj;
+
+    if (globalconf.screens.len == 0)
+        return luaL_error(L, "no screen to push");
+    obj = globalconf.screens.tab[0];
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < iterations; i++) {
+        luaA_object_push(L, obj);
+        lua_pop(L, 1);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double slot_ns = (double)timespec_diff_ns(&start, &end) / iterations;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < iterations; i++) {
+        luaA_object_push_pointer(L, obj);
+        lua_pop(L, 1);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double pointer_ns = (double)timespec_diff_ns(&start, &end) / iterations;
+
+    lua_newtable(L);
+    lua_pushinteger(L, iterations);
+    lua_setfield(L, -2, "iterations");
+    lua_pushnumber(L, slot_ns);
+    lua_setfield(L, -2, "slot_ns");
+    lua_pushnumber(L, pointer_ns);
+    lua_setfield(L, -2, "pointer_ns");
+    return 1;
+}
+
+/** awesome._bench_alloc_enter(kind, name) - charge Lua allocations to an
+ * entry point that C does not see (e.g. gears.timer callbacks run by GLib)
+ * until the matching _bench_alloc_leave(depth). Returns the depth. */
+static int
+luaA_awesome_bench_alloc_enter(lua_State *L)
+{
+    bench_alloc_kind_t kind = bench_alloc_kind_from_name(luaL_checkstring(L, 1));
+    lua_pushinteger(L, bench_alloc_enter(kind, luaL_optstring(L, 2, NULL)));
+    return 1;
+}
+
+static int
+luaA_awesome_bench_alloc_leave(lua_State *L)
+{
+    bench_alloc_leave((int)luaL_checkinteger(L, 1));
+    return 0;
+}
+
 static int
 luaA_awesome_bench_reset(lua_State *L)
 {
     (void)L;
     bench_reset_all();
+    luagc_stats_reset();
+    delayed_call_bench_reset();
     return 0;
 }
 #endif
@@ -2019,6 +2279,8 @@ luaA_awesome_bench_reset(lua_State *L)
 const luaL_Reg awesome_methods[] = {
 	{ "quit", luaA_awesome_quit },
 	{ "spawn", luaA_spawn },
+	{ "_spawn_read_lines", luaA_spawn_read_lines },
+	{ "_spawn_read_output", luaA_spawn_read_output },
 	{ "new_client_placement", luaA_awesome_new_client_placement },
 	{ "get_cursor_position", luaA_awesome_get_cursor_position },
 	{ "get_cursor_monitor", luaA_awesome_get_cursor_monitor },
@@ -2044,6 +2306,7 @@ const luaL_Reg awesome_methods[] = {
 	{ "restart", luaA_restart },
 	{ "shadow_reload", luaA_awesome_shadow_reload },
 	{ "_test_add_output", luaA_awesome_test_add_output },
+	{ "_luacache_stats", luaA_luacache_stats },
 	/* Lock API methods */
 	{ "lock", luaA_awesome_lock },
 	{ "unlock", luaA_awesome_unlock },
@@ -2062,9 +2325,20 @@ const luaL_Reg awesome_methods[] = {
 	/* DPMS (display power management) API methods */
 	{ "dpms_off", luaA_awesome_dpms_off },
 	{ "dpms_on", luaA_awesome_dpms_on },
+	{ "startup_profile", luaA_awesome_startup_profile },
+	{ "lua_profile_start", luaA_awesome_lua_profile_start },
+	{ "lua_profile_stop", luaA_awesome_lua_profile_stop },
+	{ "lua_profile_stats", luaA_awesome_lua_profile_stats },
+	/* Native queue behind gears.timer.delayed_call */
+	{ "_delayed_call", luaA_delayed_call },
+	{ "_run_delayed_calls", luaA_run_delayed_calls },
+	{ "_delayed_calls_pending", luaA_delayed_calls_pending },
 #ifdef SOMEWM_BENCH
 	{ "bench_stats", luaA_awesome_bench_stats },
 	{ "bench_reset", luaA_awesome_bench_reset },
+	{ "_bench_alloc_enter", luaA_awesome_bench_alloc_enter },
+	{ "_bench_alloc_leave", luaA_awesome_bench_alloc_leave },
+	{ "bench_object_push", luaA_awesome_bench_object_push },
 #endif
 	{ NULL, NULL }
 };
@@ -2142,11 +2416,24 @@ luaA_awesome_index(lua_State *L)
 		return 1;
 	}
 
+	/* Monotonic count of X11 property writes sent by the EWMH batcher (see
+	 * tests/test-xwayland-ewmh-batch.lua) */
+	if (A_STREQ(key, "_test_ewmh_writes")) {
+		lua_pushinteger(L, (lua_Integer)ewmh_write_count());
+		return 1;
+	}
+
 	if (A_STREQ(key, "bypass_surface_visibility")) {
 		lua_pushboolean(L, globalconf.appearance.bypass_surface_visibility);
 		return 1;
 	}
 
+	/* Max title/app_id updates per client per second, 0 = no cap */
+	if (A_STREQ(key, "client_property_rate")) {
+		lua_pushinteger(L, globalconf.client_property_rate);
+		return 1;
+	}
+
 	if (A_STREQ(key, "startup")) {
 		lua_pushboolean(L, globalconf.loop == NULL);
 		return 1;
@@ -2272,6 +2559,13 @@ luaA_awesome_newindex(lua_State *L)
 		return 0;
 	}
 
+	if (A_STREQ(key, "client_property_rate")) {
+		lua_Integer rate = luaL_checkinteger(L, 3);
+		luaL_argcheck(L, rate >= 0, 3, "rate must be >= 0");
+		globalconf.client_property_rate = (int)rate;
+		return 0;
+	}
+
 	if (A_STREQ(key, "idle_inhibit")) {
 		lua_idle_inhibited = lua_toboolean(L, 3);
 		some_recompute_idle_inhibit();
@@ -2587,6 +2881,12 @@ luaAe_type(lua_State *L)
 static void
 luaA_fixups(lua_State *L)
 {
+	/* Load Lua modules through the bytecode cache */
+	luacache_install_searcher(L);
+
+	/* Let frame holds see a collectgarbage("stop") from the config */
+	luagc_install(L);
+
 	/* Export string.wlen for UTF-8 aware string length */
 	lua_getglobal(L, "string");
 	lua_pushcfunction(L, luaA_mbstrlen);
@@ -2748,6 +3048,9 @@ luaA_init(void)
 		fprintf(stderr, "somewm: failed to create Lua state\n");
 		return;
 	}
+#ifdef SOMEWM_BENCH
+	bench_alloc_install(globalconf_L);
+#endif
 
 	/* Set panic handler for unprotected errors (AwesomeWM API parity) */
 	lua_atpanic(globalconf_L, luaA_panic);
@@ -4382,6 +4685,8 @@ luaA_loadrc(void)
 		return;
 	}
 
+	luacache_stats_reset();
+
 	/* Install require() hooks for Wayland compatibility.
 	 * 1. Track filepath in gears.surface.load_uncached_silently (for cache miss path)
 	 * 2. Track screen in gears.wallpaper.maximized (for per-screen caching)
@@ -4450,6 +4755,10 @@ luaA_loadrc(void)
 		lua_pop(globalconf_L, 1);
 	}
 
+	/* Outermost wrapper, so the hooks above are timed as part of require() */
+	startup_profile_install_require(globalconf_L);
+	startup_profile_begin("rc.lua");
+
 	/* If custom config path was specified via -c flag, use only that */
 	if (custom_confpath) {
 		config_paths[path_count++] = custom_confpath;
@@ -4517,8 +4826,9 @@ luaA_loadrc(void)
 			continue;
 		}
 
-		/* Use luaL_loadfile + lua_pcall with traceback for better errors */
-		load_result = luaL_loadfile(globalconf_L, config_paths[i]);
+		/* Load (through the bytecode cache) + lua_pcall with traceback
+		 * for better errors */
+		load_result = luacache_loadfile(globalconf_L, config_paths[i]);
 		if (load_result != 0) {
 			/* File doesn't exist or syntax error */
 			const char *err = lua_tostring(globalconf_L, -1);
@@ -4611,6 +4921,11 @@ luaA_loadrc(void)
 			luaA_cleanup_stale_glib_sources("config-timeout");
 			luaA_signal_cleanup();
 			luaA_keybinding_cleanup();
+			/* The profiler's hook and timer point at this state */
+			luaprof_stop();
+#ifdef SOMEWM_BENCH
+			bench_alloc_uninstall(globalconf_L);
+#endif
 			lua_close(globalconf_L);
 			globalconf_L = NULL;
 			globalconf.L = NULL;
@@ -4632,9 +4947,22 @@ luaA_loadrc(void)
 
 		alarm(10);  /* 10 second timeout */
 
+#ifdef SOMEWM_BENCH
+		struct timespec rc_start, rc_end;
+		luacache_stats_t rc_load_before;
+		luacache_stats_get(&rc_load_before);
+		clock_gettime(CLOCK_MONOTONIC, &rc_start);
+#endif
+
 		/* Execute with protected call using error handler */
 		if (lua_pcall(globalconf_L, 0, 0, -2) == 0) {
 			config_timeout_jmp_valid = 0;
+#ifdef SOMEWM_BENCH
+			clock_gettime(CLOCK_MONOTONIC, &rc_end);
+			luacache_stats_get(&bench_rc_load);
+			bench_rc_exec_ns = timespec_diff_ns(&rc_start, &rc_end)
+				- (bench_rc_load.load_ns - rc_load_before.load_ns);
+#endif
 			/* Success - cancel timeout and restore signal handler */
 			alarm(0);
 			sigaction(SIGALRM, &old_sa, NULL);
@@ -4711,6 +5039,8 @@ luaA_loadrc(void)
 		}
 	}
 
+	startup_profile_end();
+
 	if (!loaded) {
 		fprintf(stderr, "somewm: FATAL: no working Lua config found!\n");
 		fprintf(stderr, "somewm: tried:\n");
@@ -4743,6 +5073,9 @@ luaA_create_fresh_state(void)
 		fprintf(stderr, "somewm: failed to create new Lua state\n");
 		return NULL;
 	}
+#ifdef SOMEWM_BENCH
+	bench_alloc_install(L);
+#endif
 
 	/* Update global pointers */
 	globalconf_L = L;
@@ -4963,6 +5296,10 @@ luaA_hot_reload(void)
 	}
 
 	fprintf(stderr, "somewm: hot-reload: starting in-process Lua state rebuild\n");
+	startup_profile_reset();
+	startup_profile_begin("hot-reload");
+	/* The samples stay readable, the hook goes with the old state */
+	luaprof_stop();
 
 	/* Freeze GC immediately. Lgi closures store a lua_State* (coroutine)
 	 * in their FfiClosureBlock. If GC collects a coroutine, Lgi's
@@ -5131,6 +5468,8 @@ luaA_hot_reload(void)
 		c->machine = NULL;
 		c->startup_id = NULL;
 		c->role = NULL;
+		c->pending_name = NULL;
+		c->pending_class = NULL;
 		c->keys.tab = NULL; c->keys.len = c->keys.size = 0;
 		c->icons.tab = NULL; c->icons.len = c->icons.size = 0;
 		c->buttons.tab = NULL; c->buttons.len = c->buttons.size = 0;
@@ -5184,7 +5523,8 @@ luaA_hot_reload(void)
 	/* Clear arrays so GC doesn't try to access stale data.
 	 * We've already snapshotted everything and NULL'd owned resources. */
 	globalconf.clients.len = 0;
-	globalconf.stack.len = 0;
+	client_handle_reset();
+	stack_list_clear();
 	globalconf.tags.len = 0;
 	globalconf.screens.len = 0;
 	globalconf.focus.client = NULL;
@@ -5234,14 +5574,19 @@ luaA_hot_reload(void)
 	/* Discard any events queued against the old state. We cannot
 	 * unref them: the old registry goes with the leaked state, and
 	 * luaL_unref on the new state would free unrelated slots. The
-	 * pending events' registry refs are leaked along with the state. */
+	 * pending events' registry refs are leaked along with the state.
+	 * Queued delayed calls go the same way. */
 	some_event_queue_reset();
+	delayed_call_reset();
 
 	/* Leak the old Lua state. lua_close() is unsafe because client
 	 * snapshots, screens, and other C objects still reference Lua
 	 * userdata memory. GC is kept frozen so Lgi closures retain
 	 * their block->L pointers (non-NULL but stale). The GLib source
 	 * sweep above prevents most dispatches. ~1-2MB leak per reload. */
+#ifdef SOMEWM_BENCH
+	bench_alloc_uninstall(globalconf_L);
+#endif
 	globalconf_L = NULL;
 	globalconf.L = NULL;
 
@@ -5294,6 +5639,8 @@ luaA_hot_reload(void)
 			fresh_signals = c->signals;
 			memcpy(c, &cs->data, sizeof(client_t));
 			c->signals = fresh_signals;
+			/* The old registry slot means nothing in the new state */
+			c->registry_ref = 0;
 
 			/* Clear all Lua userdata pointers from the old state.
 			 * These survive memcpy but reference dead Lua objects.
@@ -5303,6 +5650,11 @@ luaA_hot_reload(void)
 			c->toplevel_handle = NULL;
 			c->screen = NULL;
 			c->transient_for = NULL;
+			/* Relinked and registered below */
+			c->stack_prev = c->stack_next = NULL;
+			c->in_stack = false;
+			c->stack_pending = false;
+			c->handle.index = c->handle.generation = 0;
 			for (int tb = 0; tb < CLIENT_TITLEBAR_COUNT; tb++) {
 				c->titlebar[tb].drawable = NULL;
 				c->titlebar[tb].size = 0;
@@ -5335,7 +5687,10 @@ luaA_hot_reload(void)
 			/* Reference and push to arrays */
 			lua_pushvalue(L, -1);
 			client_array_append(&globalconf.clients, luaA_object_ref(L, -1));
+			client_handle_register(c);
 			stack_client_append(c);
+			/* Title/app_id updates still pending went with the old queue */
+			property_pending_requeue(c);
 
 			new_clients[i] = c;
 			if (cs->was_focused)
@@ -5351,6 +5706,7 @@ luaA_hot_reload(void)
 			for (j = 0; j < num_clients; j++) {
 				if (client_snaps[j].data.id == client_snaps[i].transient_for_id) {
 					new_clients[i]->transient_for = new_clients[j];
+					stack_client_changed(new_clients[i]);
 					break;
 				}
 			}
@@ -5530,6 +5886,8 @@ luaA_hot_reload(void)
 		luaA_emit_signal_global("xwayland::ready");
 
 	globalconf.hot_reload_in_progress = false;
+	startup_profile_end();
+	startup_profile_ready();
 
 	fprintf(stderr, "somewm: hot-reload: complete (%d clients, %d screens, %d tags reset)\n",
 		num_clients, num_screens, num_tags);
@@ -5577,6 +5935,10 @@ luaA_cleanup(void)
 		 * collector functions (client_wipe, tag_wipe, screen_wipe, drawin_wipe)
 		 * to properly free all Lua objects. This must happen BEFORE
 		 * globalconf_wipe() to avoid use-after-free bugs. */
+		luaprof_stop();
+#ifdef SOMEWM_BENCH
+		bench_alloc_uninstall(globalconf_L);
+#endif
 		lua_close(globalconf_L);
 		globalconf_L = NULL;
 
@@ -5619,7 +5981,7 @@ globalconf_init(lua_State *L)
 
 	/* Initialize arrays to empty state */
 	client_array_init(&globalconf.clients);
-	client_array_init(&globalconf.stack);
+	stack_list_clear();
 	tag_array_init(&globalconf.tags);
 	key_array_init(&globalconf.keys);
 	button_array_init(&globalconf.buttons);
@@ -5671,7 +6033,7 @@ globalconf_wipe(void)
 
 	/* Wipe arrays - uses DO_NOTHING dtor so it doesn't free the objects */
 	client_array_wipe(&globalconf.clients);
-	client_array_wipe(&globalconf.stack);
+	stack_list_clear();
 	tag_array_wipe(&globalconf.tags);
 	screen_array_wipe(&globalconf.screens);
 	drawin_array_wipe(&globalconf.drawins);
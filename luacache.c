@@ -0,0 +1,416 @@
+/*
+ * luacache.c - Content-addressed Lua bytecode cache
+ *
+ * A cache entry is the lua_dump() of a chunk, stored under the SHA-256 of
+ * (runtime tag, chunk name, source). Editing a file changes its key, so
+ * stale bytecode is never loaded; entries nobody has used for
+ * LUACACHE_MAX_AGE are pruned once per process. Bytecode that fails to
+ * load (truncated write, runtime built differently) is deleted and the
+ * source is parsed instead.
+ *
+ * Set SOMEWM_NO_BYTECODE_CACHE=1 to bypass the cache.
+ */
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <glib.h>
+#include <lua.h>
+#include <lauxlib.h>
+
+#if defined(__has_include)
+#if __has_include(<luajit.h>)
+#include <luajit.h>
+#endif
+#endif
+
+#include "luacache.h"
+#include "common/util.h"
+
+/* Bytecode is only portable between identical runtimes */
+#ifdef LUAJIT_VERSION
+#define LUACACHE_RUNTIME LUAJIT_VERSION
+#else
+#define LUACACHE_RUNTIME LUA_RELEASE
+#endif
+
+#define LUACACHE_MAX_AGE (30 * 24 * 3600)
+/* Refresh an entry's mtime on use at most this often */
+#define LUACACHE_TOUCH_AGE (24 * 3600)
+
+static char *cache_dir = NULL;
+static bool cache_disabled = false;
+static bool cache_pruned = false;
+static luacache_stats_t cache_stats;
+
+static uint64_t
+luacache_now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/** Remove entries that have not been used for LUACACHE_MAX_AGE */
+static void
+luacache_prune(void)
+{
+	DIR *dir;
+	struct dirent *ent;
+	struct stat st;
+	time_t now = time(NULL);
+
+	cache_pruned = true;
+
+	if (!(dir = opendir(cache_dir)))
+		return;
+
+	while ((ent = readdir(dir))) {
+		if (!g_str_has_suffix(ent->d_name, ".luac"))
+			continue;
+		if (fstatat(dirfd(dir), ent->d_name, &st, 0) == 0
+		    && now - st.st_mtime > LUACACHE_MAX_AGE)
+			unlinkat(dirfd(dir), ent->d_name, 0);
+	}
+
+	closedir(dir);
+}
+
+/** Resolve (and create) the cache directory on first use */
+static const char *
+luacache_dir(void)
+{
+	const char *base, *home;
+
+	if (cache_dir || cache_disabled)
+		return cache_dir;
+
+	base = getenv("SOMEWM_NO_BYTECODE_CACHE");
+	if (base && base[0] != '\0' && strcmp(base, "0") != 0) {
+		cache_disabled = true;
+		return NULL;
+	}
+
+	base = getenv("XDG_CACHE_HOME");
+	home = getenv("HOME");
+	if (base && base[0] != '\0')
+		cache_dir = g_build_filename(base, "somewm", "luac", NULL);
+	else if (home && home[0] != '\0')
+		cache_dir = g_build_filename(home, ".cache", "somewm", "luac", NULL);
+
+	if (!cache_dir || g_mkdir_with_parents(cache_dir, 0700) != 0) {
+		g_free(cache_dir);
+		cache_dir = NULL;
+		cache_disabled = true;
+		return NULL;
+	}
+
+	if (!cache_pruned)
+		luacache_prune();
+
+	return cache_dir;
+}
+
+/** Path of the entry for a chunk. Caller frees. */
+static char *
+luacache_entry_path(const char *chunkname, const char *src, size_t len)
+{
+	GChecksum *sum = g_checksum_new(G_CHECKSUM_SHA256);
+	char *name, *path;
+	unsigned int ptr_size = sizeof(void *);
+
+	g_checksum_update(sum, (const guchar *)LUACACHE_RUNTIME, sizeof(LUACACHE_RUNTIME));
+	g_checksum_update(sum, (const guchar *)&ptr_size, sizeof(ptr_size));
+	g_checksum_update(sum, (const guchar *)chunkname, strlen(chunkname) + 1);
+	g_checksum_update(sum, (const guchar *)src, len);
+
+	name = g_strconcat(g_checksum_get_string(sum), ".luac", NULL);
+	path = g_build_filename(cache_dir, name, NULL);
+
+	g_free(name);
+	g_checksum_free(sum);
+	return path;
+}
+
+static int
+luacache_writer(lua_State *L, const void *p, size_t size, void *ud)
+{
+	(void)L;
+	g_byte_array_append(ud, p, size);
+	return 0;
+}
+
+/** Dump the function on top of the stack to path, atomically */
+static void
+luacache_store(lua_State *L, const char *path)
+{
+	GByteArray *bytes = g_byte_array_new();
+
+#if LUA_VERSION_NUM >= 503
+	int status = lua_dump(L, luacache_writer, bytes, 0);
+#else
+	int status = lua_dump(L, luacache_writer, bytes);
+#endif
+
+	/* g_file_set_contents() writes a temporary file and renames it over */
+	if (status == 0 && bytes->len > 0)
+		g_file_set_contents(path, (const char *)bytes->data, bytes->len, NULL);
+
+	g_byte_array_unref(bytes);
+}
+
+/** Load cached bytecode if present.
+ * \return true with the function pushed, false with nothing pushed. */
+static bool
+luacache_fetch(lua_State *L, const char *path, const char *chunkname)
+{
+	gchar *bytes;
+	gsize len;
+	struct stat st;
+
+	if (!g_file_get_contents(path, &bytes, &len, NULL))
+		return false;
+
+#if LUA_VERSION_NUM >= 502
+	int status = luaL_loadbufferx(L, bytes, len, chunkname, "b");
+#else
+	/* No mode argument: refuse anything that is not a binary chunk */
+	if (len == 0 || bytes[0] != LUA_SIGNATURE[0]) {
+		g_free(bytes);
+		unlink(path);
+		return false;
+	}
+	int status = luaL_loadbuffer(L, bytes, len, chunkname);
+#endif
+	g_free(bytes);
+
+	if (status != 0) {
+		lua_pop(L, 1);
+		unlink(path);
+		return false;
+	}
+
+	if (stat(path, &st) == 0 && time(NULL) - st.st_mtime > LUACACHE_TOUCH_AGE)
+		utimensat(AT_FDCWD, path, NULL, 0);
+
+	return true;
+}
+
+/** Read a whole source file, leaving errno set on failure */
+static char *
+luacache_read(const char *path, size_t *len)
+{
+	FILE *f;
+	struct stat st;
+	char *data;
+
+	if (!(f = fopen(path, "rb")))
+		return NULL;
+
+	if (fstat(fileno(f), &st) != 0) {
+		int err = errno;
+		fclose(f);
+		errno = err;
+		return NULL;
+	}
+	if (!S_ISREG(st.st_mode)) {
+		fclose(f);
+		errno = EISDIR;
+		return NULL;
+	}
+
+	data = malloc((size_t)st.st_size + 1);
+	if (!data) {
+		fclose(f);
+		return NULL;
+	}
+
+	*len = fread(data, 1, (size_t)st.st_size, f);
+	if (ferror(f)) {
+		int err = errno;
+		free(data);
+		fclose(f);
+		errno = err;
+		return NULL;
+	}
+
+	fclose(f);
+	return data;
+}
+
+int
+luacache_loadfile(lua_State *L, const char *path)
+{
+	char *contents;
+	size_t len;
+	const char *src;
+	size_t srclen;
+	char *entry = NULL;
+	int status;
+	uint64_t start = luacache_now_ns();
+
+	if (!(contents = luacache_read(path, &len))) {
+		lua_pushfstring(L, "cannot open %s: %s", path, strerror(errno));
+		return LUA_ERRFILE;
+	}
+
+	lua_pushfstring(L, "@%s", path);
+	const char *chunkname = lua_tostring(L, -1);
+
+	/* Like luaL_loadfile(): skip a UTF-8 BOM and comment out a leading
+	 * '#' line, keeping line numbers intact. */
+	src = contents;
+	srclen = len;
+	if (srclen >= 3 && memcmp(src, "\xEF\xBB\xBF", 3) == 0) {
+		src += 3;
+		srclen -= 3;
+	}
+	if (srclen > 0 && src[0] == '#') {
+		while (srclen > 0 && src[0] != '\n') {
+			src++;
+			srclen--;
+		}
+	}
+
+	if (luacache_dir()) {
+		entry = luacache_entry_path(chunkname, src, srclen);
+		if (luacache_fetch(L, entry, chunkname)) {
+			cache_stats.hits++;
+			g_free(entry);
+			free(contents);
+			lua_remove(L, -2);  /* chunk name */
+			cache_stats.load_ns += luacache_now_ns() - start;
+			return 0;
+		}
+	}
+
+	status = luaL_loadbuffer(L, src, srclen, chunkname);
+	if (status == 0) {
+		cache_stats.misses++;
+		if (entry)
+			luacache_store(L, entry);
+	}
+
+	g_free(entry);
+	free(contents);
+	lua_remove(L, -2);  /* chunk name */
+	cache_stats.load_ns += luacache_now_ns() - start;
+	return status;
+}
+
+/* ========================================================================
+ * package.path searcher
+ * ======================================================================== */
+
+/** Searcher for package.searchers (package.loaders on 5.1/LuaJIT).
+ * Same lookup as the stock Lua file searcher, loading through the cache. */
+static int
+luacache_searcher(lua_State *L)
+{
+	const char *name = luaL_checkstring(L, 1);
+	const char *path;
+	char *modpath;
+	luaL_Buffer msg;
+	bool first = true;
+
+	lua_getglobal(L, "package");
+	lua_getfield(L, -1, "path");
+	path = lua_tostring(L, -1);
+	if (!path)
+		return luaL_error(L, "'package.path' must be a string");
+
+	modpath = g_strdelimit(g_strdup(name), ".", '/');
+	luaL_buffinit(L, &msg);
+
+	for (const char *p = path; *p; ) {
+		const char *end = strchr(p, ';');
+		size_t tlen = end ? (size_t)(end - p) : strlen(p);
+		char *template = g_strndup(p, tlen);
+		char **parts = g_strsplit(template, "?", -1);
+		char *filename = g_strjoinv(modpath, parts);
+
+		g_strfreev(parts);
+		g_free(template);
+		p += tlen + (end ? 1 : 0);
+
+		if (tlen == 0 || access(filename, R_OK) != 0) {
+			if (tlen > 0) {
+#if LUA_VERSION_NUM >= 504
+				/* 5.4's require() puts "\n\t" before each searcher's
+				 * message itself; only separate our entries */
+				lua_pushfstring(L, "%sno file '%s'", first ? "" : "\n\t", filename);
+#else
+				lua_pushfstring(L, "\n\tno file '%s'", filename);
+#endif
+				luaL_addvalue(&msg);
+				first = false;
+			}
+			g_free(filename);
+			continue;
+		}
+
+		g_free(modpath);
+		if (luacache_loadfile(L, filename) != 0) {
+			lua_pushfstring(L, "error loading module '%s' from file '%s':\n\t%s",
+			                name, filename, lua_tostring(L, -1));
+			g_free(filename);
+			return lua_error(L);
+		}
+		/* Lua 5.2+ passes the file name to the loader as second argument */
+		lua_pushstring(L, filename);
+		g_free(filename);
+		return 2;
+	}
+
+	g_free(modpath);
+	luaL_pushresult(&msg);
+	return 1;
+}
+
+void
+luacache_install_searcher(lua_State *L)
+{
+	lua_getglobal(L, "package");
+#if LUA_VERSION_NUM >= 502
+	lua_getfield(L, -1, "searchers");
+#else
+	lua_getfield(L, -1, "loaders");
+#endif
+	if (lua_istable(L, -1)) {
+		/* Slot 2 is the stock Lua file searcher, after package.preload */
+		lua_pushcfunction(L, luacache_searcher);
+		lua_rawseti(L, -2, 2);
+	}
+	lua_pop(L, 2);
+}
+
+void
+luacache_stats_get(luacache_stats_t *stats)
+{
+	*stats = cache_stats;
+}
+
+void
+luacache_stats_reset(void)
+{
+	p_clear(&cache_stats, 1);
+}
+
+int
+luaA_luacache_stats(lua_State *L)
+{
+	lua_newtable(L);
+	lua_pushboolean(L, luacache_dir() != NULL);
+	lua_setfield(L, -2, "enabled");
+	lua_pushinteger(L, (lua_Integer)cache_stats.hits);
+	lua_setfield(L, -2, "hits");
+	lua_pushinteger(L, (lua_Integer)cache_stats.misses);
+	lua_setfield(L, -2, "misses");
+	return 1;
+}
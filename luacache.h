@@ -0,0 +1,37 @@
+/*
+ * luacache.h - Content-addressed Lua bytecode cache
+ *
+ * Compiled chunks of rc.lua and every module found on package.path are
+ * kept under $XDG_CACHE_HOME/somewm/luac, keyed by a hash of the source,
+ * its chunk name and the Lua runtime. Starting the compositor or hot
+ * reloading then loads bytecode instead of parsing the whole Lua tree.
+ */
+#ifndef LUACACHE_H
+#define LUACACHE_H
+
+#include <stdint.h>
+#include <lua.h>
+
+/** Load a Lua file like luaL_loadfile(), going through the cache.
+ * On failure the error message follows luaL_loadfile() ("cannot open ..."
+ * for missing files). */
+int luacache_loadfile(lua_State *L, const char *path);
+
+/** Replace the package.path searcher of L with one using luacache_loadfile() */
+void luacache_install_searcher(lua_State *L);
+
+/** Cumulative loading counters since the last luacache_stats_reset() */
+typedef struct {
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t load_ns;   /**< Time spent reading, hashing and parsing/undumping */
+} luacache_stats_t;
+
+void luacache_stats_get(luacache_stats_t *stats);
+void luacache_stats_reset(void);
+
+/** awesome._luacache_stats(): enabled, hits and misses since the last
+ * config load (for tests) */
+int luaA_luacache_stats(lua_State *L);
+
+#endif /* LUACACHE_H */
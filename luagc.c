@@ -0,0 +1,280 @@
+/*
+ * luagc.c - Frame-paced Lua garbage collection
+ *
+ * While a hold is active the collector is stopped, so handlers running in
+ * some_refresh() only accumulate debt. luagc_idle() runs from the refresh
+ * source right before the main loop polls and pays it with LUA_GCSTEP
+ * slices until the deadline: the next predicted vblank minus the time the
+ * compositor recently needed to produce a frame.
+ *
+ * Pacing mirrors Lua's own: a cycle starts once the heap has doubled since
+ * the end of the previous one. The step size adapts to the measured cost
+ * per KiB so one step takes about LUAGC_STEP_TARGET_NS. If a busy session
+ * leaves no idle time and the heap keeps growing, steps are forced past
+ * the deadline so memory stays bounded.
+ *
+ * Outside holds automatic collection runs as usual (timers, D-Bus and
+ * input callbacks are not part of a frame).
+ */
+#include <string.h>
+#include <time.h>
+#include <lua.h>
+#include <lauxlib.h>
+
+#include "luagc.h"
+#include "globalconf.h"
+#ifdef SOMEWM_BENCH
+#include "bench.h"
+#endif
+
+/* Heap growth, in percent of the live heap, that starts a new cycle */
+#define LUAGC_PAUSE 200
+/* Growth past which steps are forced regardless of the deadline */
+#define LUAGC_FORCE_PAUSE 400
+#define LUAGC_STEP_TARGET_NS 200000ULL
+#define LUAGC_STEP_MIN_KB 4
+#define LUAGC_STEP_MAX_KB 4096
+/* Upper bound on collection per idle pass, so input waiting behind it is
+ * not delayed noticeably when no vblank is pending */
+#define LUAGC_IDLE_MAX_NS 3000000ULL
+/* Kept free before the predicted vblank on top of the frame work estimate */
+#define LUAGC_VBLANK_MARGIN_NS 1000000ULL
+#define LUAGC_DEFAULT_PERIOD_NS 16666667ULL
+
+static int hold_depth;
+static lua_State *hold_L;
+static bool hold_restart;
+static uint64_t hold_start_ns;
+/* Moving average of the time spent in holds (refresh + render) */
+static uint64_t frame_work_ns;
+
+static uint64_t next_vblank_ns;
+static uint64_t next_render_ns;
+
+static bool cycle_active;
+static lua_State *cycle_L;
+static uint64_t live_kb;
+static uint64_t step_kb = 64;
+/* Moving average of the step cost, in ns per KiB of step size */
+static uint64_t step_ns_per_kb;
+
+static luagc_stats_t stats;
+
+#if LUA_VERSION_NUM < 502
+/* No LUA_GCISRUNNING: collectgarbage() records a stop from the config */
+static bool user_stopped;
+
+static int
+luagc_collectgarbage(lua_State *L)
+{
+	const char *opt = luaL_optstring(L, 1, "collect");
+
+	if (strcmp(opt, "stop") == 0)
+		user_stopped = true;
+	else if (strcmp(opt, "restart") == 0)
+		user_stopped = false;
+
+	lua_pushvalue(L, lua_upvalueindex(1));
+	lua_insert(L, 1);
+	lua_call(L, lua_gettop(L) - 1, LUA_MULTRET);
+	return lua_gettop(L);
+}
+#endif
+
+void
+luagc_install(lua_State *L)
+{
+#if LUA_VERSION_NUM < 502
+	user_stopped = false;
+	lua_getglobal(L, "collectgarbage");
+	if (lua_isfunction(L, -1)) {
+		lua_pushcclosure(L, luagc_collectgarbage, 1);
+		lua_setglobal(L, "collectgarbage");
+	} else {
+		lua_pop(L, 1);
+	}
+#else
+	(void)L;
+#endif
+}
+
+static uint64_t
+luagc_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t
+luagc_heap_kb(lua_State *L)
+{
+	return (uint64_t)lua_gc(L, LUA_GCCOUNT, 0);
+}
+
+void
+luagc_hold(void)
+{
+	lua_State *L = globalconf_get_lua_State();
+
+	if (hold_depth++ > 0 || !L || globalconf.hot_reload_in_progress)
+		return;
+
+#if LUA_VERSION_NUM >= 502
+	/* Leave a collectgarbage("stop") from the config alone */
+	hold_restart = lua_gc(L, LUA_GCISRUNNING, 0);
+#else
+	hold_restart = !user_stopped;
+#endif
+	lua_gc(L, LUA_GCSTOP, 0);
+	hold_L = L;
+	hold_start_ns = luagc_now();
+}
+
+void
+luagc_release(void)
+{
+	if (hold_depth == 0 || --hold_depth > 0 || !hold_L)
+		return;
+
+	uint64_t elapsed = luagc_now() - hold_start_ns;
+	frame_work_ns = frame_work_ns ? (frame_work_ns * 7 + elapsed) / 8 : elapsed;
+
+#if LUA_VERSION_NUM < 502
+	/* A stop from a handler that ran during the hold */
+	if (user_stopped)
+		hold_restart = false;
+#endif
+
+	/* A hot reload during the hold replaced the state; the old one stays
+	 * frozen and the new one was never stopped */
+	if (hold_L == globalconf_get_lua_State() && hold_restart
+	    && !globalconf.hot_reload_in_progress)
+		lua_gc(hold_L, LUA_GCRESTART, 0);
+	hold_L = NULL;
+}
+
+void
+luagc_frame(int refresh_mhz)
+{
+	uint64_t now = luagc_now();
+	uint64_t period = refresh_mhz > 0
+		? 1000000000000ULL / (uint64_t)refresh_mhz : LUAGC_DEFAULT_PERIOD_NS;
+	uint64_t next = now + period;
+
+	/* With several outputs the earliest upcoming vblank wins */
+	if (next_vblank_ns <= now || next < next_vblank_ns)
+		next_vblank_ns = next;
+}
+
+void
+luagc_render_at(uint64_t ns)
+{
+	uint64_t now = luagc_now();
+
+	if (next_render_ns <= now || ns < next_render_ns)
+		next_render_ns = ns;
+}
+
+/** Run one step, adapting its size. \return true if a cycle finished. */
+static bool
+luagc_step(lua_State *L)
+{
+	uint64_t start = luagc_now();
+	bool finished = lua_gc(L, LUA_GCSTEP, (int)step_kb) != 0;
+	uint64_t per_kb = (luagc_now() - start) / step_kb;
+
+	step_ns_per_kb = step_ns_per_kb ? (step_ns_per_kb * 3 + per_kb) / 4 : per_kb;
+	step_kb = step_ns_per_kb ? LUAGC_STEP_TARGET_NS / step_ns_per_kb : LUAGC_STEP_MAX_KB;
+	if (step_kb < LUAGC_STEP_MIN_KB)
+		step_kb = LUAGC_STEP_MIN_KB;
+	else if (step_kb > LUAGC_STEP_MAX_KB)
+		step_kb = LUAGC_STEP_MAX_KB;
+
+	stats.steps++;
+	return finished;
+}
+
+bool
+luagc_idle(void)
+{
+	lua_State *L = globalconf_get_lua_State();
+	uint64_t start, deadline, heap;
+	bool forced;
+
+	if (!L || hold_depth > 0 || globalconf.hot_reload_in_progress) {
+#ifdef SOMEWM_BENCH
+		bench_stage_record(BENCH_STAGE_GC, 0);
+#endif
+		return false;
+	}
+
+	/* Pacing state belongs to one Lua state */
+	if (cycle_L != L) {
+		cycle_L = L;
+		cycle_active = false;
+		live_kb = 0;
+	}
+
+	heap = luagc_heap_kb(L);
+	/* Also follows cycles completed by automatic collection */
+	if (live_kb == 0 || (!cycle_active && heap < live_kb))
+		live_kb = heap;
+	if (!cycle_active && heap * 100 >= live_kb * LUAGC_PAUSE)
+		cycle_active = true;
+
+	if (!cycle_active) {
+#ifdef SOMEWM_BENCH
+		bench_stage_record(BENCH_STAGE_GC, 0);
+#endif
+		return false;
+	}
+
+	start = luagc_now();
+	deadline = start + LUAGC_IDLE_MAX_NS;
+	if (next_vblank_ns > start) {
+		uint64_t reserve = frame_work_ns + LUAGC_VBLANK_MARGIN_NS;
+		uint64_t vblank_deadline = next_vblank_ns > reserve ? next_vblank_ns - reserve : 0;
+		if (vblank_deadline < deadline)
+			deadline = vblank_deadline;
+	}
+	/* A deferred render already budgets its own work */
+	if (next_render_ns > start && next_render_ns < deadline)
+		deadline = next_render_ns;
+	forced = heap * 100 >= live_kb * LUAGC_FORCE_PAUSE;
+
+	for (;;) {
+		uint64_t now = luagc_now();
+		if (now + step_kb * step_ns_per_kb > deadline) {
+			/* Out of time: one step anyway if the heap ran away */
+			if (!forced)
+				break;
+			forced = false;
+			stats.forced_steps++;
+		}
+		if (luagc_step(L)) {
+			cycle_active = false;
+			live_kb = luagc_heap_kb(L);
+			stats.cycles++;
+			break;
+		}
+	}
+
+#ifdef SOMEWM_BENCH
+	bench_stage_record(BENCH_STAGE_GC, luagc_now() - start);
+#endif
+	return cycle_active;
+}
+
+void
+luagc_stats_get(luagc_stats_t *out)
+{
+	*out = stats;
+	out->step_kb = step_kb;
+}
+
+void
+luagc_stats_reset(void)
+{
+	stats = (luagc_stats_t){0};
+}
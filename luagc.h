@@ -0,0 +1,50 @@
+/*
+ * luagc.h - Frame-paced Lua garbage collection
+ *
+ * The Lua collector is held off while the compositor produces a frame
+ * (some_refresh(), rendermon()) and the allocation debt is paid by
+ * bounded incremental steps in the idle gap before the next predicted
+ * vblank, so large GC steps no longer land in the middle of a frame.
+ */
+#ifndef LUAGC_H
+#define LUAGC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct lua_State lua_State;
+
+/** Prepare a new Lua state. On runtimes that cannot report whether the
+ * collector runs, wraps collectgarbage() to remember a stop from the
+ * config, which holds must not undo. */
+void luagc_install(lua_State *L);
+
+/** Stop automatic collection until the matching luagc_release().
+ * Calls nest. */
+void luagc_hold(void);
+void luagc_release(void);
+
+/** An output delivered a frame event; refresh_mhz is its refresh rate
+ * (0 if unknown). Used to predict the next vblank. */
+void luagc_frame(int refresh_mhz);
+
+/** A render is scheduled at ns (CLOCK_MONOTONIC); idle collection stops
+ * before it. */
+void luagc_render_at(uint64_t ns);
+
+/** Run collection steps that fit before the next predicted vblank.
+ * \return true if a cycle is still in progress, so the main loop should
+ * not sleep indefinitely. */
+bool luagc_idle(void);
+
+typedef struct {
+	uint64_t steps;
+	uint64_t cycles;
+	uint64_t forced_steps;  /**< Steps run past the deadline, heap too large */
+	uint64_t step_kb;       /**< Current adaptive step size */
+} luagc_stats_t;
+
+void luagc_stats_get(luagc_stats_t *stats);
+void luagc_stats_reset(void);
+
+#endif /* LUAGC_H */
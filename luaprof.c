@@ -0,0 +1,355 @@
+/*
+ * luaprof.c - Sampling Lua profiler
+ *
+ * The SIGPROF handler only notes that a sample is due and when. The Lua
+ * stack is read by the count hook, where the VM is in a consistent state.
+ * A tick that lands in C (rendering, wlroots, the main loop) is not picked
+ * up by a hook soon enough and is counted as outside Lua, instead of being
+ * charged to whatever Lua code happens to run next.
+ *
+ * The hook is set on the main thread; coroutines created while sampling
+ * inherit it, older ones are not sampled. Under LuaJIT, compiled traces
+ * only run hooks at trace exits, so hot loops show up less often than
+ * their share of the time.
+ */
+#include <signal.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+#include <glib.h>
+#include <lua.h>
+#include <lauxlib.h>
+
+#include "luaprof.h"
+#include "globalconf.h"
+
+/** VM instructions between two checks for a due sample */
+#define LUAPROF_HOOK_COUNT 200
+/** A due sample is only charged to Lua if a hook takes it this soon */
+#define LUAPROF_MAX_LAG_NS 250000ULL
+#define LUAPROF_DEFAULT_HZ 1000
+#define LUAPROF_MAX_HZ 10000
+#define LUAPROF_MAX_DEPTH 64
+/** Distinct stacks kept; samples of further stacks are counted as dropped */
+#define LUAPROF_MAX_STACKS 8192
+
+static lua_State *prof_L;
+static bool prof_running;
+static int prof_hz;
+static struct sigaction prof_old_sa;
+
+/* Written by the signal handler */
+static volatile sig_atomic_t prof_pending;
+static volatile sig_atomic_t prof_missed;  /* Ticks no hook took */
+static volatile uint64_t prof_tick_ns;
+
+static GHashTable *prof_stacks; /* folded stack -> uint64_t count */
+static GString *prof_buf;
+static uint64_t prof_samples;
+static uint64_t prof_outside;
+static uint64_t prof_dropped;
+static uint64_t prof_start_ns;
+static uint64_t prof_elapsed_ns;
+
+static uint64_t
+luaprof_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void
+luaprof_signal(int sig)
+{
+	(void)sig;
+
+	/* The last tick found no hook within a whole interval */
+	if (prof_pending)
+		prof_missed++;
+
+	prof_tick_ns = luaprof_now();
+	prof_pending = 1;
+}
+
+static void
+luaprof_append_frame(GString *buf, lua_Debug *ar)
+{
+	gsize start = buf->len;
+
+	if (*ar->what == 'C')
+		g_string_append_printf(buf, "[C] %s", ar->name ? ar->name : "?");
+	else if (*ar->what == 'm')
+		g_string_append_printf(buf, "%s (main chunk)", ar->short_src);
+	else if (*ar->what == 't')
+		g_string_append(buf, "(tail call)");
+	else
+		g_string_append_printf(buf, "%s (%s:%d)",
+				ar->name ? ar->name : "?", ar->short_src, ar->linedefined);
+
+	/* ';' separates frames in the folded format */
+	for (gsize i = start; i < buf->len; i++)
+		if (buf->str[i] == ';')
+			buf->str[i] = ',';
+}
+
+static void
+luaprof_sample(lua_State *L)
+{
+	lua_Debug frames[LUAPROF_MAX_DEPTH];
+	lua_Debug extra;
+	int depth = 0;
+	uint64_t *count;
+
+	while (depth < LUAPROF_MAX_DEPTH && lua_getstack(L, depth, &frames[depth])) {
+		lua_getinfo(L, "Sn", &frames[depth]);
+		depth++;
+	}
+
+	if (depth == 0) {
+		prof_outside++;
+		return;
+	}
+
+	prof_samples++;
+
+	/* Outermost frame first */
+	g_string_truncate(prof_buf, 0);
+	if (depth == LUAPROF_MAX_DEPTH && lua_getstack(L, depth, &extra))
+		g_string_append(prof_buf, "[truncated];");
+	for (int i = depth - 1; i >= 0; i--) {
+		luaprof_append_frame(prof_buf, &frames[i]);
+		if (i > 0)
+			g_string_append_c(prof_buf, ';');
+	}
+
+	count = g_hash_table_lookup(prof_stacks, prof_buf->str);
+	if (!count) {
+		if (g_hash_table_size(prof_stacks) >= LUAPROF_MAX_STACKS) {
+			prof_dropped++;
+			return;
+		}
+		count = g_new0(uint64_t, 1);
+		g_hash_table_insert(prof_stacks, g_strdup(prof_buf->str), count);
+	}
+	(*count)++;
+}
+
+static void
+luaprof_hook(lua_State *L, lua_Debug *ar)
+{
+	(void)ar;
+
+	/* Coroutines keep the hook after a stop; nothing is pending then */
+	if (!prof_pending)
+		return;
+	prof_pending = 0;
+
+	if (luaprof_now() - prof_tick_ns > LUAPROF_MAX_LAG_NS) {
+		prof_outside++;
+		return;
+	}
+
+	luaprof_sample(L);
+}
+
+static void
+luaprof_clear(void)
+{
+	if (!prof_stacks)
+		prof_stacks = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+	else
+		g_hash_table_remove_all(prof_stacks);
+	if (!prof_buf)
+		prof_buf = g_string_sized_new(512);
+
+	prof_samples = 0;
+	prof_outside = 0;
+	prof_dropped = 0;
+	prof_elapsed_ns = 0;
+	prof_missed = 0;
+	prof_pending = 0;
+}
+
+const char *
+luaprof_start(lua_State *L, int hz)
+{
+	struct sigaction sa, cur;
+	struct itimerval it;
+	long interval_us;
+
+	if (prof_running)
+		return "the profiler is already running";
+
+	if (lua_gethook(L))
+		return "a Lua hook is already set (debug.sethook?)";
+
+	/* jit.p and external profilers drive their own SIGPROF handler */
+	if (sigaction(SIGPROF, NULL, &cur) == 0
+			&& cur.sa_handler != SIG_DFL && cur.sa_handler != SIG_IGN)
+		return "SIGPROF is in use by another profiler (jit.p?)";
+
+	if (hz <= 0)
+		hz = LUAPROF_DEFAULT_HZ;
+	if (hz > LUAPROF_MAX_HZ)
+		hz = LUAPROF_MAX_HZ;
+
+	luaprof_clear();
+	prof_L = L;
+	prof_hz = hz;
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = luaprof_signal;
+	sa.sa_flags = SA_RESTART;
+	sigemptyset(&sa.sa_mask);
+	if (sigaction(SIGPROF, &sa, &prof_old_sa) != 0)
+		return "cannot install the SIGPROF handler";
+
+	lua_sethook(L, luaprof_hook, LUA_MASKCOUNT, LUAPROF_HOOK_COUNT);
+
+	interval_us = 1000000L / hz;
+	it.it_interval.tv_sec = interval_us / 1000000L;
+	it.it_interval.tv_usec = interval_us % 1000000L;
+	it.it_value = it.it_interval;
+	if (setitimer(ITIMER_PROF, &it, NULL) != 0) {
+		lua_sethook(L, NULL, 0, 0);
+		sigaction(SIGPROF, &prof_old_sa, NULL);
+		prof_L = NULL;
+		return "cannot start the profiling timer";
+	}
+
+	prof_start_ns = luaprof_now();
+	prof_running = true;
+	return NULL;
+}
+
+void
+luaprof_stop(void)
+{
+	struct itimerval it;
+
+	if (!prof_running)
+		return;
+
+	memset(&it, 0, sizeof(it));
+	setitimer(ITIMER_PROF, &it, NULL);
+	sigaction(SIGPROF, &prof_old_sa, NULL);
+
+	if (lua_gethook(prof_L) == luaprof_hook)
+		lua_sethook(prof_L, NULL, 0, 0);
+
+	prof_outside += prof_missed + (prof_pending ? 1 : 0);
+	prof_missed = 0;
+	prof_pending = 0;
+	prof_elapsed_ns = luaprof_now() - prof_start_ns;
+	prof_running = false;
+	prof_L = NULL;
+}
+
+bool
+luaprof_running(void)
+{
+	return prof_running;
+}
+
+static void
+luaprof_push_stats(lua_State *L)
+{
+	uint64_t elapsed = prof_running ? luaprof_now() - prof_start_ns : prof_elapsed_ns;
+
+	lua_newtable(L);
+	lua_pushboolean(L, prof_running);
+	lua_setfield(L, -2, "running");
+	lua_pushnumber(L, (lua_Number)prof_samples);
+	lua_setfield(L, -2, "samples");
+	lua_pushnumber(L, (lua_Number)(prof_outside + prof_missed));
+	lua_setfield(L, -2, "outside_lua");
+	lua_pushnumber(L, prof_stacks ? g_hash_table_size(prof_stacks) : 0);
+	lua_setfield(L, -2, "stacks");
+	lua_pushnumber(L, (lua_Number)prof_dropped);
+	lua_setfield(L, -2, "dropped");
+	lua_pushnumber(L, prof_hz);
+	lua_setfield(L, -2, "hz");
+	lua_pushnumber(L, elapsed / 1e9);
+	lua_setfield(L, -2, "duration_s");
+}
+
+typedef struct {
+	const char *stack;
+	uint64_t count;
+} luaprof_entry_t;
+
+static gint
+luaprof_entry_cmp(gconstpointer a, gconstpointer b)
+{
+	const luaprof_entry_t *ea = a, *eb = b;
+
+	if (ea->count != eb->count)
+		return ea->count < eb->count ? 1 : -1;
+	return strcmp(ea->stack, eb->stack);
+}
+
+/** Folded stacks, most frequent first */
+static GString *
+luaprof_format(void)
+{
+	GString *out = g_string_new(NULL);
+	GArray *entries = g_array_new(FALSE, FALSE, sizeof(luaprof_entry_t));
+	GHashTableIter iter;
+	gpointer key, value;
+
+	if (prof_stacks) {
+		g_hash_table_iter_init(&iter, prof_stacks);
+		while (g_hash_table_iter_next(&iter, &key, &value)) {
+			luaprof_entry_t e = { key, *(uint64_t *)value };
+			g_array_append_val(entries, e);
+		}
+	}
+	g_array_sort(entries, luaprof_entry_cmp);
+
+	for (guint i = 0; i < entries->len; i++) {
+		luaprof_entry_t *e = &g_array_index(entries, luaprof_entry_t, i);
+		g_string_append_printf(out, "%s %" G_GUINT64_FORMAT "\n", e->stack, e->count);
+	}
+
+	g_array_free(entries, TRUE);
+	return out;
+}
+
+int
+luaA_awesome_lua_profile_start(lua_State *L)
+{
+	int hz = (int)luaL_optinteger(L, 1, 0);
+	const char *err = luaprof_start(globalconf_get_lua_State(), hz);
+
+	if (err) {
+		lua_pushnil(L);
+		lua_pushstring(L, err);
+		return 2;
+	}
+
+	lua_pushboolean(L, 1);
+	return 1;
+}
+
+int
+luaA_awesome_lua_profile_stop(lua_State *L)
+{
+	GString *folded;
+
+	luaprof_stop();
+
+	folded = luaprof_format();
+	lua_pushlstring(L, folded->str, folded->len);
+	g_string_free(folded, TRUE);
+	luaprof_push_stats(L);
+	return 2;
+}
+
+int
+luaA_awesome_lua_profile_stats(lua_State *L)
+{
+	luaprof_push_stats(L);
+	return 1;
+}
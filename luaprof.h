@@ -0,0 +1,37 @@
+/*
+ * luaprof.h - Sampling Lua profiler
+ *
+ * A CPU-time interval timer (SIGPROF) marks a sample as due; a count hook
+ * that runs every few hundred VM instructions takes it at the next safe
+ * point by walking the Lua stack. Stacks are aggregated in folded format
+ * (flamegraph.pl input). Works with every supported Lua runtime, unlike
+ * LuaJIT's jit.p. Started and stopped through awesome.lua_profile_*() and
+ * `somewm-client profile start|stop|status`.
+ */
+#ifndef LUAPROF_H
+#define LUAPROF_H
+
+#include <stdbool.h>
+#include <lua.h>
+
+/** Sample L at hz samples per CPU second. Clears earlier samples.
+ * Returns NULL on success, otherwise why the profiler could not start. */
+const char *luaprof_start(lua_State *L, int hz);
+
+/** Stop sampling; the samples are kept until the next start */
+void luaprof_stop(void);
+
+bool luaprof_running(void);
+
+/** awesome.lua_profile_start([hz]): true, or nil and an error */
+int luaA_awesome_lua_profile_start(lua_State *L);
+
+/** awesome.lua_profile_stop(): stops if running; returns the folded stacks
+ * (one "frame;frame;... count" line per stack) and the stats table */
+int luaA_awesome_lua_profile_stop(lua_State *L);
+
+/** awesome.lua_profile_stats(): running, samples, outside_lua, stacks,
+ * dropped, hz, duration_s */
+int luaA_awesome_lua_profile_stats(lua_State *L);
+
+#endif /* LUAPROF_H */
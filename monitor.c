@@ -46,6 +46,16 @@
 #include "window.h"
 #include "somewm_internal.h"
 #include "bench.h"
+#include "startup_profile.h"
+#include "luagc.h"
+
+/* Longest a monitor keeps skipping frames for a client that does not
+ * commit its pending resize */
+#define RESIZE_FENCE_NS 200000000ULL
+/* Margin between a deferred render's deadline and the vblank, on top of
+ * the recent render time: timer wakeup jitter and its ms resolution */
+#define RENDER_SLACK_MIN_NS 2000000ULL
+#define RENDER_SLACK_MAX_NS 8000000ULL
 
 /* Module-private state */
 static int in_updatemons;
@@ -60,7 +70,10 @@ void outputmgrapply(struct wl_listener *listener, void *data);
 void outputmgrapplyortest(struct wlr_output_configuration_v1 *config, int test);
 void outputmgrtest(struct wl_listener *listener, void *data);
 void powermgrsetmode(struct wl_listener *listener, void *data);
+void presentmon(struct wl_listener *listener, void *data);
 void rendermon(struct wl_listener *listener, void *data);
+static int rendermon_timer(void *data);
+static int resize_fence_timer(void *data);
 void requestmonstate(struct wl_listener *listener, void *data);
 void updatemons(struct wl_listener *listener, void *data);
 
@@ -128,6 +141,11 @@ cleanupmon(struct wl_listener *listener, void *data)
 
 	wl_list_remove(&m->destroy.link);
 	wl_list_remove(&m->frame.link);
+	wl_list_remove(&m->present.link);
+	if (m->render_timer)
+		wl_event_source_remove(m->render_timer);
+	if (m->resize_fence_timer)
+		wl_event_source_remove(m->resize_fence_timer);
 	wl_list_remove(&m->link);
 	wl_list_remove(&m->request_state.link);
 	if (m->lock_surface)
@@ -144,6 +162,11 @@ cleanupmon(struct wl_listener *listener, void *data)
 	in_updatemons = 0;
 
 	closemon(m);
+	/* closemon() moved the clients away; drop any count left pointing here */
+	foreach(client, globalconf.clients) {
+		if ((*client)->resize_mon == m)
+			(*client)->resize_mon = NULL;
+	}
 	wlr_scene_node_destroy(&m->fullscreen_bg->node);
 	free(m);
 
@@ -251,6 +274,7 @@ createmon(struct wl_listener *listener, void *data)
 
 	/* Set up event listeners */
 	LISTEN(&wlr_output->events.frame, &m->frame, rendermon);
+	LISTEN(&wlr_output->events.present, &m->present, presentmon);
 	LISTEN(&wlr_output->events.destroy, &m->destroy, cleanupmon);
 	LISTEN(&wlr_output->events.request_state, &m->request_state, requestmonstate);
 
@@ -260,6 +284,7 @@ createmon(struct wl_listener *listener, void *data)
 			wlr_output->name);
 		wlr_output_state_finish(&state);
 		wl_list_remove(&m->frame.link);
+		wl_list_remove(&m->present.link);
 		wl_list_remove(&m->destroy.link);
 		wl_list_remove(&m->request_state.link);
 		wlr_output->data = NULL;
@@ -269,6 +294,8 @@ createmon(struct wl_listener *listener, void *data)
 	wlr_output_state_finish(&state);
 
 	wl_list_insert(&mons, &m->link);
+	m->render_timer = wl_event_loop_add_timer(event_loop, rendermon_timer, m);
+	m->resize_fence_timer = wl_event_loop_add_timer(event_loop, resize_fence_timer, m);
 	printstatus();
 
 	/* Create output Lua object (persists from connect to disconnect).
@@ -500,29 +527,67 @@ powermgrsetmode(struct wl_listener *listener, void *data)
 	updatemons(NULL, NULL);
 }
 
-void
-rendermon(struct wl_listener *listener, void *data)
+static uint64_t
+monitor_now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/** Render the pending frame of m: the resize check and the scene commit.
+ * \param start When the work for the frame began, including any refresh
+ * run for it, so the render time the deadline budgets for covers it
+ * \param vblank Predicted vblank the frame is scanned out at, 0 if unknown
+ * \param deferred Whether the render was delayed towards it */
+static void
+rendermon_render(Monitor *m, uint64_t start, uint64_t vblank, bool deferred)
 {
-	/* This function is called every time an output is ready to display a frame,
-	 * generally at the output's refresh rate (e.g. 60Hz). */
-	Monitor *m = wl_container_of(listener, m, frame);
 	Client *c;
-	struct timespec now;
 	bool presented = false;
+#ifdef SOMEWM_BENCH
+	uint64_t bench_render_ns = 0;
+#endif
+
+	luagc_hold();
 
-	/* Safety: scene_output may not exist yet if frame fires before createmon
-	 * finishes (possible on NVIDIA), or output may be disabled */
-	if (!m->scene_output)
-		return;
 	if (!m->wlr_output->enabled)
 		goto skip;
 
 	/* Render if no XDG clients have an outstanding resize and are visible on
-	 * this monitor. */
-	foreach(client, globalconf.clients) {
-		c = *client;
-		if (c->resize && !some_client_get_floating(c) && c->mon == m && !client_is_stopped(c))
+	 * this monitor. pending_resizes makes the common case free; only when it
+	 * is set are the clients checked for one the resize actually blocks. */
+	if (m->pending_resizes > 0) {
+		uint64_t now_ns = monitor_now_ns(), wait_ns = 0;
+		foreach(client, globalconf.clients) {
+			c = *client;
+			if (!c->resize || some_client_get_floating(c) || c->mon != m || client_is_stopped(c))
+				continue;
+			/* The fence: a client slow to ack (or never acking) its
+			 * configure must not freeze the whole output. Each resize
+			 * gets its own, so one that expired doesn't stop the
+			 * output from waiting on the next. */
+			if (now_ns - c->resize_ns >= RESIZE_FENCE_NS) {
+#ifdef SOMEWM_BENCH
+				if (!c->resize_fence_expired)
+					bench_output_resize_wait(m->wlr_output->name, true);
+#endif
+				c->resize_fence_expired = true;
+				continue;
+			}
+			wait_ns = MAX(wait_ns, RESIZE_FENCE_NS - (now_ns - c->resize_ns));
+		}
+		if (wait_ns) {
+#ifdef SOMEWM_BENCH
+			bench_output_resize_wait(m->wlr_output->name, false);
+#endif
+			/* Skipping schedules no frame: an output with nothing else
+			 * going on would never see its fence expire */
+			if (m->resize_fence_timer)
+				wl_event_source_timer_update(m->resize_fence_timer,
+					(int)((wait_ns + 999999) / 1000000ULL));
 			goto skip;
+		}
 	}
 
 #ifdef SOMEWM_BENCH
@@ -536,21 +601,188 @@ rendermon(struct wl_listener *listener, void *data)
 	if (!wlr_scene_output_commit(m->scene_output, NULL)) {
 		wlr_log(WLR_DEBUG, "[HOTPLUG] rendermon commit failed: %s",
 			m->wlr_output->name);
+		presented = false;
 	} else {
 		if (presented)
 			globalconf.frame_commit_count++;
 #ifdef SOMEWM_BENCH
 		clock_gettime(CLOCK_MONOTONIC, &bench_render_end);
-		bench_render_record(timespec_diff_ns(&bench_render_start, &bench_render_end));
-		bench_input_commit_flush();
+		bench_render_ns = timespec_diff_ns(&bench_render_start, &bench_render_end);
+		bench_render_record(bench_render_ns);
+		bench_input_commit_flush(vblank);
+#endif
+		/* A commit with nothing to present still means the output shows
+		 * the post-startup scene, so count it too */
+		if (startup_profile_enabled) {
+			Monitor *o;
+			int enabled = 0;
+			wl_list_for_each(o, &mons, link)
+				enabled += o->wlr_output->enabled;
+			startup_profile_output_presented(m->wlr_output->name, enabled);
+		}
+	}
+
+	/* Frames with nothing to present say nothing about the render cost */
+	if (presented) {
+		uint64_t end = monitor_now_ns();
+		m->render_ns[m->render_index] = end - start;
+		m->render_index = (m->render_index + 1) % (int)LENGTH(m->render_ns);
+
+		if (deferred) {
+			/* Done after the vblank it aimed for: the frame slipped by a
+			 * whole period, so keep more margin from now on */
+			bool missed = end > vblank;
+			if (missed)
+				m->render_slack_ns = MIN(m->render_slack_ns * 2, RENDER_SLACK_MAX_NS);
+			else if (m->render_slack_ns > RENDER_SLACK_MIN_NS)
+				m->render_slack_ns -= (m->render_slack_ns - RENDER_SLACK_MIN_NS) / 16 + 1;
+#ifdef SOMEWM_BENCH
+			bench_output_deferred(m->wlr_output->name, missed, end - start);
 #endif
+		}
 	}
 
 skip:
+#ifdef SOMEWM_BENCH
+	bench_output_frame(m->wlr_output->name, m->wlr_output->refresh,
+	                   bench_render_ns, presented);
+#endif
+	luagc_release();
+}
+
+/** The first vblank after now, 0 without a fixed refresh cycle */
+static uint64_t
+rendermon_next_vblank(Monitor *m, uint64_t now)
+{
+	uint64_t period = m->vblank_period_ns;
+
+	if (!period || !m->vblank_ns || now < m->vblank_ns
+	    || m->wlr_output->adaptive_sync_status == WLR_OUTPUT_ADAPTIVE_SYNC_ENABLED)
+		return 0;
+	return m->vblank_ns + ((now - m->vblank_ns) / period + 1) * period;
+}
+
+/** How long the render of the frame starting now can wait to make vblank.
+ * \return The delay in ms (the timer's resolution), 0 to render now */
+static int
+rendermon_delay_ms(Monitor *m, uint64_t now, uint64_t vblank)
+{
+	uint64_t budget = 0, deadline;
+
+	if (!vblank)
+		return 0;
+
+	/* The slowest recent render, so a single fast frame doesn't make
+	 * the next one miss */
+	for (size_t i = 0; i < LENGTH(m->render_ns); i++)
+		budget = MAX(budget, m->render_ns[i]);
+	if (!m->render_slack_ns)
+		m->render_slack_ns = RENDER_SLACK_MIN_NS;
+	budget += m->render_slack_ns;
+
+	if (vblank < now + budget)
+		return 0;
+	deadline = vblank - budget;
+	return (int)((deadline - now) / 1000000ULL);
+}
+
+static int
+rendermon_timer(void *data)
+{
+	Monitor *m = data;
+	uint64_t target = m->render_target_ns;
+	uint64_t start;
+
+	m->render_scheduled = false;
+	m->render_target_ns = 0;
+	if (!m->scene_output)
+		return 0;
+
+	/* Lua work that arrived during the wait (client titles, timers) makes
+	 * this frame instead of the next one. It runs inside the deadline,
+	 * so it counts towards the render time. */
+	start = monitor_now_ns();
+	some_refresh();
+	rendermon_render(m, start, target, true);
+	return 0;
+}
+
+static int
+resize_fence_timer(void *data)
+{
+	Monitor *m = data;
+
+	/* The next frame renders past the expired fence */
+	if (m->wlr_output->enabled)
+		wlr_output_schedule_frame(m->wlr_output);
+	return 0;
+}
+
+void
+rendermon(struct wl_listener *listener, void *data)
+{
+	/* This function is called every time an output is ready to display a frame,
+	 * generally at the output's refresh rate (e.g. 60Hz).
+	 *
+	 * Rendering right away would leave the rest of the refresh period for
+	 * the frame to wait on scanout, and client commits arriving during it
+	 * for the next one. Instead, frame done goes out to clients now and the
+	 * commit is deferred to a deadline before the predicted vblank, leaving
+	 * room for the slowest recent render plus a margin that grows whenever
+	 * a vblank is missed. */
+	Monitor *m = wl_container_of(listener, m, frame);
+	struct timespec now;
+	uint64_t now_ns, vblank;
+	int delay_ms;
+
+	/* Safety: scene_output may not exist yet if frame fires before createmon
+	 * finishes (possible on NVIDIA), or output may be disabled */
+	if (!m->scene_output)
+		return;
+
+	/* Client commits during the wait schedule frames of their own; the
+	 * deferred render covers them */
+	if (m->render_scheduled)
+		return;
+
+	/* Keep Lua GC steps out of the render; luagc_idle() catches up
+	 * before the next predicted vblank */
+	luagc_frame(m->wlr_output->refresh);
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	now_ns = (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+	vblank = rendermon_next_vblank(m, now_ns);
+	delay_ms = m->render_timer && m->wlr_output->enabled
+		? rendermon_delay_ms(m, now_ns, vblank) : 0;
+
+	if (delay_ms > 0) {
+		wlr_scene_output_send_frame_done(m->scene_output, &now);
+		m->render_scheduled = true;
+		m->render_target_ns = vblank;
+		wl_event_source_timer_update(m->render_timer, delay_ms);
+		luagc_render_at(now_ns + (uint64_t)delay_ms * 1000000ULL);
+		return;
+	}
+
+	rendermon_render(m, monitor_now_ns(), vblank, false);
 	clock_gettime(CLOCK_MONOTONIC, &now);
 	wlr_scene_output_send_frame_done(m->scene_output, &now);
 }
 
+void
+presentmon(struct wl_listener *listener, void *data)
+{
+	/* Phase of the refresh cycle, for rendermon_delay_ms() */
+	Monitor *m = wl_container_of(listener, m, present);
+	struct wlr_output_event_present *event = data;
+
+	if (!event->presented)
+		return;
+	m->vblank_ns = (uint64_t)event->when.tv_sec * 1000000000ULL
+		+ (uint64_t)event->when.tv_nsec;
+	m->vblank_period_ns = event->refresh > 0 ? (uint64_t)event->refresh : 0;
+}
+
 void
 requestmonstate(struct wl_listener *listener, void *data)
 {
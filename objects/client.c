@@ -115,6 +115,7 @@
 /* Forward declaration - applies client geometry to wlroots scene graph */
 void apply_geometry_to_wlroots(client_t *c);
 
+#include <glib.h>
 #include <math.h>
 #include <stdio.h>
 #include <string.h>
@@ -1636,6 +1637,8 @@ client_wipe(client_t *c)
     p_delete(&c->name);
     p_delete(&c->alt_name);
     p_delete(&c->startup_id);
+    p_delete(&c->pending_name);
+    p_delete(&c->pending_class);
 }
 
 /** Change the clients urgency flag.
@@ -1668,12 +1671,27 @@ client_set_urgent(lua_State *L, int cidx, bool urgent)
         } \
     }
 DO_CLIENT_SET_PROPERTY(group_window)
-DO_CLIENT_SET_PROPERTY(type)
-DO_CLIENT_SET_PROPERTY(transient_for)
 DO_CLIENT_SET_PROPERTY(pid)
 DO_CLIENT_SET_PROPERTY(skip_taskbar)
 #undef DO_CLIENT_SET_PROPERTY
 
+/* Properties client_layer_translator() depends on */
+#define DO_CLIENT_SET_STACK_PROPERTY(prop) \
+    void \
+    client_set_##prop(lua_State *L, int cidx, fieldtypeof(client_t, prop) value) \
+    { \
+        client_t *c = luaA_checkudata(L, cidx, &client_class); \
+        if(c->prop != value) \
+        { \
+            c->prop = value; \
+            stack_client_changed(c); \
+            luaA_object_emit_signal(L, cidx, "property::" #prop, 0); \
+        } \
+    }
+DO_CLIENT_SET_STACK_PROPERTY(type)
+DO_CLIENT_SET_STACK_PROPERTY(transient_for)
+#undef DO_CLIENT_SET_STACK_PROPERTY
+
 #define DO_CLIENT_SET_STRING_PROPERTY2(prop, signal) \
     void \
     client_set_##prop(lua_State *L, int cidx, char *value) \
@@ -1906,6 +1924,118 @@ client_getbyframewin(xcb_window_t w)
     return NULL;
 }
 
+/* Handle slots. Generation 0 is never handed out, so a zeroed handle is
+ * always stale. */
+typedef struct
+{
+    client_t *client;
+    uint32_t generation;
+    /** Next free slot (index + 1), 0 for none */
+    uint32_t next_free;
+} client_slot_t;
+
+static client_slot_t *client_slots;
+static uint32_t client_slots_len;
+static uint32_t client_slots_size;
+static uint32_t client_slots_free;
+/** client_t * -> slot index + 1 */
+static GHashTable *client_slot_index;
+
+/** Give a client a handle; call when it enters globalconf.clients.
+ * \param c The client.
+ */
+void
+client_handle_register(client_t *c)
+{
+    uint32_t i;
+
+    if(client_is_registered(c))
+        return;
+
+    if(!client_slot_index)
+        client_slot_index = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+    if(client_slots_free)
+    {
+        i = client_slots_free - 1;
+        client_slots_free = client_slots[i].next_free;
+    }
+    else
+    {
+        if(client_slots_len == client_slots_size)
+        {
+            client_slots_size = client_slots_size ? client_slots_size * 2 : 32;
+            p_realloc(&client_slots, client_slots_size);
+        }
+        i = client_slots_len++;
+        client_slots[i].generation = 1;
+    }
+
+    client_slots[i].client = c;
+    client_slots[i].next_free = 0;
+    c->handle.index = i;
+    c->handle.generation = client_slots[i].generation;
+    g_hash_table_insert(client_slot_index, c, GUINT_TO_POINTER(i + 1));
+}
+
+/** Invalidate the handle of a client leaving globalconf.clients.
+ * \param c The client.
+ */
+void
+client_handle_unregister(client_t *c)
+{
+    gpointer value;
+    uint32_t i;
+
+    if(!client_slot_index || !(value = g_hash_table_lookup(client_slot_index, c)))
+        return;
+
+    i = GPOINTER_TO_UINT(value) - 1;
+    g_hash_table_remove(client_slot_index, c);
+
+    client_slots[i].client = NULL;
+    if(++client_slots[i].generation == 0)
+        client_slots[i].generation = 1;
+    client_slots[i].next_free = client_slots_free;
+    client_slots_free = i + 1;
+
+    c->handle.index = 0;
+    c->handle.generation = 0;
+}
+
+/** Invalidate every handle (hot reload replaces all client objects). */
+void
+client_handle_reset(void)
+{
+    for(uint32_t i = 0; i < client_slots_len; i++)
+        if(client_slots[i].client)
+            client_handle_unregister(client_slots[i].client);
+}
+
+/** Resolve a handle.
+ * \param h The handle.
+ * \return The client, or NULL if it left globalconf.clients since.
+ */
+client_t *
+client_handle_get(client_handle_t h)
+{
+    if(h.index >= client_slots_len || client_slots[h.index].generation != h.generation)
+        return NULL;
+
+    return client_slots[h.index].client;
+}
+
+/** Check that a pointer is a client in globalconf.clients. The pointer is
+ * never dereferenced, so it may be stale.
+ * \param c The pointer.
+ * \return true if c is a managed client.
+ */
+bool
+client_is_registered(const client_t *c)
+{
+    return client_slot_index && g_hash_table_contains(client_slot_index, c);
+}
+
 /** Unfocus a client (internal).
  * \param c The client.
  * \param sync Emit the signals now instead of queueing them. Required when the
@@ -2417,6 +2547,7 @@ client_manage(xcb_window_t w, xcb_get_geometry_reply_t *wgeom, xcb_get_window_at
     /* Duplicate client and push it in client list */
     lua_pushvalue(L, -1);
     client_array_push(&globalconf.clients, luaA_object_ref(L, -1));
+    client_handle_register(c);
 
     /* Set the right screen */
     screen_client_moveto(c, screen_getbycoord(wgeom->x, wgeom->y), false);
@@ -2965,7 +3096,7 @@ client_set_fullscreen(lua_State *L, int cidx, bool s)
             wlr_foreign_toplevel_handle_v1_set_fullscreen(c->toplevel_handle, s);
         /* Force a client resize, so that titlebars get shown/hidden */
         client_resize_do(c, c->geometry, false);
-        stack_windows();
+        stack_client_changed(c);
     }
 }
 
@@ -3022,7 +3153,7 @@ client_set_maximized_common(lua_State *L, int cidx, bool s, const char* type, co
                 wlr_foreign_toplevel_handle_v1_set_maximized(c->toplevel_handle, c->maximized);
         }
 
-        stack_windows();
+        stack_client_changed(c);
     }
 }
 
@@ -3070,7 +3201,7 @@ client_set_above(lua_State *L, int cidx, bool s)
             client_set_fullscreen(L, cidx, false);
         }
         c->above = s;
-        stack_windows();
+        stack_client_changed(c);
         luaA_object_emit_signal(L, cidx, "property::above", 0);
     }
 }
@@ -3095,7 +3226,7 @@ client_set_below(lua_State *L, int cidx, bool s)
             client_set_fullscreen(L, cidx, false);
         }
         c->below = s;
-        stack_windows();
+        stack_client_changed(c);
         luaA_object_emit_signal(L, cidx, "property::below", 0);
     }
 }
@@ -3113,7 +3244,7 @@ client_set_modal(lua_State *L, int cidx, bool s)
     if(c->modal != s)
     {
         c->modal = s;
-        stack_windows();
+        stack_client_changed(c);
         luaA_object_emit_signal(L, cidx, "property::modal", 0);
     }
 }
@@ -3138,7 +3269,7 @@ client_set_ontop(lua_State *L, int cidx, bool s)
             client_set_fullscreen(L, cidx, false);
         }
         c->ontop = s;
-        stack_windows();
+        stack_client_changed(c);
         luaA_object_emit_signal(L, cidx, "property::ontop", 0);
     }
 }
@@ -3186,7 +3317,10 @@ client_unmanage(client_t *c, client_unmanage_t reason)
     {
         client_t *tc = *_tc;
         if(tc->transient_for == c)
+        {
             tc->transient_for = NULL;
+            stack_client_changed(tc);
+        }
     }
 
     /* Emit synchronously: this client is invalidated before the event queue is
@@ -3217,6 +3351,9 @@ client_unmanage(client_t *c, client_unmanage_t reason)
             client_array_remove(&globalconf.clients, elem);
             break;
         }
+    client_handle_unregister(c);
+    client_set_resize(c, 0);
+    property_pending_clear(c);
     stack_client_remove(c);
     for(int i = 0; i < globalconf.tags.len; i++)
         untag_client(c, globalconf.tags.tab[i]);
@@ -3324,6 +3461,9 @@ client_unmanage(client_t *c, client_unmanage_t reason)
     }
 #endif
 
+    /* Window IDs are reused; drop the property cache for this one */
+    ewmh_client_forget(c, reason == CLIENT_UNMANAGE_DESTROYED);
+
     /* set client as invalid (X11/XWayland compatibility) */
     c->window = XCB_NONE;
 
@@ -3397,10 +3537,10 @@ luaA_client_get(lua_State *L)
     lua_newtable(L);
     if(stacked)
     {
-        foreach_reverse(c, globalconf.stack)
-            if(screen == NULL || (*c)->screen == screen)
+        stack_foreach_reverse(c)
+            if(screen == NULL || c->screen == screen)
             {
-                luaA_object_push(L, *c);
+                luaA_object_push(L, c);
                 lua_rawseti(L, -2, i++);
             }
     }
@@ -3751,8 +3891,7 @@ luaA_client_raise(lua_State *L)
 
     /* Avoid sending the signal if nothing was done */
     if (c->transient_for == NULL &&
-        globalconf.stack.len &&
-        globalconf.stack.tab[globalconf.stack.len-1] == c)
+        globalconf.stack.tail == c)
         return 0;
 
     client_raise(c);
@@ -3776,7 +3915,7 @@ luaA_client_lower(lua_State *L)
     client_t *c = luaA_checkudata(L, 1, &client_class);
 
     /* Avoid sending the signal if nothing was done */
-    if (globalconf.stack.len && globalconf.stack.tab[0] == c)
+    if (globalconf.stack.head == c)
         return 0;
 
     stack_client_push(c);
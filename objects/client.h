@@ -134,6 +134,14 @@ typedef struct {
     uint32_t status;
 } motif_wm_hints_t;
 
+/** Reference to a client in globalconf.clients, checked in O(1). The slot
+ * of a client that leaves the list is only reused with a new generation,
+ * so a stale handle resolves to NULL rather than to another client. */
+typedef struct {
+    uint32_t index;
+    uint32_t generation;
+} client_handle_t;
+
 /** client_t type - AwesomeWM client structure adapted for Wayland */
 typedef struct client_t client_t;
 struct client_t
@@ -172,6 +180,7 @@ struct client_t
     struct wl_listener unmap;
     struct wl_listener destroy;
     struct wl_listener set_title;
+    struct wl_listener set_app_id;
     struct wl_listener request_fullscreen;  /* Renamed to avoid conflict with bool fullscreen */
     struct wl_listener set_decoration_mode;
     struct wl_listener destroy_decoration;
@@ -190,8 +199,15 @@ struct client_t
     struct wl_listener foreign_request_fullscreen;
     struct wl_listener foreign_request_maximize;
     struct wl_listener foreign_request_minimize;
-    /** Pending resize serial for Wayland configure */
+    /** Pending resize serial for Wayland configure. Set through
+     *  client_set_resize() so the monitor's pending count stays right. */
     uint32_t resize;
+    /** Monitor whose pending_resizes counts this client's resize */
+    Monitor *resize_mon;
+    /** When the pending resize was first sent, for the monitor's fence */
+    uint64_t resize_ns;
+    /** The fence expired: the monitor renders without waiting for it */
+    bool resize_fence_expired;
     /** Set when we re-sent a configure because actual geometry didn't match
      *  the acked configure. Prevents infinite loop with clients that
      *  intentionally render smaller (e.g. terminals rounding to cell size). */
@@ -223,6 +239,13 @@ struct client_t
     char *name, *alt_name, *icon_name, *alt_icon_name;
     /** WM_CLASS stuff */
     char *class, *instance;
+    /** Title and app_id received but not delivered to Lua yet (property.c) */
+    char *pending_name, *pending_class;
+    uint8_t pending_props;
+    /** An event queue entry will deliver pending_props */
+    bool pending_queued;
+    /** Last delivery, for awesome.client_property_rate */
+    uint64_t pending_applied_ns;
     /** Window geometry */
     area_t geometry;
     /** Old window geometry currently configured in X11 */
@@ -324,6 +347,17 @@ struct client_t
     uint32_t pid;
     /** Window it is transient for */
     client_t *transient_for;
+    /** Neighbours in globalconf.stack (towards the bottom and the top) */
+    client_t *stack_prev;
+    client_t *stack_next;
+    /** Is the client linked into globalconf.stack? */
+    bool in_stack;
+    /** Queued for stack_refresh() (moved, or its layer may have changed) */
+    bool stack_pending;
+    /** window_layer_t the client was last stacked in */
+    int stack_layer;
+    /** Handle while the client is in globalconf.clients */
+    client_handle_t handle;
     /** Value of WM_TRANSIENT_FOR - X11 window ID (XWayland compatibility) */
     uint32_t transient_for_window;
     /** Titelbar information */
@@ -364,11 +398,25 @@ client_t * client_getbywin(xcb_window_t);
 client_t * client_getbynofocuswin(xcb_window_t);
 client_t * client_getbyframewin(xcb_window_t);
 
+/* Handles: register when a client enters globalconf.clients, unregister
+ * when it leaves. client_is_registered() takes pointers that may be stale
+ * (scene node data) and never dereferences them. */
+void client_handle_register(client_t *);
+void client_handle_unregister(client_t *);
+void client_handle_reset(void);
+client_t * client_handle_get(client_handle_t);
+bool client_is_registered(const client_t *);
+
 void client_ban(client_t *);
 void client_ban_unfocus(client_t *);
 void client_unban(client_t *);
 void client_manage(xcb_window_t, xcb_get_geometry_reply_t *, xcb_get_window_attributes_reply_t *);
 bool client_resize(client_t *, area_t, bool, bool);
+/* Set or clear (serial 0) the pending configure serial, keeping
+ * Monitor.pending_resizes in sync (window.c). client_resize_mon_update()
+ * must follow any change of c->mon. */
+void client_set_resize(client_t *, uint32_t);
+void client_resize_mon_update(client_t *);
 void client_unmanage(client_t *, client_unmanage_t);
 void client_kill(client_t *);
 void client_set_sticky(lua_State *, int, bool);
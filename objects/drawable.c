@@ -22,6 +22,7 @@
 #include <string.h>
 #include <math.h>
 #include <lauxlib.h>
+#include <pango/pangocairo.h>
 #include <wlr/types/wlr_buffer.h>
 #include <wlr/interfaces/wlr_buffer.h>
 #include <sys/mman.h>
@@ -659,6 +660,139 @@ luaA_drawable_refresh(lua_State *L)
 	return 0;
 }
 
+/* ============================================================================
+ * Widget Draw Fast Paths
+ * ============================================================================
+ *
+ * wibox.widget.textbox and imagebox draw through LGI, where every Pango or
+ * Cairo call is a separate trip through the FFI layer with its own argument
+ * marshalling (and a boxed PangoRectangle pair for each extents query).
+ * These do a whole widget draw in one call on the natives behind the LGI
+ * objects (obj._native). The PangoLayout stays owned by the textbox and
+ * keeps its line cache: Pango only invalidates it when the text,
+ * attributes, font, size or resolution actually change.
+ */
+
+static void *
+luaA_checknative(lua_State *L, int idx, const char *what)
+{
+	void *p;
+
+	if (!lua_islightuserdata(L, idx))
+		luaL_error(L, "expected %s as lightuserdata (use ._native)", what);
+	p = lua_touserdata(L, idx);
+	if (!p)
+		luaL_error(L, "%s is NULL", what);
+	return p;
+}
+
+/** Size a textbox layout for the given box */
+static void
+drawable_text_layout_setup(PangoLayout *layout, double width, double height)
+{
+	/* Both are no-ops inside Pango when the value didn't change */
+	pango_layout_set_width(layout, pango_units_from_double(width));
+	pango_layout_set_height(layout, pango_units_from_double(height));
+}
+
+/** drawable.fit_text_layout(layout, width, height) -> width, height
+ * Logical pixel size of a textbox layout in the given box, 0, 0 if empty.
+ */
+static int
+luaA_drawable_fit_text_layout(lua_State *L)
+{
+	PangoLayout *layout = luaA_checknative(L, 1, "PangoLayout");
+	PangoRectangle logical;
+
+	drawable_text_layout_setup(layout, luaL_checknumber(L, 2), luaL_checknumber(L, 3));
+	pango_layout_get_pixel_extents(layout, NULL, &logical);
+
+	if (logical.width == 0 || logical.height == 0) {
+		lua_pushinteger(L, 0);
+		lua_pushinteger(L, 0);
+	} else {
+		lua_pushinteger(L, logical.width);
+		lua_pushinteger(L, logical.height);
+	}
+	return 2;
+}
+
+/** drawable.draw_text_layout(cr, layout, width, height, valign)
+ * Draw a textbox layout at the origin of cr, aligned vertically inside
+ * the box ("top", "center" or "bottom").
+ */
+static int
+luaA_drawable_draw_text_layout(lua_State *L)
+{
+	static const char *const valigns[] = { "top", "center", "bottom", NULL };
+	cairo_t *cr = luaA_checknative(L, 1, "cairo context");
+	PangoLayout *layout = luaA_checknative(L, 2, "PangoLayout");
+	double width = luaL_checknumber(L, 3);
+	double height = luaL_checknumber(L, 4);
+	int valign = luaL_checkoption(L, 5, "top", valigns);
+	PangoRectangle logical;
+	double offset = 0;
+
+	drawable_text_layout_setup(layout, width, height);
+	/* Only invalidates the layout if the device transform or font options
+	 * changed since the last draw */
+	pango_cairo_update_layout(cr, layout);
+	pango_layout_get_pixel_extents(layout, NULL, &logical);
+
+	if (valign == 1)
+		offset = (height - logical.height) / 2;
+	else if (valign == 2)
+		offset = height - logical.height;
+
+	cairo_move_to(cr, 0, offset);
+	pango_cairo_show_layout(cr, layout);
+	return 0;
+}
+
+/** drawable.draw_image(cr, surface, x, y[, sx, sy[, extend[, filter]]])
+ * Paint an image surface translated by x, y and scaled by sx, sy, with an
+ * optional pattern extend ("pad", "repeat", "reflect") and filter
+ * ("fast", "good", "best", "nearest", "bilinear", "gaussian").
+ */
+static int
+luaA_drawable_draw_image(lua_State *L)
+{
+	static const char *const extends[] = { "none", "repeat", "reflect", "pad", NULL };
+	static const cairo_extend_t extend_values[] = {
+		CAIRO_EXTEND_NONE, CAIRO_EXTEND_REPEAT, CAIRO_EXTEND_REFLECT, CAIRO_EXTEND_PAD,
+	};
+	static const char *const filters[] = {
+		"fast", "good", "best", "nearest", "bilinear", "gaussian", NULL
+	};
+	static const cairo_filter_t filter_values[] = {
+		CAIRO_FILTER_FAST, CAIRO_FILTER_GOOD, CAIRO_FILTER_BEST,
+		CAIRO_FILTER_NEAREST, CAIRO_FILTER_BILINEAR, CAIRO_FILTER_GAUSSIAN,
+	};
+	cairo_t *cr = luaA_checknative(L, 1, "cairo context");
+	cairo_surface_t *surface = luaA_checknative(L, 2, "cairo surface");
+	double x = luaL_checknumber(L, 3);
+	double y = luaL_checknumber(L, 4);
+	double sx = luaL_optnumber(L, 5, 1);
+	double sy = luaL_optnumber(L, 6, 1);
+	int extend = lua_isnoneornil(L, 7) ? -1 : luaL_checkoption(L, 7, NULL, extends);
+	int filter = lua_isnoneornil(L, 8) ? -1 : luaL_checkoption(L, 8, NULL, filters);
+	cairo_pattern_t *pattern;
+
+	cairo_translate(cr, x, y);
+	if (sx != 1 || sy != 1)
+		cairo_scale(cr, sx, sy);
+
+	pattern = cairo_pattern_create_for_surface(surface);
+	if (extend >= 0)
+		cairo_pattern_set_extend(pattern, extend_values[extend]);
+	if (filter >= 0)
+		cairo_pattern_set_filter(pattern, filter_values[filter]);
+	cairo_set_source(cr, pattern);
+	cairo_pattern_destroy(pattern);
+	cairo_paint(cr);
+	return 0;
+}
+
 /* ============================================================================
  * Lua Class Setup
  * ============================================================================ */
@@ -753,6 +887,9 @@ void
 drawable_class_setup(lua_State *L)
 {
 	static const struct luaL_Reg drawable_methods[] = {
+		{ "fit_text_layout", luaA_drawable_fit_text_layout },
+		{ "draw_text_layout", luaA_drawable_draw_text_layout },
+		{ "draw_image", luaA_drawable_draw_image },
 		{ NULL, NULL }
 	};
 
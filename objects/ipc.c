@@ -7,6 +7,7 @@
 
 #include "ipc.h"
 #include "luaa.h"
+#include "../bench.h"
 #include <string.h>
 #include <unistd.h>
 
@@ -25,6 +26,7 @@ ipc_dispatch_to_lua(int client_fd, const char *command)
 {
 	lua_State *L = globalconf_L;
 	const char *result;
+	int status;
 
 	if (!L) {
 		ipc_send_response(client_fd, "ERROR Lua not initialized\n\n");
@@ -44,7 +46,16 @@ ipc_dispatch_to_lua(int client_fd, const char *command)
 	lua_pushinteger(L, client_fd);
 
 	/* Call _ipc_dispatch(command, client_fd) */
-	if (lua_pcall(L, 2, 1, 0) != 0) {
+#ifdef SOMEWM_BENCH
+	char word[32];
+	snprintf(word, sizeof(word), "%.*s", (int)strcspn(command, " \t\n"), command);
+	int alloc_depth = bench_alloc_enter(BENCH_ALLOC_IPC, word);
+#endif
+	status = lua_pcall(L, 2, 1, 0);
+#ifdef SOMEWM_BENCH
+	bench_alloc_leave(alloc_depth);
+#endif
+	if (status != 0) {
 		/* Error in Lua code */
 		const char *error = lua_tostring(L, -1);
 		char response[1024];
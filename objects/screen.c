@@ -11,6 +11,7 @@
 #include "../globalconf.h"
 #include "common/util.h"
 #include "../x11_compat.h"
+#include "../stack.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -1558,6 +1559,7 @@ luaA_screen_fake_add(lua_State *L)
 	screen->name = NULL;
 	screen->virtual_output = NULL;
 	signal_array_init(&screen->signals);
+	screen->registry_ref = 0;
 
 	/* Set metatable using class-based lookup (not named metatable) */
 	lua_pushlightuserdata(L, &screen_class);
@@ -2238,6 +2240,7 @@ screen_client_moveto(client_t *c, screen_t *new_screen, bool doresize)
 		had_focus = true;
 
 	c->screen = new_screen;
+	stack_client_screen_changed(c);
 
 	/* Update c->mon to match the new screen (fixes multi-monitor visibility bug) */
 	if (new_screen) {
@@ -2245,6 +2248,7 @@ screen_client_moveto(client_t *c, screen_t *new_screen, bool doresize)
 		if (new_mon && new_mon != c->mon) {
 			extern void banning_need_update(void);
 			c->mon = new_mon;
+			client_resize_mon_update(c);
 			banning_need_update();
 		}
 	}
@@ -4,6 +4,7 @@
 #include "objects/client.h"
 
 #include <lua.h>
+#include <stdbool.h>
 #include <wlr/types/wlr_xdg_activation_v1.h>
 
 /* XDG Activation protocol for startup notification */
@@ -15,6 +16,12 @@ int luaA_spawn(lua_State*);
 void spawn_child_exited(pid_t, int);
 void spawn_invalidate_callbacks(void);
 
+/* Native output readers for spawned commands' pipes */
+int luaA_spawn_read_lines(lua_State*);
+int luaA_spawn_read_output(lua_State*);
+void spawn_readers_dispatch(lua_State*);
+bool spawn_readers_pending(void);
+
 /* Setup function (legacy - no longer used) */
 void luaA_spawn_setup(lua_State *L);
 
@@ -23,6 +23,8 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <glib.h>
 
 /* Systray item class */
 lua_class_t systray_item_class;
@@ -42,6 +44,197 @@ static void systray_item_ptr_wipe(systray_item_t **item) {
 
 ARRAY_FUNCS(systray_item_t *, systray_item, systray_item_ptr_wipe)
 
+/* ========================================================================
+ * Pixmap cache
+ *
+ * SNI pixmaps arrive as raw network byte order ARGB. Apps that blink their
+ * icon resend the same two or three pixmaps over and over, and several
+ * items often share one icon. Converted surfaces are kept in a cache keyed
+ * by the pixmap itself (hashed, then compared byte for byte), so each
+ * distinct pixmap is converted (and premultiplied, which Cairo and wlroots
+ * both expect) once and shared.
+ * ======================================================================== */
+
+/** Entries no item references any more are evicted past this many */
+#define SYSTRAY_PIXMAP_CACHE_MAX 64
+
+typedef struct {
+	uint64_t hash;
+	int width;
+	int height;
+	unsigned char *pixels;       /* The pixmap as received */
+	cairo_surface_t *surface;    /* The cache holds one reference */
+} systray_pixmap_entry_t;
+
+/* Set of systray_pixmap_entry_t, which are key and value */
+static GHashTable *systray_pixmap_cache = NULL;
+static cairo_user_data_key_t systray_pixmap_data_key;
+
+static guint
+systray_pixmap_key_hash(gconstpointer key)
+{
+	uint64_t k = ((const systray_pixmap_entry_t *)key)->hash;
+	return (guint)(k ^ (k >> 32));
+}
+
+static gboolean
+systray_pixmap_key_equal(gconstpointer a, gconstpointer b)
+{
+	const systray_pixmap_entry_t *ea = a, *eb = b;
+
+	return ea->hash == eb->hash
+		&& ea->width == eb->width
+		&& ea->height == eb->height
+		&& memcmp(ea->pixels, eb->pixels, (size_t)ea->width * (size_t)ea->height * 4) == 0;
+}
+
+static void
+systray_pixmap_entry_free(gpointer data)
+{
+	systray_pixmap_entry_t *entry = data;
+
+	cairo_surface_destroy(entry->surface);
+	free(entry->pixels);
+	free(entry);
+}
+
+/** FNV-1a over the dimensions and pixel data */
+static uint64_t
+systray_pixmap_hash(const unsigned char *data, int width, int height)
+{
+	uint64_t h = 0xcbf29ce484222325ULL;
+	size_t len = (size_t)width * (size_t)height * 4;
+
+	h = (h ^ (uint64_t)width) * 0x100000001b3ULL;
+	h = (h ^ (uint64_t)height) * 0x100000001b3ULL;
+	for (size_t i = 0; i < len; i++)
+		h = (h ^ data[i]) * 0x100000001b3ULL;
+
+	return h;
+}
+
+/** Drop cached surfaces only the cache still holds */
+static void
+systray_pixmap_cache_trim(void)
+{
+	GHashTableIter iter;
+	gpointer key;
+
+	g_hash_table_iter_init(&iter, systray_pixmap_cache);
+	while (g_hash_table_iter_next(&iter, &key, NULL)) {
+		systray_pixmap_entry_t *entry = key;
+		if (cairo_surface_get_reference_count(entry->surface) <= 1)
+			g_hash_table_iter_remove(&iter);
+	}
+}
+
+/**
+ * Get a premultiplied ARGB32 surface for an SNI pixmap.
+ * \param data Pixel data in network byte order (big-endian ARGB).
+ * \return A new reference to a shared surface, or NULL.
+ */
+static cairo_surface_t *
+systray_pixmap_surface_get(const unsigned char *data, int width, int height)
+{
+	systray_pixmap_entry_t probe, *entry;
+	cairo_surface_t *surface;
+	unsigned char *cairo_data;
+	size_t len;
+	int stride;
+	int x, y;
+
+	if (!data || width <= 0 || height <= 0)
+		return NULL;
+
+	if (!systray_pixmap_cache)
+		systray_pixmap_cache = g_hash_table_new_full(systray_pixmap_key_hash,
+		                                             systray_pixmap_key_equal,
+		                                             systray_pixmap_entry_free,
+		                                             NULL);
+
+	probe.hash = systray_pixmap_hash(data, width, height);
+	probe.width = width;
+	probe.height = height;
+	probe.pixels = (unsigned char *)data;
+	entry = g_hash_table_lookup(systray_pixmap_cache, &probe);
+	if (entry)
+		return cairo_surface_reference(entry->surface);
+
+	stride = cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, width);
+	cairo_data = malloc((size_t)stride * (size_t)height);
+	if (!cairo_data)
+		return NULL;
+
+	/* Network byte order ARGB to native, premultiplied ARGB32 */
+	for (y = 0; y < height; y++) {
+		const unsigned char *src = data + (size_t)y * width * 4;
+		uint32_t *dst = (uint32_t *)(cairo_data + (size_t)y * stride);
+
+		for (x = 0; x < width; x++, src += 4) {
+			uint32_t a = src[0];
+			uint32_t r = (src[1] * a + 127) / 255;
+			uint32_t g = (src[2] * a + 127) / 255;
+			uint32_t b = (src[3] * a + 127) / 255;
+			dst[x] = (a << 24) | (r << 16) | (g << 8) | b;
+		}
+	}
+
+	surface = cairo_image_surface_create_for_data(
+		cairo_data, CAIRO_FORMAT_ARGB32, width, height, stride);
+
+	if (cairo_surface_status(surface) != CAIRO_STATUS_SUCCESS) {
+		cairo_surface_destroy(surface);
+		free(cairo_data);
+		return NULL;
+	}
+
+	/* Cairo surface now owns the data - set user data to free it */
+	cairo_surface_set_user_data(surface, &systray_pixmap_data_key, cairo_data, free);
+
+	len = (size_t)width * (size_t)height * 4;
+	entry = malloc(sizeof(*entry));
+	if (!entry || !(probe.pixels = malloc(len))) {
+		/* Not cached, still usable */
+		free(entry);
+		return surface;
+	}
+	memcpy(probe.pixels, data, len);
+	*entry = probe;
+	entry->surface = cairo_surface_reference(surface);
+
+	if (g_hash_table_size(systray_pixmap_cache) >= SYSTRAY_PIXMAP_CACHE_MAX)
+		systray_pixmap_cache_trim();
+
+	g_hash_table_add(systray_pixmap_cache, entry);
+
+	return surface;
+}
+
+/**
+ * Replace *slot with the surface for a pixmap.
+ * \return true if the slot changed, false if it already showed this pixmap
+ * or conversion failed.
+ */
+static bool
+systray_pixmap_surface_set(cairo_surface_t **slot, const unsigned char *data,
+                           int width, int height)
+{
+	cairo_surface_t *surface = systray_pixmap_surface_get(data, width, height);
+
+	if (!surface)
+		return false;
+
+	if (surface == *slot) {
+		cairo_surface_destroy(surface);
+		return false;
+	}
+
+	if (*slot)
+		cairo_surface_destroy(*slot);
+	*slot = surface;
+	return true;
+}
+
 /**
  * Wipe a systray_item when it's garbage collected
  */
@@ -471,10 +664,6 @@ luaA_systray_item_set_attention_pixmap(lua_State *L)
 	int width, height;
 	size_t data_len;
 	const char *data;
-	int stride;
-	unsigned char *cairo_data;
-	int x, y;
-	static cairo_user_data_key_t attention_data_key;
 
 	item = luaA_checkudata(L, 1, &systray_item_class);
 	width = luaL_checkinteger(L, 2);
@@ -487,50 +676,10 @@ luaA_systray_item_set_attention_pixmap(lua_State *L)
 		                  width * height * 4, (int)data_len);
 	}
 
-	/* Free old attention icon */
-	if (item->attention_icon) {
-		cairo_surface_destroy(item->attention_icon);
-		item->attention_icon = NULL;
-	}
-
-	/* Create cairo surface from ARGB32 data */
-	stride = cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, width);
-	cairo_data = malloc((size_t)stride * (size_t)height);
-	if (!cairo_data)
+	if (!systray_pixmap_surface_set(&item->attention_icon,
+	                                (const unsigned char *)data, width, height))
 		return 0;
 
-	/* Convert from network byte order ARGB to native ARGB */
-	for (y = 0; y < height; y++) {
-		for (x = 0; x < width; x++) {
-			int src_idx = (y * width + x) * 4;
-			int dst_idx = y * stride + x * 4;
-
-#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
-			cairo_data[dst_idx + 0] = (unsigned char)data[src_idx + 3];
-			cairo_data[dst_idx + 1] = (unsigned char)data[src_idx + 2];
-			cairo_data[dst_idx + 2] = (unsigned char)data[src_idx + 1];
-			cairo_data[dst_idx + 3] = (unsigned char)data[src_idx + 0];
-#else
-			cairo_data[dst_idx + 0] = (unsigned char)data[src_idx + 0];
-			cairo_data[dst_idx + 1] = (unsigned char)data[src_idx + 1];
-			cairo_data[dst_idx + 2] = (unsigned char)data[src_idx + 2];
-			cairo_data[dst_idx + 3] = (unsigned char)data[src_idx + 3];
-#endif
-		}
-	}
-
-	item->attention_icon = cairo_image_surface_create_for_data(
-		cairo_data, CAIRO_FORMAT_ARGB32, width, height, stride);
-
-	if (cairo_surface_status(item->attention_icon) != CAIRO_STATUS_SUCCESS) {
-		cairo_surface_destroy(item->attention_icon);
-		item->attention_icon = NULL;
-		free(cairo_data);
-		return 0;
-	}
-
-	cairo_surface_set_user_data(item->attention_icon, &attention_data_key, cairo_data, free);
-
 	luaA_object_emit_signal(L, 1, "property::attention_icon", 0);
 
 	return 0;
@@ -911,63 +1060,15 @@ systray_item_set_icon_from_pixmap(systray_item_t *item,
                                   const unsigned char *data,
                                   int width, int height)
 {
-	int stride;
-	unsigned char *cairo_data;
-	int x, y;
 	lua_State *L;
-	static cairo_user_data_key_t data_key;
 
 	if (!item || !data || width <= 0 || height <= 0)
 		return;
 
-	/* Free old icon */
-	if (item->icon) {
-		cairo_surface_destroy(item->icon);
-		item->icon = NULL;
-	}
-
-	/* Create cairo surface from ARGB32 data
-	 * D-Bus sends ARGB in network byte order (big-endian)
-	 * Cairo wants native byte order, so we need to convert */
-	stride = cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, width);
-	cairo_data = malloc((size_t)stride * (size_t)height);
-	if (!cairo_data)
-		return;
-
-	/* Convert from network byte order ARGB to native ARGB */
-	for (y = 0; y < height; y++) {
-		for (x = 0; x < width; x++) {
-			int src_idx = (y * width + x) * 4;
-			int dst_idx = y * stride + x * 4;
-
-			/* Network byte order: ARGB (big endian)
-			 * On little-endian systems, we need to swap to BGRA */
-#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
-			cairo_data[dst_idx + 0] = data[src_idx + 3]; /* B <- B */
-			cairo_data[dst_idx + 1] = data[src_idx + 2]; /* G <- G */
-			cairo_data[dst_idx + 2] = data[src_idx + 1]; /* R <- R */
-			cairo_data[dst_idx + 3] = data[src_idx + 0]; /* A <- A */
-#else
-			cairo_data[dst_idx + 0] = data[src_idx + 0];
-			cairo_data[dst_idx + 1] = data[src_idx + 1];
-			cairo_data[dst_idx + 2] = data[src_idx + 2];
-			cairo_data[dst_idx + 3] = data[src_idx + 3];
-#endif
-		}
-	}
-
-	item->icon = cairo_image_surface_create_for_data(
-		cairo_data, CAIRO_FORMAT_ARGB32, width, height, stride);
-
-	if (cairo_surface_status(item->icon) != CAIRO_STATUS_SUCCESS) {
-		cairo_surface_destroy(item->icon);
-		item->icon = NULL;
-		free(cairo_data);
+	/* Apps resend unchanged pixmaps; only signal when something changed */
+	if (!systray_pixmap_surface_set(&item->icon, data, width, height)
+	    && (!item->icon || (item->icon_width == width && item->icon_height == height)))
 		return;
-	}
-
-	/* Cairo surface now owns the data - set user data to free it */
-	cairo_surface_set_user_data(item->icon, &data_key, cairo_data, free);
 
 	item->icon_width = width;
 	item->icon_height = height;
@@ -1021,60 +1122,14 @@ systray_item_set_overlay_from_pixmap(systray_item_t *item,
                                      const unsigned char *data,
                                      int width, int height)
 {
-	int stride;
-	unsigned char *cairo_data;
-	int x, y;
 	lua_State *L;
-	static cairo_user_data_key_t overlay_data_key;
 
 	if (!item || !data || width <= 0 || height <= 0)
 		return;
 
-	/* Free old overlay icon */
-	if (item->overlay_icon) {
-		cairo_surface_destroy(item->overlay_icon);
-		item->overlay_icon = NULL;
-	}
-
-	/* Create cairo surface from ARGB32 data */
-	stride = cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, width);
-	cairo_data = malloc((size_t)stride * (size_t)height);
-	if (!cairo_data)
+	if (!systray_pixmap_surface_set(&item->overlay_icon, data, width, height))
 		return;
 
-	/* Convert from network byte order ARGB to native ARGB */
-	for (y = 0; y < height; y++) {
-		for (x = 0; x < width; x++) {
-			int src_idx = (y * width + x) * 4;
-			int dst_idx = y * stride + x * 4;
-
-#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
-			cairo_data[dst_idx + 0] = data[src_idx + 3]; /* B <- B */
-			cairo_data[dst_idx + 1] = data[src_idx + 2]; /* G <- G */
-			cairo_data[dst_idx + 2] = data[src_idx + 1]; /* R <- R */
-			cairo_data[dst_idx + 3] = data[src_idx + 0]; /* A <- A */
-#else
-			cairo_data[dst_idx + 0] = data[src_idx + 0];
-			cairo_data[dst_idx + 1] = data[src_idx + 1];
-			cairo_data[dst_idx + 2] = data[src_idx + 2];
-			cairo_data[dst_idx + 3] = data[src_idx + 3];
-#endif
-		}
-	}
-
-	item->overlay_icon = cairo_image_surface_create_for_data(
-		cairo_data, CAIRO_FORMAT_ARGB32, width, height, stride);
-
-	if (cairo_surface_status(item->overlay_icon) != CAIRO_STATUS_SUCCESS) {
-		cairo_surface_destroy(item->overlay_icon);
-		item->overlay_icon = NULL;
-		free(cairo_data);
-		return;
-	}
-
-	/* Cairo surface now owns the data */
-	cairo_surface_set_user_data(item->overlay_icon, &overlay_data_key, cairo_data, free);
-
 	/* Emit property::overlay_icon signal */
 	L = globalconf_get_lua_State();
 	if (L) {
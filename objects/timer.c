@@ -15,6 +15,7 @@
 #include "luaa.h"
 #include "../common/lualib.h"
 #include "../somewm_api.h"
+#include "../bench.h"
 
 #define TIMER_MT "somewm.timer"
 
@@ -128,12 +129,20 @@ timer_callback(void *data)
 	Timer *timer = data;
 	lua_State *L = timer->L;
 	int continue_timer;
+	int status;
 
 	/* Get the Lua callback from registry */
 	lua_rawgeti(L, LUA_REGISTRYINDEX, timer->callback_ref);
 
 	/* Call the Lua function */
-	if (lua_pcall(L, 0, 1, 0) != 0) {
+#ifdef SOMEWM_BENCH
+	int alloc_depth = bench_alloc_enter_function(L, BENCH_ALLOC_TIMER);
+#endif
+	status = lua_pcall(L, 0, 1, 0);
+#ifdef SOMEWM_BENCH
+	bench_alloc_leave(alloc_depth);
+#endif
+	if (status != 0) {
 		/* Error occurred */
 		fprintf(stderr, "Error in timer callback: %s\n", lua_tostring(L, -1));
 		lua_pop(L, 1);
@@ -24,12 +24,20 @@
 #include "objects/client.h"
 #include "luaa.h"
 #include "globalconf.h"
+#include "event_queue.h"
+#include "stack.h"
+#ifdef SOMEWM_BENCH
+#include "bench.h"
+#endif
 
 #include <wayland-server-core.h>
 #include <wlr/types/wlr_xdg_shell.h>
 #include <string.h>
+#include <time.h>
 #include <xcb/xcb.h>
 
+extern struct wl_display *dpy;
+
 /* ========================================================================
  * X11 Property API Stubs (for AwesomeWM compatibility)
  * ======================================================================== */
@@ -77,6 +85,163 @@ PROPERTY_STUB(motif_wm_hints)
 
 #undef PROPERTY_STUB
 
+/* ========================================================================
+ * Coalesced Title/App ID Updates
+ *
+ * Terminals showing the running command, browsers with spinners and
+ * progress titles can retitle hundreds of times per second, and every
+ * property::name reruns tasklist updates. Changes are stored on the client
+ * instead and delivered from the event queue: one update per client per
+ * refresh cycle carrying the latest value, and with
+ * awesome.client_property_rate set, at most that many per second.
+ * ======================================================================== */
+
+#define PROPERTY_PENDING_NAME  (1 << 0)
+#define PROPERTY_PENDING_CLASS (1 << 1)
+
+/* Queues rate-limited clients again once they are due */
+static struct wl_event_source *rate_timer;
+static uint64_t rate_timer_due_ns;
+
+static uint64_t
+property_now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void property_pending_apply(lua_State *L, int cidx);
+
+static void
+property_pending_queue(client_t *c)
+{
+	lua_State *L;
+
+	if (c->pending_queued || !c->pending_props)
+		return;
+
+	L = globalconf_get_lua_State();
+	luaA_object_push(L, c);
+	some_event_queue_apply(L, -1, property_pending_apply);
+	lua_pop(L, 1);
+	c->pending_queued = true;
+}
+
+static int
+property_rate_timeout(void *data)
+{
+	(void)data;
+
+	rate_timer_due_ns = 0;
+	foreach(client, globalconf.clients)
+		property_pending_queue(*client);
+	return 0;
+}
+
+static void
+property_rate_timer_arm(uint64_t due, uint64_t now)
+{
+	if (rate_timer_due_ns > now && rate_timer_due_ns <= due)
+		return;
+	if (!rate_timer)
+		rate_timer = wl_event_loop_add_timer(wl_display_get_event_loop(dpy),
+			property_rate_timeout, NULL);
+	if (!rate_timer)
+		return;
+	/* Round up: firing early would only hold the client back again */
+	wl_event_source_timer_update(rate_timer, (int)((due - now + 999999) / 1000000));
+	rate_timer_due_ns = due;
+}
+
+/** Deliver the pending values of the client at cidx (event queue drain) */
+static void
+property_pending_apply(lua_State *L, int cidx)
+{
+	client_t *c = luaA_checkudata(L, cidx, &client_class);
+	int rate = globalconf.client_property_rate;
+	uint64_t now = property_now_ns();
+	uint8_t props = c->pending_props;
+
+	c->pending_queued = false;
+	/* Cleared by unmanage since */
+	if (!props)
+		return;
+
+	if (rate > 0 && c->pending_applied_ns) {
+		uint64_t due = c->pending_applied_ns + 1000000000ULL / (uint64_t)rate;
+		if (now < due) {
+			property_rate_timer_arm(due, now);
+#ifdef SOMEWM_BENCH
+			bench_prop_update(BENCH_PROP_RATE_LIMITED);
+#endif
+			return;
+		}
+	}
+
+	c->pending_props = 0;
+	c->pending_applied_ns = now;
+
+	if (props & PROPERTY_PENDING_NAME) {
+		char *name = c->pending_name;
+		c->pending_name = NULL;
+		/* Takes ownership */
+		client_set_name(L, cidx, name);
+	}
+	if (props & PROPERTY_PENDING_CLASS) {
+		char *class = c->pending_class;
+		c->pending_class = NULL;
+		if (!A_STREQ(c->class, class ? class : ""))
+			client_set_class_instance(L, cidx, class ? class : "", "");
+		free(class);
+	}
+#ifdef SOMEWM_BENCH
+	bench_prop_update(BENCH_PROP_DELIVERED);
+#endif
+}
+
+static void
+property_pending_set(client_t *c, uint8_t prop, char **slot, const char *value)
+{
+#ifdef SOMEWM_BENCH
+	bench_prop_update(BENCH_PROP_RECEIVED);
+	if (c->pending_props & prop)
+		bench_prop_update(BENCH_PROP_COALESCED);
+#endif
+	free(*slot);
+	*slot = value ? strdup(value) : NULL;
+	c->pending_props |= prop;
+	property_pending_queue(c);
+}
+
+void
+property_queue_name(client_t *c, const char *title)
+{
+	property_pending_set(c, PROPERTY_PENDING_NAME, &c->pending_name, title);
+}
+
+void
+property_queue_class(client_t *c, const char *class)
+{
+	property_pending_set(c, PROPERTY_PENDING_CLASS, &c->pending_class, class);
+}
+
+void
+property_pending_clear(client_t *c)
+{
+	free(c->pending_name);
+	free(c->pending_class);
+	c->pending_name = c->pending_class = NULL;
+	c->pending_props = 0;
+}
+
+void
+property_pending_requeue(client_t *c)
+{
+	c->pending_queued = false;
+	property_pending_queue(c);
+}
+
 /* ========================================================================
  * Wayland Property Handlers (Native Wayland clients)
  * ======================================================================== */
@@ -91,8 +256,6 @@ property_handle_toplevel_title(struct wl_listener *listener, void *data)
 {
 	client_t *c;
 	struct wlr_xdg_toplevel *toplevel;
-	lua_State *L;
-	const char *title;
 
 	(void)data; /* Unused */
 
@@ -106,14 +269,8 @@ property_handle_toplevel_title(struct wl_listener *listener, void *data)
 	if (!toplevel)
 		return;
 
-	title = toplevel->title;
-
-	/* Update client name using proper AwesomeWM setter
-	 * This will emit property::name signal on the client object */
-	L = globalconf_get_lua_State();
-	luaA_object_push(L, c);
-	client_set_name(L, -1, title ? strdup(title) : NULL);
-	lua_pop(L, 1);
+	/* property::name follows from the event queue */
+	property_queue_name(c, toplevel->title);
 }
 
 /** Handle xdg_toplevel.set_app_id event
@@ -126,14 +283,10 @@ property_handle_toplevel_app_id(struct wl_listener *listener, void *data)
 {
 	client_t *c;
 	struct wlr_xdg_toplevel *toplevel;
-	lua_State *L;
-	const char *app_id;
 
 	(void)data; /* Unused */
 
-	/* Get client from listener - note: we reuse set_title listener for app_id
-	 * In practice, app_id changes are rare after initial mapping */
-	c = wl_container_of(listener, c, set_title);
+	c = wl_container_of(listener, c, set_app_id);
 	if (!c || c->client_type != XDGShell || !c->surface.xdg)
 		return;
 
@@ -142,17 +295,9 @@ property_handle_toplevel_app_id(struct wl_listener *listener, void *data)
 	if (!toplevel)
 		return;
 
-	app_id = toplevel->app_id;
-
-	/* Update client class using proper AwesomeWM setter
-	 * This will emit property::class signal on the client object
-	 * Note: Wayland doesn't have "instance" like X11, so we set class only */
-	L = globalconf_get_lua_State();
-	luaA_object_push(L, c);
-	client_set_class_instance(L, -1,
-		app_id ? app_id : "",
-		""); /* Empty instance for Wayland clients */
-	lua_pop(L, 1);
+	/* property::class follows from the event queue. Wayland doesn't have
+	 * "instance" like X11, so the instance stays empty. */
+	property_queue_class(c, toplevel->app_id);
 }
 
 /** Update all Wayland properties for a client
@@ -221,13 +366,9 @@ property_register_wayland_listeners(client_t *c)
 	if (!toplevel)
 		return;
 
-	/* Note: The set_title listener is already registered in somewm.c
-	 * via LISTEN(&toplevel->events.set_title, &c->set_title, updatetitle)
-	 * We don't need to register it again here.
-	 *
-	 * XDG shell doesn't have separate events for app_id changes,
-	 * so we handle app_id during initial property fetch.
-	 */
+	/* Note: The set_title and set_app_id listeners are already registered
+	 * in createnotify() (updatetitle, updateappid). We don't need to
+	 * register them again here. */
 
 	/* Fetch initial properties */
 	property_update_wayland_properties(c);
@@ -376,6 +517,8 @@ property_update_xwayland_properties(client_t *c)
 	else if (wlr_xwayland_surface_has_window_type(xsurface,
 			WLR_XWAYLAND_NET_WM_WINDOW_TYPE_NORMAL))
 		c->type = WINDOW_TYPE_NORMAL;
+	/* Written directly: the client may be queued already, under its old layer */
+	stack_client_changed(c);
 
 	lua_pop(L, 1);
 }
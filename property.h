@@ -55,6 +55,30 @@ PROPERTY(motif_wm_hints);
 
 void property_handle_propertynotify(xcb_property_notify_event_t *ev);
 
+/* ========================================================================
+ * Coalesced Title/App ID Updates
+ * ======================================================================== */
+
+/** Store a new title and queue its delivery: property::name is emitted
+ * from the event queue with the latest title, once per refresh cycle and
+ * at most awesome.client_property_rate times per second.
+ * \param c The client
+ * \param title The new title (copied), NULL to clear
+ */
+void property_queue_name(client_t *c, const char *title);
+
+/** Same as property_queue_name() for the class (app_id)
+ * \param c The client
+ * \param class The new class (copied), NULL to clear
+ */
+void property_queue_class(client_t *c, const char *class);
+
+/** Drop undelivered values (unmanage) */
+void property_pending_clear(client_t *c);
+
+/** Queue undelivered values again after hot-reload dropped the event queue */
+void property_pending_requeue(client_t *c);
+
 /* ========================================================================
  * Wayland Property Listeners (Native Wayland clients)
  * ======================================================================== */
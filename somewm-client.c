@@ -147,7 +147,11 @@ print_usage(const char *progname)
 	fprintf(stderr, "  lock                           Lock the session\n");
 	fprintf(stderr, "  reload                         Reload configuration\n");
 	fprintf(stderr, "  restart                        Cold restart (via somewm-session)\n");
-	fprintf(stderr, "  rebuild                        Rebuild and restart (via somewm-session)\n\n");
+	fprintf(stderr, "  rebuild                        Rebuild and restart (via somewm-session)\n");
+	fprintf(stderr, "  startup profile                Startup timings (needs somewm --startup-profile)\n");
+	fprintf(stderr, "  profile start [hz]             Start the sampling Lua profiler\n");
+	fprintf(stderr, "  profile stop [file]            Stop it; print or write folded stacks\n");
+	fprintf(stderr, "  profile status                 Profiler state and sample counts\n\n");
 
 	fprintf(stderr, "DISPLAY MANAGEMENT:\n");
 	fprintf(stderr, "  output list                    List all outputs\n");
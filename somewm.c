@@ -81,6 +81,7 @@
 #include "globalconf.h"
 #include "luaa.h"
 #include "stack.h"
+#include "ewmh.h"
 #include "banning.h"
 #include "animation.h"
 #include "ipc.h"
@@ -92,6 +93,8 @@
 #include "objects/signal.h"
 #include "objects/mousegrabber.h"
 #include "event_queue.h"
+#include "startup_profile.h"
+#include "luagc.h"
 #include "xwayland.h"
 #include "protocols.h"
 #include "monitor.h"
@@ -126,7 +129,6 @@ struct wlr_backend *backend;
 struct wlr_scene *scene;
 struct wlr_scene_tree *layers[NUM_LAYERS];
 struct wlr_scene_tree *drag_icon;
-Client *drag_source_client;
 /* Map from ZWLR_LAYER_SHELL_* constants to Lyr* enum */
 const int layermap[] = { LyrBg, LyrBottom, LyrTop, LyrOverlay };
 struct wlr_renderer *drw;
@@ -221,7 +223,7 @@ static void __attribute__((unused))
 sync_client_remove_from_arrays(Client *c)
 {
 	/* Safety check: if arrays not initialized yet, skip sync */
-	if (!globalconf.clients.tab || !globalconf.stack.tab) {
+	if (!globalconf.clients.tab) {
 		return;
 	}
 
@@ -233,13 +235,10 @@ sync_client_remove_from_arrays(Client *c)
 		}
 	}
 
-	/* Remove from stack array */
-	foreach(elem, globalconf.stack) {
-		if (*elem == c) {
-			client_array_remove(&globalconf.stack, elem);
-			break;
-		}
-	}
+	client_handle_unregister(c);
+
+	/* Remove from stack list */
+	stack_client_remove(c);
 
 }
 
@@ -447,6 +446,7 @@ some_deactivate_lua_lock(void)
 	}
 
 	/* Let stack_refresh() sort everything back to proper layers */
+	stack_windows();
 	stack_refresh();
 
 	/* Restore focus to pre-lock client if still valid, otherwise top client */
@@ -602,6 +602,9 @@ static float main_loop_iteration_limit = 0.1f;
 /* Recursion guard for some_refresh() */
 static bool in_refresh = false;
 
+/* Poll timeout while a Lua GC cycle is unfinished (see luagc.c) */
+#define GC_IDLE_RETRY_MS 16
+
 #include "bench.h"
 
 /* Forward declaration */
@@ -694,6 +697,7 @@ static gboolean
 refresh_source_prepare(GSource *source, gint *timeout)
 {
 	lua_State *L = globalconf_get_lua_State();
+	bool gc_pending;
 
 	some_refresh();
 
@@ -705,8 +709,18 @@ refresh_source_prepare(GSource *source, gint *timeout)
 		lua_settop(L, 0);
 	}
 
-	/* Never ready: this source only does work in prepare */
-	*timeout = -1;
+	/* The frame work is done and the loop is about to sleep: pay the Lua
+	 * allocation debt the refresh built up, within the idle budget. */
+	gc_pending = luagc_idle();
+
+	/* Never ready: this source only does work in prepare. Spawned output
+	 * left over by the refresh budget must not wait for an unrelated
+	 * wakeup, so don't let poll() block while there is some. An unfinished
+	 * GC cycle continues on a later pass. */
+	if (spawn_readers_pending())
+		*timeout = 0;
+	else
+		*timeout = gc_pending ? GC_IDLE_RETRY_MS : -1;
 	return FALSE;
 }
 
@@ -797,10 +811,13 @@ some_refresh(void)
 	if (in_refresh)
 		return;
 	in_refresh = true;
+	luagc_hold();
 
 #ifdef SOMEWM_BENCH
+	/* bench_ts[s] is when stage s started, bench_ts[s + 1] when it ended.
+	 * Only the stages up to BENCH_STAGE_DESTROY run here. */
 	struct timespec bench_ts[BENCH_STAGE_COUNT + 1];
-	clock_gettime(CLOCK_MONOTONIC, &bench_ts[0]);
+	clock_gettime(CLOCK_MONOTONIC, &bench_ts[BENCH_STAGE_LUA_REFRESH]);
 #endif
 
 	/* Step 0: Drain queued events - dispatch batched signals to Lua.
@@ -809,11 +826,15 @@ some_refresh(void)
 	 * Included in the lua_refresh stage timing. */
 	some_event_queue_drain(globalconf_L);
 
+	/* Step 0.5: Hand buffered output of spawned commands to their line
+	 * callbacks, within a per-cycle budget. */
+	spawn_readers_dispatch(globalconf_L);
+
 	/* Step 1: Emit refresh signal - triggers Lua layout calculations */
 	luaA_emit_signal_global("refresh");
 
 #ifdef SOMEWM_BENCH
-	clock_gettime(CLOCK_MONOTONIC, &bench_ts[1]);
+	clock_gettime(CLOCK_MONOTONIC, &bench_ts[BENCH_STAGE_LUA_REFRESH + 1]);
 #endif
 
 	/* Step 1.5: Tick frame-synced animations - tick callbacks that modify
@@ -822,7 +843,7 @@ some_refresh(void)
 	animation_tick_all();
 
 #ifdef SOMEWM_BENCH
-	clock_gettime(CLOCK_MONOTONIC, &bench_ts[2]);
+	clock_gettime(CLOCK_MONOTONIC, &bench_ts[BENCH_STAGE_ANIMATION + 1]);
 #endif
 
 	/* Step 2: Refresh drawins (wibox/panels) FIRST - matches AwesomeWM order
@@ -831,7 +852,7 @@ some_refresh(void)
 	drawin_refresh();
 
 #ifdef SOMEWM_BENCH
-	clock_gettime(CLOCK_MONOTONIC, &bench_ts[3]);
+	clock_gettime(CLOCK_MONOTONIC, &bench_ts[BENCH_STAGE_DRAWIN + 1]);
 #endif
 
 	/* Step 3: Apply client changes (geometry, borders, focus)
@@ -839,7 +860,7 @@ some_refresh(void)
 	client_refresh();
 
 #ifdef SOMEWM_BENCH
-	clock_gettime(CLOCK_MONOTONIC, &bench_ts[4]);
+	clock_gettime(CLOCK_MONOTONIC, &bench_ts[BENCH_STAGE_CLIENT + 1]);
 #endif
 
 	/* Step 4: Update client visibility (banning) */
@@ -856,7 +877,7 @@ some_refresh(void)
 		motionnotify(0, NULL, 0, 0, 0, 0);
 
 #ifdef SOMEWM_BENCH
-	clock_gettime(CLOCK_MONOTONIC, &bench_ts[5]);
+	clock_gettime(CLOCK_MONOTONIC, &bench_ts[BENCH_STAGE_BANNING + 1]);
 #endif
 
 	/* Step 5: Update window stacking (Z-order)
@@ -864,20 +885,27 @@ some_refresh(void)
 	stack_refresh();
 
 #ifdef SOMEWM_BENCH
-	clock_gettime(CLOCK_MONOTONIC, &bench_ts[6]);
+	clock_gettime(CLOCK_MONOTONIC, &bench_ts[BENCH_STAGE_STACK + 1]);
 #endif
 
 	/* Step 6: Destroy windows queued for deferred destruction (XWayland only)
 	 * This matches AwesomeWM's deferred destruction pattern to avoid race conditions */
 	client_destroy_later();
 
+	/* Step 7: Write the EWMH properties staged during this cycle and flush
+	 * the XWayland connection (AwesomeWM ends awesome_refresh() with
+	 * xcb_flush()). Included in the destroy stage timing. */
+	ewmh_flush();
+
 #ifdef SOMEWM_BENCH
-	clock_gettime(CLOCK_MONOTONIC, &bench_ts[7]);
-	for (int i = 0; i < BENCH_STAGE_COUNT; i++)
+	clock_gettime(CLOCK_MONOTONIC, &bench_ts[BENCH_STAGE_DESTROY + 1]);
+	for (int i = BENCH_STAGE_LUA_REFRESH; i <= BENCH_STAGE_DESTROY; i++)
 		bench_stage_record(i, timespec_diff_ns(&bench_ts[i], &bench_ts[i + 1]));
-	bench_record_frame_time(timespec_diff_ns(&bench_ts[0], &bench_ts[7]));
+	bench_record_frame_time(timespec_diff_ns(&bench_ts[BENCH_STAGE_LUA_REFRESH],
+		&bench_ts[BENCH_STAGE_DESTROY + 1]));
 #endif
 
+	luagc_release();
 	in_refresh = false;
 }
 
@@ -900,8 +928,10 @@ run(char *startup_cmd)
 
 	/* Start the backend. This will enumerate outputs and inputs, become the DRM
 	 * master, etc. This will trigger createmon() for each detected output. */
+	startup_profile_begin("backend start (screen scan)");
 	if (!wlr_backend_start(backend))
 		die("startup: backend_start");
+	startup_profile_end();
 
 	/* Initialize tag objects after monitors are created */
 	/* NOTE: Tags are now created entirely from Lua via awful.tag() in rc.lua (AwesomeWM-compatible)
@@ -918,14 +948,18 @@ run(char *startup_cmd)
 		luaA_loadrc();
 		/* Emit screen::scanned AFTER rc.lua loads (matches AwesomeWM).
 		 * This allows rc.lua handlers to be connected before scanned fires. */
+		startup_profile_begin("screen::scanned");
 		screen_emit_scanned();
+		startup_profile_end();
 
 		/* Emit client scanning signals - triggers awful.mouse to set up default mousebindings */
 		client_emit_scanning();
 		client_emit_scanned();
 
 		/* Emit startup signal to initialize Lua modules (matches AwesomeWM) */
+		startup_profile_begin("startup signal");
 		luaA_emit_signal_global("startup");
+		startup_profile_end();
 
 		/* In a test instance, remap Mod4 -> Mod1 if the host can't forward shortcuts. */
 		if (getenv("SOMEWM_TEST_NAME")) {
@@ -945,7 +979,9 @@ run(char *startup_cmd)
 		 * don't appear until an external event triggers some_refresh().
 		 * In AwesomeWM, xcb_flush() sends everything immediately after config
 		 * loads; in Wayland we need to explicitly refresh all drawables. */
+		startup_profile_begin("first refresh");
 		some_refresh();
+		startup_profile_end();
 
 		/* Compositor reached steady state: rc.lua loaded, screens scanned,
 		 * clients managed, drawables pushed to scene. Subscribers can now
@@ -954,6 +990,7 @@ run(char *startup_cmd)
 		 * after rc.lua reload (this branch only runs on cold boot). */
 		globalconf.somewm_ready_seen = true;
 		luaA_emit_signal_global("somewm::ready");
+		startup_profile_ready();
 	}
 
 	/* Now that the socket exists and the backend is started, run the startup command */
@@ -1114,6 +1151,7 @@ setup(void)
 	 * output hardware. The autocreate option will choose the most suitable
 	 * backend based on the current environment, such as opening an X11 window
 	 * if an X11 server is running. */
+	startup_profile_begin("wlroots init");
 	if (!(backend = wlr_backend_autocreate(event_loop, &session)))
 		die("couldn't create backend");
 
@@ -1411,8 +1449,11 @@ setup(void)
 	/* Initialise the XWayland X server (no-op if XWAYLAND is not enabled).
 	 * It will be started when the first X client is started. */
 	xwayland_setup();
+	startup_profile_end();
 
+	startup_profile_begin("luaA_init");
 	luaA_init();
+	startup_profile_end();
 	some_event_queue_init();
 
 	/* Initialize animation subsystem (must be AFTER luaA_init for Lua state) */
@@ -1836,6 +1877,7 @@ main(int argc, char *argv[])
 		{"startup", required_argument, 0, 's'},
 		{"check",       required_argument, 0, 'k'},
 		{"check-level", required_argument, 0, 257},
+		{"startup-profile", no_argument,   0, 258},
 		{0, 0, 0, 0}
 	};
 
@@ -1878,6 +1920,9 @@ main(int argc, char *argv[])
 				goto usage;
 			}
 			break;
+		case 258:  /* --startup-profile */
+			startup_profile_enable();
+			break;
 		default:
 			goto usage;
 		}
@@ -1924,5 +1969,6 @@ usage:
 	    "  -L, --search DIR   Add directory to Lua module search path\n"
 	    "  -s, --startup CMD  Run command after startup\n"
 	    "  -k, --check CONFIG       Check config for Wayland compatibility issues\n"
-	    "      --check-level LEVEL   Minimum severity for non-zero exit: critical, warning (default), info", argv[0]);
+	    "      --check-level LEVEL   Minimum severity for non-zero exit: critical, warning (default), info\n"
+	    "      --startup-profile     Print a startup timing report once every output has drawn", argv[0]);
 }
@@ -771,6 +771,7 @@ some_client_set_ontop(Client *c, int ontop)
 	if (!c)
 		return;
 	c->ontop = ontop;
+	stack_client_changed(c);
 	stack_refresh();
 }
 
@@ -780,6 +781,7 @@ some_client_set_above(Client *c, int above)
 	if (!c)
 		return;
 	c->above = above;
+	stack_client_changed(c);
 	stack_refresh();
 }
 
@@ -789,6 +791,7 @@ some_client_set_below(Client *c, int below)
 	if (!c)
 		return;
 	c->below = below;
+	stack_client_changed(c);
 	stack_refresh();
 }
 
@@ -798,6 +801,7 @@ some_client_set_window_type(Client *c, window_type_t window_type)
 	if (!c)
 		return;
 	c->type = window_type;
+	stack_client_changed(c);
 	stack_refresh();
 }
 
@@ -917,6 +921,7 @@ some_client_set_modal(Client *c, int modal)
 	c->modal = modal;
 
 	/* Modal windows affect stacking */
+	stack_client_changed(c);
 	stack_refresh();
 
 	/* Emit property change signal */
@@ -101,6 +101,7 @@ struct Monitor {
 	struct wlr_scene_output *scene_output;
 	struct wlr_scene_rect *fullscreen_bg; /* See createmon() for info */
 	struct wl_listener frame;
+	struct wl_listener present;
 	struct wl_listener destroy;
 	struct wl_listener request_state;
 	struct wl_listener destroy_lock_surface;
@@ -115,6 +116,17 @@ struct Monitor {
 	int needs_screen_added; /* Set in createmon, cleared by updatemons after geometry is ready */
 	int needs_output_added; /* Set in createmon, cleared by updatemons after screen is ready */
 	output_t *output; /* Lua output object (persists across enable/disable) */
+	int pending_resizes; /* Clients on this monitor with c->resize set */
+	struct wl_event_source *resize_fence_timer; /* Renders once a waited-on resize's fence expires */
+	/* Frame scheduling, see rendermon() */
+	struct wl_event_source *render_timer;
+	bool render_scheduled;     /* render_timer armed for the current frame */
+	uint64_t vblank_ns;        /* Last presentation reported by the output */
+	uint64_t vblank_period_ns; /* Refresh period reported with it, 0 if unknown */
+	uint64_t render_target_ns; /* Predicted vblank the scheduled render aims for */
+	uint64_t render_slack_ns;  /* Margin kept before vblank, grows on misses */
+	uint64_t render_ns[8];     /* Recent refresh + commit durations */
+	int render_index;
 };
 
 /* KeyboardGroup structure */
@@ -11,27 +11,65 @@
  * (at your option) any later version.
  */
 
+#define _GNU_SOURCE  /* POSIX_SPAWN_SETSID, pipe2 */
+
 #include "objects/spawn.h"
 #include "protocols.h"
 #include "globalconf.h"
 #include "luaa.h"
 #include "objects/signal.h"
+#include "common/lualib.h"
 
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
 #include <stdbool.h>
+#include <sys/syscall.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <unistd.h>
 #include <glib.h>
+#include <glib-unix.h>
+#include <stdlib.h>
 #include <string.h>
 
+/* posix_spawn_file_actions_addclosefrom_np() */
+#ifdef __GLIBC_PREREQ
+#if __GLIBC_PREREQ(2, 34)
+#define SPAWN_HAVE_CLOSEFROM 1
+#endif
+#endif
+#ifndef SPAWN_HAVE_CLOSEFROM
+#define SPAWN_HAVE_CLOSEFROM 0
+#endif
+
+#ifdef SOMEWM_BENCH
+#include "bench.h"
+#endif
+
+extern char **environ;
+
 /* Tracking structure for child processes with exit callbacks */
 typedef struct {
-	GPid pid;
+	pid_t pid;
 	int exit_callback;  /* Lua registry reference */
+	int pidfd;          /* -1 if pidfd_open() is unavailable */
+	guint pidfd_source; /* GLib fd watch on pidfd, 0 if none */
 } running_child_t;
 
-/* Array of running children (for exit callback tracking) */
-static GArray *running_children = NULL;
+/* Running children with exit callbacks, keyed by pid */
+static GHashTable *running_children = NULL;
+
+static void spawn_readers_invalidate(void);
+
+/* How a standard stream of the child is wired up */
+typedef enum {
+	SPAWN_STDIO_INHERIT,
+	SPAWN_STDIO_DEV_NULL,
+	SPAWN_STDIO_PIPE,
+} spawn_stdio_t;
 
 /** Initialize program spawner.
  * X11-only: Sets up libstartup-notification monitor.
@@ -62,23 +100,73 @@ spawn_start_notify(client_t *c, const char *startup_id)
 
 /* Helper: Find child by PID */
 static running_child_t *
-find_child(GPid pid)
+find_child(pid_t pid)
 {
-	running_child_t *result = NULL;
-	guint i;
-
-	if (!running_children || running_children->len == 0)
+	if (!running_children)
 		return NULL;
 
-	/* Linear search */
-	for (i = 0; i < running_children->len; i++) {
-		running_child_t *child = &g_array_index(running_children, running_child_t, i);
-		if (child->pid == pid) {
-			result = child;
-			break;
-		}
+	return g_hash_table_lookup(running_children, GINT_TO_POINTER(pid));
+}
+
+/* Hash table value destructor: drop the pidfd watch and the pidfd itself */
+static void
+running_child_free(gpointer data)
+{
+	running_child_t *child = data;
+
+	if (child->pidfd_source)
+		g_source_remove(child->pidfd_source);
+	if (child->pidfd >= 0)
+		close(child->pidfd);
+	g_free(child);
+}
+
+/** Open a pidfd for a child (Linux 5.3+).
+ * \return The pidfd, or -1 if the kernel or libc lacks pidfd_open.
+ */
+static int
+spawn_pidfd_open(pid_t pid)
+{
+#ifdef SYS_pidfd_open
+	return (int)syscall(SYS_pidfd_open, pid, 0);
+#else
+	(void)pid;
+	errno = ENOSYS;
+	return -1;
+#endif
+}
+
+/** GLib callback: a tracked child's pidfd became readable, i.e. it exited.
+ * Reaps that one child directly instead of waiting for the SIGCHLD pipe.
+ * Whichever of this and reap_children() gets to waitpid() first wins; both
+ * end in spawn_child_exited(), which drops the hash entry and this watch.
+ */
+static gboolean
+spawn_pidfd_ready(gint fd, GIOCondition condition, gpointer data)
+{
+	running_child_t *child = data;
+	pid_t pid = child->pid;
+	pid_t res;
+	int status;
+
+	res = waitpid(pid, &status, WNOHANG);
+	if (res == 0)
+		return G_SOURCE_CONTINUE;
+
+	/* The source is removed by returning G_SOURCE_REMOVE below */
+	child->pidfd_source = 0;
+
+	if (res == pid) {
+		spawn_child_exited(pid, status);
+	} else {
+		/* Reaped behind our back; the exit status is lost */
+		lua_State *L = globalconf_get_lua_State();
+		if (child->exit_callback != LUA_NOREF && child->exit_callback != LUA_REFNIL)
+			luaL_unref(L, LUA_REGISTRYINDEX, child->exit_callback);
+		g_hash_table_remove(running_children, GINT_TO_POINTER(pid));
 	}
-	return result;
+
+	return G_SOURCE_REMOVE;
 }
 
 /** Convert a Lua table of strings to a char** array.
@@ -143,23 +231,23 @@ parse_command(lua_State *L, int idx, GError **error)
 	return argv;
 }
 
-/** Invalidate all exit callbacks in the running children array.
+/** Invalidate all exit callbacks of running children.
  * Called during hot-reload before the old Lua state is abandoned.
- * We can't luaL_unref (old state is leaked), but setting callbacks
- * to LUA_NOREF prevents spawn_child_exited from trying to call
- * stale registry refs in the new state.
+ * We can't luaL_unref (old state is leaked), so the children are simply
+ * forgotten: reap_children() still reaps them, as untracked children.
+ * Dropping the entries also removes their pidfd watches before the
+ * stale GLib source sweep would destroy them behind our back. Output
+ * readers are dropped for the same reasons.
  */
 void
 spawn_invalidate_callbacks(void)
 {
+	spawn_readers_invalidate();
+
 	if (!running_children)
 		return;
 
-	for (guint i = 0; i < running_children->len; i++) {
-		running_child_t *child = &g_array_index(running_children,
-			running_child_t, i);
-		child->exit_callback = LUA_NOREF;
-	}
+	g_hash_table_remove_all(running_children);
 }
 
 /** Called when a spawned process exits (AwesomeWM pattern).
@@ -173,7 +261,6 @@ spawn_child_exited(pid_t pid, int status)
 	lua_State *L = globalconf_get_lua_State();
 	running_child_t *child;
 	int exit_callback;
-	guint i;
 
 	child = find_child(pid);
 
@@ -185,13 +272,8 @@ spawn_child_exited(pid_t pid, int status)
 
 	exit_callback = child->exit_callback;
 
-	/* Remove from tracking array */
-	for (i = 0; i < running_children->len; i++) {
-		if (g_array_index(running_children, running_child_t, i).pid == pid) {
-			g_array_remove_index(running_children, i);
-			break;
-		}
-	}
+	/* Stop tracking (also drops the pidfd watch, see running_child_free) */
+	g_hash_table_remove(running_children, GINT_TO_POINTER(pid));
 
 	/* Callback was invalidated by hot-reload - skip it */
 	if (exit_callback == LUA_NOREF || exit_callback == LUA_REFNIL)
@@ -223,22 +305,234 @@ spawn_child_exited(pid_t pid, int status)
 	luaL_unref(L, LUA_REGISTRYINDEX, exit_callback);
 }
 
-/** Child setup callback - just call setsid()
- * This runs in the child process before exec
+/** Parse a stdin/stdout/stderr argument of awesome.spawn().
+ * \param L The Lua VM state.
+ * \param idx The argument index.
+ * \param name Stream name for error messages.
+ * \param mode Receives the stream mode; left untouched for nil/none.
  */
 static void
-spawn_child_setup(gpointer user_data)
+parse_stdio_mode(lua_State *L, int idx, const char *name, spawn_stdio_t *mode)
+{
+	if (lua_isnoneornil(L, idx))
+		return;
+
+	if (lua_type(L, idx) == LUA_TSTRING) {
+		const char *str = lua_tostring(L, idx);
+		if (strcmp(str, "DEV_NULL") == 0)
+			*mode = SPAWN_STDIO_DEV_NULL;
+		else if (strcmp(str, "INHERIT") == 0)
+			*mode = SPAWN_STDIO_INHERIT;
+		else
+			luaL_error(L, "%s: expected boolean, 'DEV_NULL', or 'INHERIT'", name);
+	} else if (lua_isboolean(L, idx)) {
+		if (lua_toboolean(L, idx))
+			*mode = SPAWN_STDIO_PIPE;
+	} else {
+		luaL_error(L, "%s: expected boolean or string", name);
+	}
+}
+
+#if !SPAWN_HAVE_CLOSEFROM
+/** Add a close action for every fd from 3 up that would survive exec.
+ * Used where posix_spawn_file_actions_addclosefrom_np() is missing
+ * (glibc < 2.34, other libcs). Closing an fd the child does not have is
+ * not an error for posix_spawn.
+ * \param actions The file actions of the spawn.
+ * \return 0, or an error number.
+ */
+static int
+spawn_close_inherited(posix_spawn_file_actions_t *actions)
 {
-	char *token;
+	DIR *dir = opendir("/proc/self/fd");
+	long max;
+	int ret = 0;
+
+	if (dir) {
+		struct dirent *de;
+		int skip = dirfd(dir);
+
+		while (ret == 0 && (de = readdir(dir))) {
+			char *end;
+			long fd = strtol(de->d_name, &end, 10);
+			int flags;
+
+			if (end == de->d_name || *end || fd < 3 || fd == skip)
+				continue;
+			flags = fcntl((int)fd, F_GETFD);
+			if (flags >= 0 && !(flags & FD_CLOEXEC))
+				ret = posix_spawn_file_actions_addclose(actions, (int)fd);
+		}
+		closedir(dir);
+		return ret;
+	}
+
+	/* No /proc: probe every descriptor we could have open */
+	max = sysconf(_SC_OPEN_MAX);
+	if (max < 0)
+		max = 1024;
+	for (long fd = 3; ret == 0 && fd < max; fd++) {
+		int flags = fcntl((int)fd, F_GETFD);
 
-	setsid();
+		if (flags >= 0 && !(flags & FD_CLOEXEC))
+			ret = posix_spawn_file_actions_addclose(actions, (int)fd);
+	}
+	return ret;
+}
+#endif
+
+/** Start a process with posix_spawnp().
+ *
+ * glibc implements posix_spawn with clone(CLONE_VM | CLONE_VFORK), so the
+ * compositor's GPU and Lua mappings are never copied, unlike fork() in
+ * g_spawn_async_with_pipes(). Exec failures are still reported synchronously.
+ *
+ * \param argv Command and arguments (PATH is searched for argv[0]).
+ * \param envp Environment, or NULL to inherit ours.
+ * \param token XDG activation token to export to the child, or NULL.
+ * \param modes How to wire stdin, stdout and stderr.
+ * \param fds Receives our end of each SPAWN_STDIO_PIPE stream, else -1.
+ * \param pid Receives the child pid.
+ * \param error GError pointer for error reporting.
+ * \return true on success.
+ */
+static bool
+spawn_posix(gchar **argv, gchar **envp, const char *token,
+		const spawn_stdio_t modes[3], int fds[3], pid_t *pid, GError **error)
+{
+	posix_spawn_file_actions_t actions;
+	posix_spawnattr_t attr;
+	sigset_t sigmask;
+	int child_fds[3] = { -1, -1, -1 };
+	gchar **child_env = NULL;
+	short attr_flags;
+	int ret = 0;
+
+	fds[0] = fds[1] = fds[2] = -1;
 
 	/* Set XDG_ACTIVATION_TOKEN for Wayland startup notification
 	 * (matches AwesomeWM's DESKTOP_STARTUP_ID pattern for X11) */
-	token = (char *)user_data;
 	if (token) {
-		setenv("XDG_ACTIVATION_TOKEN", token, 1);
+		child_env = envp ? g_strdupv(envp) : g_get_environ();
+		child_env = g_environ_setenv(child_env, "XDG_ACTIVATION_TOKEN", token, TRUE);
+	}
+
+	posix_spawn_file_actions_init(&actions);
+	posix_spawnattr_init(&attr);
+
+	for (int i = 0; i < 3 && ret == 0; i++) {
+		int p[2];
+
+		switch (modes[i]) {
+		case SPAWN_STDIO_PIPE:
+			if (pipe2(p, O_CLOEXEC) < 0) {
+				ret = errno;
+				break;
+			}
+			/* stdin: child reads p[0]; stdout/stderr: child writes p[1] */
+			child_fds[i] = i == 0 ? p[0] : p[1];
+			fds[i] = i == 0 ? p[1] : p[0];
+			ret = posix_spawn_file_actions_adddup2(&actions, child_fds[i], i);
+			break;
+		case SPAWN_STDIO_DEV_NULL:
+			ret = posix_spawn_file_actions_addopen(&actions, i, "/dev/null",
+					i == 0 ? O_RDONLY : O_WRONLY, 0);
+			break;
+		case SPAWN_STDIO_INHERIT:
+			break;
+		}
+	}
+
+	/* Don't leak compositor fds that lack O_CLOEXEC (g_spawn did the same) */
+	if (ret == 0)
+#if SPAWN_HAVE_CLOSEFROM
+		ret = posix_spawn_file_actions_addclosefrom_np(&actions, 3);
+#else
+		ret = spawn_close_inherited(&actions);
+#endif
+
+	/* New session, like the old setsid() child setup, and no blocked signals */
+	attr_flags = POSIX_SPAWN_SETSIGMASK;
+#ifdef POSIX_SPAWN_SETSID
+	attr_flags |= POSIX_SPAWN_SETSID;
+#else
+	attr_flags |= POSIX_SPAWN_SETPGROUP;
+#endif
+	sigemptyset(&sigmask);
+	if (ret == 0)
+		ret = posix_spawnattr_setsigmask(&attr, &sigmask);
+	if (ret == 0)
+		ret = posix_spawnattr_setflags(&attr, attr_flags);
+
+	if (ret == 0) {
+#ifdef SOMEWM_BENCH
+		struct timespec bench_start, bench_end;
+		clock_gettime(CLOCK_MONOTONIC, &bench_start);
+#endif
+		ret = posix_spawnp(pid, argv[0], &actions, &attr, argv,
+				child_env ? child_env : (envp ? envp : environ));
+#ifdef SOMEWM_BENCH
+		clock_gettime(CLOCK_MONOTONIC, &bench_end);
+		if (ret == 0)
+			bench_spawn_record(timespec_diff_ns(&bench_start, &bench_end));
+#endif
+	}
+
+	posix_spawnattr_destroy(&attr);
+	posix_spawn_file_actions_destroy(&actions);
+	g_strfreev(child_env);
+
+	/* The child has its own copies now */
+	for (int i = 0; i < 3; i++) {
+		if (child_fds[i] >= 0)
+			close(child_fds[i]);
+	}
+
+	if (ret != 0) {
+		for (int i = 0; i < 3; i++) {
+			if (fds[i] >= 0) {
+				close(fds[i]);
+				fds[i] = -1;
+			}
+		}
+		g_set_error(error, G_SPAWN_ERROR, G_SPAWN_ERROR_FAILED,
+				"Failed to execute child process \"%s\" (%s)",
+				argv[0], g_strerror(ret));
+		return false;
+	}
+
+	return true;
+}
+
+/** Start tracking a child so its exit callback runs when it exits.
+ * \param pid The child pid.
+ * \param callback_ref Lua registry reference of the exit callback.
+ */
+static void
+spawn_track_child(pid_t pid, int callback_ref)
+{
+	running_child_t *child;
+
+	/* Initialize table on first use */
+	if (!running_children)
+		running_children = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+				NULL, running_child_free);
+
+	child = g_new0(running_child_t, 1);
+	child->pid = pid;
+	child->exit_callback = callback_ref;
+
+	/* With a pidfd in the main loop the exit is reaped as soon as the fd
+	 * polls readable. Without one (pre-5.3 kernels) we still get it through
+	 * somewm.c's reap_children() SIGCHLD pipe (AwesomeWM pattern). */
+	child->pidfd = spawn_pidfd_open(pid);
+	if (child->pidfd >= 0) {
+		fcntl(child->pidfd, F_SETFD, FD_CLOEXEC);
+		child->pidfd_source = g_unix_fd_add(child->pidfd, G_IO_IN,
+				spawn_pidfd_ready, child);
 	}
+
+	g_hash_table_replace(running_children, GINT_TO_POINTER(pid), child);
 }
 
 /** Spawn a program.
@@ -265,14 +559,17 @@ int
 luaA_spawn(lua_State *L)
 {
 	gchar **argv = NULL, **envp = NULL;
-	bool return_stdin = false, return_stdout = false, return_stderr = false;
 	bool use_sn = true;  /* Default: enable startup notification */
+	bool has_exit_callback = false;
 	char *activation_token = NULL;  /* XDG activation token for Wayland */
-	int stdin_fd = -1, stdout_fd = -1, stderr_fd = -1;
-	int *stdin_ptr = NULL, *stdout_ptr = NULL, *stderr_ptr = NULL;
-	GSpawnFlags flags = 0;
-	gboolean retval;
-	GPid pid;
+	spawn_stdio_t modes[3] = {
+		SPAWN_STDIO_DEV_NULL,  /* stdin */
+		SPAWN_STDIO_INHERIT,   /* stdout */
+		SPAWN_STDIO_INHERIT,   /* stderr */
+	};
+	int fds[3];
+	bool retval;
+	pid_t pid;
 	GError *error = NULL;
 
 	/* Parse use_sn argument (arg 2) */
@@ -281,80 +578,17 @@ luaA_spawn(lua_State *L)
 		use_sn = lua_toboolean(L, 2);
 	}
 
-	/* Parse stdin argument (arg 3) */
-	if (lua_gettop(L) >= 3) {
-		if (lua_isstring(L, 3)) {
-			const char *str = lua_tostring(L, 3);
-			if (strcmp(str, "DEV_NULL") == 0) {
-#if GLIB_CHECK_VERSION(2, 74, 0)
-				flags |= G_SPAWN_STDIN_FROM_DEV_NULL;
-#endif
-			} else if (strcmp(str, "INHERIT") == 0) {
-				flags |= G_SPAWN_CHILD_INHERITS_STDIN;
-			} else {
-				return luaL_error(L, "stdin: expected boolean, 'DEV_NULL', or 'INHERIT'");
-			}
-		} else if (lua_isboolean(L, 3)) {
-			return_stdin = lua_toboolean(L, 3);
-		} else if (!lua_isnil(L, 3)) {
-			return luaL_error(L, "stdin: expected boolean or string");
-		}
-	}
-
-	/* Parse stdout argument (arg 4) */
-	if (lua_gettop(L) >= 4) {
-		if (lua_isstring(L, 4)) {
-			const char *str = lua_tostring(L, 4);
-			if (strcmp(str, "DEV_NULL") == 0) {
-				flags |= G_SPAWN_STDOUT_TO_DEV_NULL;
-			} else if (strcmp(str, "INHERIT") == 0) {
-#if GLIB_CHECK_VERSION(2, 74, 0)
-				flags |= G_SPAWN_CHILD_INHERITS_STDOUT;
-#endif
-			} else {
-				return luaL_error(L, "stdout: expected boolean, 'DEV_NULL', or 'INHERIT'");
-			}
-		} else if (lua_isboolean(L, 4)) {
-			return_stdout = lua_toboolean(L, 4);
-		} else if (!lua_isnil(L, 4)) {
-			return luaL_error(L, "stdout: expected boolean or string");
-		}
-	}
-
-	/* Parse stderr argument (arg 5) */
-	if (lua_gettop(L) >= 5) {
-		if (lua_isstring(L, 5)) {
-			const char *str = lua_tostring(L, 5);
-			if (strcmp(str, "DEV_NULL") == 0) {
-				flags |= G_SPAWN_STDERR_TO_DEV_NULL;
-			} else if (strcmp(str, "INHERIT") == 0) {
-#if GLIB_CHECK_VERSION(2, 74, 0)
-				flags |= G_SPAWN_CHILD_INHERITS_STDERR;
-#endif
-			} else {
-				return luaL_error(L, "stderr: expected boolean, 'DEV_NULL', or 'INHERIT'");
-			}
-		} else if (lua_isboolean(L, 5)) {
-			return_stderr = lua_toboolean(L, 5);
-		} else if (!lua_isnil(L, 5)) {
-			return luaL_error(L, "stderr: expected boolean or string");
-		}
-	}
+	/* Parse stdin, stdout and stderr arguments (args 3-5) */
+	parse_stdio_mode(L, 3, "stdin", &modes[0]);
+	parse_stdio_mode(L, 4, "stdout", &modes[1]);
+	parse_stdio_mode(L, 5, "stderr", &modes[2]);
 
 	/* Parse exit_callback argument (arg 6) */
 	if (!lua_isnoneornil(L, 6)) {
 		luaL_checktype(L, 6, LUA_TFUNCTION);
-		flags |= G_SPAWN_DO_NOT_REAP_CHILD;
+		has_exit_callback = true;
 	}
 
-	/* Setup pipe pointers */
-	if (return_stdin)
-		stdin_ptr = &stdin_fd;
-	if (return_stdout)
-		stdout_ptr = &stdout_fd;
-	if (return_stderr)
-		stderr_ptr = &stderr_fd;
-
 	/* Parse command (arg 1) */
 	argv = parse_command(L, 1, &error);
 	if (!argv || !argv[0]) {
@@ -393,10 +627,7 @@ luaA_spawn(lua_State *L)
 		}
 
 	/* Spawn the process */
-	flags |= G_SPAWN_SEARCH_PATH | G_SPAWN_CLOEXEC_PIPES;
-	retval = g_spawn_async_with_pipes(NULL, argv, envp, flags,
-			spawn_child_setup, activation_token, &pid,
-			stdin_ptr, stdout_ptr, stderr_ptr, &error);
+	retval = spawn_posix(argv, envp, activation_token, modes, fds, &pid, &error);
 
 	g_strfreev(argv);
 	g_strfreev(envp);
@@ -407,26 +638,12 @@ luaA_spawn(lua_State *L)
 		return 1;
 	}
 
-	/* Setup exit callback if requested */
-	if (flags & G_SPAWN_DO_NOT_REAP_CHILD) {
-		int callback_ref;
-		running_child_t child;
-
-		/* Initialize array on first use */
-		if (!running_children)
-			running_children = g_array_new(FALSE, FALSE, sizeof(running_child_t));
-
+	/* Setup exit callback if requested. Children without one are reaped
+	 * (and ignored) by reap_children(). */
+	if (has_exit_callback) {
 		/* Store callback in registry */
 		lua_pushvalue(L, 6);
-		callback_ref = luaL_ref(L, LUA_REGISTRYINDEX);
-
-		/* Track this child */
-		child.pid = pid;
-		child.exit_callback = callback_ref;
-		g_array_append_val(running_children, child);
-
-		/* Note: No g_child_watch_add() here - child reaping is unified
-		 * in somewm.c's reap_children() callback (AwesomeWM pattern) */
+		spawn_track_child(pid, luaL_ref(L, LUA_REGISTRYINDEX));
 	}
 
 	/* Return: pid, snid, stdin, stdout, stderr */
@@ -437,22 +654,348 @@ luaA_spawn(lua_State *L)
 	else
 		lua_pushnil(L);
 
-	if (return_stdin)
-		lua_pushinteger(L, stdin_fd);
-	else
-		lua_pushnil(L);
+	for (int i = 0; i < 3; i++) {
+		if (modes[i] == SPAWN_STDIO_PIPE)
+			lua_pushinteger(L, fds[i]);
+		else
+			lua_pushnil(L);
+	}
 
-	if (return_stdout)
-		lua_pushinteger(L, stdout_fd);
-	else
-		lua_pushnil(L);
+	return 5;
+}
 
-	if (return_stderr)
-		lua_pushinteger(L, stderr_fd);
-	else
-		lua_pushnil(L);
+/* ==========================================================================
+ * Native output readers for spawned commands
+ * ==========================================================================
+ * awful.spawn.with_line_callback and easy_async used to read their pipes
+ * through LGI GIO streams, one read_line_async closure and Lua string per
+ * line. These readers do the reading and line splitting in C: bytes are
+ * appended to a growable buffer as they arrive, and complete lines are
+ * handed to Lua straight out of that buffer from some_refresh(), in
+ * batches bounded by a per-cycle line/byte budget.
+ */
 
-	return 5;
+/* Initial buffer size; grows by doubling */
+#define SPAWN_READER_BUFSIZE 4096
+/* Max bytes read from one pipe per wakeup, so a chatty child can't starve
+ * the main loop */
+#define SPAWN_READER_READ_MAX (64 * 1024)
+/* Stop polling a line reader's pipe while this much is undelivered, resume
+ * below the low-water mark (the child then blocks on a full pipe) */
+#define SPAWN_READER_HIGH_WATER (1024 * 1024)
+#define SPAWN_READER_LOW_WATER (256 * 1024)
+/* Per refresh cycle delivery budget, shared by all readers */
+#define SPAWN_READER_LINE_BUDGET 1024
+#define SPAWN_READER_BYTE_BUDGET (256 * 1024)
+
+typedef struct {
+	int fd;              /* -1 after EOF */
+	guint source;        /* fd watch, 0 while paused or after EOF */
+	bool accumulate;     /* Deliver the whole output at EOF (easy_async) */
+	int line_callback;   /* Lua registry ref, LUA_REFNIL in accumulate mode */
+	int done_callback;   /* Lua registry ref or LUA_REFNIL */
+	char *buf;
+	size_t size;
+	size_t head;         /* Start of undelivered data */
+	size_t tail;         /* End of data */
+	size_t scan;         /* No '\n' in [head, scan) */
+} spawn_reader_t;
+
+static GPtrArray *spawn_readers = NULL;
+/* Set when the last dispatch ran out of budget with lines still queued */
+static bool spawn_readers_backlog = false;
+
+static gboolean spawn_reader_readable(gint fd, GIOCondition condition, gpointer data);
+
+static void
+spawn_reader_watch(spawn_reader_t *reader)
+{
+	reader->source = g_unix_fd_add(reader->fd, G_IO_IN | G_IO_HUP | G_IO_ERR,
+			spawn_reader_readable, reader);
+}
+
+static void
+spawn_reader_close(spawn_reader_t *reader)
+{
+	if (reader->source) {
+		g_source_remove(reader->source);
+		reader->source = 0;
+	}
+	if (reader->fd >= 0) {
+		close(reader->fd);
+		reader->fd = -1;
+	}
+}
+
+static void
+spawn_reader_free(spawn_reader_t *reader)
+{
+	spawn_reader_close(reader);
+	g_free(reader->buf);
+	g_free(reader);
+}
+
+/** Make room for at least one more read at buf[tail].
+ * Line readers slide undelivered data to the front before growing.
+ */
+static void
+spawn_reader_reserve(spawn_reader_t *reader)
+{
+	if (reader->tail < reader->size)
+		return;
+
+	if (reader->head > 0) {
+		size_t len = reader->tail - reader->head;
+		memmove(reader->buf, reader->buf + reader->head, len);
+		reader->scan -= reader->head;
+		reader->head = 0;
+		reader->tail = len;
+		if (len < reader->size / 2)
+			return;
+	}
+
+	reader->size = reader->size ? reader->size * 2 : SPAWN_READER_BUFSIZE;
+	reader->buf = g_realloc(reader->buf, reader->size);
+}
+
+/** GLib callback: data (or EOF) is available on a reader's pipe. */
+static gboolean
+spawn_reader_readable(gint fd, GIOCondition condition, gpointer data)
+{
+	spawn_reader_t *reader = data;
+	size_t total = 0;
+
+	while (total < SPAWN_READER_READ_MAX) {
+		ssize_t n;
+
+		spawn_reader_reserve(reader);
+		n = read(fd, reader->buf + reader->tail, reader->size - reader->tail);
+		if (n > 0) {
+			reader->tail += n;
+			total += n;
+			continue;
+		}
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+			break;
+		if (n < 0)
+			warn("spawn: error reading child output: %s", strerror(errno));
+
+		/* EOF or error: stop watching, dispatch delivers the rest */
+		reader->source = 0;
+		close(reader->fd);
+		reader->fd = -1;
+		return G_SOURCE_REMOVE;
+	}
+
+	if (!reader->accumulate
+			&& reader->tail - reader->head > SPAWN_READER_HIGH_WATER) {
+		reader->source = 0;
+		return G_SOURCE_REMOVE;
+	}
+
+	return G_SOURCE_CONTINUE;
+}
+
+/** Deliver one reader's pending output to Lua within the cycle budget.
+ * \return true once the reader is finished and can be freed.
+ */
+static bool
+spawn_reader_deliver(lua_State *L, spawn_reader_t *reader,
+		int *lines_left, size_t *bytes_left)
+{
+	bool eof = reader->fd < 0;
+
+	if (reader->accumulate) {
+		size_t len = reader->tail - reader->head;
+
+		if (!eof)
+			return false;
+
+		/* Same shape as concatenating line .. "\n" for every line */
+		if (len > 0 && reader->buf[reader->tail - 1] != '\n') {
+			spawn_reader_reserve(reader);
+			reader->buf[reader->tail++] = '\n';
+			len++;
+		}
+
+		if (reader->done_callback != LUA_REFNIL) {
+			lua_rawgeti(L, LUA_REGISTRYINDEX, reader->done_callback);
+			lua_pushlstring(L, len ? reader->buf + reader->head : "", len);
+			luaA_dofunction(L, 1, 0);
+		}
+		return true;
+	}
+
+	while (reader->head < reader->tail) {
+		char *start = reader->buf + reader->head;
+		char *nl;
+		size_t len;
+
+		if (*lines_left <= 0 || *bytes_left == 0) {
+			spawn_readers_backlog = true;
+			break;
+		}
+
+		nl = memchr(reader->buf + reader->scan, '\n', reader->tail - reader->scan);
+		if (nl) {
+			len = nl - start;
+		} else if (eof) {
+			/* Trailing line without newline */
+			len = reader->tail - reader->head;
+		} else {
+			reader->scan = reader->tail;
+			break;
+		}
+
+		reader->head += len + (nl ? 1 : 0);
+		reader->scan = reader->head;
+		(*lines_left)--;
+		*bytes_left = len < *bytes_left ? *bytes_left - len : 0;
+
+		/* The line callback may spawn more readers and grow spawn_readers,
+		 * but it cannot touch this reader's buffer. */
+		lua_rawgeti(L, LUA_REGISTRYINDEX, reader->line_callback);
+		lua_pushlstring(L, start, len);
+		luaA_dofunction(L, 1, 0);
+	}
+
+	if (reader->head == reader->tail)
+		reader->head = reader->tail = reader->scan = 0;
+
+	if (eof && reader->tail == 0) {
+		if (reader->done_callback != LUA_REFNIL) {
+			lua_rawgeti(L, LUA_REGISTRYINDEX, reader->done_callback);
+			luaA_dofunction(L, 0, 0);
+		}
+		return true;
+	}
+
+	/* Resume a reader paused at the high-water mark */
+	if (!eof && !reader->source
+			&& reader->tail - reader->head < SPAWN_READER_LOW_WATER)
+		spawn_reader_watch(reader);
+
+	return false;
+}
+
+/** Deliver buffered child output to Lua. Called once per some_refresh(). */
+void
+spawn_readers_dispatch(lua_State *L)
+{
+	int lines_left = SPAWN_READER_LINE_BUDGET;
+	size_t bytes_left = SPAWN_READER_BYTE_BUDGET;
+
+	spawn_readers_backlog = false;
+	if (!spawn_readers || spawn_readers->len == 0)
+		return;
+
+	/* Readers added by callbacks are appended and picked up in this pass */
+	for (guint i = 0; i < spawn_readers->len; ) {
+		spawn_reader_t *reader = g_ptr_array_index(spawn_readers, i);
+
+		if (spawn_reader_deliver(L, reader, &lines_left, &bytes_left)) {
+			luaL_unref(L, LUA_REGISTRYINDEX, reader->line_callback);
+			luaL_unref(L, LUA_REGISTRYINDEX, reader->done_callback);
+			g_ptr_array_remove_index(spawn_readers, i);
+			spawn_reader_free(reader);
+		} else {
+			i++;
+		}
+	}
+}
+
+/** Whether buffered output is waiting for the next refresh cycle.
+ * The main loop must not block in poll() while this is true.
+ */
+bool
+spawn_readers_pending(void)
+{
+	return spawn_readers_backlog;
+}
+
+/** Drop all readers. Their Lua refs belong to the abandoned state. */
+static void
+spawn_readers_invalidate(void)
+{
+	if (!spawn_readers)
+		return;
+
+	for (guint i = 0; i < spawn_readers->len; i++)
+		spawn_reader_free(g_ptr_array_index(spawn_readers, i));
+	g_ptr_array_set_size(spawn_readers, 0);
+	spawn_readers_backlog = false;
+}
+
+static int
+spawn_reader_new(lua_State *L, bool accumulate)
+{
+	int fd = (int)luaL_checkinteger(L, 1);
+	spawn_reader_t *reader;
+	int flags;
+
+	luaL_checktype(L, 2, LUA_TFUNCTION);
+	if (!accumulate && !lua_isnoneornil(L, 3))
+		luaL_checktype(L, 3, LUA_TFUNCTION);
+
+	flags = fcntl(fd, F_GETFL);
+	if (flags < 0)
+		return luaL_error(L, "invalid file descriptor %d", fd);
+	fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+
+	reader = g_new0(spawn_reader_t, 1);
+	reader->fd = fd;
+	reader->accumulate = accumulate;
+	reader->line_callback = LUA_REFNIL;
+	reader->done_callback = LUA_REFNIL;
+
+	if (accumulate) {
+		lua_pushvalue(L, 2);
+		reader->done_callback = luaL_ref(L, LUA_REGISTRYINDEX);
+	} else {
+		lua_pushvalue(L, 2);
+		reader->line_callback = luaL_ref(L, LUA_REGISTRYINDEX);
+		if (!lua_isnoneornil(L, 3)) {
+			lua_pushvalue(L, 3);
+			reader->done_callback = luaL_ref(L, LUA_REGISTRYINDEX);
+		}
+	}
+
+	if (!spawn_readers)
+		spawn_readers = g_ptr_array_new();
+	g_ptr_array_add(spawn_readers, reader);
+	spawn_reader_watch(reader);
+
+	return 0;
+}
+
+/** Read lines from a pipe returned by awesome.spawn().
+ * Takes ownership of the fd and closes it at EOF.
+ *
+ * @tparam integer fd The pipe fd.
+ * @tparam function line_callback Called with each line (without the newline).
+ * @tparam[opt] function done_callback Called after the last line.
+ * @noreturn
+ */
+int
+luaA_spawn_read_lines(lua_State *L)
+{
+	return spawn_reader_new(L, false);
+}
+
+/** Read all output from a pipe returned by awesome.spawn().
+ * Takes ownership of the fd and closes it at EOF.
+ *
+ * @tparam integer fd The pipe fd.
+ * @tparam function done_callback Called with the whole output, where every
+ *   line (including a final unterminated one) ends in a newline.
+ * @noreturn
+ */
+int
+luaA_spawn_read_output(lua_State *L)
+{
+	return spawn_reader_new(L, true);
 }
 
 /** Setup the spawn module
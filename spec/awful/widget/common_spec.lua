@@ -0,0 +1,192 @@
+---------------------------------------------------------------------------
+-- Tests for the keyed list update of awful.widget.common
+---------------------------------------------------------------------------
+
+-- Stub awful.button: the entry templates set buttons, and the real
+-- awful.button needs capi backing that is unavailable under busted.
+package.loaded["awful.button"] = setmetatable({}, {
+    __call = function() return {} end
+})
+
+local unpack = unpack or table.unpack -- luacheck: globals unpack (compatibility with Lua 5.1)
+local cairo = require("lgi").cairo
+local common = require("awful.widget.common")
+
+-- A layout that records the removals and insertions made on it.
+local function recording_layout(children)
+    local l = { children = children or {}, removed = {}, inserted = {}, resets = 0 }
+
+    function l:get_children()
+        return { unpack(self.children) }
+    end
+
+    function l:insert(index, widget)
+        table.insert(self.children, index, widget)
+        table.insert(self.inserted, { index, widget })
+    end
+
+    function l:remove(index)
+        table.insert(self.removed, table.remove(self.children, index))
+    end
+
+    function l:reset()
+        self.children = {}
+        self.resets = self.resets + 1
+    end
+
+    function l:add(widget)
+        table.insert(self.children, widget)
+    end
+
+    return l
+end
+
+local function set_size(set)
+    local n = 0
+    for _ in pairs(set) do n = n + 1 end
+    return n
+end
+
+describe("awful.widget.common", function()
+    describe("_lis_indices", function()
+        it("empty sequence", function()
+            assert.is.same({}, common._lis_indices({}))
+        end)
+
+        it("increasing sequence keeps everything", function()
+            assert.is.same({ true, true, true }, common._lis_indices({ 1, 2, 3 }))
+        end)
+
+        it("keeps the longest increasing run", function()
+            local keep = common._lis_indices({ 4, 1, 2, 3 })
+            assert.is.same({ [2] = true, [3] = true, [4] = true }, keep)
+        end)
+
+        it("decreasing sequence keeps one", function()
+            assert.is.equal(1, set_size(common._lis_indices({ 3, 2, 1 })))
+        end)
+    end)
+
+    describe("_reconcile_children", function()
+        local a, b, c, d = {}, {}, {}, {}
+
+        it("same children make no changes", function()
+            local l = recording_layout({ a, b, c })
+            assert.is.equal(0, common._reconcile_children(l, { a, b, c }))
+            assert.is.same({}, l.removed)
+            assert.is.same({}, l.inserted)
+        end)
+
+        it("insert", function()
+            local l = recording_layout({ a, c })
+            assert.is.equal(1, common._reconcile_children(l, { a, b, c }))
+            assert.is.same({ a, b, c }, l.children)
+            assert.is.same({ { 2, b } }, l.inserted)
+        end)
+
+        it("remove", function()
+            local l = recording_layout({ a, b, c })
+            assert.is.equal(1, common._reconcile_children(l, { a, c }))
+            assert.is.same({ a, c }, l.children)
+            assert.is.same({ b }, l.removed)
+        end)
+
+        it("reorder only moves the children outside the LIS", function()
+            local l = recording_layout({ a, b, c, d })
+            assert.is.equal(2, common._reconcile_children(l, { d, a, b, c }))
+            assert.is.same({ d, a, b, c }, l.children)
+            assert.is.same({ d }, l.removed)
+            assert.is.same({ { 1, d } }, l.inserted)
+        end)
+
+        it("rebuilds layouts without indexed insertion", function()
+            local l = recording_layout({ a, b })
+            l.insert, l.remove = nil, nil
+            assert.is.equal(3, common._reconcile_children(l, { b, a }))
+            assert.is.same({ b, a }, l.children)
+            assert.is.equal(1, l.resets)
+        end)
+    end)
+
+    describe("list_update_keyed", function()
+        local data, texts, l
+
+        local function label(o)
+            return texts[o]
+        end
+
+        local function update(objects, args)
+            return common.list_update_keyed(l, nil, label, data, objects, args)
+        end
+
+        local a, b, c = {}, {}, {}
+
+        before_each(function()
+            data = setmetatable({}, { __mode = "k" })
+            texts = { [a] = "a", [b] = "b", [c] = "c" }
+            l = recording_layout()
+        end)
+
+        it("keeps each object's widget across updates", function()
+            update({ a, b })
+            local wa, wb = data[a].primary, data[b].primary
+            assert.is.same({ wa, wb }, l.children)
+
+            update({ b, a })
+            assert.is.equal(wa, data[a].primary)
+            assert.is.equal(wb, data[b].primary)
+            assert.is.same({ wb, wa }, l.children)
+        end)
+
+        it("insert and remove only touch the changed entries", function()
+            update({ a, c })
+            l.removed, l.inserted = {}, {}
+
+            assert.is.equal(1, update({ a, b, c }))
+            assert.is.same({ { 2, data[b].primary } }, l.inserted)
+
+            l.removed, l.inserted = {}, {}
+            assert.is.equal(1, update({ a, c }))
+            assert.is.same({ data[b].primary }, l.removed)
+        end)
+
+        it("label-only updates apply only the changed text", function()
+            update({ a, b })
+            local set_a = spy.on(data[a].tb, "set_markup_silently")
+            local set_b = spy.on(data[b].tb, "set_markup_silently")
+
+            texts[a] = "a2"
+            assert.is.equal(0, update({ a, b }))
+            assert.spy(set_a).was.called(1)
+            assert.spy(set_b).was_not.called()
+            assert.is.equal("a2", data[a].tb.text)
+        end)
+
+        it("dirty skips the labels of clean entries", function()
+            local calls = 0
+            local function counting_label(o)
+                calls = calls + 1
+                return texts[o]
+            end
+
+            common.list_update_keyed(l, nil, counting_label, data, { a, b })
+            calls = 0
+            common.list_update_keyed(l, nil, counting_label, data, { a, b },
+                { dirty = { [b] = true } })
+            assert.is.equal(1, calls)
+        end)
+
+        it("sets a new icon surface on every relabel", function()
+            local function icon_label(o)
+                return texts[o], nil, nil, cairo.ImageSurface(cairo.Format.ARGB32, 1, 1)
+            end
+
+            common.list_update_keyed(l, nil, icon_label, data, { a })
+            local set_image = spy.on(data[a].ib, "set_image")
+            common.list_update_keyed(l, nil, icon_label, data, { a })
+            assert.spy(set_image).was.called(1)
+        end)
+    end)
+end)
+
+-- vim: filetype=lua:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:textwidth=80
@@ -134,6 +134,83 @@ describe("gears.matcher", function()
         assert.is_nil(obj2.main_applied)
         assert.is_nil(obj1.fallback_applied)
     end)
+
+    describe("indexed matching agrees with checking every rule", function()
+        local m = matcher()
+
+        m:add_property_matcher("is_special", function(o, value)
+            return o.special == value
+        end)
+
+        local classes = { "Firefox", "firefox", "XTerm", "gnome-terminal",
+            "org.gnome.Nautilus", "mpv", "", "Gimp-2.10" }
+
+        local rules = {
+            { rule = {} },
+            { rule = { floating = true } },
+            { rule = { is_special = true, class = "mpv" } },
+            { rule = { class = "^firefox$" } },
+            { rule = { class = "gnome%-terminal" } },
+            { rule = { class = "gnome-terminal" } },
+            { rule = { class = "org.gnome.*" } },
+            { rule = { class = "^Gimp" } },
+            { rule = { class = "" } },
+            { rule = { class = "%w+" } },
+            { rule = { name = "vim" }, except = { class = "XTerm" } },
+            { rule_any = { type = { "dialog", "menu" } } },
+            { rule_any = { class = { "mpv", "XTerm" }, name = { "notes" } } },
+            { rule_any = { class = { "[Ff]irefox" } } },
+            { rule = { class = "Fire" }, rule_any = { name = { "x" } } },
+        }
+
+        for i, c in ipairs(classes) do
+            table.insert(rules, { rule = { class = c, instance = "i" .. i } })
+        end
+
+        m:append_rules("default", rules)
+
+        local names = { "vim", "notes", "x", "" }
+        local types = { "normal", "dialog", "dropdown_menu" }
+        local objects = {}
+
+        for _, c in ipairs(classes) do
+            for _, n in ipairs(names) do
+                for i, t in ipairs(types) do
+                    table.insert(objects, {
+                        class = c, name = n, type = t, instance = "i" .. i,
+                        floating = i == 2, special = i == 3,
+                    })
+                end
+            end
+        end
+
+        local function linear(o)
+            local ret = {}
+            for _, entry in ipairs(m._matching_rules.default) do
+                if m:matches_rule(o, entry) then
+                    table.insert(ret, entry)
+                end
+            end
+            return ret
+        end
+
+        local function check()
+            for _, o in ipairs(objects) do
+                assert.same(linear(o), m:matching_rules(o, m._matching_rules.default))
+                assert.equal(#linear(o) > 0, m:matches_rules(o, m._matching_rules.default))
+            end
+        end
+
+        check()
+
+        -- The index follows append_rule, remove_rule and direct edits.
+        m:append_rule("default", { rule = { class = "Firefox" } })
+        check()
+        m:remove_rule("default", rules[4])
+        check()
+        table.insert(m._matching_rules.default, 1, { rule = { class = "mpv" } })
+        check()
+    end)
 end)
 
 -- vim: filetype=lua:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:textwidth=80
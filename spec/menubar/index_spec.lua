@@ -0,0 +1,139 @@
+---------------------------------------------------------------------------
+-- Tests for the persistent directory index of menubar
+---------------------------------------------------------------------------
+
+local gfs = require("gears.filesystem")
+local lgi = require("lgi")
+local gio = lgi.Gio
+local glib = lgi.GLib
+
+describe("menubar.index", function()
+    local tmp, dir
+    local get_cache_dir = gfs.get_cache_dir
+    local index
+
+    -- A fresh module: what a new session (or a hot reload) starts from.
+    local function new_session()
+        package.loaded["menubar.index"] = nil
+        index = require("menubar.index")
+        return index
+    end
+
+    local function write(path, content)
+        local f = assert(io.open(path, "w"))
+        f:write(content)
+        f:close()
+    end
+
+    local function dir_mtime(path)
+        local info = gio.File.new_for_path(path):query_info(index.query,
+            gio.FileQueryInfoFlags.NONE)
+        return index.mtime(info)
+    end
+
+    -- Move the modification time of a file, as an edit made later would.
+    local function touch(path, seconds)
+        local file = gio.File.new_for_path(path)
+        local info = file:query_info("time::modified", gio.FileQueryInfoFlags.NONE)
+        assert(file:set_attribute_uint64("time::modified",
+            info:get_attribute_uint64("time::modified") + seconds,
+            gio.FileQueryInfoFlags.NONE))
+    end
+
+    before_each(function()
+        tmp = glib.dir_make_tmp("menubar-index-XXXXXX")
+        dir = tmp .. "/applications"
+        glib.mkdir_with_parents(tmp .. "/cache", 448) -- 0700
+        glib.mkdir_with_parents(dir .. "/sub", 448)
+        write(dir .. "/a.desktop", "[Desktop Entry]\nName=A\n")
+        write(dir .. "/b.desktop", "[Desktop Entry]\nName=B\n")
+
+        gfs.get_cache_dir = function() return tmp .. "/cache/" end
+        new_session()
+    end)
+
+    after_each(function()
+        gfs.get_cache_dir = get_cache_dir
+        os.execute("rm -rf '" .. tmp .. "'")
+    end)
+
+    it("lists files and subdirectories", function()
+        local listing = index.list_dir(dir)
+        assert.is_number(listing.files["a.desktop"])
+        assert.is_number(listing.files["b.desktop"])
+        assert.is_same({ sub = true }, listing.dirs)
+        assert.is_nil(index.list_dir(dir .. "/a.desktop"))
+        assert.is_nil(index.list_dir(tmp .. "/missing"))
+    end)
+
+    it("reuses a saved listing if the directory did not change", function()
+        local listing = index.list_dir(dir)
+        index.set_desktop_entry(dir .. "/a.desktop", listing.files["a.desktop"], { Name = "A" })
+        index.save()
+
+        new_session()
+        assert.is_nil(index.get_listing(dir))
+        local cached = index.get_listing(dir, dir_mtime(dir))
+        assert.is_same(listing, cached)
+        assert.is_same({ Name = "A" },
+            index.get_desktop_entry(dir .. "/a.desktop", cached.files["a.desktop"]))
+        -- Current for the rest of the session
+        assert.is_equal(cached, index.get_listing(dir))
+    end)
+
+    it("drops a saved listing if the directory changed", function()
+        index.list_dir(dir)
+        index.save()
+
+        new_session()
+        assert.is_nil(index.get_listing(dir, dir_mtime(dir) + 1))
+    end)
+
+    it("notices files edited in place while not running", function()
+        local listing = index.list_dir(dir)
+        local old = listing.files["a.desktop"]
+        index.set_desktop_entry(dir .. "/a.desktop", old, { Name = "A" })
+        index.save()
+
+        -- Rewriting an existing file leaves the directory time alone
+        local before = dir_mtime(dir)
+        write(dir .. "/a.desktop", "[Desktop Entry]\nName=A2\n")
+        touch(dir .. "/a.desktop", 10)
+        assert.is_equal(before, dir_mtime(dir))
+
+        new_session()
+        local cached = index.get_listing(dir, before, true)
+        assert.is_not_nil(cached)
+        assert.is_not_equal(old, cached.files["a.desktop"])
+        assert.is_nil(index.get_desktop_entry(dir .. "/a.desktop", cached.files["a.desktop"]))
+        assert.is_number(cached.files["b.desktop"])
+    end)
+
+    it("keeps file times unchecked without check_files", function()
+        local old = index.list_dir(dir).files["a.desktop"]
+        index.save()
+
+        touch(dir .. "/a.desktop", 10)
+
+        new_session()
+        assert.is_equal(old, index.get_listing(dir, dir_mtime(dir)).files["a.desktop"])
+    end)
+
+    it("forgets entries of removed files on save", function()
+        local listing = index.list_dir(dir)
+        index.set_desktop_entry(dir .. "/b.desktop", listing.files["b.desktop"], { Name = "B" })
+        index.save()
+
+        os.remove(dir .. "/b.desktop")
+
+        new_session()
+        local fresh = index.list_dir(dir)
+        assert.is_nil(fresh.files["b.desktop"])
+        index.save()
+
+        new_session()
+        assert.is_nil(index.get_desktop_entry(dir .. "/b.desktop", listing.files["b.desktop"]))
+    end)
+end)
+
+-- vim: filetype=lua:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:textwidth=80
@@ -145,4 +145,102 @@ describe("menubar.utils lookup_icon_uncached", function()
     end)
 end)
 
+describe("menubar.utils lookup_icon", function()
+    local index = require("menubar.index")
+    local shimmed = {}
+    local gfs_shim_dir_readable
+    local gfs_shim_file_readable
+    local gfs_shim_get_cache_dir
+    local index_list_dir
+    local icon_theme
+    local cache_dir
+
+    setup(function()
+        local root = (os.getenv("SOURCE_DIRECTORY") or '.') .. "/spec/menubar"
+
+        local function shim(name, retval)
+            shimmed[name] = glib[name]
+            glib[name] = function() return retval end
+        end
+
+        shim('get_home_dir',         "/home")
+        shim('get_user_data_dir',    "/home/.local/share")
+        shim('get_system_data_dirs', {
+            "/usr/local/share",
+            "/usr/share"
+        })
+
+        gfs_shim_dir_readable = gfs.dir_readable
+        gfs.dir_readable = function(path) return gfs_shim_dir_readable(root..path) end
+        gfs_shim_file_readable = gfs.file_readable
+        gfs.file_readable = function(filename) return gfs_shim_file_readable(root..filename) end
+
+        -- The map is built from the listings of the index
+        index_list_dir = index.list_dir
+        index.list_dir = function(path) return index_list_dir(root..path) end
+        cache_dir = glib.dir_make_tmp("menubar-utils-XXXXXX")
+        gfs_shim_get_cache_dir = gfs.get_cache_dir
+        gfs.get_cache_dir = function() return cache_dir .. "/" end
+
+        icon_theme = theme.icon_theme
+        theme.icon_theme = 'awesome'
+    end)
+
+    teardown(function()
+        for name, func in pairs(shimmed) do
+            glib[name] = func
+        end
+        gfs.dir_readable = gfs_shim_dir_readable
+        gfs.file_readable = gfs_shim_file_readable
+        gfs.get_cache_dir = gfs_shim_get_cache_dir
+        index.list_dir = index_list_dir
+        theme.icon_theme = icon_theme
+        os.execute("rm -rf '" .. cache_dir .. "'")
+    end)
+
+    it('resolves bare names like lookup_icon_uncached', function()
+        for _, icon in ipairs {
+            'icon1', 'icon2', 'icon3', 'icon4', 'icon5', 'icon6', 'icon7',
+            'icon5.png', 'icon6.xpm', 'icon7.svg', '.filename',
+            'awesome', 'awesome2',
+        } do
+            local expected = utils.lookup_icon_uncached(icon)
+            assert.is_string(expected)
+            assert.is_equal(expected, utils.lookup_icon(icon))
+        end
+    end)
+
+    it('prefers the exact name over an added extension', function()
+        assert.matches('/.icons/icon5.png$', utils.lookup_icon('icon5.png'))
+        assert.matches('/usr/share/icons/.filename.png$', utils.lookup_icon('.filename.png'))
+    end)
+
+    it('falls back for unknown names', function()
+        assert.is_falsy(utils.lookup_icon('icon9'))
+        assert.is_falsy(utils.lookup_icon('png'))
+    end)
+
+    it('probes names with a directory part', function()
+        assert.matches('/usr/share/icon6.xpm$', utils.lookup_icon('/usr/share/icon6.xpm'))
+    end)
+
+    it('rebuilds the map when the index reports a change', function()
+        utils.lookup_icon('icon1')
+        local calls = 0
+        local list_dir = index.list_dir
+        index.list_dir = function(path)
+            calls = calls + 1
+            return list_dir(path)
+        end
+
+        utils.lookup_icon('icon2')
+        assert.is_equal(0, calls)
+
+        index:emit_signal("changed", "/usr/share/icons")
+        utils.lookup_icon('icon2')
+        index.list_dir = list_dir
+        assert.is_true(calls > 0)
+    end)
+end)
+
 -- vim: filetype=lua:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:textwidth=80
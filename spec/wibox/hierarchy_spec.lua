@@ -258,6 +258,37 @@ describe("wibox.hierarchy", function()
             -- Intermediate drew to 4, 0, 5, 2 (and so does new_intermediate)
             assert.is.same({ rect.x, rect.y, rect.width, rect.height }, { 4, 0, 5, 2 })
         end)
+
+        it("moved child keeps its layout", function()
+            instance:update(context, parent, 15, 16)
+            local layout_calls = 0
+            local intermediate_layout = intermediate.layout
+            intermediate.layout = function(...)
+                layout_calls = layout_calls + 1
+                return intermediate_layout(...)
+            end
+
+            -- Clear caches and move intermediate
+            parent.layout = function()
+                return { make_child(intermediate, 5, 2, matrix.create_translate(6, 0)) }
+            end
+            parent:emit_signal("widget::layout_changed")
+
+            local region = instance:update(context, parent, 15, 16)
+            local hierarchy_intermediate = instance:get_children()[1]
+            local hierarchy_child = hierarchy_intermediate:get_children()[1]
+            assert.is.equal(layout_calls, 0)
+            assert.is.equal(hierarchy_intermediate:get_matrix_to_device(), matrix.create_translate(6, 0))
+            assert.is.equal(hierarchy_child:get_matrix_to_device(), matrix.create_translate(6, 5))
+            -- Both the old and the new place of the child are damaged
+            local x1, y1, x2, y2 = math.huge, math.huge, 0, 0
+            for i = 0, region:num_rectangles() - 1 do
+                local rect = region:get_rectangle(i)
+                x1, y1 = math.min(x1, rect.x), math.min(y1, rect.y)
+                x2, y2 = math.max(x2, rect.x + rect.width), math.max(y2, rect.y + rect.height)
+            end
+            assert.is.same({ x1, y1, x2, y2 }, { 4, 0, 16, 25 })
+        end)
     end)
 
     describe("widget counts", function()
@@ -47,6 +47,48 @@ describe("wibox.widget.base", function()
             collectgarbage("collect")
             assert.is.equal(0, #alive)
         end)
+
+        it("last layout survives a collection", function()
+            local calls = 0
+            widget1.layout = function()
+                calls = calls + 1
+                return {}
+            end
+            local ctx = {}
+            base.layout_widget(no_parent, ctx, widget1, 20, 20)
+            collectgarbage("collect")
+            base.layout_widget(no_parent, ctx, widget1, 20, 20)
+            assert.is.equal(1, calls)
+
+            widget1:emit_signal("widget::layout_changed")
+            base.layout_widget(no_parent, ctx, widget1, 20, 20)
+            assert.is.equal(2, calls)
+        end)
+
+        it("child changes reach the parent after a collection", function()
+            local child_width = 5
+            widget2.fit = function()
+                return child_width, 10
+            end
+            widget1.layout = function(self, context, width, height)
+                local w = base.fit_widget(self, context, widget2, width, height)
+                return { base.place_widget_at(widget2, 0, 0, w, height) }
+            end
+
+            local ctx = {}
+            local placed = base.layout_widget(no_parent, ctx, widget1, 20, 20)
+            assert.is.equal(5, placed[1]._width)
+
+            -- The parent's last layout is reused without asking the child
+            collectgarbage("collect")
+            base.layout_widget(no_parent, ctx, widget1, 20, 20)
+            collectgarbage("collect")
+
+            child_width = 8
+            widget2:emit_signal("widget::layout_changed")
+            placed = base.layout_widget(no_parent, ctx, widget1, 20, 20)
+            assert.is.equal(8, placed[1]._width)
+        end)
     end)
 
     describe("setup", function()
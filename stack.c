@@ -6,6 +6,9 @@
  *
  * Key differences from AwesomeWM:
  * - Uses wlroots scene graph layers instead of XCB stacking
+ * - Restacking is incremental: raise/lower and layer changes are recorded
+ *   per client, and stack_refresh() only reorders the scene layers they
+ *   touched. stack_windows() still asks for a full pass.
  */
 
 #include "stack.h"
@@ -15,7 +18,9 @@
 #include "objects/drawin.h"  /* For drawin stacking */
 #include "globalconf.h"      /* For globalconf.stack and globalconf.drawins */
 #include "somewm_api.h"
+#include "common/util.h"
 #include <stdbool.h>
+#include <stdint.h>
 #include <wlr/types/wlr_scene.h>
 #ifdef XWAYLAND
 #include <wlr/xwayland.h>
@@ -23,35 +28,144 @@
 
 /* Flag to mark stack as needing refresh */
 static bool need_stack_refresh = false;
+/* Recompute every client's layer and reorder every scene layer */
+static bool need_full_refresh = true;
+/* Clients moved in the stack or whose layer may have changed */
+static client_array_t stack_pending;
+/* The relative order of X11 clients changed (_NET_CLIENT_LIST_STACKING) */
+static bool x11_order_changed = true;
 
 /* External references */
 extern struct wlr_scene_tree *layers[NUM_LAYERS];
 
+/* Queue a client for the next stack_refresh() */
+static void
+stack_mark(Client *c)
+{
+	if (!c->stack_pending) {
+		c->stack_pending = true;
+		client_array_append(&stack_pending, c);
+	}
+	need_stack_refresh = true;
+}
+
 /*
  * Stack management - uses globalconf.stack (matches AwesomeWM)
  */
 
+/* A client pushed or appended while queued stays in stack_pending: it
+ * is still in the stack, and stack_refresh() looks at it only there */
+static void
+stack_list_remove(Client *c)
+{
+	if (!c->in_stack)
+		return;
+
+	if (c->stack_prev)
+		c->stack_prev->stack_next = c->stack_next;
+	else
+		globalconf.stack.head = c->stack_next;
+	if (c->stack_next)
+		c->stack_next->stack_prev = c->stack_prev;
+	else
+		globalconf.stack.tail = c->stack_prev;
+
+	c->stack_prev = c->stack_next = NULL;
+	c->in_stack = false;
+	globalconf.stack.len--;
+
+	if (c->client_type == X11)
+		x11_order_changed = true;
+}
+
+static void
+stack_list_push(Client *c)
+{
+	stack_list_remove(c);
+
+	c->stack_next = globalconf.stack.head;
+	if (globalconf.stack.head)
+		globalconf.stack.head->stack_prev = c;
+	else
+		globalconf.stack.tail = c;
+	globalconf.stack.head = c;
+
+	c->in_stack = true;
+	globalconf.stack.len++;
+
+	if (c->client_type == X11)
+		x11_order_changed = true;
+	stack_mark(c);
+}
+
+static void
+stack_list_append(Client *c)
+{
+	stack_list_remove(c);
+
+	c->stack_prev = globalconf.stack.tail;
+	if (globalconf.stack.tail)
+		globalconf.stack.tail->stack_next = c;
+	else
+		globalconf.stack.head = c;
+	globalconf.stack.tail = c;
+
+	c->in_stack = true;
+	globalconf.stack.len++;
+
+	if (c->client_type == X11)
+		x11_order_changed = true;
+	stack_mark(c);
+}
+
 void
-stack_client_remove(Client *c)
+stack_list_clear(void)
 {
-	foreach(client, globalconf.stack)
-		if (*client == c)
-		{
-			client_array_remove(&globalconf.stack, client);
-			break;
-		}
+	Client *c = globalconf.stack.head;
+
+	while (c) {
+		Client *next = c->stack_next;
+		c->stack_prev = c->stack_next = NULL;
+		c->in_stack = false;
+		c = next;
+	}
+
+	foreach(elem, stack_pending)
+		(*elem)->stack_pending = false;
+	stack_pending.len = 0;
+
+	globalconf.stack.head = globalconf.stack.tail = NULL;
+	globalconf.stack.len = 0;
+	x11_order_changed = true;
 	stack_windows();
 }
 
+void
+stack_client_remove(Client *c)
+{
+	/* The client may be freed before the next stack_refresh(), so it
+	 * cannot stay queued. Only unmanaged clients get here. */
+	if (c->stack_pending) {
+		foreach(elem, stack_pending)
+			if (*elem == c) {
+				client_array_remove(&stack_pending, elem);
+				break;
+			}
+		c->stack_pending = false;
+	}
+
+	stack_list_remove(c);
+	/* The others keep their order; only the X11 property may change */
+	need_stack_refresh = true;
+}
+
 /** Push the client at the beginning of the client stack.
  * \param c The client to push.
  */
 void
 stack_client_push(Client *c)
 {
-	stack_client_remove(c);
-	client_array_push(&globalconf.stack, c);
-	stack_windows();
+	stack_list_push(c);
 }
 
 /** Push the client at the end of the client stack.
@@ -60,14 +174,37 @@ stack_client_push(Client *c)
 void
 stack_client_append(Client *c)
 {
-	stack_client_remove(c);
-	client_array_append(&globalconf.stack, c);
-	stack_windows();
+	stack_list_append(c);
+}
+
+void
+stack_client_changed(Client *c)
+{
+	stack_mark(c);
+}
+
+void
+stack_focus_changed(void)
+{
+	stack_foreach(c)
+		if (c->fullscreen)
+			stack_mark(c);
+	need_stack_refresh = true;
+}
+
+void
+stack_client_screen_changed(Client *c)
+{
+	if (c == some_get_focused_client())
+		stack_focus_changed();
+	else if (c->fullscreen)
+		stack_mark(c);
 }
 
 void
 stack_windows(void)
 {
+	need_full_refresh = true;
 	need_stack_refresh = true;
 }
 
@@ -153,117 +290,112 @@ get_scene_layer(window_layer_t layer)
 	}
 }
 
-/** Stack a client relative to another within the same scene layer
- * \param c Client to stack
- * \param previous Previous client (stack above this one), or NULL
+/** Layer of the client a transient is stacked with
+ * \param c The client
+ * \return The cached layer of c or of its first non-transient ancestor
  */
-static void
-stack_client_relative(Client *c, Client *previous)
+static window_layer_t
+stack_group_layer(Client *c)
 {
-	if (!c || !c->scene)
-		return;
+	int guard = globalconf.stack.len;
 
-	if (previous && previous->scene) {
-		/* Ensure both nodes share the same scene parent.
-		 * In X11, stacking is flat (xcb_configure_window works on any two windows).
-		 * In wlroots, wlr_scene_node_place_above requires shared parents.
-		 * Transients should visually stack with their parent regardless of
-		 * which layer they were initially placed in. */
-		if (c->scene->node.parent != previous->scene->node.parent) {
-			wlr_scene_node_reparent(&c->scene->node, previous->scene->node.parent);
-		}
-		wlr_scene_node_place_above(&c->scene->node, &previous->scene->node);
-	} else {
-		/* No previous client, raise to top of layer */
-		wlr_scene_node_raise_to_top(&c->scene->node);
-	}
+	while (c->stack_layer == WINDOW_LAYER_IGNORE && c->transient_for && guard-- > 0)
+		c = c->transient_for;
+
+	return c->stack_layer == WINDOW_LAYER_IGNORE
+		? WINDOW_LAYER_NORMAL : (window_layer_t)c->stack_layer;
 }
 
-/** Stack transient windows above their parent
- * Recursively stacks all transients above c
- * \param c Parent client
- * \param previous Last stacked window
- * \return Last stacked transient (or c if no transients)
- */
-static Client *
-stack_transients_above(Client *c, Client *previous)
+/** Does stack_refresh() place this client? */
+static bool
+stack_client_placed(Client *c)
 {
-	if (!c)
-		return previous;
-
-	/* Stack this client first */
-	stack_client_relative(c, previous);
-	previous = c;
-
-	/* Then stack all transients above it */
-	foreach(node, globalconf.stack) {
-		if ((*node)->transient_for == c) {
-			/* Recursively stack this transient and its transients */
-			previous = stack_transients_above(*node, previous);
-		}
-	}
+	if (!c->scene)
+		return false;
+
+	/* Unmanaged (override_redirect) X11 clients bypass the window
+	 * manager; they have no stacking attributes, so running them
+	 * through client_layer_translator() returns LyrTile and drops
+	 * Wine/Qt popups below their floating parents. mapnotify()
+	 * placed them in LyrOverlay; skip them here so the placement
+	 * survives. */
+#ifdef XWAYLAND
+	if (c->client_type == X11 && c->surface.xwayland->override_redirect)
+		return false;
+#endif
 
-	return previous;
+	return true;
 }
 
-/** Refresh stacking order
- * Ported from AwesomeWM stack.c:stack_refresh (lines 162-199)
- * Applies computed stack order to wlroots scene graph
+/** Scene layer of a drawin
+ * Layer is determined by: ontop property AND type property (AwesomeWM compat)
+ * - type="desktop" → LyrBg (below everything, like wallpaper)
+ * - type="dock" → LyrTop (above normal windows, like panels)
+ * - ontop=true → LyrOverlay (above everything except fullscreen)
+ * - otherwise → LyrWibox (above clients but below ontop)
  */
-void
-stack_refresh(void)
+static int
+drawin_scene_layer(drawin_t *drawin)
 {
-	window_layer_t layer;
-	Client *prev_in_layer[WINDOW_LAYER_COUNT];
-	int scene_layer;
+	if (drawin->type == WINDOW_TYPE_DESKTOP || drawin->type == WINDOW_TYPE_SPLASH)
+		return LyrBg;
+	if (drawin->ontop)
+		return LyrOverlay;
+	if (drawin->type == WINDOW_TYPE_DOCK)
+		return LyrTop;
+	return LyrWibox;
+}
 
-	if (!need_stack_refresh)
-		return;
+/* Nodes of one scene layer in their wanted order, bottom to top */
+static struct wlr_scene_node **order;
+static int order_len, order_size;
 
-	/* Initialize previous pointers for each layer */
-	for (layer = 0; layer < WINDOW_LAYER_COUNT; layer++) {
-		prev_in_layer[layer] = NULL;
+static void
+order_add(struct wlr_scene_node *node)
+{
+	if (order_len == order_size) {
+		order_size = order_size ? order_size * 2 : 64;
+		p_realloc(&order, order_size);
 	}
+	order[order_len++] = node;
+}
 
-	/* Process stack from bottom to top, organizing by layer */
-	foreach(node, globalconf.stack) {
-		if (!(*node) || !(*node)->scene)
-			continue;
-
-		/* Unmanaged (override_redirect) X11 clients bypass the window
-		 * manager; they have no stacking attributes, so running them
-		 * through client_layer_translator() returns LyrTile and drops
-		 * Wine/Qt popups below their floating parents. mapnotify()
-		 * placed them in LyrOverlay; skip them here so the placement
-		 * survives. */
-#ifdef XWAYLAND
-		if ((*node)->client_type == X11 &&
-		    (*node)->surface.xwayland->override_redirect)
-			continue;
-#endif
+/** Add a client and, above it, the transients that follow it
+ * \param c The client
+ * \param transients Placed clients of WINDOW_LAYER_IGNORE, in stack order
+ */
+static void
+order_add_group(Client *c, client_array_t *transients)
+{
+	order_add(&c->scene->node);
 
-		layer = client_layer_translator(*node);
+	foreach(t, *transients)
+		if ((*t)->transient_for == c)
+			order_add_group(*t, transients);
+}
 
-		/* Skip IGNORE layer (transients are handled with their parents) */
-		if (layer == WINDOW_LAYER_IGNORE)
-			continue;
+/** Put the nodes of a scene layer in order
+ * Clients go above other nodes (layer surfaces), in stack order with their
+ * transients, and drawins above the clients. Nodes are placed from the top
+ * down, each right below the next one, so only nodes that are out of place
+ * move (wlroots skips a placement that changes nothing).
+ * \param scene_layer Scene graph layer index
+ * \param transients Placed clients of WINDOW_LAYER_IGNORE, in stack order
+ */
+static void
+stack_restack_scene_layer(int scene_layer, client_array_t *transients)
+{
+	struct wlr_scene_node *next = NULL;
 
-		/* Move client to correct scene graph layer if needed */
-		scene_layer = get_scene_layer(layer);
-		if ((void *)(*node)->scene->node.parent != (void *)layers[scene_layer]) {
-			wlr_scene_node_reparent(&(*node)->scene->node, layers[scene_layer]);
-		}
+	order_len = 0;
 
-		/* Stack client and its transients */
-		prev_in_layer[layer] = stack_transients_above(*node, prev_in_layer[layer]);
+	stack_foreach(c) {
+		if (!stack_client_placed(c) || c->stack_layer == WINDOW_LAYER_IGNORE)
+			continue;
+		if (get_scene_layer(c->stack_layer) == scene_layer)
+			order_add_group(c, transients);
 	}
 
-	/* Stack drawins (wiboxes) - AwesomeWM stacks these after clients
-	 * Layer is determined by: ontop property AND type property (AwesomeWM compat)
-	 * - type="desktop" → LyrBg (below everything, like wallpaper)
-	 * - type="dock" → LyrTop (above normal windows, like panels)
-	 * - ontop=true → LyrOverlay (above everything except fullscreen)
-	 * - otherwise → LyrTile (same as normal clients) */
 	foreach(drawin, globalconf.drawins) {
 		if (!(*drawin)->scene_tree)
 			continue;
@@ -271,36 +403,84 @@ stack_refresh(void)
 		/* Lock drawins are managed by some_activate_lua_lock() /
 		 * some_promote_lock_cover() and must stay in LyrBlock while the
 		 * session is locked. Without this skip, the normal ontop/type
-		 * logic below would reparent them out of LyrBlock. */
+		 * logic would reparent them out of LyrBlock. */
 		if (session_is_locked() && some_is_lock_drawin(*drawin))
 			continue;
 
-		/* Determine layer based on type and ontop (AwesomeWM compatibility) */
-		if ((*drawin)->type == WINDOW_TYPE_DESKTOP ||
-		    (*drawin)->type == WINDOW_TYPE_SPLASH) {
-			/* Desktop/splash type goes to background layer (below clients) */
-			scene_layer = LyrBg;
-		} else if ((*drawin)->ontop) {
-			/* ontop drawins go to overlay layer */
-			scene_layer = LyrOverlay;
-		} else if ((*drawin)->type == WINDOW_TYPE_DOCK) {
-			/* Dock type goes above normal windows */
-			scene_layer = LyrTop;
-		} else {
-			/* Normal drawins go to wibox layer (above clients but below ontop) */
-			scene_layer = LyrWibox;
-		}
+		if (drawin_scene_layer(*drawin) == scene_layer)
+			order_add(&(*drawin)->scene_tree->node);
+	}
+
+	for (int i = order_len - 1; i >= 0; i--) {
+		struct wlr_scene_node *node = order[i];
+
+		/* Transients join their parent's layer, whatever layer they
+		 * were initially placed in (wlr_scene_node_place_below requires
+		 * shared parents) */
+		if ((void *)node->parent != (void *)layers[scene_layer])
+			wlr_scene_node_reparent(node, layers[scene_layer]);
 
-		/* Reparent to correct layer if needed */
-		if ((void *)(*drawin)->scene_tree->node.parent != (void *)layers[scene_layer]) {
-			wlr_scene_node_reparent(&(*drawin)->scene_tree->node, layers[scene_layer]);
+		if (next)
+			wlr_scene_node_place_below(node, next);
+		else
+			wlr_scene_node_raise_to_top(node);
+		next = node;
+	}
+}
+
+/** Refresh stacking order
+ * Ported from AwesomeWM stack.c:stack_refresh (lines 162-199)
+ * Applies the recorded stack changes to the wlroots scene graph
+ */
+void
+stack_refresh(void)
+{
+	uint32_t dirty = 0;
+	client_array_t transients;
+
+	if (!need_stack_refresh)
+		return;
+
+	if (need_full_refresh) {
+		stack_foreach(c)
+			c->stack_layer = client_layer_translator(c);
+		dirty = (1u << NUM_LAYERS) - 1;
+	} else {
+		/* The layers a pending client leaves and joins. A transient is
+		 * reordered with the client it is stacked above. */
+		foreach(c, stack_pending) {
+			if (!(*c)->in_stack)
+				continue;
+			dirty |= 1u << get_scene_layer(stack_group_layer(*c));
+			(*c)->stack_layer = client_layer_translator(*c);
 		}
+		foreach(c, stack_pending)
+			if ((*c)->in_stack)
+				dirty |= 1u << get_scene_layer(stack_group_layer(*c));
+	}
+
+	client_array_init(&transients);
+	if (dirty) {
+		stack_foreach(c)
+			if (c->stack_layer == WINDOW_LAYER_IGNORE && stack_client_placed(c))
+				client_array_append(&transients, c);
+	}
+
+	for (int l = 0; l < NUM_LAYERS; l++)
+		if (dirty & (1u << l))
+			stack_restack_scene_layer(l, &transients);
+
+	client_array_wipe(&transients);
 
-		/* Raise to top of its layer (drawins stack above clients in same layer) */
-		wlr_scene_node_raise_to_top(&(*drawin)->scene_tree->node);
+	if (x11_order_changed) {
+		ewmh_update_net_client_list_stacking();
+		x11_order_changed = false;
 	}
 
-	ewmh_update_net_client_list_stacking();
+	foreach(c, stack_pending)
+		(*c)->stack_pending = false;
+	stack_pending.len = 0;
 
+	need_full_refresh = false;
 	need_stack_refresh = false;
 }
@@ -27,7 +27,23 @@ typedef enum {
 	WINDOW_LAYER_COUNT        /* Not a real layer, just for counting */
 } window_layer_t;
 
-/* Stack management functions - uses globalconf.stack (matches AwesomeWM) */
+/* Stack management functions - uses globalconf.stack (matches AwesomeWM)
+ *
+ * globalconf.stack is an intrusive doubly-linked list, so removing, pushing
+ * and appending a client are O(1). */
+
+/** Iterate globalconf.stack from the bottom to the top.
+ * The loop body must not unlink var.
+ */
+#define stack_foreach(var) \
+	for (Client *var = globalconf.stack.head; var; var = var->stack_next)
+
+/** Iterate globalconf.stack from the top to the bottom. */
+#define stack_foreach_reverse(var) \
+	for (Client *var = globalconf.stack.tail; var; var = var->stack_prev)
+
+/** Unlink every client (hot reload, shutdown). */
+void stack_list_clear(void);
 
 /** Push the client at the beginning of the client stack.
  * \param c The client to push.
@@ -44,14 +60,33 @@ void stack_client_append(Client *c);
  */
 void stack_client_remove(Client *c);
 
-/** Mark stack as needing refresh
- * Actual restacking happens in stack_refresh()
+/** Record that a client's layer may have changed
+ * (ontop, above, below, fullscreen, type, transient_for)
+ * \param c The client
+ */
+void stack_client_changed(Client *c);
+
+/** Record a focus change: the layer of fullscreen clients depends on the
+ * focused client and its screen.
+ */
+void stack_focus_changed(void);
+
+/** Record that a client moved to another screen: the layer of a fullscreen
+ * client depends on the screen of the focused client.
+ * \param c The client
+ */
+void stack_client_screen_changed(Client *c);
+
+/** Mark the whole stack as needing refresh
+ * Recomputes every client's layer and restacks every layer, drawins
+ * included. Actual restacking happens in stack_refresh()
  */
 void stack_windows(void);
 
 /** Refresh stacking order
- * Applies computed stack order to wlroots scene graph
- * Call after property changes (ontop, above, below, fullscreen, focus)
+ * Applies the recorded changes to the wlroots scene graph, reordering only
+ * the scene layers they touched. _NET_CLIENT_LIST_STACKING is only
+ * rewritten when the order of X11 clients changed.
  */
 void stack_refresh(void);
 
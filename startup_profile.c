@@ -0,0 +1,331 @@
+/*
+ * startup_profile.c - Startup and hot-reload phase profiler
+ *
+ * Everything here is a no-op unless --startup-profile was given. Records
+ * are appended to flat arrays in start order together with their nesting
+ * depth, which is all the report needs to print an indented tree.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <glib.h>
+#include <lua.h>
+#include <lauxlib.h>
+
+#include "startup_profile.h"
+
+/** Modules slower than this (inclusive) are listed in the report */
+#define STARTUP_PROFILE_MODULE_MIN_NS 500000ULL
+
+typedef struct {
+	const char *name;
+	int depth;
+	uint64_t start_ns;
+	uint64_t end_ns;
+} startup_phase_t;
+
+typedef struct {
+	char *name;
+	int depth;
+	/** Lua call depth of the require() call, to drop frames of failed loads */
+	int level;
+	uint64_t start_ns;
+	uint64_t inclusive_ns;
+	uint64_t child_ns;
+	int64_t start_bytes;
+	int64_t bytes;
+} startup_module_t;
+
+typedef struct {
+	char *name;
+	uint64_t present_ns;
+} startup_output_t;
+
+bool startup_profile_enabled = false;
+
+static uint64_t origin_ns;
+static GArray *phases;      /* startup_phase_t */
+static GArray *phase_stack; /* int, index into phases */
+static GArray *modules;     /* startup_module_t */
+static GArray *module_stack;/* int, index into modules */
+static GArray *outputs;     /* startup_output_t */
+static bool ready;
+static bool reported;
+
+static uint64_t
+startup_profile_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void
+startup_module_clear(gpointer data)
+{
+	g_free(((startup_module_t *)data)->name);
+}
+
+static void
+startup_output_clear(gpointer data)
+{
+	g_free(((startup_output_t *)data)->name);
+}
+
+void
+startup_profile_enable(void)
+{
+	startup_profile_enabled = true;
+	phases = g_array_new(FALSE, FALSE, sizeof(startup_phase_t));
+	phase_stack = g_array_new(FALSE, FALSE, sizeof(int));
+	modules = g_array_new(FALSE, FALSE, sizeof(startup_module_t));
+	g_array_set_clear_func(modules, startup_module_clear);
+	module_stack = g_array_new(FALSE, FALSE, sizeof(int));
+	outputs = g_array_new(FALSE, FALSE, sizeof(startup_output_t));
+	g_array_set_clear_func(outputs, startup_output_clear);
+	origin_ns = startup_profile_now();
+}
+
+void
+startup_profile_reset(void)
+{
+	if (!startup_profile_enabled)
+		return;
+
+	g_array_set_size(phases, 0);
+	g_array_set_size(phase_stack, 0);
+	g_array_set_size(modules, 0);
+	g_array_set_size(module_stack, 0);
+	g_array_set_size(outputs, 0);
+	ready = false;
+	reported = false;
+	origin_ns = startup_profile_now();
+}
+
+void
+startup_profile_begin(const char *name)
+{
+	startup_phase_t phase;
+	int index;
+
+	if (!startup_profile_enabled)
+		return;
+
+	phase.name = name;
+	phase.depth = phase_stack->len;
+	phase.start_ns = startup_profile_now();
+	phase.end_ns = 0;
+
+	index = phases->len;
+	g_array_append_val(phases, phase);
+	g_array_append_val(phase_stack, index);
+}
+
+void
+startup_profile_end(void)
+{
+	if (!startup_profile_enabled || phase_stack->len == 0)
+		return;
+
+	int index = g_array_index(phase_stack, int, phase_stack->len - 1);
+	g_array_index(phases, startup_phase_t, index).end_ns = startup_profile_now();
+	g_array_set_size(phase_stack, phase_stack->len - 1);
+}
+
+/* ========================================================================
+ * require() wrapper
+ * ======================================================================== */
+
+static int64_t
+startup_profile_heap_bytes(lua_State *L)
+{
+	return (int64_t)lua_gc(L, LUA_GCCOUNT, 0) * 1024 + lua_gc(L, LUA_GCCOUNTB, 0);
+}
+
+static int
+startup_profile_call_level(lua_State *L)
+{
+	lua_Debug ar;
+	int level = 0;
+
+	while (lua_getstack(L, level, &ar))
+		level++;
+	return level;
+}
+
+/** Pop frames of require() calls that raised instead of returning */
+static void
+startup_profile_unwind(int level)
+{
+	while (module_stack->len > 0) {
+		int index = g_array_index(module_stack, int, module_stack->len - 1);
+		if (g_array_index(modules, startup_module_t, index).level < level)
+			break;
+		g_array_set_size(module_stack, module_stack->len - 1);
+	}
+}
+
+static int
+startup_profile_require(lua_State *L)
+{
+	const char *name = luaL_checkstring(L, 1);
+	int nargs = lua_gettop(L);
+	startup_module_t module;
+	bool loaded;
+	int index, level;
+
+	lua_getfield(L, LUA_REGISTRYINDEX, "_LOADED");
+	lua_getfield(L, -1, name);
+	loaded = lua_toboolean(L, -1);
+	lua_pop(L, 2);
+
+	lua_pushvalue(L, lua_upvalueindex(1));
+	lua_insert(L, 1);
+
+	/* Only actual loads are interesting */
+	if (loaded) {
+		lua_call(L, nargs, LUA_MULTRET);
+		return lua_gettop(L);
+	}
+
+	level = startup_profile_call_level(L);
+	startup_profile_unwind(level);
+
+	module.name = g_strdup(name);
+	module.depth = module_stack->len;
+	module.level = level;
+	module.child_ns = 0;
+	module.bytes = 0;
+	module.inclusive_ns = 0;
+	module.start_bytes = startup_profile_heap_bytes(L);
+	module.start_ns = startup_profile_now();
+
+	index = modules->len;
+	g_array_append_val(modules, module);
+	g_array_append_val(module_stack, index);
+
+	/* Not a pcall: errors must keep their traceback. A failed load leaves
+	 * its frame behind, dropped by startup_profile_unwind(). */
+	lua_call(L, nargs, LUA_MULTRET);
+
+	startup_module_t *m = &g_array_index(modules, startup_module_t, index);
+	m->inclusive_ns = startup_profile_now() - m->start_ns;
+	m->bytes = startup_profile_heap_bytes(L) - m->start_bytes;
+	startup_profile_unwind(level);
+
+	if (module_stack->len > 0) {
+		int parent = g_array_index(module_stack, int, module_stack->len - 1);
+		g_array_index(modules, startup_module_t, parent).child_ns += m->inclusive_ns;
+	}
+
+	return lua_gettop(L);
+}
+
+void
+startup_profile_install_require(lua_State *L)
+{
+	if (!startup_profile_enabled)
+		return;
+
+	lua_getglobal(L, "require");
+	lua_pushcclosure(L, startup_profile_require, 1);
+	lua_setglobal(L, "require");
+}
+
+/* ========================================================================
+ * Report
+ * ======================================================================== */
+
+static double
+ms(uint64_t ns)
+{
+	return (double)ns / 1e6;
+}
+
+static GString *
+startup_profile_format(void)
+{
+	GString *out = g_string_new("=== startup profile ===\n");
+	guint i;
+
+	g_string_append(out, "phases (start, duration):\n");
+	for (i = 0; i < phases->len; i++) {
+		startup_phase_t *p = &g_array_index(phases, startup_phase_t, i);
+		g_string_append_printf(out, "  %9.1f ms %*s%s", ms(p->start_ns - origin_ns),
+		                       p->depth * 2, "", p->name);
+		if (p->end_ns)
+			g_string_append_printf(out, "  %.1f ms\n", ms(p->end_ns - p->start_ns));
+		else
+			g_string_append(out, "  (running)\n");
+	}
+
+	g_string_append_printf(out, "modules slower than %.1f ms (self, inclusive, heap):\n",
+	                       ms(STARTUP_PROFILE_MODULE_MIN_NS));
+	for (i = 0; i < modules->len; i++) {
+		startup_module_t *m = &g_array_index(modules, startup_module_t, i);
+		if (m->inclusive_ns < STARTUP_PROFILE_MODULE_MIN_NS)
+			continue;
+		g_string_append_printf(out, "  %8.1f %8.1f ms %+8.0f KiB %*s%s\n",
+		                       ms(m->inclusive_ns - MIN(m->child_ns, m->inclusive_ns)),
+		                       ms(m->inclusive_ns), (double)m->bytes / 1024.0,
+		                       m->depth * 2, "", m->name);
+	}
+
+	g_string_append(out, "first present:\n");
+	for (i = 0; i < outputs->len; i++) {
+		startup_output_t *o = &g_array_index(outputs, startup_output_t, i);
+		g_string_append_printf(out, "  %9.1f ms %s\n", ms(o->present_ns - origin_ns), o->name);
+	}
+
+	return out;
+}
+
+void
+startup_profile_ready(void)
+{
+	if (startup_profile_enabled)
+		ready = true;
+}
+
+void
+startup_profile_output_presented(const char *name, int noutputs)
+{
+	startup_output_t output;
+	guint i;
+
+	if (!startup_profile_enabled || reported)
+		return;
+
+	for (i = 0; i < outputs->len; i++)
+		if (strcmp(g_array_index(outputs, startup_output_t, i).name, name) == 0)
+			break;
+
+	/* Frames presented before rc.lua ran don't show the user's desktop */
+	if (i == outputs->len && ready) {
+		output.name = g_strdup(name);
+		output.present_ns = startup_profile_now();
+		g_array_append_val(outputs, output);
+	}
+
+	if (ready && (int)outputs->len >= noutputs) {
+		GString *report = startup_profile_format();
+		fputs(report->str, stderr);
+		g_string_free(report, TRUE);
+		reported = true;
+	}
+}
+
+int
+luaA_awesome_startup_profile(lua_State *L)
+{
+	if (!startup_profile_enabled) {
+		lua_pushnil(L);
+		return 1;
+	}
+
+	GString *report = startup_profile_format();
+	lua_pushlstring(L, report->str, report->len);
+	g_string_free(report, TRUE);
+	return 1;
+}
@@ -0,0 +1,41 @@
+/*
+ * startup_profile.h - Startup and hot-reload phase profiler
+ *
+ * Opt-in with `somewm --startup-profile`. Records nested phase timings
+ * (wlroots init, Lua init, backend start, rc.lua, ...), per-module
+ * require() self/inclusive time and Lua heap growth, and the time to the
+ * first presented frame on every output. The report is printed to stderr
+ * once every output has presented after somewm::ready, and is available
+ * through awesome.startup_profile() / `somewm-client startup profile`.
+ */
+#ifndef STARTUP_PROFILE_H
+#define STARTUP_PROFILE_H
+
+#include <stdbool.h>
+#include <lua.h>
+
+extern bool startup_profile_enabled;
+
+/** Turn profiling on; timestamps are relative to this call */
+void startup_profile_enable(void);
+
+/** Drop recorded data and restart the clock (hot reload) */
+void startup_profile_reset(void);
+
+/** Phases nest: every begin must be matched by an end */
+void startup_profile_begin(const char *name);
+void startup_profile_end(void);
+
+/** Wrap the global require() of L to time module loading */
+void startup_profile_install_require(lua_State *L);
+
+/** The compositor emitted somewm::ready */
+void startup_profile_ready(void);
+
+/** An output presented a frame; noutputs is the number of enabled outputs */
+void startup_profile_output_presented(const char *name, int noutputs);
+
+/** awesome.startup_profile(): the report as a string, nil when disabled */
+int luaA_awesome_startup_profile(lua_State *L);
+
+#endif /* STARTUP_PROFILE_H */
@@ -168,14 +168,31 @@ static const struct wlr_buffer_impl systray_icon_buffer_impl = {
 	.end_data_ptr_access = systray_icon_buffer_end_data_ptr_access,
 };
 
-/** Create a wlr_buffer from a cairo surface */
+/* Scene buffers are cached on the icon surface itself. Icon surfaces are
+ * shared between items with identical pixmaps (see objects/systray.c), so
+ * an icon is copied into a buffer once and every redraw, on whichever
+ * drawin hosts the tray, reuses the same buffer. The buffer keeps the
+ * pixmap's own resolution; the scene node scales it to the tray size, so
+ * icons stay sharp on scaled outputs. */
+static cairo_user_data_key_t systray_scene_buffer_key;
+
+static void
+systray_scene_buffer_release(void *data)
+{
+	struct systray_icon_buffer *buffer = data;
+	/* Destroyed once no scene node holds it any more */
+	wlr_buffer_drop(&buffer->base);
+}
+
+/** Get a buffer with the pixels of a cairo surface.
+ * The buffer is owned by the surface; scene nodes take their own lock. */
 static struct wlr_buffer *
-systray_buffer_from_cairo(cairo_surface_t *surface)
+systray_scene_buffer_get(cairo_surface_t *surface)
 {
 	struct systray_icon_buffer *buffer;
-	int width, height;
-	size_t stride, size;
 	unsigned char *src_data;
+	int width, height;
+	size_t stride;
 
 	if (!surface || cairo_surface_status(surface) != CAIRO_STATUS_SUCCESS)
 		return NULL;
@@ -183,11 +200,15 @@ systray_buffer_from_cairo(cairo_surface_t *surface)
 	if (cairo_image_surface_get_format(surface) != CAIRO_FORMAT_ARGB32)
 		return NULL;
 
+	buffer = cairo_surface_get_user_data(surface, &systray_scene_buffer_key);
+	if (buffer)
+		return &buffer->base;
+
+	cairo_surface_flush(surface);
 	width = cairo_image_surface_get_width(surface);
 	height = cairo_image_surface_get_height(surface);
 	stride = (size_t)cairo_image_surface_get_stride(surface);
 	src_data = cairo_image_surface_get_data(surface);
-
 	if (width <= 0 || height <= 0 || !src_data)
 		return NULL;
 
@@ -195,20 +216,24 @@ systray_buffer_from_cairo(cairo_surface_t *surface)
 	if (!buffer)
 		return NULL;
 
-	size = stride * (size_t)height;
-	buffer->data = malloc(size);
+	buffer->data = malloc(stride * (size_t)height);
 	if (!buffer->data) {
 		free(buffer);
 		return NULL;
 	}
-
-	memcpy(buffer->data, src_data, size);
+	memcpy(buffer->data, src_data, stride * (size_t)height);
 	buffer->width = width;
 	buffer->height = height;
 	buffer->stride = stride;
 
 	wlr_buffer_init(&buffer->base, &systray_icon_buffer_impl, width, height);
 
+	if (cairo_surface_set_user_data(surface, &systray_scene_buffer_key, buffer,
+	                                systray_scene_buffer_release) != CAIRO_STATUS_SUCCESS) {
+		wlr_buffer_drop(&buffer->base);
+		return NULL;
+	}
+
 	return &buffer->base;
 }
 
@@ -279,7 +304,7 @@ systray_render_icons(drawin_t *drawin)
 		}
 
 		if (item->icon) {
-			struct wlr_buffer *icon_buffer = systray_buffer_from_cairo(item->icon);
+			struct wlr_buffer *icon_buffer = systray_scene_buffer_get(item->icon);
 			if (icon_buffer) {
 				struct wlr_scene_buffer *scene_buf;
 				scene_buf = wlr_scene_buffer_create(globalconf.systray.scene_tree,
@@ -287,11 +312,9 @@ systray_render_icons(drawin_t *drawin)
 				if (scene_buf) {
 					wlr_scene_node_set_position(&scene_buf->node, pos_x, pos_y);
 					scene_buf->node.data = drawin->drawable;
-					if (item->icon_width != base_size || item->icon_height != base_size) {
+					if (icon_buffer->width != base_size || icon_buffer->height != base_size)
 						wlr_scene_buffer_set_dest_size(scene_buf, base_size, base_size);
-					}
 				}
-				wlr_buffer_drop(icon_buffer);
 			}
 		} else {
 			float color[4] = {0.5f, 0.5f, 0.8f, 1.0f};
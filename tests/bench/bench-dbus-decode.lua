@@ -0,0 +1,113 @@
+-- Benchmark: D-Bus Message Decoding
+--
+-- Emits signals with StatusNotifierItem / notification shaped payloads on
+-- the session bus and receives them back through the `dbus` module, so each
+-- message goes through dbus.c's signature-directed decoder:
+--   pixmap: (a(iiay))  - SNI IconPixmap, 4 sizes up to 64x64 ARGB
+--   hints:  (a{sv})    - notification hints with nested variants
+--
+-- Meant to run against a private bus (tests/bench/bench-dbus-runner.sh
+-- starts `dbus-daemon --session` and a headless compositor), but works on a
+-- live session bus too.
+--
+-- Run: somewm-client eval "dofile('tests/bench/bench-dbus-decode.lua')"
+-- Then poll: somewm-client eval "return _bench_results.dbus_decode or 'PENDING'"
+
+local helpers = dofile("tests/bench/bench-helpers.lua")
+local lgi = require("lgi")
+local Gio = lgi.Gio
+local GLib = lgi.GLib
+
+local N = 500
+local IFACE = "org.somewm.Bench.Decode"
+local PATH = "/org/somewm/Bench"
+
+_G._bench_results = _G._bench_results or {}
+_G._bench_results.dbus_decode = nil
+
+if not dbus then
+    return "SKIP: somewm built without D-Bus"
+end
+
+local bus = Gio.bus_get_sync(Gio.BusType.SESSION)
+if not bus then
+    return "SKIP: no session bus"
+end
+
+local function pixmap(size)
+    return { size, size, string.rep("\255\0\128\255", size * size) }
+end
+
+local payloads = {
+    pixmap = GLib.Variant("(a(iiay))", {{
+        pixmap(16), pixmap(22), pixmap(32), pixmap(64),
+    }}),
+    hints = GLib.Variant("(a{sv})", {{
+        urgency = GLib.Variant("y", 1),
+        category = GLib.Variant("s", "im.received"),
+        ["desktop-entry"] = GLib.Variant("s", "org.example.Chat"),
+        transient = GLib.Variant("b", true),
+        ["x-position"] = GLib.Variant("i", 1200),
+        ["y-position"] = GLib.Variant("i", 40),
+        ["image-data"] = GLib.Variant("(iiibiiay)", {
+            48, 48, 48 * 4, true, 8, 4, string.rep("\0\64\128\255", 48 * 48),
+        }),
+    }}),
+}
+local order = { "pixmap", "hints" }
+
+local results = {}
+local member_index = 0
+local received = 0
+local start
+
+dbus.add_match("session", "type='signal',interface='" .. IFACE .. "'")
+
+local run_next
+
+local function on_signal(data)
+    if data.interface ~= IFACE then return end
+    received = received + 1
+    if received == N then
+        local elapsed = os.clock() - start
+        local result = {
+            name = order[member_index],
+            iterations = N,
+            elapsed = elapsed,
+            ops_per_sec = N / elapsed,
+        }
+        if awesome.bench_stats then
+            result.bench_stats = awesome.bench_stats()
+        end
+        table.insert(results, result)
+        run_next()
+    end
+end
+
+dbus.connect_signal(IFACE, on_signal)
+
+run_next = function()
+    member_index = member_index + 1
+    local name = order[member_index]
+    if not name then
+        dbus.disconnect_signal(IFACE, on_signal)
+        dbus.remove_match("session", "type='signal',interface='" .. IFACE .. "'")
+        _G._bench_results.dbus_decode = helpers.format_results("dbus-decode", results, {
+            signals_per_payload = N,
+        })
+        return
+    end
+
+    if awesome.bench_reset then awesome.bench_reset() end
+    collectgarbage("collect")
+    received = 0
+    start = os.clock()
+    for _ = 1, N do
+        bus:emit_signal(nil, PATH, IFACE, name, payloads[name])
+    end
+    bus:flush_sync()
+end
+
+run_next()
+
+return "ASYNC dbus-decode started (" .. N .. " signals x " .. #order .. " payloads)"
@@ -0,0 +1,96 @@
+#!/usr/bin/env bash
+#
+# D-Bus decoding benchmark runner.
+# Starts a private `dbus-daemon --session` and a headless compositor bound to
+# it, then runs bench-dbus-decode.lua so results don't depend on whatever
+# else is talking on the user's session bus.
+#
+# Usage: tests/bench/bench-dbus-runner.sh
+# Or:    make bench-dbus
+
+set -e
+
+export LC_NUMERIC=C
+
+SOMEWM="${SOMEWM:-./somewm}"
+SOMEWM_CLIENT="${SOMEWM_CLIENT:-./somewm-client}"
+
+cd "$(dirname "$0")/../.."
+ROOT_DIR="$PWD"
+
+if ! command -v dbus-daemon > /dev/null; then
+    echo "Error: dbus-daemon not found" >&2
+    exit 1
+fi
+
+TMP_DIR=$(mktemp -d)
+LOG="$TMP_DIR/somewm.log"
+TEST_RUNTIME_DIR="$TMP_DIR/runtime"
+mkdir -p "$TEST_RUNTIME_DIR"
+chmod 700 "$TEST_RUNTIME_DIR"
+
+TEST_CONFIG_DIR="$TMP_DIR/config/somewm"
+mkdir -p "$TEST_CONFIG_DIR"
+cat > "$TEST_CONFIG_DIR/rc.lua" << 'RCEOF'
+local awful = require("awful")
+screen.connect_signal("request::desktop_decoration", function(s)
+    awful.tag({ "1" }, s, awful.layout.suit.tile)
+end)
+RCEOF
+
+export WLR_BACKENDS=headless
+export WLR_RENDERER=pixman
+export WLR_WL_OUTPUTS=1
+export NO_AT_BRIDGE=1
+export XDG_RUNTIME_DIR="$TEST_RUNTIME_DIR"
+export XDG_CONFIG_HOME="$TMP_DIR/config"
+export LUA_PATH="$ROOT_DIR/lua/?.lua;$ROOT_DIR/lua/?/init.lua;;"
+
+# Private session bus
+DBUS_INFO=$(dbus-daemon --session --fork --nopidfile --print-address=1 --print-pid=1)
+export DBUS_SESSION_BUS_ADDRESS=$(echo "$DBUS_INFO" | sed -n 1p)
+DBUS_PID=$(echo "$DBUS_INFO" | sed -n 2p)
+
+cleanup() {
+    if [ -n "$SOMEWM_PID" ] && kill -0 "$SOMEWM_PID" 2>/dev/null; then
+        kill "$SOMEWM_PID" 2>/dev/null
+        wait "$SOMEWM_PID" 2>/dev/null || true
+    fi
+    [ -n "$DBUS_PID" ] && kill "$DBUS_PID" 2>/dev/null || true
+    rm -rf "$TMP_DIR"
+}
+trap cleanup EXIT
+
+# Start compositor
+"$SOMEWM" > "$LOG" 2>&1 &
+SOMEWM_PID=$!
+
+# Wait for IPC
+for i in $(seq 1 30); do
+    SOCKET=$(ls "$TEST_RUNTIME_DIR"/wayland-* 2>/dev/null | head -1)
+    if [ -n "$SOCKET" ]; then break; fi
+    sleep 0.1
+done
+export WAYLAND_DISPLAY=$(basename "$SOCKET")
+
+for i in $(seq 1 20); do
+    if "$SOMEWM_CLIENT" eval "return 'ready'" 2>/dev/null | grep -q ready; then break; fi
+    sleep 0.1
+done
+
+echo "=== D-Bus decode (private bus $DBUS_SESSION_BUS_ADDRESS) ==="
+"$SOMEWM_CLIENT" eval "return dofile('tests/bench/bench-dbus-decode.lua')" 2>/dev/null
+
+for i in $(seq 1 600); do
+    OUTPUT=$("$SOMEWM_CLIENT" eval "return _bench_results.dbus_decode or 'PENDING'" 2>/dev/null)
+    if ! echo "$OUTPUT" | grep -q PENDING; then break; fi
+    sleep 0.1
+done
+
+echo "$OUTPUT" | sed '/^OK$/d'
+
+# Save to file if requested
+if [ -n "$OUTPUT_FILE" ]; then
+    echo "$OUTPUT" | sed -n '/^---JSON-START---$/,/^---JSON-END---$/{/^---JSON/d;p;}' > "$OUTPUT_FILE"
+    echo "Saved to: $OUTPUT_FILE"
+fi
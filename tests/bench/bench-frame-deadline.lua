@@ -0,0 +1,57 @@
+-- Benchmark: Deferred render deadline
+--
+-- Makes every refresh cost BUSY_MS of Lua work, so the refresh the deferred
+-- render runs just before its commit (see rendermon_timer()) is a large part
+-- of the frame. The render time the frame scheduler budgets for has to
+-- include it, or the deadline lands too close to vblank and every deferred
+-- frame misses: deferred_render_min_us must be at least the Lua work.
+-- Outputs without a fixed refresh cycle (headless) never defer and are
+-- only reported.
+--
+-- Run: somewm-client eval "dofile('tests/bench/bench-frame-deadline.lua')"
+-- Then poll: somewm-client eval "return _bench_results.frame_deadline or 'PENDING'"
+
+local helpers = dofile("tests/bench/bench-helpers.lua")
+
+local N = 300
+local BUSY_MS = 3
+
+_G._bench_results = _G._bench_results or {}
+_G._bench_results.frame_deadline = nil
+
+local function busy()
+    local stop = os.clock() + BUSY_MS / 1000
+    while os.clock() < stop do end
+end
+
+awesome.connect_signal("refresh", busy)
+
+helpers.timed_async("frame-deadline", function() end, N, function(result)
+    awesome.disconnect_signal("refresh", busy)
+
+    local stats = result.bench_stats or {}
+    local outputs, failures = {}, {}
+    for name, o in pairs(stats.outputs or {}) do
+        outputs[name] = {
+            deferred_frames = o.deferred_frames,
+            missed_vblanks = o.missed_vblanks,
+            deferred_render_min_us = o.deferred_render_min_us,
+        }
+        if o.deferred_frames > 0 and o.deferred_render_min_us < BUSY_MS * 1000 then
+            failures[#failures + 1] = string.format(
+                "%s: deferred render %.1fus < %d ms of refresh work",
+                name, o.deferred_render_min_us, BUSY_MS)
+        end
+    end
+
+    local out = helpers.format_results("frame-deadline", {result}, {
+        busy_ms = BUSY_MS,
+        outputs = outputs,
+    })
+    if #failures > 0 then
+        out = "FAILED: " .. table.concat(failures, "; ") .. "\n" .. out
+    end
+    _G._bench_results.frame_deadline = out
+end)
+
+return "ASYNC frame-deadline started (" .. N .. " iterations)"
@@ -0,0 +1,39 @@
+-- Benchmark: Frame-paced Lua GC
+--
+-- Allocates short-lived garbage inside the refresh cycle, the way widget
+-- redraws and layout callbacks do, so the collector has debt to pay every
+-- frame. Compare refresh_p99_us and stages.gc between builds: collection
+-- should show up in the gc stage (idle time after the refresh), not in
+-- the refresh itself.
+--
+-- Run: somewm-client eval "dofile('tests/bench/bench-gc-pacing.lua')"
+-- Then poll: somewm-client eval "return _bench_results.gc_pacing or 'PENDING'"
+
+local helpers = dofile("tests/bench/bench-helpers.lua")
+
+local N = 500
+local TABLES_PER_FRAME = 2000
+
+_G._bench_results = _G._bench_results or {}
+_G._bench_results.gc_pacing = nil
+
+local sink
+
+helpers.timed_async("gc-pacing", function(i)
+    local garbage = {}
+    for j = 1, TABLES_PER_FRAME do
+        garbage[j] = { x = j, y = i, label = "w" .. j }
+    end
+    sink = garbage
+end, N, function(result)
+    sink = nil
+    local stats = result.bench_stats or {}
+    _G._bench_results.gc_pacing = helpers.format_results("gc-pacing", {result}, {
+        tables_per_frame = TABLES_PER_FRAME,
+        refresh_p99_us = stats.refresh_p99_us,
+        gc_stage = stats.stages and stats.stages.gc,
+        lua_gc = stats.lua_gc,
+    })
+end)
+
+return "ASYNC gc-pacing started (" .. N .. " iterations)"
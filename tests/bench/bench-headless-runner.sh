@@ -0,0 +1,244 @@
+#!/usr/bin/env bash
+#
+# Self-contained benchmark harness.
+# Starts a headless compositor with a fixed config, opens synthetic clients
+# (test-content-pattern-client, and test-dmabuf-pattern-client when built),
+# runs a fixed set of scenarios through run-all.sh and compares the results
+# with the branch baseline. Results don't depend on the user's session.
+#
+# Options:
+#   BENCH_CLIENTS=N:        wl_shm clients to open (default: 8)
+#   BENCH_DMABUF_CLIENTS=N: DMA-BUF clients to open (default: 2 if built)
+#   BENCH_OUTPUTS=N:        Headless outputs (default: 1)
+#   BENCH_BASELINE=dir:     Results to compare with
+#                           (default: results/baselines/<branch>, if any)
+#   BENCH_THRESHOLDS=x:     Regression threshold in percent, or a thresholds
+#                           file (default: tests/bench/bench-thresholds.lua)
+#   RUNS=N:                 Runs per scenario (default: 3)
+#   RESULTS_DIR=dir:        Where to write the JSON
+#
+# The JSON has the layout of `make bench-json`, so the run can be saved as
+# the baseline with bench-save-baseline.sh. Exits non-zero if a scenario
+# failed or a result regressed over its threshold.
+#
+# Usage: tests/bench/bench-headless-runner.sh
+# Or:    meson test -C build-bench --suite bench
+
+set -e
+
+export LC_NUMERIC=C
+
+SOMEWM="${SOMEWM:-./somewm}"
+SOMEWM_CLIENT="${SOMEWM_CLIENT:-./somewm-client}"
+BENCH_CLIENTS=${BENCH_CLIENTS:-8}
+BENCH_OUTPUTS=${BENCH_OUTPUTS:-1}
+RUNS=${RUNS:-3}
+
+cd "$(dirname "$0")/../.."
+ROOT_DIR="$PWD"
+
+# The client binaries are built next to the compositor
+BUILD_DIR=$(cd "$(dirname "$SOMEWM")" && pwd)
+SOMEWM=$(cd "$(dirname "$SOMEWM")" && pwd)/$(basename "$SOMEWM")
+SOMEWM_CLIENT=$(cd "$(dirname "$SOMEWM_CLIENT")" && pwd)/$(basename "$SOMEWM_CLIENT")
+PATTERN_CLIENT="${PATTERN_CLIENT:-$BUILD_DIR/test-content-pattern-client}"
+DMABUF_CLIENT="${DMABUF_CLIENT:-$BUILD_DIR/test-dmabuf-pattern-client}"
+
+if [ -x "$DMABUF_CLIENT" ]; then
+    BENCH_DMABUF_CLIENTS=${BENCH_DMABUF_CLIENTS:-2}
+else
+    BENCH_DMABUF_CLIENTS=0
+fi
+
+BENCH_THRESHOLDS="${BENCH_THRESHOLDS:-$ROOT_DIR/tests/bench/bench-thresholds.lua}"
+
+# Fixed scenarios: the async ones go through the full refresh cycle with
+# the synthetic clients, the others only need the Lua state.
+SCENARIOS=(
+    bench-geometry-storm
+    bench-client-churn
+    bench-focus-cycle
+    bench-tag-switch
+    bench-wibox-relayout
+    bench-tasklist-update
+    bench-rule-matching
+)
+
+for bin in "$SOMEWM" "$SOMEWM_CLIENT" "$PATTERN_CLIENT"; do
+    if [ ! -x "$bin" ]; then
+        echo "Error: $bin not found" >&2
+        echo "Run 'make build-bench' first" >&2
+        exit 1
+    fi
+done
+
+if [ -z "$RESULTS_DIR" ]; then
+    GIT_COMMIT=$(git rev-parse --short HEAD 2>/dev/null || echo "unknown")
+    RESULTS_DIR="$ROOT_DIR/tests/bench/results/$(date +%Y%m%d-%H%M%S)-${GIT_COMMIT}-headless"
+fi
+
+TMP_DIR=$(mktemp -d)
+LOG="$TMP_DIR/somewm.log"
+TEST_RUNTIME_DIR="$TMP_DIR/runtime"
+mkdir -p "$TEST_RUNTIME_DIR"
+chmod 700 "$TEST_RUNTIME_DIR"
+
+TEST_CONFIG_DIR="$TMP_DIR/config/somewm"
+mkdir -p "$TEST_CONFIG_DIR"
+cat > "$TEST_CONFIG_DIR/rc.lua" << 'RCEOF'
+local awful = require("awful")
+local wibox = require("wibox")
+require("awful.autofocus")
+
+awful.layout.layouts = { awful.layout.suit.tile }
+
+screen.connect_signal("request::desktop_decoration", function(s)
+    awful.tag({ "1", "2", "3", "4" }, s, awful.layout.suit.tile)
+
+    s.mywibox = awful.wibar { position = "top", screen = s }
+    s.mywibox:setup {
+        layout = wibox.layout.align.horizontal,
+        awful.widget.taglist { screen = s, filter = awful.widget.taglist.filter.all },
+        awful.widget.tasklist { screen = s, filter = awful.widget.tasklist.filter.currenttags },
+    }
+end)
+
+awesome.connect_signal("debug::error", function(err)
+    io.stderr:write("ERROR: " .. tostring(err) .. "\n")
+end)
+RCEOF
+
+export WLR_BACKENDS=headless
+export WLR_RENDERER=pixman
+export WLR_WL_OUTPUTS=1
+export NO_AT_BRIDGE=1
+export GDK_SCALE=1
+export XDG_RUNTIME_DIR="$TEST_RUNTIME_DIR"
+export XDG_CONFIG_HOME="$TMP_DIR/config"
+export XDG_CACHE_HOME="$TMP_DIR/cache"
+export LUA_PATH="$ROOT_DIR/lua/?.lua;$ROOT_DIR/lua/?/init.lua;;"
+
+CLIENT_PIDS=()
+
+cleanup() {
+    local exit_code=$?
+
+    for pid in "${CLIENT_PIDS[@]}"; do
+        kill "$pid" 2>/dev/null || true
+        rm -f "/tmp/test-content-pattern-$pid.scale"
+    done
+    if [ -n "$SOMEWM_PID" ] && kill -0 "$SOMEWM_PID" 2>/dev/null; then
+        kill "$SOMEWM_PID" 2>/dev/null
+        wait "$SOMEWM_PID" 2>/dev/null || true
+    fi
+    if [ "$exit_code" != 0 ] && [ -f "$LOG" ]; then
+        echo "Last 30 lines of log:" >&2
+        tail -30 "$LOG" >&2
+    fi
+    rm -rf "$TMP_DIR"
+
+    return $exit_code
+}
+trap cleanup EXIT INT TERM
+
+eval_lua() {
+    "$SOMEWM_CLIENT" eval "$1" 2>/dev/null | sed '/^OK$/d'
+}
+
+# Start compositor
+"$SOMEWM" > "$LOG" 2>&1 &
+SOMEWM_PID=$!
+
+for i in $(seq 1 100); do
+    SOCKET=$(ls "$TEST_RUNTIME_DIR"/wayland-* 2>/dev/null | grep -v '\.lock$' | head -1)
+    if [ -n "$SOCKET" ]; then break; fi
+    sleep 0.1
+done
+if [ -z "$SOCKET" ]; then
+    echo "Error: compositor did not start" >&2
+    exit 1
+fi
+export WAYLAND_DISPLAY=$(basename "$SOCKET")
+
+for i in $(seq 1 50); do
+    if eval_lua "return 'ready'" | grep -q ready; then break; fi
+    sleep 0.1
+done
+
+for i in $(seq 2 "$BENCH_OUTPUTS"); do
+    eval_lua "return awesome._test_add_output(1920, 1080)" > /dev/null
+done
+
+# Synthetic clients
+for i in $(seq 1 "$BENCH_CLIENTS"); do
+    "$PATTERN_CLIENT" >> "$LOG" 2>&1 &
+    CLIENT_PIDS+=($!)
+done
+for i in $(seq 1 "$BENCH_DMABUF_CLIENTS"); do
+    "$DMABUF_CLIENT" >> "$LOG" 2>&1 &
+    CLIENT_PIDS+=($!)
+done
+
+# Wait until every client that is still running is managed. DMA-BUF
+# clients exit without a usable render node; the run goes on without them.
+for i in $(seq 1 100); do
+    RUNNING=0
+    for pid in "${CLIENT_PIDS[@]}"; do
+        kill -0 "$pid" 2>/dev/null && RUNNING=$((RUNNING + 1))
+    done
+    MANAGED=$(eval_lua "return #client.get()")
+    if [ "$MANAGED" = "$RUNNING" ] && [ "$RUNNING" -gt 0 ]; then break; fi
+    sleep 0.1
+done
+
+if [ "$MANAGED" != "$RUNNING" ] || [ "$RUNNING" = 0 ]; then
+    echo "Error: $MANAGED of $RUNNING synthetic clients managed" >&2
+    exit 1
+fi
+
+echo "=== Headless harness: $MANAGED clients, $BENCH_OUTPUTS output(s) ==="
+echo ""
+
+JSON=1 RUNS="$RUNS" RESULTS_DIR="$RESULTS_DIR" \
+    SESSION_NAME="headless compositor" \
+    SOMEWM_CLIENT="$SOMEWM_CLIENT" \
+    "$ROOT_DIR/tests/bench/run-all.sh" "${SCENARIOS[@]}"
+
+# Record the setup along with the run
+MANIFEST="$RESULTS_DIR/manifest.json"
+sed -i '$d' "$MANIFEST"
+sed -i '$s/$/,/' "$MANIFEST"
+cat >> "$MANIFEST" << MANIFESTEOF
+  "harness": "headless",
+  "clients": $MANAGED,
+  "outputs": $BENCH_OUTPUTS
+}
+MANIFESTEOF
+
+# Compare with the baseline
+if [ -z "$BENCH_BASELINE" ]; then
+    BENCH_BASELINE="$ROOT_DIR/tests/bench/results/baselines/$(git branch --show-current 2>/dev/null || echo unknown)"
+fi
+
+if [ ! -d "$BENCH_BASELINE" ]; then
+    echo ""
+    echo "No baseline at $BENCH_BASELINE, not checking for regressions."
+    echo "Save this run with: tests/bench/bench-save-baseline.sh $RESULTS_DIR"
+    exit 0
+fi
+
+LUA=""
+for candidate in lua5.1 luajit lua; do
+    if command -v "$candidate" > /dev/null; then
+        LUA="$candidate"
+        break
+    fi
+done
+
+if [ -z "$LUA" ]; then
+    echo "No Lua interpreter found, not checking for regressions." >&2
+    exit 0
+fi
+
+echo ""
+"$LUA" "$ROOT_DIR/tests/bench/bench-stats.lua" "$BENCH_BASELINE" "$RESULTS_DIR" "$BENCH_THRESHOLDS"
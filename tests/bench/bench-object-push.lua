@@ -0,0 +1,39 @@
+-- Benchmark: C Object Push Throughput
+--
+-- Measures luaA_object_push(), which every signal emission, key press and
+-- event drain goes through:
+--   slot:    the object's own registry slot (one lua_rawgeti)
+--   pointer: the pointer-keyed object registry table (functions, tables)
+-- plus the Lua-visible cost of fetching objects through C getters.
+--
+-- Requires a bench build (awesome.bench_object_push).
+-- Run: somewm-client eval "return dofile('tests/bench/bench-object-push.lua')"
+
+local helpers = dofile("tests/bench/bench-helpers.lua")
+
+local N = 1000000
+
+if not awesome.bench_object_push then
+    return "SKIP: awesome.bench_object_push not available (build with -Dbench=enabled)"
+end
+
+local raw = awesome.bench_object_push(N)
+
+local results = {}
+
+table.insert(results, helpers.timed("screen-primary", function()
+    local _ = screen.primary
+end, N / 10))
+
+table.insert(results, helpers.timed("client-get", function()
+    local _ = client.get()
+end, N / 100))
+
+local out = helpers.format_results("object-push", results, {
+    push_slot_ns = raw.slot_ns,
+    push_pointer_ns = raw.pointer_ns,
+    push_iterations = raw.iterations,
+})
+
+return string.format("  push via slot: %.1f ns, via pointer table: %.1f ns\n",
+    raw.slot_ns, raw.pointer_ns) .. out
@@ -0,0 +1,85 @@
+-- Benchmark: Client Rule Matching
+--
+-- A gears.matcher holding RULES ruled.client-like rules: mostly literal
+-- class/instance rules, some patterns, rule_any type lists and a few rules
+-- every client is checked against. Measures matching_rules() for mock
+-- clients, indexed (the matcher) against checking every rule in order
+-- (what matching_rules() did before the index). Real manage cost shows up
+-- in awesome.bench_stats().manage_latency.
+--
+-- Run: somewm-client eval "return dofile('tests/bench/bench-rule-matching.lua')"
+
+local helpers = dofile("tests/bench/bench-helpers.lua")
+local gmatcher = require("gears.matcher")
+
+local N = 2000
+local RULES = 300
+
+local m = gmatcher()
+local rules = {}
+
+for i = 1, RULES do
+    local kind = i % 10
+    local rule
+
+    if kind == 0 then
+        rule = { rule = { class = "App%-" .. i .. "$" } }
+    elseif kind == 1 then
+        rule = { rule_any = { type = { "dialog", "utility" }, class = { "Tool" .. i } } }
+    elseif kind == 2 then
+        rule = { rule = { instance = "inst" .. i }, properties = { floating = true } }
+    else
+        rule = { rule = { class = "App" .. i }, properties = { tag = "2" } }
+    end
+
+    rules[i] = rule
+end
+
+-- Rules that apply to every client
+table.insert(rules, 1, { rule = {}, properties = { focus = true } })
+table.insert(rules, { rule_any = { floating = { true } } })
+
+m:append_rules("awful.rules", rules)
+
+local clients = {}
+for i = 1, 32 do
+    clients[i] = {
+        class = "App" .. (i * 7),
+        instance = "inst" .. (i * 7),
+        name = "Window " .. i,
+        type = i % 4 == 0 and "dialog" or "normal",
+        role = "",
+    }
+end
+
+local source = m._matching_rules["awful.rules"]
+local results = {}
+local n = 0
+
+table.insert(results, helpers.timed("linear", function()
+    n = n % #clients + 1
+    local ret = {}
+    for _, entry in ipairs(source) do
+        if m:matches_rule(clients[n], entry) then
+            table.insert(ret, entry)
+        end
+    end
+end, N))
+
+table.insert(results, helpers.timed("indexed", function()
+    n = n % #clients + 1
+    m:matching_rules(clients[n], source)
+end, N))
+
+-- Appending a rule drops the index, the next match rebuilds it
+table.insert(results, helpers.timed("indexed-after-append", function()
+    n = n % #clients + 1
+    local extra = { rule = { class = "Extra" } }
+    m:append_rule("awful.rules", extra)
+    m:matching_rules(clients[n], source)
+    m:remove_rule("awful.rules", extra)
+end, N / 10))
+
+return helpers.format_results("rule-matching", results, {
+    rules = #source,
+})
@@ -0,0 +1,59 @@
+-- Benchmark: Process Spawn
+--
+-- Spawns short-lived `true` processes back to back through awesome.spawn()
+-- with an exit callback, the way awful.spawn.easy_async does. Measures the
+-- full spawn -> exit callback round trip in Lua; bench builds additionally
+-- report spawn-to-exec latency (time spent inside posix_spawn) under
+-- bench_stats.spawn.
+--
+-- Run: somewm-client eval "dofile('tests/bench/bench-spawn.lua')"
+-- Then poll: somewm-client eval "return _bench_results.spawn or 'PENDING'"
+
+local helpers = dofile("tests/bench/bench-helpers.lua")
+
+local N = 200
+
+_G._bench_results = _G._bench_results or {}
+_G._bench_results.spawn = nil
+
+local has_bench = awesome.bench_stats ~= nil
+if has_bench then awesome.bench_reset() end
+
+collectgarbage("collect")
+
+local i = 0
+local failures = 0
+local start = os.clock()
+
+local function finish()
+    local elapsed = os.clock() - start
+    local result = {
+        name = "spawn-exit-roundtrip",
+        iterations = N,
+        elapsed = elapsed,
+        ops_per_sec = N / elapsed,
+    }
+    if has_bench then
+        result.bench_stats = awesome.bench_stats()
+    end
+    _G._bench_results.spawn = helpers.format_results("spawn", {result}, {
+        failures = failures,
+    })
+end
+
+local function next_spawn()
+    if i >= N then
+        return finish()
+    end
+    i = i + 1
+    local pid = awesome.spawn({"true"}, false, "DEV_NULL", "DEV_NULL",
+        "DEV_NULL", next_spawn)
+    if type(pid) ~= "number" then
+        failures = failures + 1
+        next_spawn()
+    end
+end
+
+next_spawn()
+
+return "ASYNC spawn started (" .. N .. " iterations)"
@@ -0,0 +1,83 @@
+#!/usr/bin/env bash
+#
+# Startup benchmark runner.
+# Starts a headless compositor with the bundled somewmrc.lua three times:
+#   cold:     empty bytecode cache, every chunk is parsed and cached
+#   warm:     bytecode cache populated by the cold run
+#   disabled: SOMEWM_NO_BYTECODE_CACHE=1, parse everything from source
+# and reports awesome.bench_stats().startup for each, i.e. time spent
+# loading chunks (parse or bytecode) vs. executing rc.lua.
+#
+# Usage: tests/bench/bench-startup-runner.sh
+# Or:    make bench-startup
+
+set -e
+
+export LC_NUMERIC=C
+
+SOMEWM="${SOMEWM:-./somewm}"
+SOMEWM_CLIENT="${SOMEWM_CLIENT:-./somewm-client}"
+
+cd "$(dirname "$0")/../.."
+ROOT_DIR="$PWD"
+
+TMP_DIR=$(mktemp -d)
+TEST_RUNTIME_DIR="$TMP_DIR/runtime"
+mkdir -p "$TEST_RUNTIME_DIR"
+chmod 700 "$TEST_RUNTIME_DIR"
+
+TEST_CONFIG_DIR="$TMP_DIR/config/somewm"
+mkdir -p "$TEST_CONFIG_DIR"
+cp "$ROOT_DIR/somewmrc.lua" "$TEST_CONFIG_DIR/rc.lua"
+
+export WLR_BACKENDS=headless
+export WLR_RENDERER=pixman
+export WLR_WL_OUTPUTS=1
+export NO_AT_BRIDGE=1
+export XDG_RUNTIME_DIR="$TEST_RUNTIME_DIR"
+export XDG_CONFIG_HOME="$TMP_DIR/config"
+export XDG_CACHE_HOME="$TMP_DIR/cache"
+export LUA_PATH="$ROOT_DIR/lua/?.lua;$ROOT_DIR/lua/?/init.lua;;"
+
+cleanup() {
+    if [ -n "$SOMEWM_PID" ] && kill -0 "$SOMEWM_PID" 2>/dev/null; then
+        kill "$SOMEWM_PID" 2>/dev/null
+        wait "$SOMEWM_PID" 2>/dev/null || true
+    fi
+    rm -rf "$TMP_DIR"
+}
+trap cleanup EXIT
+
+run_once() {
+    local label="$1"
+
+    rm -f "$TEST_RUNTIME_DIR"/wayland-*
+    "$SOMEWM" > "$TMP_DIR/$label.log" 2>&1 &
+    SOMEWM_PID=$!
+
+    for i in $(seq 1 50); do
+        SOCKET=$(ls "$TEST_RUNTIME_DIR"/wayland-* 2>/dev/null | grep -v lock | head -1)
+        if [ -n "$SOCKET" ]; then break; fi
+        sleep 0.1
+    done
+    export WAYLAND_DISPLAY=$(basename "$SOCKET")
+
+    OUTPUT=""
+    for i in $(seq 1 50); do
+        OUTPUT=$("$SOMEWM_CLIENT" eval "local s = awesome.bench_stats().startup
+            return string.format('%-9s load %8.1f ms  exec %8.1f ms  hits %4d  misses %4d',
+                '$label', s.load_us / 1000, s.exec_us / 1000, s.cache_hits, s.cache_misses)" \
+            2>/dev/null | sed '/^OK$/d') && [ -n "$OUTPUT" ] && break
+        sleep 0.1
+    done
+    echo "$OUTPUT"
+
+    kill "$SOMEWM_PID" 2>/dev/null
+    wait "$SOMEWM_PID" 2>/dev/null || true
+    SOMEWM_PID=""
+}
+
+echo "=== Startup: chunk loading vs. rc.lua execution ==="
+run_once cold
+run_once warm
+SOMEWM_NO_BYTECODE_CACHE=1 run_once disabled
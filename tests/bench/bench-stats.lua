@@ -4,16 +4,40 @@
 -- Reads JSON files from two directories, extracts ops_per_sec from each run,
 -- computes mean/stddev/change and Welch's t-test for significance.
 --
--- Usage: lua bench-stats.lua <dir-A> <dir-B>
+-- A significant decrease in ops/sec larger than the threshold (5% unless
+-- given) is a regression and makes the script exit with 1. The threshold
+-- is either a percentage for every benchmark or a Lua file returning
+-- { default = pct, ["result-name"] = pct, ... }, see bench-thresholds.lua.
+--
+-- Usage: lua bench-stats.lua <dir-A> <dir-B> [threshold-pct|thresholds.lua]
 
 local dir_a = arg[1]
 local dir_b = arg[2]
 
 if not dir_a or not dir_b then
-    io.stderr:write("Usage: lua bench-stats.lua <dir-A> <dir-B>\n")
+    io.stderr:write("Usage: lua bench-stats.lua <dir-A> <dir-B> [threshold-pct|thresholds.lua]\n")
     os.exit(1)
 end
 
+local thresholds = { default = 5 }
+
+if arg[3] and tonumber(arg[3]) then
+    thresholds.default = tonumber(arg[3])
+elseif arg[3] then
+    local chunk, err = loadfile(arg[3])
+    local ok, ret = chunk and pcall(chunk)
+    if not (ok and type(ret) == "table") then
+        io.stderr:write("Error: cannot load thresholds from " .. arg[3] .. ": "
+            .. tostring(err or ret) .. "\n")
+        os.exit(1)
+    end
+    for k, v in pairs(ret) do thresholds[k] = v end
+end
+
+local function threshold_for(name)
+    return thresholds[name] or thresholds.default
+end
+
 -- ---------------------------------------------------------------------------
 -- Minimal JSON parser (handles the subset we emit)
 -- ---------------------------------------------------------------------------
@@ -241,8 +265,9 @@ for _, name in ipairs(all_names) do
         print(string.format(fmt, name, a_str, b_str, pct_str, sig_str))
 
         -- A significant decrease in ops/sec is a regression
-        if sig and pct < -5 then
+        if sig and pct < -threshold_for(name) then
             regressions = regressions + 1
+            print(string.format("  ^ regression: more than %g%% slower", threshold_for(name)))
         end
     elseif va and not vb then
         print(string.format(fmt, name, "present", "MISSING", "-", "-"))
@@ -258,7 +283,7 @@ end
 
 print("")
 if regressions > 0 then
-    print(string.format("REGRESSIONS: %d benchmark(s) showed significant performance decrease (>5%%)", regressions))
+    print(string.format("REGRESSIONS: %d benchmark(s) showed significant performance decrease over their threshold", regressions))
     os.exit(1)
 else
     print("No significant regressions detected.")
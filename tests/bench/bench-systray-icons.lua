@@ -0,0 +1,51 @@
+-- Benchmark: SNI Icon Pixmaps
+--
+-- Feeds IconPixmap data into systray items the way awful.systray does on
+-- NewIcon signals:
+--   blink:  one item alternating between two 32x32 pixmaps (chat apps)
+--   shared: ten items receiving the same 32x32 pixmap
+--   resend: one item receiving an unchanged pixmap again
+--
+-- Run: somewm-client eval "return dofile('tests/bench/bench-systray-icons.lua')"
+
+local helpers = dofile("tests/bench/bench-helpers.lua")
+
+local N = 2000
+local SIZE = 32
+
+if not systray_item then
+    return "SKIP: systray_item class not available"
+end
+
+local function pixmap(argb)
+    return string.rep(argb, SIZE * SIZE)
+end
+
+local frame_a = pixmap("\255\32\160\255")
+local frame_b = pixmap("\128\255\64\0")
+
+local item = systray_item {}
+local items = {}
+for i = 1, 10 do items[i] = systray_item {} end
+
+local results = {}
+
+local n = 0
+table.insert(results, helpers.timed("blink", function()
+    n = n + 1
+    item:set_icon_pixmap(SIZE, SIZE, n % 2 == 0 and frame_a or frame_b)
+end, N))
+
+table.insert(results, helpers.timed("shared", function()
+    for i = 1, #items do
+        items[i]:set_icon_pixmap(SIZE, SIZE, frame_a)
+    end
+end, N / 10))
+
+table.insert(results, helpers.timed("resend", function()
+    item:set_icon_pixmap(SIZE, SIZE, frame_a)
+end, N))
+
+return helpers.format_results("systray-icons", results, {
+    icon_size = SIZE,
+})
@@ -0,0 +1,153 @@
+-- Benchmark: Tasklist Update
+--
+-- 60 mock clients spread over 3 tasklist-like lists (one per screen), each
+-- a flex layout fed by awful.widget.common with a tasklist-like label.
+-- Compares common.list_update (rebuild every entry) with
+-- common.list_update_keyed (reconcile, only the changed client dirty):
+--   title:   one client changes its title, every list updates
+--   reorder: one client moves from the front to the back of its list
+-- Besides the timings, reports per update the widget churn (layout_changed
+-- and redraw_needed emitted by the lists and their entries) and the Lua
+-- allocation in KiB.
+--
+-- Run: somewm-client eval "return dofile('tests/bench/bench-tasklist-update.lua')"
+
+local helpers = dofile("tests/bench/bench-helpers.lua")
+local wibox = require("wibox")
+local common = require("awful.widget.common")
+local gstring = require("gears.string")
+local cairo = require("lgi").cairo
+
+local N = 500
+local CLIENTS = 60
+local SCREENS = 3
+
+local icon = cairo.ImageSurface(cairo.Format.ARGB32, 16, 16)
+local focus
+
+local function label(c)
+    local name = gstring.xml_escape(c.name)
+    local text, bg
+
+    if c == focus then
+        text = string.format("<span color='%s'>%s</span>", "#ffffff", name)
+        bg = "#535d6c"
+    else
+        text = string.format("<span color='%s'>%s</span>", "#aaaaaa", name)
+        bg = "#222222"
+    end
+
+    return text, bg, nil, icon, { icon_size = 16 }
+end
+
+local function build(update)
+    local lists = {}
+
+    for s = 1, SCREENS do
+        lists[s] = {
+            layout  = wibox.layout.flex.horizontal(),
+            data    = setmetatable({}, { __mode = "k" }),
+            clients = {},
+        }
+    end
+
+    for i = 1, CLIENTS do
+        local list = lists[(i - 1) % SCREENS + 1]
+        table.insert(list.clients, { name = "client " .. i })
+    end
+    focus = lists[1].clients[1]
+
+    local churn = 0
+    local function count() churn = churn + 1 end
+
+    local function update_all(dirty)
+        for _, list in ipairs(lists) do
+            update(list.layout, nil, label, list.data, list.clients,
+                   { dirty = dirty })
+        end
+    end
+
+    update_all()
+
+    for _, list in ipairs(lists) do
+        for _, sig in ipairs { "widget::layout_changed", "widget::redraw_needed" } do
+            list.layout:connect_signal(sig, count)
+            for _, cache in pairs(list.data) do
+                for _, w in ipairs { cache.primary, cache.bgb, cache.tb, cache.ib } do
+                    w:connect_signal(sig, count)
+                end
+            end
+        end
+    end
+
+    return lists, update_all, function()
+        local n = churn
+        churn = 0
+        return n
+    end
+end
+
+local results = {}
+local stats = {}
+
+local function run(name, update, scenario)
+    local lists, update_all, take_churn = build(update)
+    local step = scenario(lists, update_all)
+
+    -- Churn and allocation, with the collector stopped
+    collectgarbage("collect")
+    collectgarbage("stop")
+    take_churn()
+    local before = collectgarbage("count")
+    for _ = 1, N do step() end
+    local kb = collectgarbage("count") - before
+    collectgarbage("restart")
+
+    stats[name] = {
+        churn_per_update = take_churn() / N,
+        alloc_kb_per_update = kb / N,
+    }
+
+    table.insert(results, helpers.timed(name, step, N))
+end
+
+local function title(lists, update_all)
+    local c = lists[1].clients[10]
+    local flip = false
+
+    return function()
+        flip = not flip
+        c.name = flip and "vim ~/notes" or "vim ~/notes [+]"
+        update_all({ [c] = true })
+    end
+end
+
+local function reorder(lists, update_all)
+    local clients = lists[1].clients
+
+    return function()
+        table.insert(clients, table.remove(clients, 1))
+        update_all({})
+    end
+end
+
+for _, mode in ipairs {
+    { "rebuild", common.list_update },
+    { "keyed", common.list_update_keyed },
+} do
+    run(mode[1] .. "-title", mode[2], title)
+    run(mode[1] .. "-reorder", mode[2], reorder)
+end
+
+local lines = { "per update:" }
+for _, r in ipairs(results) do
+    local s = stats[r.name]
+    table.insert(lines, string.format("  %s: %.1f widget signals, %.2f KiB",
+        r.name, s.churn_per_update, s.alloc_kb_per_update))
+end
+
+return table.concat(lines, "\n") .. "\n\n" .. helpers.format_results("tasklist-update", results, {
+    clients = CLIENTS,
+    screens = SCREENS,
+    per_update = stats,
+})
@@ -0,0 +1,18 @@
+-- Regression thresholds for bench-stats.lua, in percent of ops/sec.
+--
+-- A result is a regression when it is significantly slower than the
+-- baseline by more than its threshold. Keys are result names as they
+-- appear in the JSON ("name" of each entry in "results"); the others use
+-- `default`. The async scenarios go through full compositor refresh cycles
+-- on a shared machine and are noisier than the pure Lua ones.
+--
+-- Used by bench-headless-runner.sh (override with BENCH_THRESHOLDS).
+
+return {
+    default = 5,
+
+    ["geometry-storm"] = 10,
+    ["client-churn"]   = 10,
+    ["focus-cycle"]    = 10,
+    ["tag-switch"]     = 10,
+}
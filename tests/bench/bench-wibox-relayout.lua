@@ -0,0 +1,82 @@
+-- Benchmark: Widget Hierarchy Relayout
+--
+-- A wibar-like hierarchy: 48 textboxes in margins/backgrounds inside a
+-- horizontal fixed layout. Measures a relayout after one textbox changes:
+--   same-width: text changes, width does not (only that widget relaid)
+--   width:      text changes width (later siblings move)
+--   full:       every cache cleared (upper bound, the old behaviour for
+--               widgets whose caches were dropped by a GC cycle)
+-- plus a full redraw of a real wibox after a width change.
+--
+-- Run: somewm-client eval "return dofile('tests/bench/bench-wibox-relayout.lua')"
+
+local helpers = dofile("tests/bench/bench-helpers.lua")
+local wibox = require("wibox")
+local hierarchy = require("wibox.hierarchy")
+local cairo = require("lgi").cairo
+
+local N = 2000
+local WIDGETS = 48
+local WIDTH, HEIGHT = 1920, 24
+
+local function build()
+    local layout = wibox.layout.fixed.horizontal()
+    local boxes = {}
+    for i = 1, WIDGETS do
+        local tb = wibox.widget.textbox("widget " .. i)
+        boxes[i] = tb
+        layout:add(wibox.container.background(wibox.container.margin(tb, 2, 2)))
+    end
+    return layout, boxes
+end
+
+local root, boxes = build()
+local context = { dpi = 96 }
+local h = hierarchy.new(context, root, WIDTH, HEIGHT, function() end, function() end)
+local region = cairo.Region.create()
+
+local results = {}
+local changing = boxes[WIDGETS / 4]
+local flip = false
+
+table.insert(results, helpers.timed("relayout-same-width", function()
+    flip = not flip
+    changing.text = flip and "12:00" or "12:01"
+    h:update(context, root, WIDTH, HEIGHT, region)
+end, N))
+
+table.insert(results, helpers.timed("relayout-width", function()
+    flip = not flip
+    changing.text = flip and "short" or "a much longer label"
+    h:update(context, root, WIDTH, HEIGHT, region)
+end, N))
+
+table.insert(results, helpers.timed("relayout-full", function()
+    for _, tb in ipairs(boxes) do
+        tb:emit_signal("widget::layout_changed")
+    end
+    h:update(context, root, WIDTH, HEIGHT, region)
+end, N / 10))
+
+-- End to end through a real drawable: relayout, damage and repaint
+local wb = wibox {
+    x = 0, y = 0, width = WIDTH, height = HEIGHT,
+    visible = true,
+}
+local wb_root, wb_boxes = build()
+wb.widget = wb_root
+wb._drawable._do_redraw()
+local wb_changing = wb_boxes[WIDGETS / 4]
+
+table.insert(results, helpers.timed("redraw-width", function()
+    flip = not flip
+    wb_changing.text = flip and "short" or "a much longer label"
+    wb._drawable._do_redraw()
+end, N / 10))
+
+wb.visible = false
+wb.widget = nil
+
+return helpers.format_results("wibox-relayout", results, {
+    widgets = WIDGETS,
+})
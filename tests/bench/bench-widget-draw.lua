@@ -0,0 +1,59 @@
+-- Benchmark: Textbox and Imagebox Draw
+--
+-- Per-widget cost of the status bar hot path: fit and draw of textboxes
+-- (text changing every iteration, like a clock) and draw of imageboxes
+-- holding plain surfaces. somewm builds draw these through the native
+-- drawable.draw_text_layout / draw_image fast paths; compare against a
+-- baseline from before them with bench-save-baseline.sh.
+--
+-- Run: somewm-client eval "return dofile('tests/bench/bench-widget-draw.lua')"
+
+local helpers = dofile("tests/bench/bench-helpers.lua")
+local wibox = require("wibox")
+local cairo = require("lgi").cairo
+
+local N = 20000
+local W, H = 120, 24
+
+local img = cairo.ImageSurface(cairo.Format.ARGB32, W, H)
+local cr = cairo.Context(img)
+local context = { dpi = 96 }
+
+local tb = wibox.widget.textbox("12:00:00")
+local clock = 0
+
+local icon = cairo.ImageSurface(cairo.Format.ARGB32, 48, 48)
+local ib = wibox.widget.imagebox(icon)
+ib.resize = true
+
+local results = {}
+
+table.insert(results, helpers.timed("textbox-fit", function()
+    tb:fit(context, W, H)
+end, N))
+
+table.insert(results, helpers.timed("textbox-draw", function()
+    cr:save()
+    tb:draw(context, cr, W, H)
+    cr:restore()
+end, N))
+
+table.insert(results, helpers.timed("textbox-update-draw", function()
+    clock = clock + 1
+    tb.text = string.format("%02d:%02d:%02d",
+        math.floor(clock / 3600) % 24, math.floor(clock / 60) % 60, clock % 60)
+    tb:fit(context, W, H)
+    cr:save()
+    tb:draw(context, cr, W, H)
+    cr:restore()
+end, N))
+
+table.insert(results, helpers.timed("imagebox-draw", function()
+    cr:save()
+    ib:draw(context, cr, H, H)
+    cr:restore()
+end, N))
+
+return helpers.format_results("widget-draw", results, {
+    native = drawable ~= nil and drawable.draw_text_layout ~= nil,
+})
@@ -3,7 +3,8 @@
 # Profile your live compositor session.
 #
 # Attaches perf to the running somewm process while you use it normally.
-# Produces a flamegraph and optionally a Lua-level profile via jit.p.
+# Produces a flamegraph and optionally a Lua-level profile from the
+# built-in sampling profiler (`somewm-client profile`).
 #
 # Usage:
 #   tests/bench/profile-session.sh              # 30s profile
@@ -78,9 +79,10 @@ echo ""
 
 # Start Lua profiling if requested
 if [ "$LUA_PROFILE" = 1 ]; then
-    echo "Starting Lua profiler (jit.p)..."
-    "$SOMEWM_CLIENT" eval "require('jit.p').start('Gli1', '/tmp/somewm-lua-profile.txt')" 2>/dev/null || {
-        echo "WARNING: jit.p not available, skipping Lua profiling" >&2
+    echo "Starting Lua profiler..."
+    rm -f /tmp/somewm-lua-profile.txt
+    "$SOMEWM_CLIENT" profile start > /dev/null || {
+        echo "WARNING: Lua profiler did not start, skipping Lua profiling" >&2
         LUA_PROFILE=0
     }
 fi
@@ -97,7 +99,7 @@ perf record -g --call-graph dwarf -e cpu-clock -p "$SOMEWM_PID" -o "$PERF_DATA"
 
 # Stop Lua profiling
 if [ "$LUA_PROFILE" = 1 ]; then
-    "$SOMEWM_CLIENT" eval "require('jit.p').stop()" 2>/dev/null || true
+    "$SOMEWM_CLIENT" profile stop /tmp/somewm-lua-profile.txt || true
 fi
 
 echo ""
@@ -4,12 +4,17 @@
 # Runs benchmarks against the currently running compositor session.
 #
 # Options:
-#   JSON=1:     Capture JSON output to results directory
-#   RUNS=N:     Number of iterations per benchmark (default: 5)
+#   JSON=1:          Capture JSON output to results directory
+#   RUNS=N:          Number of iterations per benchmark (default: 5)
+#   RESULTS_DIR=dir: Where to write the JSON (default: results/<date>-<commit>)
+#   SESSION_NAME=s:  What the header says is benchmarked
+#
+# Exits non-zero if a benchmark run failed, timed out or reported FAILED:.
 #
 # Usage:
 #   tests/bench/run-all.sh                    # Run all benchmarks
 #   tests/bench/run-all.sh bench-focus-cycle   # Single benchmark
+#   tests/bench/run-all.sh bench-a bench-b     # Several benchmarks
 #   JSON=1 tests/bench/run-all.sh             # With JSON capture
 
 set -e
@@ -19,6 +24,8 @@ export LC_NUMERIC=C
 SOMEWM_CLIENT="${SOMEWM_CLIENT:-./somewm-client}"
 RUNS=${RUNS:-5}
 JSON=${JSON:-0}
+SESSION_NAME="${SESSION_NAME:-live session}"
+FAILURES=0
 
 cd "$(dirname "$0")/../.."
 ROOT_DIR="$PWD"
@@ -29,14 +36,21 @@ BENCH_DIR="$ROOT_DIR/tests/bench"
 if [ "$JSON" = 1 ]; then
     GIT_COMMIT=$(git rev-parse --short HEAD 2>/dev/null || echo "unknown")
     GIT_BRANCH=$(git branch --show-current 2>/dev/null || echo "unknown")
-    RUN_ID="$(date +%Y%m%d-%H%M%S)-${GIT_COMMIT}"
-    RESULTS_DIR="$BENCH_DIR/results/$RUN_ID"
+    if [ -n "$RESULTS_DIR" ]; then
+        RUN_ID=$(basename "$RESULTS_DIR")
+    else
+        RUN_ID="$(date +%Y%m%d-%H%M%S)-${GIT_COMMIT}"
+        RESULTS_DIR="$BENCH_DIR/results/$RUN_ID"
+    fi
     mkdir -p "$RESULTS_DIR"
 fi
 
 # Determine which benchmarks to run
-if [ -n "$1" ]; then
-    BENCHMARKS=("$BENCH_DIR/$1.lua")
+if [ $# -gt 0 ]; then
+    BENCHMARKS=()
+    for name in "$@"; do
+        BENCHMARKS+=("$BENCH_DIR/$name.lua")
+    done
 else
     BENCHMARKS=("$BENCH_DIR"/bench-*.lua)
 fi
@@ -45,7 +59,7 @@ fi
 FILTERED=()
 for b in "${BENCHMARKS[@]}"; do
     case "$(basename "$b")" in
-        bench-helpers.lua|bench-stats.lua|bench-memory-trend.lua) continue ;;
+        bench-helpers.lua|bench-stats.lua|bench-memory-trend.lua|bench-thresholds.lua) continue ;;
     esac
     FILTERED+=("$b")
 done
@@ -75,6 +89,7 @@ run_bench() {
         local output
         output=$("$SOMEWM_CLIENT" eval "return dofile('$bench')" 2>/dev/null) || {
             echo "FAILED"
+            FAILURES=$((FAILURES + 1))
             continue
         }
 
@@ -98,10 +113,16 @@ run_bench() {
 
             if [ $attempts -ge $max_attempts ]; then
                 echo "TIMEOUT"
+                FAILURES=$((FAILURES + 1))
                 "$SOMEWM_CLIENT" eval "_bench_results.${result_key} = nil" 2>/dev/null || true
                 continue
             fi
 
+            # A scenario that checks its own results reports them as failed
+            if echo "$output" | grep -q "^FAILED:"; then
+                FAILURES=$((FAILURES + 1))
+            fi
+
             # Clean up global for next run
             "$SOMEWM_CLIENT" eval "_bench_results.${result_key} = nil" 2>/dev/null || true
         fi
@@ -124,7 +145,7 @@ run_bench() {
     done
 }
 
-echo "=== Running against live session ==="
+echo "=== Running against $SESSION_NAME ==="
 echo ""
 
 for bench in "${BENCHMARKS[@]}"; do
@@ -132,7 +153,7 @@ for bench in "${BENCHMARKS[@]}"; do
 done
 
 # Print frame stats at end
-"$SOMEWM_CLIENT" eval "if awesome.bench_stats then local s = awesome.bench_stats(); print('=== frame timing ==='); print(string.format('refresh_count: %d', s.refresh_count)); print(string.format('refresh_avg_us: %.1f', s.refresh_avg_us)); print(string.format('refresh_p99_us: %.1f', s.refresh_p99_us)); print(string.format('refresh_max_us: %.1f', s.refresh_max_us)); if s.crossings_per_frame then print(string.format('crossings_per_frame_avg: %.1f', s.crossings_per_frame.avg)); print(string.format('crossings_per_frame_max: %d', s.crossings_per_frame.max)) end end" 2>/dev/null || true
+"$SOMEWM_CLIENT" eval "if awesome.bench_stats then local s = awesome.bench_stats(); print('=== frame timing ==='); print(string.format('refresh_count: %d', s.refresh_count)); print(string.format('refresh_avg_us: %.1f', s.refresh_avg_us)); print(string.format('refresh_p99_us: %.1f', s.refresh_p99_us)); print(string.format('refresh_max_us: %.1f', s.refresh_max_us)); if s.crossings_per_frame then print(string.format('crossings_per_frame_avg: %.1f', s.crossings_per_frame.avg)); print(string.format('crossings_per_frame_max: %d', s.crossings_per_frame.max)) end; if s.x11_requests then print(string.format('x11_requests_per_frame_avg: %.1f', s.x11_requests.avg_per_frame)); print(string.format('x11_requests_per_frame_max: %d', s.x11_requests.max_per_frame)); print(string.format('x11_requests_skipped: %d', s.x11_requests.skipped)) end end" 2>/dev/null || true
 
 # Write manifest
 if [ "$JSON" = 1 ]; then
@@ -149,3 +170,8 @@ MANIFESTEOF
     echo ""
     echo "JSON results: $RESULTS_DIR"
 fi
+
+if [ "$FAILURES" -gt 0 ]; then
+    echo "$FAILURES benchmark run(s) failed" >&2
+    exit 1
+fi
@@ -90,6 +90,8 @@ else
     export SOMEWM_SOCKET="$SOCKET"
 fi
 export XDG_CONFIG_HOME="$TMP_DIR/config"
+# Keep the bytecode cache of test runs out of the user's cache
+export XDG_CACHE_HOME="$TMP_DIR/cache"
 
 # Cleanup function
 cleanup() {
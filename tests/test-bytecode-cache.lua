@@ -0,0 +1,87 @@
+---------------------------------------------------------------------------
+--- Test: modules load through the bytecode cache
+--
+-- Verifies the observable behavior of luacache.c:
+--   1. A module on package.path loads, and loads again from cache (counted
+--      as a hit) with the same result and the original source name for
+--      tracebacks.
+--   2. Editing the source invalidates the cached bytecode.
+--   3. A missing module reports each path tried in the stock format.
+--   4. Syntax errors are still reported with file and line.
+---------------------------------------------------------------------------
+
+local runner = require("_runner")
+
+local dir = os.tmpname()
+os.remove(dir)
+os.execute("mkdir -p " .. dir)
+local saved_path = package.path
+package.path = dir .. "/?.lua;" .. package.path
+
+local function write_module(name, source)
+    local f = assert(io.open(dir .. "/" .. name .. ".lua", "w"))
+    f:write(source)
+    f:close()
+    package.loaded[name] = nil
+end
+
+local steps = {
+    -- Step 1: Load twice, second time from cache
+    function()
+        write_module("bccache_mod", "return { value = 1, src = debug.getinfo(1, 'S').source }\n")
+        local before = awesome._luacache_stats()
+        assert(before.enabled, "bytecode cache is disabled")
+        local first = require("bccache_mod")
+        local after_first = awesome._luacache_stats()
+        package.loaded.bccache_mod = nil
+        local second = require("bccache_mod")
+        local after_second = awesome._luacache_stats()
+
+        assert(after_first.misses == before.misses + 1,
+            "first load should compile the source")
+        assert(after_second.hits == after_first.hits + 1
+            and after_second.misses == after_first.misses,
+            "second load was not a cache hit")
+
+        assert(first.value == 1 and second.value == 1)
+        assert(second.src == "@" .. dir .. "/bccache_mod.lua",
+            "unexpected chunk source " .. tostring(second.src))
+        return true
+    end,
+
+    -- Step 2: Edited source is picked up
+    function()
+        write_module("bccache_mod", "return { value = 2 }\n")
+        assert(require("bccache_mod").value == 2, "stale bytecode loaded")
+        return true
+    end,
+
+    -- Step 3: A missing module lists each path tried once, in the stock
+    -- format (no doubled "\n\t" on Lua 5.4)
+    function()
+        local ok, err = pcall(require, "bccache_missing")
+        assert(not ok)
+        assert(err:find("no file '" .. dir .. "/bccache_missing.lua'", 1, true),
+            "path not listed: " .. err)
+        assert(not err:find("\n\t\n\t", 1, true), "doubled separator: " .. err)
+        return true
+    end,
+
+    -- Step 4: Syntax errors keep file and line
+    function()
+        write_module("bccache_bad", "local x = 1\nreturn {\n")
+        local ok, err = pcall(require, "bccache_bad")
+        assert(not ok)
+        assert(err:find("bccache_bad.lua:%d"), "error lacks location: " .. err)
+        return true
+    end,
+
+    -- Step 5: Cleanup
+    function()
+        package.path = saved_path
+        os.execute("rm -rf '" .. dir .. "'")
+        return true
+    end,
+}
+
+runner.run_steps(steps)
@@ -0,0 +1,98 @@
+---------------------------------------------------------------------------
+--- Test: dbus.c drops unsubscribed messages before they reach Lua
+--
+-- Verifies the observable behavior of dbus.c's subscription index:
+--   1. Broadcast signals on an interface without a handler are counted as
+--      received and dropped by dbus.get_stats().
+--   2. Once a handler is connected, matching signals are dispatched.
+--   3. With a member-restricted rule only that member is dispatched.
+---------------------------------------------------------------------------
+
+local runner = require("_runner")
+local lgi = require("lgi")
+local Gio = lgi.Gio
+
+local IFACE = "org.somewm.Test.MatchFilter"
+local PATH = "/org/somewm/Test"
+local RULE = "type='signal',interface='" .. IFACE .. "'"
+local MEMBER_RULE = RULE .. ",member='Wanted'"
+
+local bus = dbus and dbus.get_stats and Gio.bus_get_sync(Gio.BusType.SESSION)
+local received = {}
+
+local function stats()
+    return dbus.get_stats()[IFACE] or { received = 0, dropped = 0, dispatched = 0 }
+end
+
+local function emit(member, n)
+    for _ = 1, n do
+        bus:emit_signal(nil, PATH, IFACE, member, nil)
+    end
+    bus:flush_sync()
+end
+
+local function on_signal(data)
+    table.insert(received, data.member)
+end
+
+local steps = {
+    -- Step 1: No handler, messages dropped in C
+    function(count)
+        if not bus then
+            io.stderr:write("[SKIP] No D-Bus session bus\n")
+            return true
+        end
+
+        if count == 1 then
+            dbus.add_match("session", RULE)
+            emit("Nobody", 3)
+        end
+
+        local s = stats()
+        if s.received >= 3 then
+            assert(s.dropped == 3, "expected 3 dropped, got " .. s.dropped)
+            assert(s.dispatched == 0, "expected 0 dispatched, got " .. s.dispatched)
+            return true
+        end
+    end,
+
+    -- Step 2: Connected handler receives signals
+    function(count)
+        if not bus then return true end
+
+        if count == 1 then
+            dbus.connect_signal(IFACE, on_signal)
+            emit("Hello", 2)
+        end
+
+        if #received >= 2 then
+            assert(stats().dispatched == 2,
+                "expected 2 dispatched, got " .. stats().dispatched)
+            return true
+        end
+    end,
+
+    -- Step 3: Member rule filters the other member
+    function(count)
+        if not bus then return true end
+
+        if count == 1 then
+            received = {}
+            dbus.remove_match("session", RULE)
+            dbus.add_match("session", MEMBER_RULE)
+            emit("Unwanted", 2)
+            emit("Wanted", 1)
+        end
+
+        if #received >= 1 then
+            for _, member in ipairs(received) do
+                assert(member == "Wanted", "unexpected member " .. member)
+            end
+            dbus.disconnect_signal(IFACE, on_signal)
+            dbus.remove_match("session", MEMBER_RULE)
+            return true
+        end
+    end,
+}
+
+runner.run_steps(steps)
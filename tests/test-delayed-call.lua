@@ -0,0 +1,57 @@
+---------------------------------------------------------------------------
+--- Test the delayed call queue: priority classes, dedup keys and arguments.
+---
+--- Layout calls must run before drawing calls, drawing calls before user
+--- calls, FIFO within a class, calls queued from a running call must run in
+--- the same pass, and a key must drop further calls while one is queued or
+--- running.
+---------------------------------------------------------------------------
+
+local runner = require("_runner")
+local timer = require("gears.timer")
+
+runner.run_direct()
+
+local order = {}
+local function record(name, ...)
+    table.insert(order, name .. "(" .. table.concat({...}, ",") .. ")")
+end
+
+local function check()
+    local expected = table.concat({
+        "layout-a()", "layout-b()", "drawing(1,2)", "drawing-nil(3)",
+        "user-1()", "user-2(x)", "user-nested()",
+    }, " ")
+    local got = table.concat(order, " ")
+    if got ~= expected then
+        runner.done("unexpected order:\n  expected " .. expected .. "\n  got      " .. got)
+    elseif timer.has_pending_delayed_calls() then
+        runner.done("delayed calls still pending after the queue ran")
+    else
+        runner.done()
+    end
+end
+
+timer.start_new(0.1, function()
+    timer.delayed_call(record, "user-1")
+    timer.queue_call("user", nil, function(...)
+        record(...)
+        timer.delayed_call(record, "user-nested")
+        -- Check once this pass is over
+        timer.delayed_call(timer.start_new, 0.1, function() check() return false end)
+    end, "user-2", "x")
+    timer.queue_call("drawing", nil, record, "drawing", 1, 2)
+    timer.queue_call("drawing", nil, function(_, n) record("drawing-nil", n) end, nil, 3)
+
+    assert(timer.queue_call("layout", "key", record, "layout-a"))
+    assert(not timer.queue_call("layout", "key", record, "layout-dup"),
+        "duplicate key must not be queued")
+    timer.queue_call("layout", "other", function()
+        record("layout-b")
+        assert(not timer.queue_call("layout", "other", record, "layout-running"),
+            "key of a running call must not be queued")
+    end)
+
+    assert(timer.has_pending_delayed_calls())
+    return false
+end)
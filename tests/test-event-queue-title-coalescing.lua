@@ -0,0 +1,69 @@
+---------------------------------------------------------------------------
+--- Test: title updates are coalesced and rate limited
+--
+-- Verifies property.c's coalesced title path: a client retitling in a
+-- tight loop produces far fewer property::name emissions than titles,
+-- with awesome.client_property_rate capping deliveries, and the last
+-- title always arrives (held-back updates are delivered by a timer, not
+-- by the next title change).
+---------------------------------------------------------------------------
+
+local runner = require("_runner")
+local test_client = require("_client")
+local utils = require("_utils")
+local awful = require("awful")
+
+if not test_client.is_available() then
+    io.stderr:write("Test finished successfully.\n")
+    awesome.quit()
+    return
+end
+
+local TITLES = 100
+
+local my_client
+local name_count = 0
+
+-- Waits a second so the counter is connected before the burst starts
+local script = string.format(
+    "sleep 1; i=0; while [ $i -lt %d ]; do printf '\\033]2;t%%d\\007' $i; " ..
+    "i=$((i+1)); done; printf '\\033]2;final\\007'; sleep infinity", TITLES)
+
+local steps = {
+    function(count)
+        if count == 1 then
+            local t = test_client.get_terminal_info()
+            awful.spawn({ t.executable, string.format(t.class_flag, "title_coalesce"),
+                          t.exec_flag, "sh", "-c", script })
+        end
+        my_client = utils.find_client_by_class("title_coalesce")
+        return my_client and true or nil
+    end,
+
+    function()
+        awesome.client_property_rate = 4
+        my_client:connect_signal("property::name", function()
+            name_count = name_count + 1
+        end)
+        return true
+    end,
+
+    function()
+        if my_client.name ~= "final" then return nil end
+        assert(name_count < 10, string.format(
+            "expected %d titles capped at 4/s to coalesce into a few " ..
+            "property::name emissions, got %d", TITLES + 1, name_count))
+        io.stderr:write(string.format(
+            "[TEST] PASS: %d titles delivered as %d property::name\n",
+            TITLES + 1, name_count))
+        return true
+    end,
+
+    function()
+        awesome.client_property_rate = 0
+        test_client.terminate()
+        return true
+    end,
+}
+
+runner.run_steps(steps)
@@ -0,0 +1,40 @@
+---------------------------------------------------------------------------
+--- Test: an "arrange" handler can request another arrange
+--
+-- awful.layout.arrange() is deduplicated by screen while the arrange runs.
+-- The "arrange" signal is emitted after that, so an arrange requested by a
+-- handler (or by code it triggers) must not be dropped.
+---------------------------------------------------------------------------
+
+local runner = require("_runner")
+local awful = require("awful")
+
+local s = screen.primary
+local arranges = 0
+local requeued = true  -- Armed in step 1, after any startup arrange
+
+s:connect_signal("arrange", function(scr)
+    arranges = arranges + 1
+    if not requeued then
+        requeued = true
+        awful.layout.arrange(scr)
+    end
+end)
+
+local steps = {
+    function()
+        arranges = 0
+        requeued = false
+        awful.layout.arrange(s)
+        return true
+    end,
+
+    function(count)
+        if arranges >= 2 then
+            return true
+        end
+        assert(count < 10, "arrange requested from an \"arrange\" handler was dropped")
+    end,
+}
+
+runner.run_steps(steps)
@@ -0,0 +1,60 @@
+---------------------------------------------------------------------------
+--- Test: sampling Lua profiler
+--
+-- Starts the profiler, burns CPU time in a function of this file and stops
+-- it. The folded stacks must contain that function and the stats must count
+-- the samples.
+---------------------------------------------------------------------------
+
+local runner = require("_runner")
+
+local BUSY_S = 0.5
+
+local function profiled_busy_work()
+    local stop = os.clock() + BUSY_S
+    local n = 0
+    while os.clock() < stop do
+        n = n + #tostring(n)
+    end
+    return n
+end
+
+local steps = {
+    -- Step 1: Start the profiler
+    function()
+        local ok, err = awesome.lua_profile_start()
+        assert(ok, "lua_profile_start failed: " .. tostring(err))
+        assert(awesome.lua_profile_stats().running, "profiler should be running")
+        return true
+    end,
+
+    -- Step 2: Lua work to sample
+    function()
+        profiled_busy_work()
+        return true
+    end,
+
+    -- Step 3: The work shows up in the samples
+    function()
+        local folded, stats = awesome.lua_profile_stop()
+        assert(not stats.running, "profiler should be stopped")
+        assert(stats.samples > 0, "no samples taken")
+
+        local found
+        for line in folded:gmatch("[^\n]+") do
+            if line:match("test%-lua%-profile%.lua") then
+                found = line
+                break
+            end
+        end
+        assert(found, "no stack from this file in the folded output:\n" .. folded)
+
+        io.stderr:write(string.format("[TEST] PASS: %d samples, e.g. %s\n",
+            stats.samples, found))
+        return true
+    end,
+}
+
+runner.run_steps(steps)
+
+-- vim: filetype=lua:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:textwidth=80
@@ -0,0 +1,81 @@
+---------------------------------------------------------------------------
+--- Test: awesome.spawn() exit callbacks, pipes and error reporting
+--
+-- Verifies the observable behavior of spawn.c:
+--   1. Exit callbacks fire with ("exit", code) and ("signal", signo).
+--   2. Many overlapping children each get their own callback exactly once.
+--   3. stdout=true returns a readable pipe fd connected to the child.
+--   4. A missing executable returns an error string instead of a pid.
+---------------------------------------------------------------------------
+
+local runner = require("_runner")
+local Gio = require("lgi").Gio
+
+local exits = {}
+local burst_done = 0
+local BURST = 20
+
+local steps = {
+    -- Step 1: Exit code and termination signal are reported
+    function(count)
+        if count == 1 then
+            local pid = awesome.spawn({"sh", "-c", "exit 3"}, false, nil, nil, nil,
+                function(reason, code) exits.code = {reason, code} end)
+            assert(type(pid) == "number", "spawn failed: " .. tostring(pid))
+
+            pid = awesome.spawn({"sh", "-c", "kill -TERM $$"}, false, nil, nil, nil,
+                function(reason, code) exits.signal = {reason, code} end)
+            assert(type(pid) == "number", "spawn failed: " .. tostring(pid))
+        end
+
+        if exits.code and exits.signal then
+            assert(exits.code[1] == "exit" and exits.code[2] == 3,
+                "expected exit 3, got " .. exits.code[1] .. " " .. exits.code[2])
+            assert(exits.signal[1] == "signal" and exits.signal[2] == 15,
+                "expected signal 15, got " .. exits.signal[1] .. " " .. exits.signal[2])
+            return true
+        end
+    end,
+
+    -- Step 2: Overlapping children are tracked independently
+    function(count)
+        if count == 1 then
+            for _ = 1, BURST do
+                awesome.spawn({"true"}, false, nil, nil, nil,
+                    function() burst_done = burst_done + 1 end)
+            end
+        end
+
+        if burst_done == BURST then
+            return true
+        end
+        assert(burst_done < BURST, "exit callback fired more than once")
+    end,
+
+    -- Step 3: stdout pipe is returned and carries the child's output
+    function()
+        local pid, _, stdin, stdout = awesome.spawn({"echo", "spawn-pipe-ok"},
+            false, nil, true)
+        assert(type(pid) == "number", "spawn failed: " .. tostring(pid))
+        assert(stdin == nil, "stdin fd should not be returned")
+        assert(type(stdout) == "number", "stdout fd should be returned")
+
+        local f = io.open("/proc/self/fd/" .. stdout, "r")
+        assert(f, "stdout fd is not open")
+        local line = f:read("*l")
+        f:close()
+        -- io.open() opened a second fd; close the one spawn returned
+        Gio.UnixInputStream.new(stdout, true):close()
+        assert(line == "spawn-pipe-ok", "unexpected pipe output: " .. tostring(line))
+        return true
+    end,
+
+    -- Step 4: Exec failures are reported synchronously
+    function()
+        local ret = awesome.spawn({"/nonexistent/somewm-spawn-test"}, false)
+        assert(type(ret) == "string", "expected error string, got " .. type(ret))
+        return true
+    end,
+}
+
+runner.run_steps(steps)
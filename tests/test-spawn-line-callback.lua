@@ -0,0 +1,86 @@
+---------------------------------------------------------------------------
+--- Test: native spawn output readers behind awful.spawn
+--
+-- Verifies the observable behavior of spawn.c's output readers:
+--   1. with_line_callback delivers every stdout/stderr line in order, including
+--      a final line without trailing newline, then calls output_done.
+--   2. Output larger than one refresh cycle's budget is delivered completely.
+--   3. easy_async hands over whole stdout/stderr strings and the exit status.
+---------------------------------------------------------------------------
+
+local runner = require("_runner")
+local awful = require("awful")
+
+local lines = { stdout = {}, stderr = {} }
+local output_done = false
+
+local big_count = 0
+local big_in_order = true
+local big_done = false
+local BIG = 5000
+
+local async_result
+
+local steps = {
+    -- Step 1: Line callbacks on both streams
+    function(count)
+        if count == 1 then
+            awful.spawn.with_line_callback(
+                { "sh", "-c", "printf 'one\\n\\nthree\\nfour'; echo err >&2" }, {
+                stdout = function(line) table.insert(lines.stdout, line) end,
+                stderr = function(line) table.insert(lines.stderr, line) end,
+                output_done = function() output_done = true end,
+            })
+        end
+
+        if output_done then
+            assert(#lines.stdout == 4, "expected 4 stdout lines, got " .. #lines.stdout)
+            assert(lines.stdout[1] == "one")
+            assert(lines.stdout[2] == "")
+            assert(lines.stdout[3] == "three")
+            assert(lines.stdout[4] == "four", "unterminated last line lost")
+            assert(#lines.stderr == 1 and lines.stderr[1] == "err")
+            return true
+        end
+    end,
+
+    -- Step 2: Output spanning several refresh cycles
+    function(count)
+        if count == 1 then
+            awful.spawn.with_line_callback({ "seq", "1", tostring(BIG) }, {
+                stdout = function(line)
+                    big_count = big_count + 1
+                    if tonumber(line) ~= big_count then big_in_order = false end
+                end,
+                output_done = function() big_done = true end,
+            })
+        end
+
+        if big_done then
+            assert(big_count == BIG, "expected " .. BIG .. " lines, got " .. big_count)
+            assert(big_in_order, "lines delivered out of order")
+            return true
+        end
+    end,
+
+    -- Step 3: easy_async accumulates whole outputs
+    function(count)
+        if count == 1 then
+            awful.spawn.easy_async({ "sh", "-c", "echo a; printf b; echo c >&2; exit 2" },
+                function(stdout, stderr, reason, code)
+                    async_result = { stdout, stderr, reason, code }
+                end)
+        end
+
+        if async_result then
+            assert(async_result[1] == "a\nb\n",
+                "unexpected stdout: " .. string.format("%q", async_result[1]))
+            assert(async_result[2] == "c\n",
+                "unexpected stderr: " .. string.format("%q", async_result[2]))
+            assert(async_result[3] == "exit" and async_result[4] == 2)
+            return true
+        end
+    end,
+}
+
+runner.run_steps(steps)
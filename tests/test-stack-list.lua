@@ -0,0 +1,73 @@
+---------------------------------------------------------------------------
+--- Test: stacking order through raise/lower/unmanage
+--
+-- globalconf.stack is an intrusive linked list. Checks that
+-- client.get(nil, true) (top to bottom) follows raise() and lower(), that
+-- raising the top client does nothing, and that an unmanaged client leaves
+-- the list without breaking its neighbours' links.
+---------------------------------------------------------------------------
+
+local runner = require("_runner")
+local async = require("_async")
+local test_client = require("_client")
+
+if not test_client.is_available() then
+    io.stderr:write("Test finished successfully.\n")
+    awesome.quit()
+    return
+end
+
+local function stacked_classes()
+    local ret = {}
+    for _, c in ipairs(client.get(nil, true)) do
+        if c.class and c.class:match("^stack_list_") then
+            table.insert(ret, c.class)
+        end
+    end
+    return table.concat(ret, ",")
+end
+
+runner.run_async(function()
+    local clients = {}
+    for _, name in ipairs({ "a", "b", "c" }) do
+        test_client("stack_list_" .. name)
+        clients[name] = async.wait_for_client("stack_list_" .. name, 5)
+        assert(clients[name], "Client " .. name .. " did not appear")
+    end
+
+    local a, b, c = clients.a, clients.b, clients.c
+
+    c:raise(); b:raise(); a:raise()
+    assert(stacked_classes() == "stack_list_a,stack_list_b,stack_list_c",
+        "unexpected order after raise: " .. stacked_classes())
+
+    a:lower()
+    assert(stacked_classes() == "stack_list_b,stack_list_c,stack_list_a",
+        "unexpected order after lower: " .. stacked_classes())
+
+    local raised = 0
+    b:connect_signal("raised", function() raised = raised + 1 end)
+    b:raise()
+    assert(raised == 0, "raising the top client should do nothing")
+
+    c:raise()
+    assert(stacked_classes() == "stack_list_c,stack_list_b,stack_list_a",
+        "unexpected order after raise: " .. stacked_classes())
+
+    -- Unmanage the middle client
+    assert(b.pid, "Client has no pid")
+    os.execute("kill -9 " .. b.pid)
+    assert(async.wait_for_condition(function() return not b.valid end, 10),
+        "Client b was not unmanaged")
+
+    assert(stacked_classes() == "stack_list_c,stack_list_a",
+        "unexpected order after unmanage: " .. stacked_classes())
+    assert(#client.get(nil, true) == #client.get(),
+        "stacked and unstacked client lists differ in length")
+
+    a:raise()
+    assert(stacked_classes() == "stack_list_a,stack_list_c",
+        "unexpected order after raise: " .. stacked_classes())
+
+    runner.done()
+end)
@@ -14,7 +14,8 @@
 -- parent's scene layer before calling wlr_scene_node_place_above.
 --
 -- This test verifies the fix by reproducing the exact crash scenario:
--- parent with above=true + transient child spawned after.
+-- parent with above=true + transient child spawned after. It then checks
+-- that a transient with a layer of its own (ontop) stays in that layer.
 
 local runner = require("_runner")
 local utils = require("_utils")
@@ -111,7 +112,50 @@ local steps = {
         return true
     end,
 
-    -- Step 5: Cleanup
+    -- Step 5: A transient with a layer of its own (ontop) is placed in that
+    -- layer rather than its parent's
+    function(count)
+        if count == 1 then
+            child_client.ontop = true
+            return
+        end
+
+        assert(parent_client._scene_layer == "top", string.format(
+            "parent should be in top layer, got %s", tostring(parent_client._scene_layer)))
+        assert(child_client._scene_layer == "overlay", string.format(
+            "ontop transient should be in overlay layer, got %s",
+            tostring(child_client._scene_layer)))
+
+        -- Restacking the parent's layers must leave it there
+        parent_client.above = false
+        return true
+    end,
+
+    function(count)
+        if count == 1 then return end
+
+        assert(parent_client._scene_layer == "tile", string.format(
+            "parent should be in tile layer, got %s", tostring(parent_client._scene_layer)))
+        assert(child_client._scene_layer == "overlay", string.format(
+            "ontop transient should stay in overlay layer, got %s",
+            tostring(child_client._scene_layer)))
+
+        -- Without its own layer it joins its parent again
+        child_client.ontop = false
+        return true
+    end,
+
+    function(count)
+        if count == 1 then return end
+
+        assert(child_client._scene_layer == parent_client._scene_layer, string.format(
+            "transient should join its parent's layer %s, got %s",
+            tostring(parent_client._scene_layer), tostring(child_client._scene_layer)))
+        io.stderr:write("[TEST] PASS: transient with its own layer stays in it\n")
+        return true
+    end,
+
+    -- Step 6: Cleanup
     function(count)
         if count == 1 then
             io.stderr:write("[TEST] Cleanup: killing test-transient-client\n")
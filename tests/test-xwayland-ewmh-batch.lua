@@ -0,0 +1,221 @@
+---------------------------------------------------------------------------
+--- Test: batched EWMH property writes
+--
+-- EWMH updates are staged and written once per refresh, skipping values
+-- the X server already has (see ewmh_flush()). This tests that:
+-- 1. Root and client properties reach the X server after a refresh
+-- 2. A value that changes and changes back within one refresh is not sent
+-- 3. After a client is unmanaged, a window reusing its ID starts with an
+--    empty cache, so its properties are written again
+--
+-- NOTE: This test requires visual mode (HEADLESS=0) because XWayland
+-- needs a display, and xprop to read the properties back.
+---------------------------------------------------------------------------
+
+local runner = require("_runner")
+local x11_client = require("_x11_client")
+local awful = require("awful")
+
+local function is_headless()
+    return os.getenv("WLR_BACKENDS") == "headless"
+end
+
+local function has_xprop()
+    local handle = io.popen("which xprop 2>/dev/null")
+    local result = handle and handle:read("*a") or ""
+    if handle then handle:close() end
+    return result:match("xprop") ~= nil
+end
+
+if is_headless() then
+    io.stderr:write("SKIP: XWayland tests require visual mode (HEADLESS=0)\n")
+    io.stderr:write("Test finished successfully.\n")
+    awesome.quit()
+    return
+end
+
+local app = x11_client.get_app_info()
+if not (app and app.executable == "xterm") or not has_xprop() then
+    io.stderr:write("SKIP: needs xterm and xprop\n")
+    io.stderr:write("Test finished successfully.\n")
+    awesome.quit()
+    return
+end
+
+-- Run xprop without blocking the compositor; the output lands in the
+-- returned table.
+local function xprop(args)
+    local result = {}
+    awful.spawn.easy_async("xprop " .. args, function(out)
+        result.out = out
+    end)
+    return result
+end
+
+local function find_x11_client(class)
+    for _, c in ipairs(client.get()) do
+        if c.class == class and x11_client.is_xwayland(c) then
+            return c
+        end
+    end
+end
+
+local first, second
+local first_window
+local root_query, state_query
+local writes, stable_count
+
+local steps = {
+    -- Step 1: Spawn an X11 client
+    function(count)
+        if count == 1 then
+            x11_client("xw_ewmh_batch")
+        end
+
+        first = find_x11_client("xw_ewmh_batch")
+        if first then return true end
+
+        if count > 50 then
+            error("X11 client did not spawn within timeout")
+        end
+    end,
+
+    -- Step 2: Change a root and a client property
+    function()
+        client.focus = first
+        first.sticky = true
+        return true
+    end,
+
+    -- Step 3: Both reached the X server after the refresh
+    function(count)
+        if count == 1 then
+            root_query = xprop("-root _NET_ACTIVE_WINDOW")
+            state_query = xprop("-id " .. first.window .. " _NET_WM_STATE")
+        end
+
+        if not (root_query.out and state_query.out) then
+            assert(count < 50, "xprop did not finish")
+            return
+        end
+
+        local active = root_query.out:match("window id # (0x%x+)")
+        assert(active and tonumber(active) == first.window, string.format(
+            "_NET_ACTIVE_WINDOW should be 0x%x, got: %s", first.window, root_query.out))
+        assert(state_query.out:match("_NET_WM_STATE_STICKY"),
+            "_NET_WM_STATE should have STICKY, got: " .. state_query.out)
+
+        io.stderr:write("[TEST] PASS: root and client properties written\n")
+        return true
+    end,
+
+    -- Step 4: Wait for the writes to settle
+    function()
+        local now = awesome._test_ewmh_writes
+        if now ~= writes then
+            writes, stable_count = now, 0
+            return
+        end
+
+        stable_count = stable_count + 1
+        if stable_count < 3 then return end
+
+        -- Back to the value the server has, within the same refresh
+        first.sticky = false
+        first.sticky = true
+        return true
+    end,
+
+    -- Step 5: Nothing was sent for it
+    function(count)
+        if count < 3 then return end
+
+        assert(awesome._test_ewmh_writes == writes, string.format(
+            "a value restored within one refresh was written (%d writes)",
+            awesome._test_ewmh_writes - writes))
+
+        io.stderr:write("[TEST] PASS: unchanged value not written\n")
+        return true
+    end,
+
+    -- Step 6: Unmanage the client
+    function(count)
+        if count == 1 then
+            first_window = first.window
+            first:kill()
+        end
+
+        if not find_x11_client("xw_ewmh_batch") then return true end
+
+        if count >= 20 then
+            for _, pid in ipairs(x11_client.get_spawned_pids()) do
+                os.execute("kill -9 " .. pid .. " 2>/dev/null")
+            end
+        end
+    end,
+
+    -- Step 7: Spawn another client; X servers hand out the IDs of a
+    -- disconnected client again, so its window usually reuses the ID
+    function(count)
+        if count == 1 then
+            x11_client("xw_ewmh_batch2")
+        end
+
+        second = find_x11_client("xw_ewmh_batch2")
+        if second then
+            io.stderr:write(string.format("[TEST] Window ID %s\n",
+                second.window == first_window and "reused" or "not reused"))
+            -- What the first window had: a stale cache would skip it
+            second.sticky = true
+            return true
+        end
+
+        if count > 50 then
+            error("second X11 client did not spawn within timeout")
+        end
+    end,
+
+    -- Step 8: The property was written to the new window
+    function(count)
+        if count == 1 then
+            state_query = xprop("-id " .. second.window .. " _NET_WM_STATE")
+        end
+
+        if not state_query.out then
+            assert(count < 50, "xprop did not finish")
+            return
+        end
+
+        assert(state_query.out:match("_NET_WM_STATE_STICKY"),
+            "_NET_WM_STATE of the new window should have STICKY, got: "
+            .. state_query.out)
+
+        io.stderr:write("[TEST] PASS: new window starts with an empty cache\n")
+        return true
+    end,
+
+    -- Step 9: Cleanup
+    function(count)
+        if count == 1 then
+            if second and second.valid then
+                second:kill()
+            end
+            x11_client.terminate()
+        end
+
+        if #client.get() == 0 then
+            return true
+        end
+
+        if count >= 10 then
+            for _, pid in ipairs(x11_client.get_spawned_pids()) do
+                os.execute("kill -9 " .. pid .. " 2>/dev/null")
+            end
+            return true
+        end
+    end,
+}
+
+runner.run_steps(steps, { kill_clients = false })
+
+-- vim: filetype=lua:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:textwidth=80
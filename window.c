@@ -103,6 +103,35 @@ client_scene_node_destroy(Client *c)
 	c->scene = NULL;
 }
 
+void
+client_set_resize(Client *c, uint32_t serial)
+{
+	Monitor *m = serial ? c->mon : NULL;
+
+	/* The resize fence (see rendermon_render()) runs from the first
+	 * configure the client has not acked; newer serials keep it */
+	if (serial && !c->resize) {
+		struct timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		c->resize_ns = (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+		c->resize_fence_expired = false;
+	}
+	c->resize = serial;
+	if (c->resize_mon == m)
+		return;
+	if (c->resize_mon)
+		c->resize_mon->pending_resizes--;
+	if (m)
+		m->pending_resizes++;
+	c->resize_mon = m;
+}
+
+void
+client_resize_mon_update(Client *c)
+{
+	client_set_resize(c, c->resize);
+}
+
 void
 applybounds(Client *c, struct wlr_box *bbox)
 {
@@ -300,7 +329,7 @@ commitnotify(struct wl_listener *listener, void *data)
 	/* mark a pending resize as completed */
 	if (c->resize) {
 		if (c->resize <= c->surface.xdg->current.configure_serial) {
-			c->resize = 0;
+			client_set_resize(c, 0);
 		}
 	}
 
@@ -458,6 +487,7 @@ createnotify(struct wl_listener *listener, void *data)
 	LISTEN(&toplevel->events.request_fullscreen, &c->request_fullscreen, fullscreennotify);
 	LISTEN(&toplevel->events.request_maximize, &c->maximize, maximizenotify);
 	LISTEN(&toplevel->events.set_title, &c->set_title, updatetitle);
+	LISTEN(&toplevel->events.set_app_id, &c->set_app_id, updateappid);
 
 	/* Note: property_register_wayland_listeners() is called in mapnotify() after
 	 * the client is fully registered in Lua. Calling it here would fail because
@@ -467,6 +497,7 @@ createnotify(struct wl_listener *listener, void *data)
 	 * Duplicate client on stack, then take a reference for the array */
 	lua_pushvalue(L, -1);
 	client_array_push(&globalconf.clients, luaA_object_ref(L, -1));
+	client_handle_register(c);
 
 	/* Add to stack (matches AwesomeWM client_manage) */
 	stack_client_push(c);
@@ -541,6 +572,7 @@ client_remove_all_listeners(client_t *c)
 		wl_list_remove(&c->map.link);
 		wl_list_remove(&c->unmap.link);
 		wl_list_remove(&c->maximize.link);
+		wl_list_remove(&c->set_app_id.link);
 	}
 	/* Clean up foreign toplevel handle if not already done by unmapnotify */
 	if (c->toplevel_handle) {
@@ -601,6 +633,7 @@ client_reregister_listeners(client_t *c)
 		LISTEN(&toplevel->events.request_fullscreen, &c->request_fullscreen, fullscreennotify);
 		LISTEN(&toplevel->events.request_maximize, &c->maximize, maximizenotify);
 		LISTEN(&toplevel->events.set_title, &c->set_title, updatetitle);
+		LISTEN(&toplevel->events.set_app_id, &c->set_app_id, updateappid);
 
 		if (c->scene) {
 			/* Mapped: register commit (not initial_commit, since already mapped).
@@ -852,6 +885,7 @@ mapnotify(struct wl_listener *listener, void *data)
 		c->window = c->surface.xwayland->window_id;
 		c->bw = client_is_unmanaged(c) ? 0 : get_border_width();
 		client_array_push(&globalconf.clients, c);
+		client_handle_register(c);
 		stack_client_push(c);
 		luaA_class_emit_signal(globalconf_get_lua_State(),
 			&client_class, "list", 0);
@@ -945,6 +979,7 @@ mapnotify(struct wl_listener *listener, void *data)
 		 * This makes Lua's update_implicitly_floating() detect them as floating,
 		 * allowing user placement code in request::manage to work correctly. */
 		c->type = WINDOW_TYPE_DIALOG;
+		stack_client_changed(c);
 
 		/* Set transient_for so Lua code can access c.transient_for property.
 		 * This is needed for placement rules like awful.placement.centered(c, {parent = c.transient_for}) */
@@ -993,7 +1028,7 @@ mapnotify(struct wl_listener *listener, void *data)
 		 * idle, before the next poll cycle blocks. See schedule_flush_clients
 		 * above and trip-zip/somewm#530 for why this can't run synchronously
 		 * here. */
-		c->resize = 0;
+		client_set_resize(c, 0);
 		apply_geometry_to_wlroots(c);
 		schedule_flush_clients(dpy);
 
@@ -1024,8 +1059,10 @@ mapnotify(struct wl_listener *listener, void *data)
 		 * For native Wayland clients, infer dialog-like float types from the XDG
 		 * parent/size constraints so Lua can treat them as implicitly floating.
 		 * For XWayland clients, keep the type established by X11 properties. */
-		if (c->client_type == XDGShell)
+		if (c->client_type == XDGShell) {
 			c->type = client_is_float_type(c) ? WINDOW_TYPE_DIALOG : WINDOW_TYPE_NORMAL;
+			stack_client_changed(c);
+		}
 
 		/* Determine target monitor (but don't set c->mon yet - setmon() needs to do that) */
 		target_mon = xytomon(c->geometry.x, c->geometry.y);
@@ -1117,7 +1154,7 @@ mapnotify(struct wl_listener *listener, void *data)
 		 * Without this, the client may render at its requested (wrong) size.
 		 * Fixes Firefox tiling issue (#10). Reset c->resize to force re-send
 		 * configure even if setmon()->resize() already queued one. */
-		c->resize = 0;
+		client_set_resize(c, 0);
 		apply_geometry_to_wlroots(c);
 
 		/* Schedule a flush so the encoded configure leaves the kernel buffer
@@ -1340,9 +1377,9 @@ apply_geometry_to_wlroots(Client *c)
 #endif
 		if (c->fullscreen) {
 			/* Fullscreen: client gets full geometry minus borders only */
-			c->resize = client_set_size(c,
+			client_set_resize(c, client_set_size(c,
 					c->geometry.width - 2 * c->bw,
-					c->geometry.height - 2 * c->bw);
+					c->geometry.height - 2 * c->bw));
 		} else {
 			int sw = c->geometry.width - 2 * c->bw
 				- titlebar_left - c->titlebar[CLIENT_TITLEBAR_RIGHT].size;
@@ -1350,7 +1387,7 @@ apply_geometry_to_wlroots(Client *c)
 				- titlebar_top - c->titlebar[CLIENT_TITLEBAR_BOTTOM].size;
 			if (sw < 1) sw = 1;
 			if (sh < 1) sh = 1;
-			c->resize = client_set_size(c, sw, sh);
+			client_set_resize(c, client_set_size(c, sw, sh));
 		}
 	}
 	client_get_clip(c, &clip);
@@ -1558,6 +1595,7 @@ setfullscreen(Client *c, int fullscreen)
 	printstatus();
 
 	/* Refresh stacking order (fullscreen layer changes) */
+	stack_client_changed(c);
 	stack_refresh();
 }
 
@@ -1581,6 +1619,7 @@ setmon(Client *c, Monitor *m, uint32_t newtags)
 
 	c->mon = m;
 	c->prev = c->geometry;
+	client_resize_mon_update(c);
 
 	/* Update c->screen to match c->mon for Lua property access */
 	c->screen = luaA_screen_get_by_monitor(L, m);
@@ -1589,6 +1628,7 @@ setmon(Client *c, Monitor *m, uint32_t newtags)
 	 * This triggers Lua tag management (awful/tag.lua) to assign client
 	 * to tags on the new screen via request::tag signal. */
 	if (c->screen != old_screen) {
+		stack_client_screen_changed(c);
 		luaA_object_push(L, c);
 		if (old_screen != NULL)
 			luaA_object_push(L, old_screen);
@@ -1823,24 +1863,17 @@ void
 updatetitle(struct wl_listener *listener, void *data)
 {
 	Client *c = wl_container_of(listener, c, set_title);
-	lua_State *L;
 
 	/* Guard against stale XWayland client after client_unmanage() */
 	if (c->client_type == X11 && c->window == XCB_NONE)
 		return;
 
-	/* Use new property system for both Wayland and XWayland clients
-	 * Both call client_set_name() which emits property::name signal */
-	if (c->client_type == XDGShell) {
+	/* Both queue the title; property::name is emitted when the event
+	 * queue drains, once per refresh cycle with the latest title */
+	if (c->client_type == XDGShell)
 		property_handle_toplevel_title(listener, data);
-	} else {
-		/* XWayland: extract title from xwayland surface */
-		L = globalconf_get_lua_State();
-		luaA_object_push(L, c);
-		client_set_name(L, -1, c->surface.xwayland->title
-			? strdup(c->surface.xwayland->title) : NULL);
-		lua_pop(L, 1);
-	}
+	else
+		property_queue_name(c, c->surface.xwayland->title);
 
 	if (c == focustop(c->mon))
 		printstatus();
@@ -1852,6 +1885,20 @@ updatetitle(struct wl_listener *listener, void *data)
 	}
 }
 
+void
+updateappid(struct wl_listener *listener, void *data)
+{
+	Client *c = wl_container_of(listener, c, set_app_id);
+
+	/* Queued like the title, see updatetitle() */
+	property_handle_toplevel_app_id(listener, data);
+
+	if (c->toplevel_handle) {
+		const char *app_id = client_get_appid(c);
+		if (app_id)
+			wlr_foreign_toplevel_handle_v1_set_app_id(c->toplevel_handle, app_id);
+	}
+}
 
 void
 zoom(const Arg *arg)
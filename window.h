@@ -30,6 +30,7 @@ void mapnotify(struct wl_listener *listener, void *data);
 void unmapnotify(struct wl_listener *listener, void *data);
 void destroynotify(struct wl_listener *listener, void *data);
 void updatetitle(struct wl_listener *listener, void *data);
+void updateappid(struct wl_listener *listener, void *data);
 void maximizenotify(struct wl_listener *listener, void *data);
 void fullscreennotify(struct wl_listener *listener, void *data);
 
@@ -162,6 +162,7 @@ createnotifyx11(struct wl_listener *listener, void *data)
 	/* Add to global clients array (matches AwesomeWM client_manage line 2202) */
 	lua_pushvalue(L, -1);
 	client_array_push(&globalconf.clients, luaA_object_ref(L, -1));
+	client_handle_register(c);
 
 	/* Add to stack (matches AwesomeWM client_manage) */
 	stack_client_push(c);